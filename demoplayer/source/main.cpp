@@ -17,6 +17,10 @@
 
 const std::wstring EngineFolder = L"engine/main/";
 const std::wstring ShaderExtension = L".shader";
+
+/// Spline baking parameters, see Document::BakeSplines()
+const float SplineBakeSamplesPerBeat = 16.0f;
+const float SplineBakeMaxError = 0.001f;
 //#define FULLSCREEN
 
 /// HACK HACK HACK
@@ -160,26 +164,32 @@ int CALLBACK WinMain(
   LoadEngineShaders();
   RenderTarget* renderTarget = new RenderTarget(ivec2(windowWidth, windowHeight));
 
+  /// Workers for asset decoding and resource updates
+  ThreadPool& threadPool = ThreadPool::GetSharedPool();
+
   /// Load precalc project file
-  char* json = System::ReadFile(L"loading.zen");
-  std::shared_ptr<Document> loading = FromJson(std::string(json));
+  std::shared_ptr<Document> loading =
+    LoadDocument(System::MapFile(L"loading.zen"), &threadPool);
   ASSERT(loading);
-  delete json;
 
   /// Show loading screen
   loading->mMovie.GetNode()->Draw(renderTarget, 0);
   wglSwapLayerBuffers(hdc, WGL_SWAP_MAIN_PLANE);
 
-  /// Load demo file
-  json = System::ReadFile(L"demo.zen");
-  std::shared_ptr<Document> doc = FromJson(std::string(json));
+  /// Load demo file, either JSON or binary. Binary meshes and textures are
+  /// uploaded straight from the mapped file, JSON assets are decoded in parallel.
+  std::shared_ptr<Document> doc = LoadDocument(System::MapFile(L"demo.zen"), &threadPool);
   ASSERT(doc);
-  delete json;
 
   /// Compile shaders, upload resources
-  std::vector<std::shared_ptr<Node>> nodes;
-  doc->GenerateTransitiveClosure(nodes, true);
-  for (const auto& node : nodes) node->Update();
+  doc->UpdateDependencies(&threadPool);
+
+  /// Replace spline evaluation with table lookups
+  const Document::SplineBakeStatistics bakeStatistics =
+    doc->BakeSplines(SplineBakeSamplesPerBeat, SplineBakeMaxError);
+  INFO("Baked %d splines (%d samples, max error %f), %d splines kept analytic",
+    bakeStatistics.mBakedCount, bakeStatistics.mSampleCount, bakeStatistics.mMaxError,
+    bakeStatistics.mSkippedCount);
 
   /// No more OpenGL resources should be allocated after this point
   //PleaseNoNewResources = true;
@@ -223,7 +233,7 @@ int CALLBACK WinMain(
       time = beatsPerSecond * float(timeGetTime() - startTime) / 1000.0f;
     }
     if (time > movieLength) break;
-    GlobalTimeNode::OnTimeChanged(time);
+    GlobalTimeNode::SetGlobalTime(time);
 
     /// Render demo frame
     movieNode->Draw(renderTarget, time);
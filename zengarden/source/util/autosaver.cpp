@@ -0,0 +1,169 @@
+#include "autosaver.h"
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSaveFile>
+#include <algorithm>
+
+/// Journals are compacted when they reach half the snapshot size, or this size
+static const qint64 MinCompactedJournalSize = 1024 * 1024;
+
+static QString GetJournalFileName(const QString& fileName) {
+  return fileName + ".journal";
+}
+
+static QString GetCompactingFileName(const QString& fileName) {
+  return fileName + ".compacting";
+}
+
+/// Returns an empty array if the file doesn't exist
+static QByteArray ReadAll(const QString& fileName) {
+  QFile file(fileName);
+  if (!file.open(QFile::ReadOnly)) return QByteArray();
+  return file.readAll();
+}
+
+/// Replaces the file only after the whole content is written
+static bool WriteAll(const QString& fileName, const std::string& content) {
+  QSaveFile file(fileName);
+  if (!file.open(QIODevice::WriteOnly)) return false;
+  file.write(content.c_str(), qint64(content.size()));
+  return file.commit();
+}
+
+Autosaver::Autosaver(const std::shared_ptr<Document>& document, const QString& fileName)
+  : mJournal(document, MeshArrayEncoding::BINARY, BlobCompression::ZSTD)
+  , mFileName(fileName)
+{}
+
+Autosaver::~Autosaver() {
+  WaitForWorker();
+  SaveChanges();
+  WaitForWorker();
+}
+
+void Autosaver::Save() {
+  WaitForWorker();
+
+  /// Journal records written from now on follow this snapshot
+  mCapture = mJournal.CaptureSnapshot();
+  mHasSnapshot = true;
+  mJournalSize = 0;
+
+  JSONCapture* capture = mCapture.get();
+  const QString fileName = mFileName;
+  StartWorker([capture, fileName]() {
+    return WriteSnapshot(fileName, capture);
+  });
+}
+
+void Autosaver::SaveChanges() {
+  if (!mJournal.HasChanges()) return;
+  JoinWorker();
+
+  /// Changes stay collected until the snapshot they follow is written
+  if (mCapture) return;
+
+  if (!mHasSnapshot) {
+    Save();
+    return;
+  }
+
+  const std::string records = mJournal.GetRecords();
+  QFile journal(GetJournalFileName(mFileName));
+  if (!journal.open(QIODevice::WriteOnly | QIODevice::Append) ||
+    journal.write(records.c_str(), qint64(records.size())) != qint64(records.size()))
+  {
+    /// These changes are lost from the journal, the next save writes everything
+    ERR("Can't write journal of %s", mFileName.toLatin1().data());
+    mHasSnapshot = false;
+    return;
+  }
+  mJournalSize += qint64(records.size());
+
+  if (mWorkerThread.joinable()) return;
+  if (mJournalSize >= std::max(mSnapshotSize / 2, MinCompactedJournalSize)) {
+    StartCompaction();
+  }
+}
+
+void Autosaver::StartCompaction() {
+  /// Records written from now on go to a new journal
+  const QString compactingFileName = GetCompactingFileName(mFileName);
+  if (!QFile::rename(GetJournalFileName(mFileName), compactingFileName)) return;
+  mJournalSize = 0;
+
+  const QString fileName = mFileName;
+  StartWorker([fileName]() { return Compact(fileName); });
+}
+
+void Autosaver::StartWorker(std::function<bool()> job) {
+  ASSERT(!mWorkerThread.joinable());
+  mIsWorking = true;
+  mWorkerThread = std::thread([this, job]() {
+    mWorkerFailed = !job();
+    mIsWorking = false;
+  });
+}
+
+void Autosaver::JoinWorker() {
+  if (!mIsWorking) WaitForWorker();
+}
+
+void Autosaver::WaitForWorker() {
+  if (!mWorkerThread.joinable()) return;
+  mWorkerThread.join();
+  mCapture.reset();
+
+  /// The journal can't be replayed over a snapshot that wasn't written, or
+  /// over a compaction that failed, the next save writes everything
+  if (mWorkerFailed) mHasSnapshot = false;
+  mSnapshotSize = QFileInfo(mFileName).size();
+}
+
+bool Autosaver::WriteSnapshot(const QString& fileName, JSONCapture* capture) {
+  if (!WriteAll(fileName, capture->GetJSON())) {
+    ERR("Can't write file: %s", fileName.toLatin1().data());
+    return false;
+  }
+  QFile::remove(GetJournalFileName(fileName));
+  QFile::remove(GetCompactingFileName(fileName));
+  return true;
+}
+
+bool Autosaver::Compact(const QString& fileName) {
+  const QString compactingFileName = GetCompactingFileName(fileName);
+  const QByteArray snapshot = ReadAll(fileName);
+  const QByteArray journal = ReadAll(compactingFileName);
+  const std::string json = DocumentJournal::Compact(
+    snapshot.data(), size_t(snapshot.size()), journal.data(), size_t(journal.size()));
+  if (json.empty() || !WriteAll(fileName, json)) {
+    ERR("Can't compact journal of %s", fileName.toLatin1().data());
+    return false;
+  }
+
+  /// Replaying these records again would be harmless, the snapshot has them
+  QFile::remove(compactingFileName);
+  return true;
+}
+
+QByteArray Autosaver::ReadDocument(const QString& fileName) {
+  const QByteArray snapshot = ReadAll(fileName);
+  if (snapshot.isEmpty() || IsBinaryDocument(snapshot.data(), size_t(snapshot.size())) ||
+    IsCompressedDocument(snapshot.data(), size_t(snapshot.size())))
+  {
+    return snapshot;
+  }
+
+  /// Records of an interrupted compaction come before the newer ones
+  const QByteArray journal =
+    ReadAll(GetCompactingFileName(fileName)) + ReadAll(GetJournalFileName(fileName));
+  if (journal.isEmpty()) return snapshot;
+
+  const std::string json = DocumentJournal::Compact(
+    snapshot.data(), size_t(snapshot.size()), journal.data(), size_t(journal.size()));
+  if (json.empty()) {
+    WARN("Can't replay journal of %s", fileName.toLatin1().data());
+    return snapshot;
+  }
+  return QByteArray(json.c_str(), int(json.size()));
+}
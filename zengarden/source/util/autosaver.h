@@ -0,0 +1,74 @@
+#pragma once
+
+#include <zengine.h>
+#include <QtCore/QString>
+#include <QtCore/QByteArray>
+#include <thread>
+#include <atomic>
+#include <functional>
+
+/// Incremental saving of a JSON document, see DocumentJournal. Saving changes
+/// appends the changed nodes to a journal next to the document file. When the
+/// journal grows too large, a background thread compacts it into the document.
+/// Snapshots are captured on the main thread and written on the same background
+/// thread, so editing can go on while a large document is encoded. Meshes and
+/// textures are saved zstd compressed.
+///
+/// Files next to "name.zen":
+///   name.zen.journal     records written since the last snapshot
+///   name.zen.compacting  records being merged into the snapshot
+class Autosaver {
+public:
+  Autosaver(const std::shared_ptr<Document>& document, const QString& fileName);
+  /// Finishes writing, including the changes not saved yet
+  ~Autosaver();
+
+  /// Captures a complete snapshot. It's written in the background, then the
+  /// journal is removed.
+  void Save();
+
+  /// Appends the changes since the last save to the journal
+  void SaveChanges();
+
+  /// Reads a document file with its journal replayed. Binary and compressed
+  /// documents have no journal, they are returned as they are.
+  static QByteArray ReadDocument(const QString& fileName);
+
+private:
+  /// Moves the journal aside and merges it into the snapshot on mWorkerThread
+  void StartCompaction();
+
+  /// Runs a job on mWorkerThread, the previous one must have been joined. The
+  /// job returns false if it failed.
+  void StartWorker(std::function<bool()> job);
+
+  /// Joins mWorkerThread if it's finished
+  void JoinWorker();
+
+  /// Joins mWorkerThread, waiting for the job to finish
+  void WaitForWorker();
+
+  /// Run on mWorkerThread
+  static bool WriteSnapshot(const QString& fileName, JSONCapture* capture);
+  static bool Compact(const QString& fileName);
+
+  DocumentJournal mJournal;
+  const QString mFileName;
+
+  /// The journal doesn't know the node IDs of a loaded file, so the first save
+  /// after opening writes a snapshot
+  bool mHasSnapshot = false;
+
+  qint64 mSnapshotSize = 0;
+  qint64 mJournalSize = 0;
+
+  std::thread mWorkerThread;
+  std::atomic<bool> mIsWorking{ false };
+
+  /// Set by the worker, read after joining
+  bool mWorkerFailed = false;
+
+  /// Snapshot being written. Released on the main thread after the worker is
+  /// joined, it may hold the last reference to a mesh.
+  std::shared_ptr<JSONCapture> mCapture;
+};
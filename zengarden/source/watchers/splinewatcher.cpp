@@ -351,6 +351,8 @@ QPointF FloatSplineWatcher::GetPixelsPerStep() const
 }
 
 static QPointF drawPoints[10000 * 2];
+static float drawSampleTimes[10000];
+static float drawSampleValues[10000];
 
 void FloatSplineWatcher::DrawSpline(QPaintEvent* ev) const {
   QPainter painter(mSplineWidget);
@@ -399,11 +401,14 @@ void FloatSplineWatcher::DrawSpline(QPaintEvent* ev) const {
   const float heightHalf = 0.5f * float(mSplineWidget->height());
   float t = mLeftCenterPoint.x;
   for (UINT i = 0; i < sampleCount; i++) {
-    const float splineVal = spline->GetValue(t);
-    const float y = (splineVal - mLeftCenterPoint.y) * ppsy + heightHalf;
+    drawSampleTimes[i] = t;
+    t += spp.x;
+  }
+  spline->GetValues(drawSampleTimes, drawSampleValues, sampleCount);
+  for (UINT i = 0; i < sampleCount; i++) {
+    const float y = (drawSampleValues[i] - mLeftCenterPoint.y) * ppsy + heightHalf;
     drawPoints[i * 2] = QPointF(float(i), y);
     drawPoints[i * 2 + 1] = QPointF(float(i), y);
-    t += spp.x;
   }
   painter.drawLines(drawPoints + 1, sampleCount - 1);
 
@@ -443,11 +448,14 @@ void FloatSplineWatcher::DrawSplineComponentControl(
   const float heightHalf = 0.5f * float(mSplineWidget->height());
   float t = mLeftCenterPoint.x;
   for (UINT i = 0; i < sampleCount; i++) {
-    const float splineVal = component->Get(t);
-    const float y = (splineVal - mLeftCenterPoint.y) * ppsy + heightHalf;
+    drawSampleTimes[i] = t;
+    t += spp.x;
+  }
+  component->GetValues(drawSampleTimes, drawSampleValues, sampleCount);
+  for (UINT i = 0; i < sampleCount; i++) {
+    const float y = (drawSampleValues[i] - mLeftCenterPoint.y) * ppsy + heightHalf;
     drawPoints[i * 2] = QPointF(float(i), y);
     drawPoints[i * 2 + 1] = QPointF(float(i), y);
-    t += spp.x;
   }
   painter.drawLines(drawPoints + 1, sampleCount - 1);
 
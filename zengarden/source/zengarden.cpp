@@ -23,6 +23,9 @@
 
 static ZenGarden* gZengarden;
 
+/// Time between saving changes to the journal, in milliseconds
+static const int AutosaveInterval = 5000;
+
 ZenGarden::ZenGarden(QWidget *parent)
   : QMainWindow(parent)
 {
@@ -44,6 +47,8 @@ ZenGarden::ZenGarden(QWidget *parent)
   connect(mUI.actionOpen, SIGNAL(triggered()), this, SLOT(HandleMenuOpen()));
   connect(mUI.actionDocumentProperties, SIGNAL(triggered()), this,
     SLOT(HandlePropertiesMenu()));
+  connect(&mAutosaveTimer, SIGNAL(timeout()), this, SLOT(HandleAutosave()));
+  mAutosaveTimer.start(AutosaveInterval);
 
   mUI.timelineWidget->hide();
 
@@ -375,28 +380,58 @@ void ZenGarden::SetupMovieWatcher() {
 
 void ZenGarden::HandleMenuSaveAs() {
   const QString fileName = QFileDialog::getSaveFileName(this,
-    tr("Open project"), "app", tr("Zengine project (*.zen)"));
+    tr("Open project"), "app",
+    tr("Zengine project (*.zen);;Zengine binary project (*.zenb);;"
+      "Zengine compressed project (*.zenz)"));
+  if (fileName.isEmpty()) return;
 
   INFO("Saving document...");
   QTime myTimer;
   myTimer.start();
-  const std::string json = ToJson(mDocument);
-  QFile file(fileName);
-  file.open(QIODevice::WriteOnly);
-  file.write(json.c_str());
+  SafeDelete(mAutosaver);
+
+  /// Textures that only live in GPU memory are read back when serialized
+  mCommonGLWidget->makeCurrent();
+  if (fileName.endsWith(".zenb", Qt::CaseInsensitive)) {
+    QFile file(fileName);
+    file.open(QIODevice::WriteOnly);
+    const std::vector<char> binary = ToBinary(mDocument);
+    file.write(binary.data(), binary.size());
+  }
+  else if (fileName.endsWith(".zenz", Qt::CaseInsensitive)) {
+    /// Whole-file compression on top of compressed blobs, meant for playback,
+    /// so static meshes are saved optimized for rendering too
+    QFile file(fileName);
+    file.open(QIODevice::WriteOnly);
+    const std::string json = ToJson(mDocument, MeshArrayEncoding::BINARY,
+      BlobCompression::ZSTD, MeshOptimization::OPTIMIZE);
+    const std::vector<char> compressed =
+      CompressDocument(json.c_str(), json.size(), &ThreadPool::GetSharedPool());
+    file.write(compressed.data(), compressed.size());
+  }
+  else {
+    /// Later changes are saved to the journal
+    mAutosaver = new Autosaver(mDocument, fileName);
+    mAutosaver->Save();
+  }
 
   const int milliseconds = myTimer.elapsed();
   INFO("Document saved in %.3f seconds.", float(milliseconds) / 1000.0f);
   mDocumentFileName = fileName;
 }
 
+void ZenGarden::HandleAutosave() {
+  mCommonGLWidget->makeCurrent();
+  if (mAutosaver) mAutosaver->SaveChanges();
+}
+
 void ZenGarden::Tick() {
   const float elapsedBeats = GetElapsedBeats();
   if (mPlayMovie) {
     mMovieCursor = elapsedBeats - mMovieStartBeat;
     mOnMovieCursorChange(mMovieCursor);
   }
-  GlobalTimeNode::OnTimeChanged(elapsedBeats);
+  GlobalTimeNode::SetGlobalTime(elapsedBeats);
   QTimer::singleShot(10, this, SLOT(Tick()));
 }
 
@@ -406,20 +441,24 @@ void ZenGarden::HandleMenuNew() {
 
 void ZenGarden::HandleMenuOpen() {
   const QString fileName = QFileDialog::getOpenFileName(this,
-    tr("Open project"), "app", tr("Zengine project (*.zen)"));
+    tr("Open project"), "app", tr("Zengine project (*.zen *.zenb *.zenz)"));
   if (fileName.isEmpty()) return;
 
   /// Measure load time
   QTime myTimer;
   myTimer.start();
 
-  /// Load file content
-  const std::unique_ptr<char> json = std::unique_ptr<char>(Util::ReadFileQt(fileName));
-  if (json == nullptr) return;
+  /// Load file content, with the autosave journal replayed
+  const QByteArray content = Autosaver::ReadDocument(fileName);
+  if (content.isEmpty()) {
+    ERR("Can't open file: %s", fileName.toLatin1().data());
+    return;
+  }
 
-  /// Parse file into a Document
+  /// Parse file into a Document, JSON or binary
   mCommonGLWidget->makeCurrent();
-  const std::shared_ptr<Document> document = FromJson(std::string(json.get()));
+  const std::shared_ptr<Document> document =
+    LoadDocument(content.data(), content.size(), &ThreadPool::GetSharedPool());
   if (document == nullptr) return;
 
   /// Load succeeded, remove old document
@@ -438,6 +477,12 @@ void ZenGarden::HandleMenuOpen() {
     mDocument->mProperties.Connect(std::make_shared<PropertiesNode>());
   }
 
+  if (!IsBinaryDocument(content.data(), content.size()) &&
+    !IsCompressedDocument(content.data(), content.size()))
+  {
+    mAutosaver = new Autosaver(mDocument, fileName);
+  }
+
   /// Open "debug" node first -- nvidia Nsight workaround, it can only debug the
   /// first OpenGL window
   std::vector<std::shared_ptr<Node>> nodes;
@@ -462,6 +507,7 @@ void ZenGarden::HandlePropertiesMenu() {
 
 void ZenGarden::DeleteDocument() {
   if (!mDocument) return;
+  SafeDelete(mAutosaver);
   mCommonGLWidget->makeCurrent();
 
   std::vector<std::shared_ptr<Node>> nodes;
@@ -5,8 +5,10 @@
 #include "watchers/documentwatcher.h"
 #include "watchers/logwatcher.h"
 #include "watchers/watcherwidget.h"
+#include "util/autosaver.h"
 #include <zengine.h>
 #include <QtCore/QTime>
+#include <QtCore/QTimer>
 #include <QtCore/QDir>
 
 class ZenGarden: public QMainWindow {
@@ -66,7 +68,11 @@ private:
   std::shared_ptr<Document> mDocument;
   DocumentWatcher* mDocumentWatcher = nullptr;
   QString mDocumentFileName;
-  
+
+  /// Incremental saving of the current document, JSON documents only
+  Autosaver* mAutosaver = nullptr;
+  QTimer mAutosaveTimer;
+
   /// When creating a new Graph, this number will be its index
   UINT mNextGraphIndex = 0;
 
@@ -113,6 +119,7 @@ private slots:
 
   /// Menu buttons
   void HandleMenuSaveAs();
+  void HandleAutosave();
   void HandleMenuNew();
   void HandleMenuOpen();
   void HandlePropertiesMenu();
@@ -2,6 +2,7 @@
 #include "system.h"
 #include <memory>
 #include <string_view>
+#include <mutex>
 
 using std::string_view;
 
@@ -57,6 +58,7 @@ T SafeCastAllowNull(K object) {
 /// Logging facility 
 class Document;
 class Logger;
+class ThreadPool;
 extern Logger* TheLogger;
 
 #define __STR2WSTR(str) L##str
@@ -102,6 +104,10 @@ public:
 
   /// Events
   Event<LogMessage> onLog;
+
+private:
+  /// Logging may happen on worker threads, see ParallelEvaluator
+  std::mutex mMutex;
 };
 
 
@@ -145,5 +151,64 @@ namespace Convert {
   std::string WstringToString(const std::wstring& sourceString);
 }
 
-std::string ToJson(const std::shared_ptr<Document>& document);
+/// Encoding of mesh vertex and index arrays in JSON documents, see
+/// serialize/json/compactarrays.h
+enum class MeshArrayEncoding {
+  /// Arrays of JSON numbers
+  NUMBERS,
+  /// Little-endian binary in base64, lossless
+  BINARY,
+  /// Vertex floats quantized to 16 bits, indices as BINARY
+  QUANTIZED,
+};
+
+/// Compression of the base64 blobs in JSON documents: texels and compact mesh
+/// arrays. Compressed blobs are decompressed in parallel on load.
+enum class BlobCompression {
+  NONE,
+  ZSTD,
+};
+
+/// Index and vertex order optimization of static meshes when saving, see
+/// resources/meshoptimizer.h. Saved meshes are optimized copies, the document
+/// doesn't change.
+enum class MeshOptimization {
+  NONE,
+  OPTIMIZE,
+};
+
+std::string ToJson(const std::shared_ptr<Document>& document,
+  MeshArrayEncoding meshArrayEncoding = MeshArrayEncoding::BINARY,
+  BlobCompression blobCompression = BlobCompression::NONE,
+  MeshOptimization meshOptimization = MeshOptimization::NONE);
 std::shared_ptr<Document> FromJson(const std::string& json);
+
+/// Loads JSON without building a DOM, see JSONStreamDeserializer. Embedded
+/// assets are decoded on the thread pool when given.
+std::shared_ptr<Document> FromJsonStream(const char* json, size_t size,
+  ThreadPool* threadPool = nullptr);
+
+/// Binary document format, see serialize/binary/binaryformat.h
+std::vector<char> ToBinary(const std::shared_ptr<Document>& document);
+std::shared_ptr<Document> FromBinary(const char* data, size_t size);
+
+/// Zero-copy load, meshes and textures are created straight from the mapped
+/// file. Meant for playback: textures keep no CPU-side copy for saving.
+std::shared_ptr<Document> FromBinary(const std::shared_ptr<MappedFile>& file);
+bool IsBinaryDocument(const char* data, size_t size);
+
+/// Whole-file zstd compression of a JSON or binary document. The result is a
+/// sequence of frames that are decompressed in parallel on load.
+std::vector<char> CompressDocument(const char* data, size_t size,
+  ThreadPool* threadPool = nullptr);
+bool IsCompressedDocument(const char* data, size_t size);
+
+/// Loads a document in JSON or binary format, compressed or not
+std::shared_ptr<Document> LoadDocument(const char* data, size_t size,
+  ThreadPool* threadPool = nullptr);
+std::shared_ptr<Document> LoadDocument(const std::shared_ptr<MappedFile>& file,
+  ThreadPool* threadPool = nullptr);
+
+/// Format converters, return an empty result when the source doesn't load
+std::vector<char> ConvertJsonToBinary(const std::string& json);
+std::string ConvertBinaryToJson(const char* data, size_t size);
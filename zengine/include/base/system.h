@@ -7,12 +7,38 @@
 #include <set>
 #include <vector>
 #include <string>
+#include <memory>
 
 using namespace fastdelegate;
 
+/// Read-only memory mapped file. The mapping lives as long as the object.
+class MappedFile {
+  friend class System;
+
+public:
+  ~MappedFile();
+
+  const char* GetData() const;
+  size_t GetSize() const;
+
+private:
+  MappedFile() = default;
+
+  /// Windows handles
+  void* mFile = nullptr;
+  void* mMapping = nullptr;
+
+  const char* mData = nullptr;
+  size_t mSize = 0;
+};
+
 class System {
 public:
-  static OWNERSHIP char* ReadFile(const wchar_t* fileName);
+  /// Returns null-terminated file content, optionally its size without the terminator
+  static OWNERSHIP char* ReadFile(const wchar_t* fileName, size_t* oFileSize = nullptr);
+
+  /// Maps a file into memory without reading it, returns nullptr on failure
+  static std::shared_ptr<MappedFile> MapFile(const wchar_t* fileName);
 
   static void ReadFilesInFolder(const wchar_t* folder, const wchar_t* extension, 
                                 std::vector<std::wstring>& oFileList);
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "defines.h"
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+/// Work-stealing thread pool. Every worker has its own task queue, idle workers
+/// steal tasks from the other queues. The thread waiting for the tasks takes part
+/// in the work too.
+///
+/// ParallelFor only waits for its own jobs, so it can be called from several
+/// threads at once, and from tasks of the same pool.
+class ThreadPool {
+public:
+  typedef std::function<void()> Task;
+
+  /// Zero worker count means one worker for each hardware thread except the 
+  /// calling one.
+  explicit ThreadPool(UINT workerCount = 0);
+  ~ThreadPool();
+
+  /// Pool used by the engine and the applications, created on first use.
+  /// Sharing one pool keeps the number of busy threads at the hardware limit.
+  static ThreadPool& GetSharedPool();
+
+  /// Schedules a task. Tasks submitted from a worker go to its own queue.
+  void Submit(Task task);
+
+  /// Helps running tasks until all submitted tasks are finished.
+  /// Must not be called from a task.
+  void WaitAll();
+
+  /// Calls job(i) for every i in [0, count) and waits for all of them, helping
+  /// with queued tasks meanwhile
+  void ParallelFor(UINT count, const std::function<void(UINT)>& job);
+
+  /// Number of worker threads, not counting the waiting thread
+  UINT GetWorkerCount() const;
+
+private:
+  struct WorkQueue {
+    std::mutex mMutex;
+    std::deque<Task> mTasks;
+  };
+
+  void WorkerMain(UINT queueIndex);
+
+  /// Pops a task from the queue's back, or steals one from other queues' front
+  bool TryGetTask(UINT queueIndex, Task& oTask);
+
+  void RunTask(Task& task);
+
+  /// Runs queued tasks until the counter of the caller's jobs gets to zero
+  void Wait(const std::atomic<UINT>& remainingJobCount);
+
+  /// Queue #0 belongs to the waiting thread, the rest to the workers
+  std::vector<std::unique_ptr<WorkQueue>> mQueues;
+  std::vector<std::thread> mWorkers;
+
+  /// Tasks in queues, not taken yet
+  std::atomic<UINT> mQueuedTaskCount{ 0 };
+
+  /// Tasks not finished yet
+  std::atomic<UINT> mPendingTaskCount{ 0 };
+
+  /// Round-robin queue selection for tasks submitted by non-worker threads
+  std::atomic<UINT> mNextQueue{ 0 };
+
+  std::mutex mSignalMutex;
+  std::condition_variable mTaskAvailable;
+
+  /// Wakes waiting threads when tasks finish or get queued
+  std::condition_variable mWaitSignal;
+  bool mIsShuttingDown = false;
+};
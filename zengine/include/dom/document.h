@@ -2,6 +2,8 @@
 
 #include "node.h"
 #include "graph.h"
+#include "schedule.h"
+#include "../base/threadpool.h"
 #include "../nodes/movienode.h"
 #include "../nodes/propertiesnode.h"
 
@@ -13,4 +15,31 @@ public:
   MovieSlot mMovie;
 
   PropertiesSlot mProperties;
+
+  /// Evaluates every node of the document, eg. compiles shaders and uploads
+  /// resources after loading. Uses parallel evaluation if a thread pool is given.
+  void UpdateDependencies(ThreadPool* threadPool = nullptr);
+
+  struct SplineBakeStatistics {
+    UINT mBakedCount = 0;
+
+    /// Splines that couldn't be baked within the error limit
+    UINT mSkippedCount = 0;
+
+    /// Total number of samples in lookup tables
+    UINT mSampleCount = 0;
+
+    /// Largest error of baked splines
+    float mMaxError = 0.0f;
+  };
+
+  /// Bakes every spline into a lookup table over the movie length, see 
+  /// FloatSplineNode::Bake(). Meant for playback, when nothing is edited anymore.
+  SplineBakeStatistics BakeSplines(float samplesPerBeat, float maxError);
+
+protected:
+  void HandleMessage(Message* message) override;
+
+private:
+  EvaluationSchedule mSchedule{ this, true };
 };
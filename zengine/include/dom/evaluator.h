@@ -0,0 +1,34 @@
+#pragma once
+
+#include "node.h"
+#include "../base/threadpool.h"
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+/// Opt-in multithreaded evaluation of a dependency graph. Nodes are grouped
+/// into wavefronts of mutually independent nodes, and each wavefront is
+/// evaluated on a thread pool. Nodes pinned to the main thread (see
+/// Node::GetThreadAffinity) are operated on the calling thread after the 
+/// workers finished their part of the wavefront.
+class ParallelEvaluator {
+public:
+  explicit ParallelEvaluator(ThreadPool* threadPool);
+
+  /// Evaluates all nodes that aren't up to date. The nodes must be in 
+  /// topological order, as returned by Node::GenerateTransitiveClosure.
+  void Update(const std::vector<std::shared_ptr<Node>>& topologicalOrder);
+
+private:
+  /// Assigns every node to the wavefront after its deepest dependency
+  void BuildWavefronts(const std::vector<std::shared_ptr<Node>>& topologicalOrder);
+
+  void EvaluateWavefront(const std::vector<Node*>& wavefront);
+
+  ThreadPool* const mThreadPool;
+
+  /// Buffers reused between updates
+  std::unordered_map<Node*, UINT> mWavefrontIndices;
+  std::vector<std::vector<Node*>> mWavefronts;
+  std::vector<Node*> mWorkerNodes;
+};
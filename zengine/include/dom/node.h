@@ -7,7 +7,7 @@
 #include <vector>
 #include <set>
 #include <memory>
-#include <deque>
+#include <unordered_map>
 
 using namespace fastdelegate;
 
@@ -59,13 +59,40 @@ enum class MessageType {
   SCENE_TIME_EDITED,
 };
 
+
+/// Threads the evaluation of a node may run on, see ParallelEvaluator. The 
+/// inputs are brought up to date on the main thread, code running on other 
+/// threads reads them with ValueSlot::GetCurrentValue().
+enum class ThreadAffinity {
+  /// Prepare() and Operate() must run on the main thread, eg. they use OpenGL
+  /// or send messages
+  MAIN_THREAD,
+
+  /// Prepare() may run on any thread, Operate() must run on the main thread
+  PREPARE_ON_ANY_THREAD,
+
+  /// Prepare() and Operate() may run on any thread
+  ANY_THREAD,
+};
+
 struct Message {
   std::shared_ptr<Node> mSource;
   std::shared_ptr<Node> mTarget;
   Slot* mSlot;
   MessageType mType;
+};
+
+
+/// A message waiting in the queue. Only raw pointers are stored to avoid refcount
+/// traffic, nodes remove themselves from the queue when they are destroyed.
+struct QueuedMessage {
+  Node* mSource;
+  Node* mTarget;
+  Slot* mSlot;
+  MessageType mType;
 
-  bool operator < (const Message& other) const;
+  bool operator == (const QueuedMessage& other) const;
+  size_t Hash() const;
 };
 
 
@@ -76,13 +103,100 @@ public:
   void Enqueue(const std::shared_ptr<Node>& source, const std::shared_ptr<Node>& target, 
     MessageType type, Slot* slot = nullptr);
 
+  /// Starts a batch. Messages are queued but not delivered until the outermost
+  /// batch is committed, so repeated notifications of the same dependants 
+  /// (eg. a time change fanning out to many splines) are merged into one.
+  /// At commit, messages are delivered in topological order of their targets:
+  /// a node only receives its messages after every pending node upstream of it
+  /// did, so it propagates the change once. Batches can be nested. A time tick
+  /// batch only carries time changes, dependants can tell them apart from edits
+  /// using IsDeliveringTimeTick().
+  void BeginBatch(bool isTimeTick = false);
+  void CommitBatch();
+
+  /// True while the messages of a time tick batch are being delivered
+  bool IsDeliveringTimeTick() const;
+
+  /// Message counters for profiling
+  struct Statistics {
+    /// Messages delivered to nodes
+    UINT mDeliveredCount = 0;
+
+    /// Messages dropped because an identical one was already pending
+    UINT mMergedCount = 0;
+  };
+  const Statistics& GetStatistics() const;
+  void ResetStatistics();
+
+  /// Fires for every delivered message, right before the target receives it.
+  /// Lets the editor observe edits, see DocumentJournal.
+  Event<Message*> mOnMessageDelivered;
+
 private:
-  std::set<Message> mMessageSet;
-  std::deque<Message> mMessageQueue;
+  /// Pending messages in FIFO order. Capacity is always a power of two.
+  /// Entries with a null mTarget are tombstones of removed messages.
+  std::vector<QueuedMessage> mRing;
+  UINT mRingHead = 0;
+  UINT mRingCount = 0;
+
+  /// Open-addressed hash set (linear probing) of pending messages, used for
+  /// deduplication. Capacity is always a power of two, null mTarget means empty.
+  std::vector<QueuedMessage> mDedupTable;
+  UINT mDedupCount = 0;
+
   bool mIsInProgress = false;
 
+  /// Depth of nested batches
+  UINT mBatchDepth = 0;
+
+  /// True if all open batches are time ticks
+  bool mIsTimeTickBatch = false;
+  bool mIsDeliveringTimeTick = false;
+
+  Statistics mStatistics;
+
+  /// Topological levels of the pending targets and the nodes downstream of 
+  /// them, see ProcessMessagesInTopologicalOrder. Buffers reused between batches.
+  std::unordered_map<Node*, UINT> mTopologicalLevels;
+  std::unordered_map<Node*, UINT> mInputCounts;
+  std::vector<Node*> mReachableNodes;
+
+  /// Cleared when the graph changes while a batch is being delivered
+  bool mAreTopologicalLevelsValid = false;
+
+  /// Delivers messages in FIFO order
   void ProcessAllMessages();
+
+  /// Delivers messages level by level, see BeginBatch
+  void ProcessMessagesInTopologicalOrder();
+
+  /// Lowest level of the pending targets. Calculates the levels again if they
+  /// are invalid or miss a target.
+  UINT GetMinimumPendingLevel();
+  void CalculateTopologicalLevels();
+  UINT GetTopologicalLevel(Node* node) const;
+
+  void Deliver(const QueuedMessage& queued);
+
+  /// Tombstones the messages of a destroyed node. Free for nodes without
+  /// pending messages, otherwise scans the ring until the last one is found.
   void RemoveNode(Node* node);
+
+  void PushBack(const QueuedMessage& message);
+  QueuedMessage PopFront();
+
+  /// Appends a message that is already counted, eg. a popped one
+  void Requeue(const QueuedMessage& message);
+  void GrowRing();
+
+  /// Dedup table operations. Insert returns false if the message was already there.
+  bool InsertToDedupTable(const QueuedMessage& message);
+  void RemoveFromDedupTable(const QueuedMessage& message);
+  void GrowDedupTable();
+
+  /// Maintains the per-node counters of pending messages
+  static void AddReference(const QueuedMessage& message);
+  static void RemoveReference(const QueuedMessage& message);
 };
 
 
@@ -126,6 +240,11 @@ public:
   /// Returns the 'index'th connected node reference (only for multislot)
   std::shared_ptr<Node> GetReferencedMultiNode(UINT index) const;
 
+  /// Non-owning versions of GetReferencedNode() and GetReferencedMultiNode(),
+  /// without reference counting. Use these for per-frame reads.
+  Node* GetReferencedNodeRaw() const;
+  Node* GetReferencedMultiNodeRaw(UINT index) const;
+
   /// Returns the multinodes *without* forwarding,
   /// ie. not calling Node::GetReferencedNode()
   const std::vector<std::shared_ptr<Node>>& GetDirectMultiNodes() const;
@@ -170,6 +289,8 @@ class Node: public std::enable_shared_from_this<Node> {
   friend class Slot;
   friend class Watcher;
   friend class MessageQueue;
+  friend class EvaluationSchedule;
+  friend class ParallelEvaluator;
   template<typename T> friend class ValueSlot;
 
 public:
@@ -192,8 +313,20 @@ public:
   /// - Composite nodes have internal, hidden nodes that do the heavy lifting
   virtual std::shared_ptr<Node> GetReferencedNode();
 
+  /// Non-owning version of GetReferencedNode(). Only forwarder nodes pay for
+  /// reference counting, they own the nodes they refer to.
+  Node* GetReferencedNodeRaw();
+
   virtual bool IsGhostNode();
 
+  /// Node trait for parallel evaluation. Nodes are pinned to the main thread
+  /// unless they declare otherwise.
+  virtual ThreadAffinity GetThreadAffinity() const;
+
+  /// True for nodes whose value changes every frame, eg. time nodes.
+  /// Everything not depending on a time source is static between edits.
+  virtual bool IsTimeSource() const;
+
   /// Disconnects all outgoing connections
   void Dispose();
 
@@ -207,9 +340,20 @@ protected:
   /// True is all slots are properly connected
   bool mIsProperlyConnected;
 
+  /// True if GetReferencedNode() doesn't return this node, eg. for ghosts
+  const bool mIsForwarderNode;
+
+  /// Thread-independent, CPU-heavy part of the evaluation. It's called right
+  /// before Operate(), but it must not use OpenGL or send messages.
+  virtual void Prepare() {}
+
   /// Main operation
   virtual void Operate() {}
 
+  /// Updates the nodes connected to the public slots. Always runs on the main
+  /// thread, overrides may read their inputs here for Prepare().
+  virtual void UpdateInputs();
+
   /// Sends a message to dependants. ('SendMessage' is already defined in WinUser.h)
   void SendMsg(MessageType message);
 
@@ -237,6 +381,9 @@ private:
   /// Receives message through a slot
   void ReceiveMessage(Message* message);
 
+  /// Number of queued messages this node is the source or target of
+  UINT mQueuedMessageCount = 0;
+
   /// ---------------- Editor-specific parts ----------------
   /// This section can be disabled without hurting the engine.
   /// --------------------------------------------------------
@@ -325,6 +472,11 @@ public:
     return PointerCast<N>(GetReferencedNode());
   }
 
+  /// Non-owning version of GetNode(), for per-frame reads
+  N* GetNodeRaw() const {
+    return SafeCastAllowNull<N*>(GetReferencedNodeRaw());
+  }
+
   bool DoesAcceptNode(const std::shared_ptr<Node>& node) const override {
     return IsPointerOf<N>(node->GetReferencedNode());
   }
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "node.h"
+#include <vector>
+#include <memory>
+#include <unordered_set>
+#include <unordered_map>
+
+/// Cached, flattened topological order of the nodes a root node depends on.
+/// Roots (scenes, passes, documents) own a schedule and invalidate it when their
+/// transitive closure changes. Updating dependencies is then a linear pass over 
+/// a contiguous array, without recursion and without reference counting.
+class EvaluationSchedule {
+public:
+  EvaluationSchedule(Node* root, bool includeHiddenSlots);
+
+  /// Drops the cached order, it will be rebuilt when it's needed next time
+  void Invalidate();
+
+  /// Calls Operate() on all dependencies that aren't up to date, deepest first.
+  /// The root itself is not updated.
+  void Update();
+
+  /// Same as Update(), but only for dependencies that depend on time (see
+  /// Node::IsTimeSource). Used on frame ticks, static subgraphs stay frozen.
+  void UpdateTimeDependentNodes();
+
+  /// Returns the dependencies of the root in topological order, deepest first.
+  /// The root itself is not included.
+  const std::vector<std::shared_ptr<Node>>& GetNodes();
+
+  /// Returns true if the node depends on a time source, including hidden slots
+  bool IsTimeDependent(Node* node);
+
+private:
+  void Rebuild();
+  void Traverse(const std::shared_ptr<Node>& node, std::unordered_set<Node*>& visited);
+  static void UpdateNode(Node* node);
+
+  Node* const mRoot;
+  const bool mIncludeHiddenSlots;
+
+  /// Dependencies of the root, deepest first
+  std::vector<std::shared_ptr<Node>> mNodes;
+
+  /// Subset of mNodes depending on time, same order
+  std::vector<Node*> mTimeDependentNodes;
+
+  /// Memoized results of IsTimeDependent()
+  std::unordered_map<Node*, bool> mTimeDependency;
+
+  bool mIsValid = false;
+  bool mIsUpdating = false;
+};
@@ -30,7 +30,32 @@ protected:
   void HandleMessage(Message* message) override;
 };
 
-class GeosphereMeshNode : public MeshNode {
+/// Base class for generators with a CPU-heavy geometry generation. Geometry
+/// is generated in Prepare(), which may run on a worker thread and only reads
+/// the current values of the inputs, and it's uploaded in Operate() on the
+/// main thread. Geometry is generated at unit size
+/// and scaled during the upload, so size changes don't need a new geometry,
+/// Prepare() skips generation if nothing else changed.
+class GeneratedMeshNode : public MeshNode {
+public:
+  ThreadAffinity GetThreadAffinity() const override;
+
+protected:
+  /// Uploads the generated geometry, indices only if they changed
+  void Operate() override;
+
+  /// Scale of the generated geometry
+  virtual float GetSize() = 0;
+
+  /// Generated geometry
+  std::vector<VertexPosUvNormTangent> mVertices;
+  std::vector<IndexEntry> mIndices;
+
+  /// Set by Prepare() when mIndices need to be uploaded
+  bool mHasNewIndices = false;
+};
+
+class GeosphereMeshNode : public GeneratedMeshNode {
 public:
   GeosphereMeshNode();
 
@@ -38,14 +63,24 @@ public:
   FloatSlot mSize;
   FloatSlot mFlatten;
 
+  /// Faces share their edge vertices, unless they're flattened. Vertices are
+  /// only split where triangles wrap around the texture seam.
+  FloatSlot mWelded;
+
 protected:
-  void Operate() override;
+  void Prepare() override;
+  float GetSize() override;
+
+  /// Parameters of the generated geometry
+  int mGeneratedResolution = -1;
+  float mGeneratedFlatten = 0;
+  bool mIsGeneratedWelded = false;
 
   /// Handle received messages
   void HandleMessage(Message* message) override;
 };
 
-class PlaneMeshNode : public MeshNode {
+class PlaneMeshNode : public GeneratedMeshNode {
 public:
   PlaneMeshNode();
 
@@ -53,13 +88,17 @@ public:
   FloatSlot mSize;
 
 protected:
-  void Operate() override;
+  void Prepare() override;
+  float GetSize() override;
+
+  /// Resolution of the generated geometry
+  int mGeneratedResolution = -1;
 
   /// Handle received messages
   void HandleMessage(Message* message) override;
 };
 
-class PolarSphereMeshNode : public MeshNode {
+class PolarSphereMeshNode : public GeneratedMeshNode {
 public:
   PolarSphereMeshNode();
 
@@ -67,7 +106,11 @@ public:
   FloatSlot mSize;
 
 protected:
-  void Operate() override;
+  void Prepare() override;
+  float GetSize() override;
+
+  /// Resolution of the generated geometry
+  int mGeneratedResolution = -1;
 
   /// Handle received messages
   void HandleMessage(Message* message) override;
@@ -11,6 +11,12 @@ public:
   const std::shared_ptr<Mesh>& GetMesh() const;
 
 protected:
+  /// Makes mMesh safe to rewrite in place. Returns true if it's a new mesh,
+  /// either because there was none, or because the old one is also held by
+  /// someone else (eg. a document snapshot being saved), who expects it to stay
+  /// unchanged.
+  bool MakeMeshWritable();
+
   std::shared_ptr<Mesh> mMesh;
 };
 
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "meshnode.h"
+#include "../shaders/valuestubslot.h"
+
+/// Mesh attributes in SoA layout, one array per attribute. Missing attributes
+/// have empty arrays. Indices form a triangle list.
+struct MeshArrays {
+  UINT GetVertexCount() const;
+
+  /// Reads the vertices and indices of a mesh. Meshes without indices get one
+  /// index for each vertex.
+  void Read(const Mesh& mesh);
+
+  /// Vertex format bits of the attributes present
+  UINT GetBinaryFormat() const;
+
+  /// Writes the vertices in the interleaved layout of the format
+  void WriteVertices(const VertexFormat& format, void* target) const;
+
+  /// Keeps the vertices with a valid new index, remap[i] is either the new
+  /// index of vertex i or -1. Indices aren't touched.
+  void RemapVertices(const std::vector<int>& remap, UINT newVertexCount);
+
+  std::vector<vec3> mPositions;
+  std::vector<vec2> mUvs;
+  std::vector<vec3> mNormals;
+  std::vector<vec3> mTangents;
+  std::vector<IndexEntry> mIndices;
+};
+
+/// Base class for nodes that process the mesh of another node. The inputs are
+/// read in UpdateInputs() on the main thread, the input mesh is processed in
+/// Prepare(), which may run on a worker thread, and the result is uploaded in
+/// Operate() on the main thread.
+class MeshProcessorNode : public MeshNode {
+public:
+  ThreadAffinity GetThreadAffinity() const override;
+
+  MeshSlot mMeshSlot;
+
+protected:
+  MeshProcessorNode();
+
+  /// Processes mArrays in place
+  virtual void Process(MeshArrays& arrays) = 0;
+
+  void UpdateInputs() override;
+  void Prepare() override;
+  void Operate() override;
+
+  /// Handle received messages
+  void HandleMessage(Message* message) override;
+
+  /// Mesh of the input node, held from UpdateInputs() to Operate()
+  std::shared_ptr<Mesh> mInputMesh;
+
+  /// Processed geometry
+  MeshArrays mArrays;
+
+  /// Format of the processed mesh, kept while the attributes don't change
+  std::shared_ptr<VertexFormat> mFormat;
+};
+
+/// Merges vertices closer to each other than Tolerance, found by a spatial hash.
+/// Vertices with different attributes (texture seams, hard edges) are only
+/// merged if "Positions only" is set, then the merged normals and tangents are
+/// averaged. Triangles collapsing to a line are removed.
+class WeldMeshNode : public MeshProcessorNode {
+public:
+  WeldMeshNode();
+
+  FloatSlot mTolerance;
+  FloatSlot mPositionsOnly;
+
+protected:
+  void UpdateInputs() override;
+  void Process(MeshArrays& arrays) override;
+
+  /// Slot values for Process()
+  float mToleranceValue = 0;
+  bool mIsPositionsOnly = false;
+};
+
+/// Recomputes smooth normals, and tangents if the mesh has texture coordinates.
+/// Normals average the faces around vertices at the same position, so they're
+/// smooth across texture seams. Front faces are clockwise, like the ones of the
+/// generated meshes. Tangents are computed like MikkTSpace does:
+/// face tangents are projected to the plane of the vertex normal, and summed
+/// weighted by the corner angles.
+class SmoothNormalsMeshNode : public MeshProcessorNode {
+public:
+  SmoothNormalsMeshNode();
+
+protected:
+  void Process(MeshArrays& arrays) override;
+};
+
+/// Quadric error metric edge collapse simplification (Garland-Heckbert) down to
+/// a target triangle count. Edges collapse into one of their vertices, so the
+/// remaining vertices keep their attributes. Open boundaries are kept by
+/// penalty planes, vertices shared by texture seams or hard edges don't move.
+/// Welding the mesh before simplification lets those collapse too.
+class SimplifyMeshNode : public MeshProcessorNode {
+public:
+  SimplifyMeshNode();
+
+  FloatSlot mTriangleCount;
+
+protected:
+  void UpdateInputs() override;
+  void Process(MeshArrays& arrays) override;
+
+  /// Slot value for Process()
+  UINT mTargetTriangleCount = 0;
+};
+
+/// Reorders triangles for the vertex cache and less overdraw, then vertices in
+/// the order of their first use, see MeshOptimizer. Unused vertices are removed.
+class OptimizeMeshNode : public MeshProcessorNode {
+public:
+  OptimizeMeshNode();
+
+protected:
+  void Process(MeshArrays& arrays) override;
+};
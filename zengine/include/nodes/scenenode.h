@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../dom/node.h"
+#include "../dom/schedule.h"
 #include "drawable.h"
 #include "cameranode.h"
 #include "../render/rendertarget.h"
@@ -51,7 +52,7 @@ protected:
   void HandleMessage(Message* message) override;
 
 private:
-  std::vector<std::shared_ptr<Node>> mTransitiveClosure;
+  EvaluationSchedule mSchedule{ this, true };
   Slot mSceneTimes;
   float mSceneTime = 0.0f;
   float mLastRenderTime{};
@@ -28,6 +28,27 @@ struct SplinePoint
 };
 
 
+/// Cubic polynomial of a spline segment, in the form expected by batch evaluation.
+/// value = mA + ft * (mB + ft * (mC + ft * mD)), ft = (time - mStartTime) * mInvDuration
+struct SplineSegment
+{
+  float mStartTime;
+  float mInvDuration;
+  float mA, mB, mC, mD;
+
+  /// Padding to two SSE registers
+  float mPadding[2];
+};
+
+
+/// Search position for spline evaluation, owned by the caller. Lookups close to 
+/// the previous one are faster, eg. when sampling in increasing time order.
+struct SplineCursor
+{
+  int mIndex = -1;
+};
+
+
 /// A simple spline component consisting of one set of points. Acts as a component 
 /// to spline nodes which have several layers of basic splines. In each layer there is
 /// one spline component.
@@ -46,18 +67,22 @@ protected:
   SplineComponent() = default;
 
   /// Finds the last spline point which's time is not greater than the argument
-  /// Returns -1 if there are no points before (or exactly at) the argument
-  int FindPointIndexBefore(float time);
+  /// Returns -1 if there are no points before (or exactly at) the argument.
+  /// Checks the cursor's segment and the next one first.
+  int FindPointIndexBefore(float time, SplineCursor& cursor) const;
+
+  /// Same as FindPointIndexBefore(), using a branchless binary search
+  int SearchPointIndexBefore(float time) const;
 
   /// Key points
   std::vector<SplinePoint> mPoints;
 
+  /// Times of the key points, kept in sync with mPoints. Searching a 
+  /// contiguous array touches less memory than searching mPoints.
+  std::vector<float> mTimes;
+
   /// Recalculates tangents for a given index
   virtual void CalculateTangent(int index) = 0;
-
-private:
-  /// Cache of the last found index for performance reasons
-  int mLastIndex = -1;
 };
 
 
@@ -66,10 +91,16 @@ class SplineFloatComponent: public SplineComponent {
   friend class FloatSplineNode;
 
 public:
-  SplineFloatComponent() = default;
+  SplineFloatComponent();
   virtual ~SplineFloatComponent() = default;
 
-  float Get(float time);
+  /// Evaluation doesn't change the component, several threads can sample it
+  /// concurrently as long as nobody edits it.
+  float Get(float time) const;
+  float Get(float time, SplineCursor& cursor) const;
+
+  /// Evaluates the spline at 'count' points in time, same as Get() for each
+  void GetValues(const float* times, float* values, UINT count) const;
 
 protected:
   /// Adds a point to the spline, returns its index
@@ -78,8 +109,19 @@ protected:
   /// Sets a point's time and value
   void SetPointValue(int index, float time, float value);
 
+  /// Removes a point at 'index'
+  void RemovePoint(int index);
+
   /// Calculates tangents of the Nth control point
   void CalculateTangent(int index) override;
+
+  /// Recalculates the segments adjacent to points in [firstPoint, lastPoint].
+  /// Must be called whenever a point or its tangents change.
+  void UpdateSegments(int firstPoint, int lastPoint);
+
+  /// Segment polynomials, one more than the number of points. Segment N+1 
+  /// starts at the Nth point, the first and last segments are constant.
+  std::vector<SplineSegment> mSegments;
 };
 
 
@@ -110,9 +152,24 @@ public:
 
   /// Returns spline value at current scene time
   const float& Get() override;
+  const float& GetCurrentValue() const override;
 
   /// Returns spline components value at a given time
-  float GetValue(float time);
+  float GetValue(float time) const;
+
+  /// Evaluates the spline at 'count' points in time, same as GetValue() for each
+  void GetValues(const float* times, float* values, UINT count) const;
+
+  /// Samples the spline between 0 and 'endTime' into a lookup table, which is 
+  /// then used instead of evaluating the layers. The sample rate starts at
+  /// 'samplesPerBeat' and is doubled until linear interpolation stays within 
+  /// 'maxError' of the analytic curve. Returns the measured error, the table is 
+  /// only kept if it's within the limit. Returns -1 if a parameter slot is
+  /// connected to another node. Editing the spline discards the table.
+  float Bake(float endTime, float samplesPerBeat, float maxError);
+  void Unbake();
+  bool IsBaked() const;
+  UINT GetBakedSampleCount() const;
 
   /// Noise component
   FloatSlot mNoiseEnabled;
@@ -159,11 +216,16 @@ protected:
   void HandleMessage(Message* message) override;
 
   /// Computer layer values
-  float GetNoiseValue(float time);
-  float GetBeatSpikeValue(float time);
-  float GetBeatQuantizerValue(float time);
+  float GetNoiseValue(float time) const;
+  float GetBeatSpikeValue(float time) const;
+  float GetBeatQuantizerValue(float time) const;
+
+  /// Batch versions of layer evaluation, results are added to 'values'
+  void AddNoiseValues(const float* times, float* values, UINT count) const;
+  void AddBeatSpikeValues(const float* times, float* values, UINT count) const;
+  void AddBeatQuantizerValues(const float* times, float* values, UINT count) const;
 
-  static float EvaluateLinearSpline(std::vector<SplinePoint>& points, float time);
+  static float EvaluateLinearSpline(const SplineComponent& component, float time);
 
   /// Control points of spline
   SplineFloatComponent mBaseLayer;
@@ -172,14 +234,23 @@ protected:
   SplineFloatComponent mBeatSpikeFrequencyLayer;
   SplineFloatComponent mBeatQuantizerLayer;
 
-  /// Current value
+  /// Current value. The sum with the base offset is kept up to date by every
+  /// change, so GetCurrentValue() doesn't have to write it.
   float currentValue = 0.0f;
   float mCurrentValuePlusBaseOffset = 0.0f;
 
   /// User-set base offset. For temporary overrides, experimenting
   float mBaseOffset = 0.0f;
 
+  /// Lookup table created by Bake(), empty if not baked
+  std::vector<float> mBakedValues;
+  float mBakedSamplesPerBeat = 0.0f;
+
   void InvalidateCurrentValue();
+
+  /// Called after editing points, notifies dependants even if the current
+  /// value is already invalid
+  void InvalidatePoints();
   void Operate() override;
 };
 
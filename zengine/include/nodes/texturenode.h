@@ -16,6 +16,7 @@ public:
   StringSlot mFileName;
 
   const std::shared_ptr<Texture>& Get() override;
+  const std::shared_ptr<Texture>& GetCurrentValue() const override;
 
   void HandleMessage(Message* message) override;
 
@@ -10,6 +10,11 @@ public:
   virtual ~GlobalTimeNode();
   static Event<float> OnTimeChanged;
 
+  /// Sets the time of all global time nodes, changes propagate in one batch
+  static void SetGlobalTime(float beats);
+
+  bool IsTimeSource() const override;
+
 private:
   void HandleTimeChange(float beats);
 };
@@ -22,4 +27,6 @@ public:
   /// Manually sets time. This function has the same effect as Set(), except
   /// it sends different signal indicating user input.
   void EditTime(float time);
+
+  bool IsTimeSource() const override;
 };
\ No newline at end of file
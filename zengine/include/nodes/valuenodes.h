@@ -9,6 +9,10 @@ class ValueNode: public Node {
 public:
   /// Returns value of node. Reevaluates if necessary
   virtual const T& Get() = 0;
+
+  /// Returns the value of the last evaluation without reevaluating. Doesn't
+  /// change the node, so worker threads can read their inputs this way.
+  virtual const T& GetCurrentValue() const = 0;
 };
 
 
@@ -20,6 +24,7 @@ public:
 
   /// Returns value of node. Reevaluates if necessary
   const T& Get() override;
+  const T& GetCurrentValue() const override;
 
   /// Sets value of node.
   void Set(const T& newValue);
@@ -44,6 +49,12 @@ const T& StaticValueNode<T>::Get() {
 }
 
 
+template<typename T>
+const T& StaticValueNode<T>::GetCurrentValue() const {
+  return mValue;
+}
+
+
 /// Slots for value nodes. These slots have a StaticValueNode built in
 /// that provides a default value. This way these nodes provide a value
 /// even when there's no external node connected to them. Also, GetNode()
@@ -57,6 +68,10 @@ public:
 
   const T& Get() const;
 
+  /// Reads the connected node without evaluating it, see 
+  /// ValueNode::GetCurrentValue(). The node must be up to date.
+  const T& GetCurrentValue() const;
+
   /// Return minimum & maximum
   vec2 GetRange() const;
 
@@ -104,7 +119,13 @@ ValueSlot<T>::ValueSlot(Node* owner, const std::string& name, bool isMultiSlot,
 
 template<typename T>
 const T& ValueSlot<T>::Get() const {
-  return PointerCast<ValueNode<T>>(this->GetReferencedNode())->Get();
+  return SafeCast<ValueNode<T>*>(this->GetReferencedNodeRaw())->Get();
+}
+
+
+template<typename T>
+const T& ValueSlot<T>::GetCurrentValue() const {
+  return SafeCast<ValueNode<T>*>(this->GetReferencedNodeRaw())->GetCurrentValue();
 }
 
 
@@ -11,9 +11,12 @@ public:
   FloatSlot mZ;
 
   const vec3& Get() override;
+  const vec3& GetCurrentValue() const override;
 
   void HandleMessage(Message* message) override;
 
+  ThreadAffinity GetThreadAffinity() const override;
+
 protected:
   void Operate() override;
 
@@ -30,9 +33,12 @@ public:
   FloatSlot mW;
 
   const vec4& Get() override;
+  const vec4& GetCurrentValue() const override;
 
   void HandleMessage(Message* message) override;
 
+  ThreadAffinity GetThreadAffinity() const override;
+
 protected:
   void Operate() override;
 
@@ -47,9 +53,12 @@ public:
   FloatSlot mX;
 
   const float& Get() override;
+  const float& GetCurrentValue() const override;
 
   void HandleMessage(Message* message) override;
 
+  ThreadAffinity GetThreadAffinity() const override;
+
 protected:
   void Operate() override;
 
@@ -65,9 +74,12 @@ public:
   FloatSlot mC;
 
   const float& Get() override;
+  const float& GetCurrentValue() const override;
 
   void HandleMessage(Message* message) override;
 
+  ThreadAffinity GetThreadAffinity() const override;
+
 protected:
   void Operate() override;
 
@@ -141,11 +141,13 @@ public:
   void SetIndexBuffer(const std::shared_ptr<Buffer>& buffer);
   static void SetSsbo(UINT index, const std::shared_ptr<Buffer>& buffer);
 
+  /// Short indices are 16-bit, the rest are IndexEntry
   void Render(const std::shared_ptr<Buffer>& indexBuffer,
     UINT Count, PrimitiveTypeEnum primitiveType,
-    UINT instanceCount);
+    UINT instanceCount, bool hasShortIndices);
 
-  /// Texture and surface handling
+  /// Texture and surface handling. Returns the size of one texel in the format
+  /// texel data is uploaded and read back in.
   static UINT GetTexelByteCount(TexelType type);
 
   std::shared_ptr<Texture> MakeTexture(int width, int height, TexelType type,
@@ -154,6 +156,11 @@ public:
   static void DeleteTextureGpuData(Texture::Handle handle);
   void UploadTextureGpuData(const std::shared_ptr<Texture>& texture, void* texelData);
 
+  /// Texels of the base level in the upload format, for textures made with
+  /// gpuMemoryOnly. Returns nullptr for multisample textures.
+  std::shared_ptr<std::vector<char>> ReadTextureGpuData(
+    const std::shared_ptr<Texture>& texture);
+
   void SetTexture(const ShaderProgram::Sampler& sampler, 
     const std::shared_ptr<Texture>& texture, UINT slotIndex);
 
@@ -22,9 +22,16 @@ public:
   /// Uploads only the first VertexCount vertices, doessn't reallocate
   void UploadVertices(void* vertices, int vertexCount) const;
 
-  /// Uploads all indices
+  /// Uploads all indices. The index buffer gets 16-bit indices if all of them
+  /// fit, mIndexData always keeps IndexEntry.
   void UploadIndices(const IndexEntry* indices);
 
+  /// Uploads vertices that live in memory owned by someone else (eg. a mapped
+  /// file) and uses them as raw vertex data without copying. The mesh keeps
+  /// the owner alive, borrowed data is never written.
+  void BorrowVertices(const std::shared_ptr<VertexFormat>& format, UINT vertexCount,
+    const void* vertices, const std::shared_ptr<const void>& owner);
+
   template<typename T, int N>	void SetVertices(const T(&staticVertices)[N]);
   template<int N> void SetIndices(const IndexEntry(&staticIndices)[N]);
 
@@ -34,11 +41,20 @@ public:
   UINT mIndexCount = 0;
   const std::shared_ptr<Buffer> mIndexBuffer = std::make_shared<Buffer>();
 
+  /// The index buffer holds 16-bit indices, see UploadIndices
+  bool mHasShortIndices = false;
+
   std::shared_ptr<VertexFormat> mFormat = nullptr;
 
   /// Raw mesh data for deserialization
   void* mRawVertexData = nullptr;
   std::vector<IndexEntry> mIndexData;
+
+private:
+  void ReleaseRawVertexData();
+
+  /// Owner of borrowed raw vertex data, nullptr if mRawVertexData is owned
+  std::shared_ptr<const void> mRawVertexDataOwner;
 };
 
 template<typename T, int N>
@@ -46,8 +62,6 @@ void Mesh::SetVertices(const T(&staticVertices)[N]) {
   AllocateVertices(T::mFormat, N);
   // ReSharper disable once CppCStyleCast
   UploadVertices((void*)staticVertices);
-  SafeDelete(mRawVertexData);
-  mRawVertexData = new char[N * T::mFormat->mStride];
 }
 
 template<int N>
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "mesh.h"
+
+/// Index and vertex order optimizations of triangle list meshes. They only
+/// change the order of triangles and vertices, the rendered image stays the same.
+namespace MeshOptimizer {
+  /// FIFO post-transform vertex cache size the optimizations and the statistics
+  /// assume. Actual GPUs behave about like this.
+  const UINT DefaultCacheSize = 16;
+
+  /// Overdraw sorting may make the average cache miss ratio this much worse
+  const float DefaultOverdrawThreshold = 1.05f;
+
+  /// Statistics of a simulated FIFO post-transform vertex cache
+  struct VertexCacheStatistics {
+    /// Vertices transformed, counting cache misses
+    UINT mTransformedVertexCount = 0;
+
+    /// Average cache miss ratio, transformed vertices per triangle. 3 is the
+    /// worst, about 0.5-0.7 is the best possible on regular meshes.
+    float mACMR = 0;
+
+    /// Average transformed to vertex ratio, 1 is ideal
+    float mATVR = 0;
+  };
+
+  VertexCacheStatistics AnalyzeVertexCache(const std::vector<IndexEntry>& indices,
+    UINT vertexCount, UINT cacheSize = DefaultCacheSize);
+
+  /// Reorders triangles for the vertex cache with Tipsify (Sander et al. 2007),
+  /// in linear time. Optionally returns the first triangles of the clusters
+  /// where the optimizer had to jump to a new part of the mesh.
+  void OptimizeVertexCache(std::vector<IndexEntry>& indices, UINT vertexCount,
+    UINT cacheSize = DefaultCacheSize, std::vector<UINT>* oClusters = nullptr);
+
+  /// Splits the clusters of OptimizeVertexCache further while the cache miss
+  /// ratio allows, then sorts them by how much they face outwards, so that
+  /// outer surfaces are drawn first and occlude the rest. Front faces are
+  /// clockwise.
+  void OptimizeOverdraw(std::vector<IndexEntry>& indices,
+    const std::vector<vec3>& positions, const std::vector<UINT>& clusters,
+    float threshold = DefaultOverdrawThreshold, UINT cacheSize = DefaultCacheSize);
+
+  /// Vertex cache and overdraw optimization
+  void OptimizeTriangleOrder(std::vector<IndexEntry>& indices,
+    const std::vector<vec3>& positions);
+
+  /// Renumbers vertices in the order of their first use, so vertex fetches
+  /// read memory sequentially. oRemap gets the new index of every vertex, -1
+  /// for unused ones. Returns the count of used vertices.
+  UINT OptimizeVertexFetch(std::vector<IndexEntry>& indices, UINT vertexCount,
+    std::vector<int>& oRemap);
+
+  /// Optimized copy of the raw vertex data and the indices of a mesh
+  struct OptimizedMesh {
+    std::vector<char> mVertices;
+    UINT mVertexCount = 0;
+    std::vector<IndexEntry> mIndices;
+  };
+
+  /// Runs all optimizations on copies of the indices and raw vertex data of the
+  /// mesh, the mesh stays unchanged. Unused vertices are removed. Returns false
+  /// if the mesh has no indices, raw vertex data or positions. Thread safe.
+  bool Optimize(const Mesh& mesh, OptimizedMesh& oResult);
+
+  /// Same on the mesh itself, the results are uploaded
+  bool Optimize(Mesh& mesh);
+}
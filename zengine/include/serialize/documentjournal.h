@@ -0,0 +1,86 @@
+#pragma once
+
+#include "../dom/document.h"
+#include "../base/helpers.h"
+#include <string>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+
+class JSONSerializer;
+
+/// IDs of saved nodes. Kept between saves, so that journal records written later
+/// refer to the same nodes as the snapshot they follow.
+struct JSONNodeIDs {
+  std::unordered_map<std::shared_ptr<Node>, int> mIDs;
+  int mLastID = 0;
+};
+
+/// Document state captured for saving on another thread. Capturing copies the
+/// node values on the main thread, meshes and textures are only referenced.
+/// Release the capture on the main thread, it may hold the last reference to a
+/// mesh.
+class JSONCapture {
+public:
+  ~JSONCapture();
+
+  /// Returns the same text as a synchronous save of the captured state. Can be
+  /// called on any thread.
+  std::string GetJSON();
+
+private:
+  friend class DocumentJournal;
+  JSONCapture(JSONSerializer* serializer, bool isRecords);
+
+  const std::unique_ptr<JSONSerializer> mSerializer;
+
+  /// Journal records instead of a complete document
+  const bool mIsRecords;
+};
+
+/// Incremental JSON saving. A snapshot is a complete JSON document, the journal
+/// is a list of node records written after it, one JSON object per line, in the
+/// format of the snapshot's "nodes" array. On replay, a record replaces the node
+/// with the same ID, and nodes that can't be reached from the Document anymore
+/// are dropped.
+///
+/// Changed nodes are collected from the messages delivered by TheMessageQueue,
+/// so the cost of a journal write depends on the edits, not the document size.
+class DocumentJournal {
+public:
+  DocumentJournal(const std::shared_ptr<Document>& document,
+    MeshArrayEncoding meshArrayEncoding = MeshArrayEncoding::BINARY,
+    BlobCompression blobCompression = BlobCompression::NONE);
+  ~DocumentJournal();
+
+  /// Captures the complete document and starts a new journal
+  std::shared_ptr<JSONCapture> CaptureSnapshot();
+
+  /// Captures the records of the nodes changed since the last snapshot or
+  /// records, nullptr if nothing changed
+  std::shared_ptr<JSONCapture> CaptureRecords();
+
+  /// Capture and write in one step
+  std::string GetSnapshot();
+  std::string GetRecords();
+
+  bool HasChanges() const;
+
+  /// Replays journal records over a snapshot, returns the merged snapshot or an
+  /// empty string if the snapshot doesn't parse. Damaged records, eg. the last
+  /// line of an interrupted write, are skipped. Doesn't touch nodes, so it can
+  /// run on any thread.
+  static std::string Compact(const char* snapshot, size_t snapshotSize,
+    const char* journal, size_t journalSize);
+
+private:
+  void HandleMessage(Message* message);
+
+  const std::shared_ptr<Document> mDocument;
+  const MeshArrayEncoding mMeshArrayEncoding;
+  const BlobCompression mBlobCompression;
+  JSONNodeIDs mNodeIDs;
+
+  /// Nodes changed since the last save
+  std::unordered_set<std::shared_ptr<Node>> mChangedNodes;
+};
@@ -11,7 +11,8 @@ public:
   PassSlot mZPostPass;
   PassSlot mFluidPaintPass;
 
-  std::shared_ptr<Pass> GetPass(PassType passType);
+  /// Non-owning, meant for per-frame rendering
+  Pass* GetPass(PassType passType) const;
 
 protected:
   void HandleMessage(Message* message) override;
@@ -2,6 +2,7 @@
 
 #include "shadersource.h"
 #include "../dom/node.h"
+#include "../dom/schedule.h"
 #include "../render/drawingapi.h"
 #include "../nodes/fluidnode.h"
 #include <map>
@@ -106,6 +107,19 @@ protected:
   /// Client-side uniform buffer. 
   /// Uniforms are assembled in this array and then uploaded to OpenGL
   std::shared_ptr<Buffer> mUniformBuffer = std::make_shared<Buffer>();
+
+  /// Dependencies in evaluation order, eg. uniform value nodes
+  EvaluationSchedule mSchedule{ this, false };
+
+  /// Uniform values kept between frames. Uniforms that don't depend on time
+  /// are only rewritten after an edit, see mStaticUniformsDirty.
+  std::vector<char> mUniformArray;
+
+  /// One flag per item in mUniforms, true if the source node depends on time
+  std::vector<bool> mIsUniformTimeDependent;
+
+  /// True if static dependencies or uniforms need to be updated
+  bool mStaticUniformsDirty = true;
 };
 
 typedef TypedSlot<Pass> PassSlot;
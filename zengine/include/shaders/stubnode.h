@@ -203,8 +203,14 @@ public:
   /// Copies shader source from another StubNode
   void CopyFrom(const std::shared_ptr<Node>& node) override;
 
+  /// Parsing may run on any thread, slots are generated on the main thread
+  ThreadAffinity GetThreadAffinity() const override;
+
 protected:
   /// Performs metadata analysis on the new stub source.
+  void Prepare() override;
+
+  /// Generates slots from the metadata
   void Operate() override;
 
   /// Handle received messages
@@ -213,6 +219,9 @@ protected:
   /// Metadata
   StubMetadata* mMetadata;
 
+  /// Metadata analyzed by Prepare(), not applied yet
+  StubMetadata* mPreparedMetadata = nullptr;
+
   /// Maps stub parameters to stub slots
   std::map<StubParameter*, Slot*> mParameterSlotMap;
   std::map<std::string, Slot*> mParameterNameSlotMap;
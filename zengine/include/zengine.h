@@ -9,9 +9,12 @@
 #include "dom/ghost.h"
 #include "dom/graph.h"
 #include "dom/document.h"
+#include "dom/schedule.h"
+#include "dom/evaluator.h"
 #include "dom/watcher.h"
 
 #include "resources/mesh.h"
+#include "resources/meshoptimizer.h"
 #include "resources/texture.h"
 
 #include "shaders/stubnode.h"
@@ -35,10 +38,12 @@
 #include "nodes/splinenode.h"
 #include "nodes/cameranode.h"
 #include "nodes/meshgenerators.h"
+#include "nodes/meshprocessing.h"
 #include "nodes/buffernode.h"
 #include "nodes/fluidnode.h"
 
 #include "serialize/lodepng.h"
+#include "serialize/documentjournal.h"
 // ReSharper restore CppUnusedIncludeDirective
 
 /// Initializes Zengine. Returns true if everything went okay.
@@ -3,6 +3,10 @@
 
 #include "../serialize/json/jsonserializer.h"
 #include "../serialize/json/jsondeserializer.h"
+#include "../serialize/json/jsonstreamdeserializer.h"
+#include "../serialize/binary/binaryserializer.h"
+#include "../serialize/binary/binarydeserializer.h"
+#include "../serialize/compression.h"
 #include <include/base/helpers.h>
 #include <cstdarg>
 #include <codecvt>
@@ -14,6 +18,7 @@ static wchar_t TempStringW[LogMessageMaxLength];
 static char TempStringA[LogMessageMaxLength];
 
 void Logger::Log2(LogSeverity severity, const wchar_t* logString, ...) {
+  std::lock_guard<std::mutex> lock(mMutex);
   va_list args;
   va_start(args, logString);
   vswprintf(TempStringW, LogMessageMaxLength, logString, args);
@@ -23,6 +28,7 @@ void Logger::Log2(LogSeverity severity, const wchar_t* logString, ...) {
 
 void Logger::LogFunc2(LogSeverity severity, const wchar_t* function,
                       const wchar_t* logString, ...) {
+  std::lock_guard<std::mutex> lock(mMutex);
   const int funlen = swprintf(TempStringW, LogMessageMaxLength, function);
 
   va_list args;
@@ -35,6 +41,7 @@ void Logger::LogFunc2(LogSeverity severity, const wchar_t* function,
 
 void Logger::LogFunc2(LogSeverity severity, const wchar_t* function,
                       const char* logString, ...) {
+  std::lock_guard<std::mutex> lock(mMutex);
   /// God, this is bad.
   va_list args;
   va_start(args, logString);
@@ -67,12 +74,105 @@ namespace Convert {
   }
 }
 
-std::string ToJson(const std::shared_ptr<Document>& document) {
-  const JSONSerializer serializer(document);
+std::string ToJson(const std::shared_ptr<Document>& document,
+  MeshArrayEncoding meshArrayEncoding, BlobCompression blobCompression,
+  MeshOptimization meshOptimization)
+{
+  JSONSerializer serializer(document, meshArrayEncoding, blobCompression,
+    meshOptimization);
   return serializer.GetJSON();
 }
 
 std::shared_ptr<Document> FromJson(const std::string& json) {
   const JSONDeserializer deserializer(json);
   return deserializer.GetDocument();
+}
+
+std::shared_ptr<Document> FromJsonStream(const char* json, size_t size,
+  ThreadPool* threadPool)
+{
+  const JSONStreamDeserializer deserializer(json, size, threadPool);
+  return deserializer.GetDocument();
+}
+
+std::vector<char> ToBinary(const std::shared_ptr<Document>& document) {
+  const BinarySerializer serializer(document);
+  return serializer.GetData();
+}
+
+std::shared_ptr<Document> FromBinary(const char* data, size_t size) {
+  const BinaryDeserializer deserializer(data, size);
+  return deserializer.GetDocument();
+}
+
+std::shared_ptr<Document> FromBinary(const std::shared_ptr<MappedFile>& file) {
+  const BinaryDeserializer deserializer(file->GetData(), file->GetSize(), file);
+  return deserializer.GetDocument();
+}
+
+bool IsBinaryDocument(const char* data, size_t size) {
+  return BinaryDeserializer::IsBinaryDocument(data, size);
+}
+
+std::vector<char> CompressDocument(const char* data, size_t size,
+  ThreadPool* threadPool)
+{
+  return Compression::Compress(data, size, Compression::DefaultLevel, threadPool);
+}
+
+bool IsCompressedDocument(const char* data, size_t size) {
+  return Compression::IsCompressed(data, size);
+}
+
+std::shared_ptr<Document> LoadDocument(const char* data, size_t size,
+  ThreadPool* threadPool)
+{
+  if (IsCompressedDocument(data, size)) {
+    std::vector<char> content;
+    if (!Compression::Decompress(data, size, content, threadPool)) {
+      ERR("Can't decompress document");
+      return nullptr;
+    }
+    return LoadDocument(content.data(), content.size(), threadPool);
+  }
+  if (IsBinaryDocument(data, size)) {
+    return FromBinary(data, size);
+  }
+  return FromJsonStream(data, size, threadPool);
+}
+
+std::shared_ptr<Document> LoadDocument(const std::shared_ptr<MappedFile>& file,
+  ThreadPool* threadPool)
+{
+  if (file == nullptr) return nullptr;
+  if (IsCompressedDocument(file->GetData(), file->GetSize())) {
+    /// Binary documents borrow from the decompressed data like from the file
+    const std::shared_ptr<std::vector<char>> content =
+      std::make_shared<std::vector<char>>();
+    if (!Compression::Decompress(file->GetData(), file->GetSize(), *content, threadPool)) {
+      ERR("Can't decompress document");
+      return nullptr;
+    }
+    if (IsBinaryDocument(content->data(), content->size())) {
+      const BinaryDeserializer deserializer(content->data(), content->size(), content);
+      return deserializer.GetDocument();
+    }
+    return FromJsonStream(content->data(), content->size(), threadPool);
+  }
+  if (IsBinaryDocument(file->GetData(), file->GetSize())) {
+    return FromBinary(file);
+  }
+  return FromJsonStream(file->GetData(), file->GetSize(), threadPool);
+}
+
+std::vector<char> ConvertJsonToBinary(const std::string& json) {
+  const std::shared_ptr<Document> document = FromJsonStream(json.c_str(), json.size());
+  if (document == nullptr) return std::vector<char>();
+  return ToBinary(document);
+}
+
+std::string ConvertBinaryToJson(const char* data, size_t size) {
+  const std::shared_ptr<Document> document = FromBinary(data, size);
+  if (document == nullptr) return std::string();
+  return ToJson(document);
 }
\ No newline at end of file
@@ -1,9 +1,10 @@
 #include <include/base/system.h>
 #include <include/base/helpers.h>
+#include <Windows.h>
 #include <io.h>
 #include <direct.h> 
 
-char* System::ReadFile(const wchar_t* fileName) {
+char* System::ReadFile(const wchar_t* fileName, size_t* oFileSize) {
   FILE* file = _wfopen(fileName, L"rb");
   if (!file) {
     ERR(L"Cannot open file for read: %s", fileName);
@@ -25,10 +26,60 @@ char* System::ReadFile(const wchar_t* fileName) {
   }
   fclose(file);
 
+  if (oFileSize) *oFileSize = static_cast<size_t>(fileLength);
   INFO(L"Reading file done: %s", fileName);
   return fileContent;
 }
 
+std::shared_ptr<MappedFile> System::MapFile(const wchar_t* fileName) {
+  const std::shared_ptr<MappedFile> mappedFile(new MappedFile());
+  mappedFile->mFile = CreateFileW(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr,
+    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (mappedFile->mFile == INVALID_HANDLE_VALUE) {
+    mappedFile->mFile = nullptr;
+    ERR(L"Cannot open file for read: %s", fileName);
+    return nullptr;
+  }
+
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(mappedFile->mFile, &fileSize) || fileSize.QuadPart == 0) {
+    ERR(L"Cannot map empty file: %s", fileName);
+    return nullptr;
+  }
+  mappedFile->mSize = size_t(fileSize.QuadPart);
+
+  mappedFile->mMapping =
+    CreateFileMappingW(mappedFile->mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mappedFile->mMapping == nullptr) {
+    ERR(L"Cannot map file: %s", fileName);
+    return nullptr;
+  }
+
+  mappedFile->mData = static_cast<const char*>(
+    MapViewOfFile(mappedFile->mMapping, FILE_MAP_READ, 0, 0, 0));
+  if (mappedFile->mData == nullptr) {
+    ERR(L"Cannot map file: %s", fileName);
+    return nullptr;
+  }
+
+  INFO(L"Mapping file done: %s", fileName);
+  return mappedFile;
+}
+
+MappedFile::~MappedFile() {
+  if (mData) UnmapViewOfFile(mData);
+  if (mMapping) CloseHandle(mMapping);
+  if (mFile) CloseHandle(mFile);
+}
+
+const char* MappedFile::GetData() const {
+  return mData;
+}
+
+size_t MappedFile::GetSize() const {
+  return mSize;
+}
+
 void System::ReadFilesInFolder(const wchar_t* folder, const wchar_t* extension,
                                std::vector<std::wstring>& oFileList) {
   wchar_t currentDir[1024];
@@ -0,0 +1,169 @@
+#include <include/base/threadpool.h>
+#include <include/base/helpers.h>
+
+namespace {
+  /// Queue index of the current worker thread, zero for other threads
+  thread_local UINT CurrentQueueIndex = 0;
+  thread_local const ThreadPool* CurrentThreadPool = nullptr;
+}
+
+ThreadPool::ThreadPool(UINT workerCount) {
+  if (workerCount == 0) {
+    const UINT hardwareThreads = std::thread::hardware_concurrency();
+    workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+  }
+  for (UINT i = 0; i <= workerCount; i++) {
+    mQueues.push_back(std::make_unique<WorkQueue>());
+  }
+  for (UINT i = 1; i <= workerCount; i++) {
+    mWorkers.emplace_back(&ThreadPool::WorkerMain, this, i);
+  }
+}
+
+ThreadPool& ThreadPool::GetSharedPool() {
+  static ThreadPool threadPool;
+  return threadPool;
+}
+
+ThreadPool::~ThreadPool() {
+  WaitAll();
+  {
+    std::lock_guard<std::mutex> lock(mSignalMutex);
+    mIsShuttingDown = true;
+  }
+  mTaskAvailable.notify_all();
+  for (std::thread& worker : mWorkers) worker.join();
+}
+
+void ThreadPool::Submit(Task task) {
+  UINT queueIndex = CurrentThreadPool == this ? CurrentQueueIndex : 0;
+  if (queueIndex == 0) queueIndex = mNextQueue++ % UINT(mQueues.size());
+
+  mPendingTaskCount++;
+  {
+    /// Locking prevents lost wakeups of workers about to sleep. The counter is
+    /// incremented first so that it never underflows when the task is taken.
+    std::lock_guard<std::mutex> lock(mSignalMutex);
+    mQueuedTaskCount++;
+  }
+  {
+    WorkQueue* queue = mQueues[queueIndex].get();
+    std::lock_guard<std::mutex> lock(queue->mMutex);
+    queue->mTasks.push_back(std::move(task));
+  }
+  mTaskAvailable.notify_one();
+  mWaitSignal.notify_all();
+}
+
+void ThreadPool::WaitAll() {
+  ASSERT(CurrentThreadPool != this);
+  Task task;
+  while (mPendingTaskCount > 0) {
+    if (TryGetTask(0, task)) {
+      RunTask(task);
+      continue;
+    }
+    /// Remaining tasks are running on workers
+    std::unique_lock<std::mutex> lock(mSignalMutex);
+    mWaitSignal.wait(lock, [this]() { 
+      return mPendingTaskCount == 0 || mQueuedTaskCount > 0; 
+    });
+  }
+}
+
+void ThreadPool::ParallelFor(UINT count, const std::function<void(UINT)>& job) {
+  if (count == 0) return;
+  if (count == 1) {
+    job(0);
+    return;
+  }
+  std::atomic<UINT> remainingJobCount{ count };
+  for (UINT i = 0; i < count; i++) {
+    Submit([this, &job, &remainingJobCount, i]() {
+      job(i);
+      if (--remainingJobCount == 0) {
+        /// The counter is gone once the waiting thread sees zero, only the
+        /// pool is touched from here
+        std::lock_guard<std::mutex> lock(mSignalMutex);
+        mWaitSignal.notify_all();
+      }
+    });
+  }
+  Wait(remainingJobCount);
+}
+
+UINT ThreadPool::GetWorkerCount() const {
+  return UINT(mWorkers.size());
+}
+
+void ThreadPool::WorkerMain(UINT queueIndex) {
+  CurrentQueueIndex = queueIndex;
+  CurrentThreadPool = this;
+  Task task;
+  for (;;) {
+    if (TryGetTask(queueIndex, task)) {
+      RunTask(task);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mSignalMutex);
+    mTaskAvailable.wait(lock, [this]() { 
+      return mIsShuttingDown || mQueuedTaskCount > 0; 
+    });
+    if (mIsShuttingDown) return;
+  }
+}
+
+bool ThreadPool::TryGetTask(UINT queueIndex, Task& oTask) {
+  if (mQueuedTaskCount == 0) return false;
+
+  /// Own queue first, newest task is the most likely to have warm caches
+  {
+    WorkQueue* queue = mQueues[queueIndex].get();
+    std::lock_guard<std::mutex> lock(queue->mMutex);
+    if (!queue->mTasks.empty()) {
+      oTask = std::move(queue->mTasks.back());
+      queue->mTasks.pop_back();
+      mQueuedTaskCount--;
+      return true;
+    }
+  }
+
+  /// Steal the oldest task of another queue
+  const UINT queueCount = UINT(mQueues.size());
+  for (UINT i = 1; i < queueCount; i++) {
+    WorkQueue* queue = mQueues[(queueIndex + i) % queueCount].get();
+    std::lock_guard<std::mutex> lock(queue->mMutex);
+    if (!queue->mTasks.empty()) {
+      oTask = std::move(queue->mTasks.front());
+      queue->mTasks.pop_front();
+      mQueuedTaskCount--;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::RunTask(Task& task) {
+  task();
+  task = nullptr;
+  if (--mPendingTaskCount == 0) {
+    std::lock_guard<std::mutex> lock(mSignalMutex);
+    mWaitSignal.notify_all();
+  }
+}
+
+void ThreadPool::Wait(const std::atomic<UINT>& remainingJobCount) {
+  const UINT queueIndex = CurrentThreadPool == this ? CurrentQueueIndex : 0;
+  Task task;
+  while (remainingJobCount > 0) {
+    if (TryGetTask(queueIndex, task)) {
+      RunTask(task);
+      continue;
+    }
+    /// Remaining jobs are running on other threads
+    std::unique_lock<std::mutex> lock(mSignalMutex);
+    mWaitSignal.wait(lock, [this, &remainingJobCount]() {
+      return remainingJobCount == 0 || mQueuedTaskCount > 0;
+    });
+  }
+}
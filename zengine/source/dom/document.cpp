@@ -1,4 +1,7 @@
 #include <include/dom/document.h>
+#include <include/dom/evaluator.h>
+#include <include/nodes/splinenode.h>
+#include <algorithm>
 
 REGISTER_NODECLASS(Document, "Document");
 
@@ -7,3 +10,44 @@ Document::Document()
   , mMovie(this, "movie")
   , mProperties(this, "properties", false, true)
 {}
+
+void Document::UpdateDependencies(ThreadPool* threadPool) {
+  if (threadPool == nullptr) {
+    mSchedule.Update();
+    return;
+  }
+  ParallelEvaluator evaluator(threadPool);
+  evaluator.Update(mSchedule.GetNodes());
+}
+
+Document::SplineBakeStatistics Document::BakeSplines(float samplesPerBeat, 
+  float maxError) 
+{
+  SplineBakeStatistics statistics;
+  MovieNode* movie = mMovie.GetNodeRaw();
+  if (!movie) return statistics;
+  const float movieLength = movie->CalculateMovieLength();
+
+  for (const std::shared_ptr<Node>& node : mSchedule.GetNodes()) {
+    if (!IsExactType<FloatSplineNode>(node)) continue;
+    FloatSplineNode* spline = SafeCast<FloatSplineNode*>(node.get());
+    const float error = spline->Bake(movieLength, samplesPerBeat, maxError);
+    if (!spline->IsBaked()) {
+      statistics.mSkippedCount++;
+      continue;
+    }
+    statistics.mBakedCount++;
+    statistics.mSampleCount += spline->GetBakedSampleCount();
+    statistics.mMaxError = std::max(statistics.mMaxError, error);
+  }
+  return statistics;
+}
+
+void Document::HandleMessage(Message* message) {
+  switch (message->mType) {
+  case MessageType::TRANSITIVE_CLOSURE_CHANGED:
+    mSchedule.Invalidate();
+    break;
+  default: break;
+  }
+}
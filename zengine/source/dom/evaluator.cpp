@@ -0,0 +1,100 @@
+#include <include/dom/evaluator.h>
+
+ParallelEvaluator::ParallelEvaluator(ThreadPool* threadPool)
+  : mThreadPool(threadPool)
+{}
+
+void ParallelEvaluator::Update(
+  const std::vector<std::shared_ptr<Node>>& topologicalOrder)
+{
+  BuildWavefronts(topologicalOrder);
+  for (const std::vector<Node*>& wavefront : mWavefronts) {
+    if (!wavefront.empty()) EvaluateWavefront(wavefront);
+  }
+}
+
+void ParallelEvaluator::BuildWavefronts(
+  const std::vector<std::shared_ptr<Node>>& topologicalOrder)
+{
+  mWavefrontIndices.clear();
+  for (std::vector<Node*>& wavefront : mWavefronts) wavefront.clear();
+
+  for (const std::shared_ptr<Node>& node : topologicalOrder) {
+    /// Dependencies precede the node in topological order. Nodes outside of 
+    /// the closure are ignored, those are evaluated on demand.
+    UINT index = 0;
+    for (Slot* slot : node->GetTraversableSlots()) {
+      if (slot->mIsMultiSlot) {
+        for (const std::shared_ptr<Node>& directNode : slot->GetDirectMultiNodes()) {
+          auto it = mWavefrontIndices.find(directNode.get());
+          if (it != mWavefrontIndices.end() && it->second >= index) {
+            index = it->second + 1;
+          }
+        }
+      }
+      else {
+        auto it = mWavefrontIndices.find(slot->GetDirectNode().get());
+        if (it != mWavefrontIndices.end() && it->second >= index) {
+          index = it->second + 1;
+        }
+      }
+    }
+    if (node->IsGhostNode()) {
+      /// Ghosts are read through their internal nodes
+      auto it = mWavefrontIndices.find(node->GetReferencedNode().get());
+      if (it != mWavefrontIndices.end() && it->second >= index) {
+        index = it->second + 1;
+      }
+    }
+    mWavefrontIndices[node.get()] = index;
+
+    /// Ghosts are always visited, see EvaluateWavefront
+    if (!node->IsGhostNode() && 
+      (node->mIsUpToDate || !node->mIsProperlyConnected)) continue;
+    if (index >= mWavefronts.size()) mWavefronts.resize(index + 1);
+    mWavefronts[index].push_back(node.get());
+  }
+}
+
+void ParallelEvaluator::EvaluateWavefront(const std::vector<Node*>& wavefront) {
+  mWorkerNodes.clear();
+  for (Node* node : wavefront) {
+    if (node->GetThreadAffinity() != ThreadAffinity::MAIN_THREAD) {
+      /// Inputs from earlier wavefronts are already up to date, but nodes 
+      /// outside of the closure are evaluated here. Workers only read them.
+      node->UpdateInputs();
+      mWorkerNodes.push_back(node);
+    }
+  }
+
+  mThreadPool->ParallelFor(UINT(mWorkerNodes.size()), [this](UINT i) {
+    Node* node = mWorkerNodes[i];
+    node->Prepare();
+    if (node->GetThreadAffinity() == ThreadAffinity::ANY_THREAD) {
+      node->Operate();
+      node->mIsUpToDate = true;
+    }
+  });
+
+  /// Pinned parts, in the original topological order
+  for (Node* node : wavefront) {
+    if (node->IsGhostNode()) {
+      /// Internal nodes of ghosts aren't part of the closure. They must be up
+      /// to date before dependants read them from worker threads.
+      const std::shared_ptr<Node> referencedNode = node->GetReferencedNode();
+      if (referencedNode) referencedNode->Update();
+    }
+    switch (node->GetThreadAffinity()) {
+    case ThreadAffinity::MAIN_THREAD:
+      node->Prepare();
+      node->Operate();
+      node->mIsUpToDate = true;
+      break;
+    case ThreadAffinity::PREPARE_ON_ANY_THREAD:
+      node->Operate();
+      node->mIsUpToDate = true;
+      break;
+    default: break;
+    }
+  }
+}
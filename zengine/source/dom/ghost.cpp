@@ -54,7 +54,8 @@ private:
 };
 
 Ghost::Ghost()
-  : mOriginalNode(this, "Original", false, false, true, true)
+  : Node(true)
+  , mOriginalNode(this, "Original", false, false, true, true)
   , mMainInternalNode(this, std::string(), false, false, false, false)
 {
   Regenerate();
@@ -4,56 +4,322 @@
 #include <include/base/helpers.h>
 #include <algorithm>
 #include <utility>
+#include <climits>
 
 MessageQueue TheMessageQueue;
 
+static const UINT InitialMessageQueueSize = 256;
+
+/// Level of nodes in dependency cycles, their messages are delivered last
+static const UINT UnorderedLevel = UINT_MAX;
+
 void MessageQueue::Enqueue(const std::shared_ptr<Node>& source, 
   const std::shared_ptr<Node>& target, MessageType type, Slot* slot)
 {
-  const Message message = { source, target, slot, type };
-  if (mMessageSet.find(message) != mMessageSet.end()) return;
-  mMessageQueue.push_back(message);
-  mMessageSet.insert(message);
+  const QueuedMessage message = { source.get(), target.get(), slot, type };
 
-  if (!mIsInProgress) {
+  /// Connection changes reshape the graph the levels were calculated for
+  if (type == MessageType::SLOT_CONNECTION_CHANGED ||
+    type == MessageType::SLOT_STRUCTURE_CHANGED) mAreTopologicalLevelsValid = false;
+
+  if (!InsertToDedupTable(message)) {
+    mStatistics.mMergedCount++;
+    return;
+  }
+  PushBack(message);
+
+  if (!mIsInProgress && mBatchDepth == 0) {
     mIsInProgress = true;
     ProcessAllMessages();
     mIsInProgress = false;
   }
 }
 
+void MessageQueue::BeginBatch(bool isTimeTick) {
+  mIsTimeTickBatch = (mBatchDepth == 0 || mIsTimeTickBatch) && isTimeTick;
+  mBatchDepth++;
+}
+
+void MessageQueue::CommitBatch() {
+  ASSERT(mBatchDepth > 0);
+  if (--mBatchDepth > 0 || mIsInProgress) return;
+  mIsInProgress = true;
+  mIsDeliveringTimeTick = mIsTimeTickBatch;
+  ProcessMessagesInTopologicalOrder();
+  mIsDeliveringTimeTick = false;
+  mIsInProgress = false;
+}
+
+bool MessageQueue::IsDeliveringTimeTick() const {
+  return mIsDeliveringTimeTick;
+}
+
+const MessageQueue::Statistics& MessageQueue::GetStatistics() const {
+  return mStatistics;
+}
+
+void MessageQueue::ResetStatistics() {
+  mStatistics = Statistics();
+}
+
 void MessageQueue::ProcessAllMessages() {
-  while (!mMessageQueue.empty()) {
-    Message message = mMessageQueue.front();
-    mMessageQueue.pop_front();
-    mMessageSet.erase(message);
-    message.mTarget->ReceiveMessage(&message);
+  while (mRingCount > 0) {
+    const QueuedMessage queued = PopFront();
+
+    /// Skip tombstones of removed messages
+    if (queued.mTarget != nullptr) Deliver(queued);
+  }
+}
+
+void MessageQueue::ProcessMessagesInTopologicalOrder() {
+  /// Levels are calculated once per batch. Delivery only adds messages to
+  /// nodes downstream, which already have their levels, unless it changes the
+  /// graph.
+  mAreTopologicalLevelsValid = false;
+  while (mRingCount > 0) {
+    const UINT minimumLevel = GetMinimumPendingLevel();
+
+    /// Deliver the lowest level, keep the rest in their original order. 
+    /// Messages sent meanwhile are appended after the ones visited here.
+    const UINT count = mRingCount;
+    for (UINT i = 0; i < count; i++) {
+      const QueuedMessage queued = PopFront();
+      if (queued.mTarget == nullptr) continue;
+      if (GetTopologicalLevel(queued.mTarget) == minimumLevel) Deliver(queued);
+      else Requeue(queued);
+    }
+  }
+}
+
+UINT MessageQueue::GetMinimumPendingLevel() {
+  const UINT mask = UINT(mRing.size()) - 1;
+  for (;;) {
+    if (!mAreTopologicalLevelsValid) {
+      CalculateTopologicalLevels();
+      mAreTopologicalLevelsValid = true;
+    }
+    UINT minimumLevel = UnorderedLevel;
+    bool isComplete = true;
+    for (UINT i = 0; i < mRingCount && isComplete; i++) {
+      Node* target = mRing[(mRingHead + i) & mask].mTarget;
+      if (target == nullptr) continue;
+      if (mInputCounts.find(target) == mInputCounts.end()) isComplete = false;
+      else minimumLevel = std::min(minimumLevel, GetTopologicalLevel(target));
+    }
+    if (isComplete) return minimumLevel;
+    mAreTopologicalLevelsValid = false;
+  }
+}
+
+void MessageQueue::CalculateTopologicalLevels() {
+  mTopologicalLevels.clear();
+  mInputCounts.clear();
+  mReachableNodes.clear();
+
+  /// Collect the nodes reachable from the targets, and count their inputs 
+  /// from within the reachable part of the graph
+  const UINT mask = UINT(mRing.size()) - 1;
+  for (UINT i = 0; i < mRingCount; i++) {
+    Node* target = mRing[(mRingHead + i) & mask].mTarget;
+    if (target && mInputCounts.emplace(target, 0).second) {
+      mReachableNodes.push_back(target);
+    }
+  }
+  for (size_t i = 0; i < mReachableNodes.size(); i++) {
+    for (Slot* slot : mReachableNodes[i]->mDependants) {
+      if (slot->IsOwnerExpired()) continue;
+      Node* owner = slot->GetOwner().get();
+      auto it = mInputCounts.emplace(owner, 0);
+      if (it.second) mReachableNodes.push_back(owner);
+      it.first->second++;
+    }
+  }
+
+  /// Kahn's algorithm, reusing mReachableNodes as the queue. A node's level is
+  /// one more than the level of its deepest input. Nodes in cycles are left out.
+  size_t readIndex = 0;
+  size_t writeIndex = 0;
+  for (Node* node : mReachableNodes) {
+    if (mInputCounts[node] == 0) {
+      mTopologicalLevels[node] = 0;
+      mReachableNodes[writeIndex++] = node;
+    }
+  }
+  while (readIndex < writeIndex) {
+    Node* node = mReachableNodes[readIndex++];
+    const UINT level = mTopologicalLevels[node];
+    for (Slot* slot : node->mDependants) {
+      if (slot->IsOwnerExpired()) continue;
+      Node* owner = slot->GetOwner().get();
+      UINT& ownerLevel = mTopologicalLevels[owner];
+      ownerLevel = std::max(ownerLevel, level + 1);
+      if (--mInputCounts[owner] == 0) mReachableNodes[writeIndex++] = owner;
+    }
+  }
+}
+
+UINT MessageQueue::GetTopologicalLevel(Node* node) const {
+  auto it = mTopologicalLevels.find(node);
+  if (it == mTopologicalLevels.end() || mInputCounts.at(node) > 0) {
+    return UnorderedLevel;
+  }
+  return it->second;
+}
+
+void MessageQueue::Deliver(const QueuedMessage& queued) {
+  RemoveFromDedupTable(queued);
+  RemoveReference(queued);
+
+  /// Nodes being destroyed can't receive messages anymore
+  std::shared_ptr<Node> target = queued.mTarget->weak_from_this().lock();
+  if (!target) return;
+  Message message = { 
+    queued.mSource ? queued.mSource->weak_from_this().lock() : nullptr,
+    std::move(target), queued.mSlot, queued.mType };
+  mStatistics.mDeliveredCount++;
+  mOnMessageDelivered(&message);
+  message.mTarget->ReceiveMessage(&message);
+  if (message.mType == MessageType::TRANSITIVE_CLOSURE_CHANGED) {
+    mAreTopologicalLevelsValid = false;
   }
 }
 
 void MessageQueue::RemoveNode(Node* node) {
-start:
-  for (auto it = mMessageQueue.begin(); it != mMessageQueue.end(); ++it) {
-    Message message = *it;
-    if (message.mTarget == nullptr || message.mTarget.get() != node) continue;
-    mMessageQueue.erase(it);
-    mMessageSet.erase(message);
-    goto start;  // NOLINT
-  }
-}
-
-bool Message::operator<(const Message& other) const {
-  if (this->mTarget < other.mTarget) return true;
-  if (this->mTarget == other.mTarget) {
-    if (this->mSource < other.mSource) return true;
-    if (this->mSource == other.mSource) {
-      if (this->mSlot < other.mSlot) return true;
-      if (this->mSlot == other.mSlot) {
-        if (this->mType < other.mType) return true;
-      }
+  /// A new node may get the same address
+  mAreTopologicalLevelsValid = false;
+
+  /// Most nodes don't have pending messages when they get destroyed. The
+  /// dedup table is keyed by the whole message, so it can't find the messages
+  /// of a node, the ring is scanned instead.
+  if (node->mQueuedMessageCount == 0) return;
+
+  const UINT mask = UINT(mRing.size()) - 1;
+  for (UINT i = 0; i < mRingCount && node->mQueuedMessageCount > 0; i++) {
+    QueuedMessage& message = mRing[(mRingHead + i) & mask];
+    if (message.mTarget == nullptr) continue;
+    if (message.mTarget != node && message.mSource != node) continue;
+
+    RemoveFromDedupTable(message);
+    RemoveReference(message);
+    if (message.mTarget == node) {
+      /// Tombstone, ProcessAllMessages will skip it
+      message.mTarget = nullptr;
+      continue;
+    }
+
+    /// The message stays, but its source is gone
+    message.mSource = nullptr;
+    if (InsertToDedupTable(message)) {
+      AddReference(message);
+    } else {
+      message.mTarget = nullptr;
     }
   }
-  return false;
+}
+
+void MessageQueue::PushBack(const QueuedMessage& message) {
+  Requeue(message);
+  AddReference(message);
+}
+
+QueuedMessage MessageQueue::PopFront() {
+  const QueuedMessage message = mRing[mRingHead];
+  mRingHead = (mRingHead + 1) & (UINT(mRing.size()) - 1);
+  mRingCount--;
+  return message;
+}
+
+void MessageQueue::Requeue(const QueuedMessage& message) {
+  if (mRingCount == mRing.size()) GrowRing();
+  const UINT mask = UINT(mRing.size()) - 1;
+  mRing[(mRingHead + mRingCount) & mask] = message;
+  mRingCount++;
+}
+
+void MessageQueue::GrowRing() {
+  const UINT oldSize = UINT(mRing.size());
+  const UINT newSize = oldSize == 0 ? InitialMessageQueueSize : oldSize * 2;
+  std::vector<QueuedMessage> newRing(newSize);
+  for (UINT i = 0; i < mRingCount; i++) {
+    newRing[i] = mRing[(mRingHead + i) & (oldSize - 1)];
+  }
+  mRing.swap(newRing);
+  mRingHead = 0;
+}
+
+bool MessageQueue::InsertToDedupTable(const QueuedMessage& message) {
+  /// Keep load factor under 50%
+  if ((mDedupCount + 1) * 2 > mDedupTable.size()) GrowDedupTable();
+  const UINT mask = UINT(mDedupTable.size()) - 1;
+  UINT i = UINT(message.Hash()) & mask;
+  while (mDedupTable[i].mTarget != nullptr) {
+    if (mDedupTable[i] == message) return false;
+    i = (i + 1) & mask;
+  }
+  mDedupTable[i] = message;
+  mDedupCount++;
+  return true;
+}
+
+void MessageQueue::RemoveFromDedupTable(const QueuedMessage& message) {
+  const UINT mask = UINT(mDedupTable.size()) - 1;
+  UINT i = UINT(message.Hash()) & mask;
+  while (!(mDedupTable[i] == message)) {
+    ASSERT(mDedupTable[i].mTarget != nullptr);
+    i = (i + 1) & mask;
+  }
+
+  /// Backward shift deletion, no tombstones needed in the hash table
+  UINT hole = i;
+  for (UINT k = (hole + 1) & mask; mDedupTable[k].mTarget != nullptr; k = (k + 1) & mask) {
+    const UINT home = UINT(mDedupTable[k].Hash()) & mask;
+    /// Move the entry if its home position is not within (hole, k]
+    if (((k - home) & mask) >= ((k - hole) & mask)) {
+      mDedupTable[hole] = mDedupTable[k];
+      hole = k;
+    }
+  }
+  mDedupTable[hole].mTarget = nullptr;
+  mDedupCount--;
+}
+
+void MessageQueue::GrowDedupTable() {
+  const UINT oldSize = UINT(mDedupTable.size());
+  const UINT newSize = oldSize == 0 ? InitialMessageQueueSize * 2 : oldSize * 2;
+  std::vector<QueuedMessage> oldTable(newSize, QueuedMessage{});
+  oldTable.swap(mDedupTable);
+  mDedupCount = 0;
+  for (const QueuedMessage& message : oldTable) {
+    if (message.mTarget != nullptr) InsertToDedupTable(message);
+  }
+}
+
+void MessageQueue::AddReference(const QueuedMessage& message) {
+  message.mTarget->mQueuedMessageCount++;
+  if (message.mSource && message.mSource != message.mTarget) {
+    message.mSource->mQueuedMessageCount++;
+  }
+}
+
+void MessageQueue::RemoveReference(const QueuedMessage& message) {
+  message.mTarget->mQueuedMessageCount--;
+  if (message.mSource && message.mSource != message.mTarget) {
+    message.mSource->mQueuedMessageCount--;
+  }
+}
+
+bool QueuedMessage::operator==(const QueuedMessage& other) const {
+  return mTarget == other.mTarget && mSource == other.mSource && 
+    mSlot == other.mSlot && mType == other.mType;
+}
+
+size_t QueuedMessage::Hash() const {
+  size_t hash = reinterpret_cast<size_t>(mTarget);
+  hash = hash * 31 + reinterpret_cast<size_t>(mSource);
+  hash = hash * 31 + reinterpret_cast<size_t>(mSlot);
+  hash = hash * 31 + size_t(mType);
+  /// Pointers are aligned, mix the high bits down
+  return hash ^ (hash >> 17) ^ (hash >> 31);
 }
 
 Slot::Slot(Node* owner, std::string name, bool isMultiSlot, bool isPublic, 
@@ -158,6 +424,18 @@ std::shared_ptr<Node> Slot::GetReferencedNode() const {
 }
 
 
+Node* Slot::GetReferencedNodeRaw() const {
+  ASSERT(!mIsMultiSlot);
+  return mNode ? mNode->GetReferencedNodeRaw() : nullptr;
+}
+
+
+Node* Slot::GetReferencedMultiNodeRaw(UINT index) const {
+  ASSERT(index >= 0 && index < mMultiNodes.size());
+  return mMultiNodes[index]->GetReferencedNodeRaw();
+}
+
+
 std::shared_ptr<Node> Slot::GetDirectNode() const {
   ASSERT(!mIsMultiSlot);
   return mNode;
@@ -228,7 +506,9 @@ bool Slot::IsGhost() const
   return mGhostSlot;
 }
 
-Node::Node(bool isForwarderNode) {
+Node::Node(bool isForwarderNode)
+  : mIsForwarderNode(isForwarderNode)
+{
   mIsUpToDate = false;
   mIsProperlyConnected = true;
 }
@@ -259,9 +539,25 @@ std::shared_ptr<Node> Node::GetReferencedNode() {
 }
 
 
+Node* Node::GetReferencedNodeRaw() {
+  if (!mIsForwarderNode) return this;
+
+  /// The forwarder owns the referenced node, the pointer outlives the temporary
+  return GetReferencedNode().get();
+}
+
+
 bool Node::IsGhostNode() {
   return false;
 }
+
+ThreadAffinity Node::GetThreadAffinity() const {
+  return ThreadAffinity::MAIN_THREAD;
+}
+
+bool Node::IsTimeSource() const {
+  return false;
+}
   
 void Node::Dispose() {
   RemoveAllWatchers();
@@ -342,22 +638,27 @@ void Node::EnqueueMessage(MessageType message, Slot* slot /*= nullptr*/,
 
 void Node::Update() {
   if (!mIsUpToDate && mIsProperlyConnected) {
-    for (Slot* slot : mPublicSlots) {
-      if (slot->mIsMultiSlot) {
-        for (UINT i = 0; i < slot->GetMultiNodeCount(); i++) {
-          slot->GetReferencedMultiNode(i)->Update();
-        }
-      }
-      else {
-        std::shared_ptr<Node> node = slot->GetReferencedNode();
-        if (node) node->Update();
-      }
-    }
+    UpdateInputs();
+    Prepare();
     Operate();
     mIsUpToDate = true;
   }
 }
 
+void Node::UpdateInputs() {
+  for (Slot* slot : mPublicSlots) {
+    if (slot->mIsMultiSlot) {
+      for (UINT i = 0; i < slot->GetMultiNodeCount(); i++) {
+        slot->GetReferencedMultiNode(i)->Update();
+      }
+    }
+    else {
+      std::shared_ptr<Node> node = slot->GetReferencedNode();
+      if (node) node->Update();
+    }
+  }
+}
+
 
 Node::~Node() {
   /// Don't send any more messages to this node.
@@ -395,6 +696,7 @@ const std::string& Node::GetName() const {
 void Node::SetPosition(const vec2 position) {
   mPosition.x = floorf(position.x);
   mPosition.y = floorf(position.y);
+  EnqueueMessage(MessageType::NODE_POSITION_CHANGED);
   NotifyWatchers(&Watcher::OnGraphPositionChanged);
 }
 
@@ -0,0 +1,125 @@
+#include <include/dom/schedule.h>
+
+EvaluationSchedule::EvaluationSchedule(Node* root, bool includeHiddenSlots)
+  : mRoot(root)
+  , mIncludeHiddenSlots(includeHiddenSlots)
+{}
+
+void EvaluationSchedule::Invalidate() {
+  mIsValid = false;
+
+  /// Release references early, unless nodes are being operated right now
+  if (!mIsUpdating) {
+    mNodes.clear();
+    mTimeDependentNodes.clear();
+    mTimeDependency.clear();
+  }
+}
+
+void EvaluationSchedule::Update() {
+  if (!mIsValid) Rebuild();
+  mIsUpdating = true;
+  for (const std::shared_ptr<Node>& node : mNodes) UpdateNode(node.get());
+  mIsUpdating = false;
+}
+
+void EvaluationSchedule::UpdateTimeDependentNodes() {
+  if (!mIsValid) Rebuild();
+  mIsUpdating = true;
+  for (Node* node : mTimeDependentNodes) UpdateNode(node);
+  mIsUpdating = false;
+}
+
+void EvaluationSchedule::UpdateNode(Node* node) {
+  if (!node->mIsUpToDate && node->mIsProperlyConnected) {
+    /// Earlier nodes of the schedule are already up to date, but overrides 
+    /// capture their input values for Prepare() here
+    node->UpdateInputs();
+    node->Prepare();
+    node->Operate();
+    node->mIsUpToDate = true;
+  }
+}
+
+const std::vector<std::shared_ptr<Node>>& EvaluationSchedule::GetNodes() {
+  if (!mIsValid) Rebuild();
+  return mNodes;
+}
+
+bool EvaluationSchedule::IsTimeDependent(Node* node) {
+  if (!mIsValid) Rebuild();
+  auto it = mTimeDependency.find(node);
+  if (it != mTimeDependency.end()) return it->second;
+
+  /// Hidden slots count too, splines are connected to scene time that way
+  bool isTimeDependent = node->IsTimeSource();
+  for (Slot* slot : node->GetTraversableSlots()) {
+    if (isTimeDependent) break;
+    if (slot->mIsMultiSlot) {
+      for (const std::shared_ptr<Node>& directNode : slot->GetDirectMultiNodes()) {
+        if (IsTimeDependent(directNode.get())) {
+          isTimeDependent = true;
+          break;
+        }
+      }
+    }
+    else if (!slot->IsDefaulted()) {
+      Node* dependency = slot->GetDirectNode().get();
+      if (dependency != nullptr && IsTimeDependent(dependency)) isTimeDependent = true;
+    }
+  }
+  if (!isTimeDependent) {
+    Node* referencedNode = node->GetReferencedNodeRaw();
+    if (referencedNode != nullptr && referencedNode != node) {
+      isTimeDependent = IsTimeDependent(referencedNode);
+    }
+  }
+
+  mTimeDependency[node] = isTimeDependent;
+  return isTimeDependent;
+}
+
+void EvaluationSchedule::Rebuild() {
+  ASSERT(!mIsUpdating);
+  mNodes.clear();
+  mTimeDependentNodes.clear();
+  mTimeDependency.clear();
+  mIsValid = true;
+  if (mRoot->weak_from_this().expired()) return;
+
+  std::unordered_set<Node*> visited;
+  Traverse(mRoot->shared_from_this(), visited);
+
+  for (const std::shared_ptr<Node>& node : mNodes) {
+    if (IsTimeDependent(node.get())) mTimeDependentNodes.push_back(node.get());
+  }
+}
+
+void EvaluationSchedule::Traverse(const std::shared_ptr<Node>& node, 
+  std::unordered_set<Node*>& visited) 
+{
+  if (!visited.insert(node.get()).second) return;
+
+  /// Follows the same edges as GenerateTransitiveClosure()
+  const std::vector<Slot*>& slots =
+    mIncludeHiddenSlots ? node->GetTraversableSlots() : node->GetPublicSlots();
+  for (Slot* slot : slots) {
+    if (slot->mIsMultiSlot) {
+      for (const std::shared_ptr<Node>& directNode : slot->GetDirectMultiNodes()) {
+        Traverse(directNode, visited);
+      }
+    }
+    else if (!slot->IsDefaulted()) {
+      const std::shared_ptr<Node> dependency = slot->GetDirectNode();
+      if (dependency != nullptr) Traverse(dependency, visited);
+    }
+  }
+
+  /// Ghosts forward to their internal nodes, those need to be evaluated first
+  const std::shared_ptr<Node> referencedNode = node->GetReferencedNode();
+  if (referencedNode != nullptr && referencedNode != node) {
+    Traverse(referencedNode, visited);
+  }
+
+  if (node.get() != mRoot) mNodes.push_back(node);
+}
@@ -44,7 +44,7 @@ void ClipNode::Draw(RenderTarget* renderTarget, Globals* globals, float clipTime
     OpenGL->Clear(clearColor, clearDepth);
   }
 
-  const auto& scene = mSceneSlot.GetNode();
+  SceneNode* scene = mSceneSlot.GetNodeRaw();
   if (!scene) return;
 
   float fakeClipTime = clipTime;
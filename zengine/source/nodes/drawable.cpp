@@ -19,8 +19,8 @@ Drawable::Drawable()
 Drawable::~Drawable() = default;
 
 void Drawable::Draw(Globals* oldGlobals, PassType passType, PrimitiveTypeEnum Primitive) {
-  const auto& material = mMaterial.GetNode();
-  const auto& meshNode = mMesh.GetNode();
+  Material* material = mMaterial.GetNodeRaw();
+  MeshNode* meshNode = mMesh.GetNodeRaw();
 
   if (mChildren.GetMultiNodeCount() == 0 && !(material && meshNode)) return;
   Globals globals = *oldGlobals;
@@ -31,7 +31,7 @@ void Drawable::Draw(Globals* oldGlobals, PassType passType, PrimitiveTypeEnum Pr
     const std::shared_ptr<Mesh>& mesh = meshNode->GetMesh();
 
     /// Set pass (pipeline state)
-    const auto& pass = material->GetPass(passType);
+    Pass* pass = material->GetPass(passType);
     if (!pass) return;
     pass->Update();
 
@@ -42,7 +42,7 @@ void Drawable::Draw(Globals* oldGlobals, PassType passType, PrimitiveTypeEnum Pr
   }
 
   for (UINT i = 0; i < mChildren.GetMultiNodeCount(); i++) {
-    PointerCast<Drawable>(mChildren.GetReferencedMultiNode(i))->Draw(&globals, passType);
+    SafeCast<Drawable*>(mChildren.GetReferencedMultiNodeRaw(i))->Draw(&globals, passType);
   }
 }
 
@@ -56,7 +56,7 @@ void Drawable::ComputeForcedShadowCenter(Globals* globals, vec3& oShadowCenter)
     oShadowCenter = vec3(s.x, s.y, s.z);
   }
   for (UINT i = 0; i < mChildren.GetMultiNodeCount(); i++) {
-    PointerCast<Drawable>(mChildren.GetReferencedMultiNode(i))->ComputeForcedShadowCenter(
+    SafeCast<Drawable*>(mChildren.GetReferencedMultiNodeRaw(i))->ComputeForcedShadowCenter(
       &currentGlobals, oShadowCenter);
   }
 }
@@ -1,4 +1,7 @@
 #include <include/nodes/meshgenerators.h>
+#include <include/base/threadpool.h>
+#include <algorithm>
+#include <emmintrin.h>
 
 REGISTER_NODECLASS(CubeMeshNode, "Cube");
 REGISTER_NODECLASS(HalfCubeMeshNode, "HalfCube");
@@ -9,6 +12,297 @@ REGISTER_NODECLASS(PolarSphereMeshNode, "PolarSphere");
 using glm::vec3;
 using glm::vec2;
 
+namespace {
+  /// Geosphere faces are split into jobs of about this many vertices or triangles
+  const int GeosphereJobSize = 8192;
+
+  /// Smaller meshes are generated on the calling thread
+  const int MinParallelVertexCount = 4096;
+
+  /// Four vectors in SoA layout
+  struct Vec3SSE {
+    __m128 x, y, z;
+  };
+
+  Vec3SSE SplatSSE(const vec3& v) {
+    return { _mm_set1_ps(v.x), _mm_set1_ps(v.y), _mm_set1_ps(v.z) };
+  }
+
+  Vec3SSE AddSSE(const Vec3SSE& a, const Vec3SSE& b) {
+    return { _mm_add_ps(a.x, b.x), _mm_add_ps(a.y, b.y), _mm_add_ps(a.z, b.z) };
+  }
+
+  Vec3SSE SubSSE(const Vec3SSE& a, const Vec3SSE& b) {
+    return { _mm_sub_ps(a.x, b.x), _mm_sub_ps(a.y, b.y), _mm_sub_ps(a.z, b.z) };
+  }
+
+  Vec3SSE MulSSE(const Vec3SSE& a, __m128 s) {
+    return { _mm_mul_ps(a.x, s), _mm_mul_ps(a.y, s), _mm_mul_ps(a.z, s) };
+  }
+
+  /// Same operations in the same order as glm::normalize(), so the result is
+  /// bit-identical to the scalar code
+  Vec3SSE NormalizeSSE(const Vec3SSE& v) {
+    const __m128 dot = _mm_add_ps(
+      _mm_add_ps(_mm_mul_ps(v.x, v.x), _mm_mul_ps(v.y, v.y)), _mm_mul_ps(v.z, v.z));
+    return MulSSE(v, _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(dot)));
+  }
+
+  /// Same as glm::cross(), multiplications by zero are kept for signed zeros
+  Vec3SSE CrossSSE(const Vec3SSE& a, const Vec3SSE& b) {
+    return {
+      _mm_sub_ps(_mm_mul_ps(a.y, b.z), _mm_mul_ps(b.y, a.z)),
+      _mm_sub_ps(_mm_mul_ps(a.z, b.x), _mm_mul_ps(b.z, a.x)),
+      _mm_sub_ps(_mm_mul_ps(a.x, b.y), _mm_mul_ps(b.x, a.y)),
+    };
+  }
+
+  /// Selects a where the mask is set, b elsewhere
+  __m128 SelectSSE(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+  }
+
+  /// atan2f() for SSE2, with the Cephes atanf polynomial. The error is below
+  /// 2.5e-7 radians. Signed zeros are handled like atan2f(), which matters at
+  /// the texture seam of spheres.
+  __m128 Atan2SSE(__m128 y, __m128 x) {
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 absY = _mm_andnot_ps(signMask, y);
+    const __m128 absX = _mm_andnot_ps(signMask, x);
+
+    /// atan(y/x) for |y| <= |x|, pi/2 - atan(x/y) otherwise. 0/0 is taken as 0.
+    const __m128 isSwapped = _mm_cmpgt_ps(absY, absX);
+    const __m128 numerator = _mm_min_ps(absY, absX);
+    const __m128 denominator = _mm_max_ps(absY, absX);
+    __m128 a = _mm_and_ps(_mm_div_ps(numerator, denominator),
+      _mm_cmpgt_ps(denominator, _mm_setzero_ps()));
+
+    /// Reduction to |a| <= tan(pi/8)
+    const __m128 isReduced = _mm_cmpgt_ps(a, _mm_set1_ps(0.414213562373095f));
+    const __m128 one = _mm_set1_ps(1.0f);
+    a = SelectSSE(isReduced,
+      _mm_div_ps(_mm_sub_ps(a, one), _mm_add_ps(a, one)), a);
+    const __m128 offset = _mm_and_ps(isReduced, _mm_set1_ps(Pi * 0.25f));
+
+    const __m128 a2 = _mm_mul_ps(a, a);
+    __m128 poly = _mm_set1_ps(8.05374449538e-2f);
+    poly = _mm_add_ps(_mm_mul_ps(poly, a2), _mm_set1_ps(-1.38776856032e-1f));
+    poly = _mm_add_ps(_mm_mul_ps(poly, a2), _mm_set1_ps(1.99777106478e-1f));
+    poly = _mm_add_ps(_mm_mul_ps(poly, a2), _mm_set1_ps(-3.33329491539e-1f));
+    __m128 angle = _mm_add_ps(offset,
+      _mm_add_ps(_mm_mul_ps(_mm_mul_ps(poly, a2), a), a));
+
+    angle = SelectSSE(isSwapped, _mm_sub_ps(_mm_set1_ps(Pi * 0.5f), angle), angle);
+
+    /// Negative x, including -0, mirrors to the other side
+    const __m128 isXNegative = _mm_castsi128_ps(
+      _mm_srai_epi32(_mm_castps_si128(x), 31));
+    angle = SelectSSE(isXNegative, _mm_sub_ps(_mm_set1_ps(Pi), angle), angle);
+
+    return _mm_or_ps(angle, _mm_and_ps(signMask, y));
+  }
+
+  /// One side of the tetrahedron
+  struct GeosphereFace {
+    vec3 mP1;
+    vec3 mD1;
+    vec3 mD2;
+    vec3 mFlatNormal;
+  };
+
+  /// Index of the first vertex of a row in a face
+  int GetGeosphereRowStart(int maxCoord, int y) {
+    return y * (maxCoord + 1) - y * (y - 1) / 2;
+  }
+
+  /// Generates the vertices of rows [firstRow, endRow) of a face at unit size,
+  /// four at a time
+  void MakeGeosphereVertices(const GeosphereFace& face, float flatten,
+    int resolution, int firstRow, int endRow, VertexPosUvNormTangent* faceVertices)
+  {
+    const int maxCoord = 1 << resolution;
+    const float vRecip = 1.0f / float(maxCoord);
+
+    const Vec3SSE p1 = SplatSSE(face.mP1);
+    const Vec3SSE d1 = SplatSSE(face.mD1);
+    const Vec3SSE d2 = SplatSSE(face.mD2);
+    const Vec3SSE flatNormal = SplatSSE(face.mFlatNormal);
+    const Vec3SSE upVector = SplatSSE(vec3(0, 1, 0));
+    const __m128 flatten4 = _mm_set1_ps(flatten);
+    const __m128 vRecip4 = _mm_set1_ps(vRecip);
+    const __m128 pi = _mm_set1_ps(Pi);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128i laneOffsets = _mm_set_epi32(3, 2, 1, 0);
+
+    VertexPosUvNormTangent* vertexTarget =
+      faceVertices + GetGeosphereRowStart(maxCoord, firstRow);
+    for (int y = firstRow; y < endRow; y++) {
+      const __m128 yr = _mm_set1_ps(float(y) * vRecip);
+      const int rowLength = maxCoord - y + 1;
+      for (int x = 0; x < rowLength; x += 4) {
+        /// Lanes past the end of the row are computed, but not stored
+        const __m128 xr = _mm_mul_ps(
+          _mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(x), laneOffsets)), vRecip4);
+        const Vec3SSE p = AddSSE(AddSSE(p1, MulSSE(d1, xr)), MulSSE(d2, yr));
+        const Vec3SSE spherical = NormalizeSSE(p);
+        const Vec3SSE pos = AddSSE(spherical, MulSSE(SubSSE(p, spherical), flatten4));
+        const Vec3SSE normal =
+          AddSSE(spherical, MulSSE(SubSSE(flatNormal, spherical), flatten4));
+        const Vec3SSE tangent = NormalizeSSE(CrossSSE(upVector, normal));
+        const __m128 urad = Atan2SSE(spherical.x, spherical.z);
+        const __m128 xz = _mm_sqrt_ps(_mm_add_ps(
+          _mm_mul_ps(spherical.x, spherical.x), _mm_mul_ps(spherical.z, spherical.z)));
+        const __m128 vrad = Atan2SSE(xz, spherical.y);
+        const __m128 u = _mm_add_ps(_mm_mul_ps(_mm_div_ps(urad, pi), half), half);
+        const __m128 v = _mm_add_ps(_mm_div_ps(vrad, pi), half);
+
+        /// Transpose to the vertex layout
+        float lanes[11][4];
+        _mm_storeu_ps(lanes[0], pos.x);
+        _mm_storeu_ps(lanes[1], pos.y);
+        _mm_storeu_ps(lanes[2], pos.z);
+        _mm_storeu_ps(lanes[3], u);
+        _mm_storeu_ps(lanes[4], v);
+        _mm_storeu_ps(lanes[5], normal.x);
+        _mm_storeu_ps(lanes[6], normal.y);
+        _mm_storeu_ps(lanes[7], normal.z);
+        _mm_storeu_ps(lanes[8], tangent.x);
+        _mm_storeu_ps(lanes[9], tangent.y);
+        _mm_storeu_ps(lanes[10], tangent.z);
+        const int laneCount = std::min(4, rowLength - x);
+        for (int i = 0; i < laneCount; i++) {
+          vertexTarget->mPosition = vec3(lanes[0][i], lanes[1][i], lanes[2][i]);
+          vertexTarget->mUv = vec2(lanes[3][i], lanes[4][i]);
+          vertexTarget->mNormal = vec3(lanes[5][i], lanes[6][i], lanes[7][i]);
+          vertexTarget->mTangent = vec3(lanes[8][i], lanes[9][i], lanes[10][i]);
+          vertexTarget++;
+        }
+      }
+    }
+  }
+
+  /// Generates triangles [firstTriangle, endTriangle) of a face
+  void MakeGeosphereIndices(int resolution, int baseIndex, int firstTriangle,
+    int endTriangle, IndexEntry* faceIndices)
+  {
+    const int ox[4] = { 0, 0, 1, 1 };
+    const int oy[4] = { 0, 1, 1, 0 };
+    const int dir[4] = { 1, 1, -1, 1 };
+
+    const int maxCoord = 1 << resolution;
+    const int verticesPerSide = (maxCoord + 1) * (maxCoord + 2) / 2;
+    IndexEntry* indexTarget = faceIndices + firstTriangle * 3;
+    for (int i = firstTriangle; i < endTriangle; i++) {
+      /// Cache-friendlier ordering for really high resolution meshes
+      int k = i;
+      int x1 = 0, y1 = 0, x2 = 1, y2 = 0, x3 = 0, y3 = 1, step = 1;
+      while (k > 0) {
+        const int sel = k & 3;
+        x1 = x1 * dir[sel] + step * ox[sel];
+        y1 = y1 * dir[sel] + step * oy[sel];
+        x2 = x2 * dir[sel] + step * ox[sel];
+        y2 = y2 * dir[sel] + step * oy[sel];
+        x3 = x3 * dir[sel] + step * ox[sel];
+        y3 = y3 * dir[sel] + step * oy[sel];
+        step <<= 1;
+        k >>= 2;
+      }
+      const int index1 = x1 + verticesPerSide - ((maxCoord - y1 + 1) * (maxCoord - y1 + 2) / 2);
+      const int index2 = x2 + verticesPerSide - ((maxCoord - y2 + 1) * (maxCoord - y2 + 2) / 2);
+      const int index3 = x3 + verticesPerSide - ((maxCoord - y3 + 1) * (maxCoord - y3 + 2) / 2);
+
+      indexTarget[0] = index1 + baseIndex;
+      indexTarget[1] = index2 + baseIndex;
+      indexTarget[2] = index3 + baseIndex;
+      indexTarget += 3;
+    }
+  }
+
+  /// A band of vertex rows or a range of triangles of a face
+  struct GeosphereJob {
+    int mFace;
+    bool mIsIndices;
+    int mFirst;
+    int mEnd;
+  };
+
+  /// Shares the vertices on the tetrahedron edges between the faces, then splits
+  /// the vertices of triangles wrapping around the texture seam
+  void WeldGeosphere(int resolution, const int faceCorners[4][3],
+    std::vector<VertexPosUvNormTangent>& vertices, std::vector<IndexEntry>& indices)
+  {
+    const int maxCoord = 1 << resolution;
+    const int vertexPerSide = GetGeosphereRowStart(maxCoord, maxCoord + 1);
+
+    /// Welded vertex of each tetrahedron corner, and of each point along the
+    /// edges, counted from the lower numbered corner
+    const int edgeIDs[4][4] = {
+      { -1, 0, 1, 2 }, { 0, -1, 3, 4 }, { 1, 3, -1, 5 }, { 2, 4, 5, -1 } };
+    int cornerVertices[4] = { -1, -1, -1, -1 };
+    std::vector<int> edgeVertices(6 * (maxCoord + 1), -1);
+
+    std::vector<VertexPosUvNormTangent> welded;
+    welded.reserve(vertices.size());
+    std::vector<IndexEntry> remap(vertices.size());
+    for (int face = 0; face < 4; face++) {
+      const int* corners = faceCorners[face];
+      for (int y = 0; y <= maxCoord; y++) {
+        for (int x = 0; x <= maxCoord - y; x++) {
+          int* shared = nullptr;
+          int cornerA = -1, cornerB = -1, distance = 0;
+          if (x == 0 && y == 0) shared = &cornerVertices[corners[0]];
+          else if (x == maxCoord) shared = &cornerVertices[corners[1]];
+          else if (y == maxCoord) shared = &cornerVertices[corners[2]];
+          else if (y == 0) cornerA = corners[0], cornerB = corners[1], distance = x;
+          else if (x == 0) cornerA = corners[0], cornerB = corners[2], distance = y;
+          else if (x + y == maxCoord) {
+            cornerA = corners[1], cornerB = corners[2], distance = y;
+          }
+          if (cornerA >= 0) {
+            if (cornerA > cornerB) distance = maxCoord - distance;
+            shared = &edgeVertices[edgeIDs[cornerA][cornerB] * (maxCoord + 1) + distance];
+          }
+
+          const int index = face * vertexPerSide + GetGeosphereRowStart(maxCoord, y) + x;
+          if (shared != nullptr && *shared >= 0) {
+            remap[index] = IndexEntry(*shared);
+            continue;
+          }
+          remap[index] = IndexEntry(welded.size());
+          if (shared != nullptr) *shared = int(welded.size());
+          welded.push_back(vertices[index]);
+        }
+      }
+    }
+    for (IndexEntry& index : indices) index = remap[index];
+
+    /// Triangles on the seam span more than half of the texture. Their vertices
+    /// near 1 get a copy near 0. Triangles at the poles span exactly half.
+    std::vector<int> seamCopies(welded.size(), -1);
+    for (size_t i = 0; i < indices.size(); i += 3) {
+      float minU = 1.0f, maxU = 0.0f;
+      for (size_t o = i; o < i + 3; o++) {
+        minU = std::min(minU, welded[indices[o]].mUv.x);
+        maxU = std::max(maxU, welded[indices[o]].mUv.x);
+      }
+      if (maxU - minU <= 0.5f) continue;
+      for (size_t o = i; o < i + 3; o++) {
+        const IndexEntry index = indices[o];
+        if (welded[index].mUv.x <= 0.75f) continue;
+        if (seamCopies[index] < 0) {
+          seamCopies[index] = int(welded.size());
+          VertexPosUvNormTangent copy = welded[index];
+          copy.mUv.x -= 1.0f;
+          welded.push_back(copy);
+        }
+        indices[o] = IndexEntry(seamCopies[index]);
+      }
+    }
+
+    vertices.swap(welded);
+  }
+}
+
 CubeMeshNode::CubeMeshNode()
   : mSizeX(this, "SizeX")
   , mSizeY(this, "SizeY")
@@ -16,7 +310,7 @@ CubeMeshNode::CubeMeshNode()
 {}
 
 void CubeMeshNode::Operate() {
-  if (!mMesh) mMesh = std::make_shared<Mesh>();
+  const bool isNewMesh = MakeMeshWritable();
 
   const float x = mSizeX.Get();
   const float y = mSizeY.Get();
@@ -69,6 +363,10 @@ void CubeMeshNode::Operate() {
     }
   }
 
+  /// Size changes keep the allocations and the index buffer
+  mMesh->SetVertices(vertices);
+  if (!isNewMesh) return;
+
   IndexEntry indexes[3 * 2 * 6];
   int a = 0;
   for (int i = 0; i < 6; i++) {
@@ -81,7 +379,6 @@ void CubeMeshNode::Operate() {
     indexes[a++] = 3 + base;
   }
 
-  mMesh->SetVertices(vertices);
   mMesh->SetIndices(indexes);
 }
 
@@ -99,7 +396,8 @@ void CubeMeshNode::HandleMessage(Message* message) {
 }
 
 void HalfCubeMeshNode::Operate() {
-  if (!mMesh) mMesh = std::make_shared<Mesh>();
+  /// The geometry never changes
+  if (!MakeMeshWritable()) return;
 
   VertexPosNorm vertices[] = {
     /// Top
@@ -150,110 +448,73 @@ void HalfCubeMeshNode::HandleMessage(Message* message) {
   }
 }
 
+ThreadAffinity GeneratedMeshNode::GetThreadAffinity() const {
+  return ThreadAffinity::PREPARE_ON_ANY_THREAD;
+}
+
+void GeneratedMeshNode::Operate() {
+  const bool isNewMesh = MakeMeshWritable();
+
+  /// Vertices are scaled while they're copied into the raw data of the mesh,
+  /// which is only reallocated if the vertex count changes
+  const UINT vertexCount = UINT(mVertices.size());
+  mMesh->AllocateVertices(VertexPosUvNormTangent::mFormat, vertexCount);
+  VertexPosUvNormTangent* vertices =
+    static_cast<VertexPosUvNormTangent*>(mMesh->mRawVertexData);
+  const float size = GetSize();
+  for (UINT i = 0; i < vertexCount; i++) {
+    vertices[i] = mVertices[i];
+    vertices[i].mPosition = mVertices[i].mPosition * size;
+  }
+  mMesh->UploadVertices(vertices);
+
+  if (isNewMesh || mHasNewIndices) {
+    mMesh->AllocateIndices(UINT(mIndices.size()));
+    mMesh->UploadIndices(&mIndices[0]);
+    mHasNewIndices = false;
+  }
+}
+
 GeosphereMeshNode::GeosphereMeshNode()
   : mResolution(this, "Resolution", false, true, true, 0.0f, 8.0f)
   , mSize(this, "Size", false, true, true, 0.0f, 10.0f)
   , mFlatten(this, "Flatten", false, true, true, 0.0f, 1.0f)
+  , mWelded(this, "Welded", false, true, true, 0.0f, 1.0f)
 {
   mResolution.SetDefaultValue(5);
   mSize.SetDefaultValue(1.0f);
   mFlatten.SetDefaultValue(0);
+  mWelded.SetDefaultValue(0);
 }
 
-
-void MakeGeosphereTriangle(const vec3& p1, const vec3& p2, const vec3& p3, float flatten,
-  float size, int resolution, VertexPosUvNormTangent** oVertexTarget,
-  IndexEntry** oIndexTarget, int* oBaseIndex)
-{
-  /// Generate vertices
-  const vec3 d1 = p2 - p1;
-  const vec3 d2 = p3 - p1;
-  const vec3 flatNormal = normalize(cross(d2, d1));
-  const vec3 upVector(0, 1, 0);
-
-  VertexPosUvNormTangent* vertexTarget = *oVertexTarget;
-  const int maxCoord = 1 << resolution;
-  const float vRecip = 1.0f / float(maxCoord);
-  for (int y = 0; y <= maxCoord; y++) {
-    const float yr = float(y) * vRecip;
-    for (int x = 0; x <= maxCoord - y; x++) {
-      const float xr = float(x) * vRecip;
-      vec3 p = p1 + d1 * xr + d2 * yr;
-      vec3 spherical = normalize(p);
-      const vec3 pos = (spherical + (p - spherical) * flatten) * size;
-      vec3 normal = spherical + (flatNormal - spherical) * flatten;
-      const vec3 tangent = normalize(cross(upVector, normal));
-      const float urad = atan2f(spherical.x, spherical.z);
-      const float xz = sqrtf(spherical.x * spherical.x + spherical.z * spherical.z);
-      const float vrad = atan2f(xz, spherical.y);
-      const vec2 uv((urad / Pi) * 0.5f + 0.5f, vrad / Pi + 0.5f);
-      vertexTarget->mPosition = pos;
-      vertexTarget->mUv = uv;
-      vertexTarget->mNormal = normal;
-      vertexTarget->mTangent = tangent;
-      vertexTarget++;
-    }
-  }
-  *oVertexTarget = vertexTarget;
-
-  const int ox[4] = { 0, 0, 1, 1 };
-  const int oy[4] = { 0, 1, 1, 0 };
-  const int dir[4] = { 1, 1, -1, 1 };
-
-  IndexEntry* indexTarget = *oIndexTarget;
-
-  /// Generate indices
-  const int baseIndex = *oBaseIndex;
-  const int trianglesPerSide = 1 << (resolution * 2);
-  const int verticesPerSide = (maxCoord + 1) * (maxCoord + 2) / 2;
-  for (int i = 0; i < trianglesPerSide; i++) {
-    /// Cache-friendlier ordering for really high resolution meshes
-    int k = i;
-    int x1 = 0, y1 = 0, x2 = 1, y2 = 0, x3 = 0, y3 = 1, step = 1;
-    while (k > 0) {
-      const int sel = k & 3;
-      x1 = x1 * dir[sel] + step * ox[sel];
-      y1 = y1 * dir[sel] + step * oy[sel];
-      x2 = x2 * dir[sel] + step * ox[sel];
-      y2 = y2 * dir[sel] + step * oy[sel];
-      x3 = x3 * dir[sel] + step * ox[sel];
-      y3 = y3 * dir[sel] + step * oy[sel];
-      step <<= 1;
-      k >>= 2;
-    }
-    const int index1 = x1 + verticesPerSide - ((maxCoord - y1 + 1) * (maxCoord - y1 + 2) / 2);
-    const int index2 = x2 + verticesPerSide - ((maxCoord - y2 + 1) * (maxCoord - y2 + 2) / 2);
-    const int index3 = x3 + verticesPerSide - ((maxCoord - y3 + 1) * (maxCoord - y3 + 2) / 2);
-
-    indexTarget[0] = index1 + baseIndex;
-    indexTarget[1] = index2 + baseIndex;
-    indexTarget[2] = index3 + baseIndex;
-    indexTarget += 3;
-  }
-  *oIndexTarget = indexTarget;
-  *oBaseIndex += verticesPerSide;
+float GeosphereMeshNode::GetSize() {
+  return mSize.Get();
 }
 
+void GeosphereMeshNode::Prepare() {
+  const int resolution = int(mResolution.GetCurrentValue());
+  const float flatten = mFlatten.GetCurrentValue();
 
-void GeosphereMeshNode::Operate() {
-  if (!mMesh) mMesh = std::make_shared<Mesh>();
+  /// Flattened faces keep their own edge vertices for the hard edges
+  const bool isWelded = mWelded.GetCurrentValue() >= 0.5f && flatten == 0.0f;
 
-  const int resolution = int(mResolution.Get());
-  const float size = mSize.Get();
-  const float flatten = mFlatten.Get();
+  if (resolution == mGeneratedResolution && flatten == mGeneratedFlatten &&
+    isWelded == mIsGeneratedWelded) return;
+  mGeneratedResolution = resolution;
+  mGeneratedFlatten = flatten;
+  mIsGeneratedWelded = isWelded;
+  mHasNewIndices = true;
 
-  const int vertexPerEdge = 1 + (1 << resolution);
+  const int maxCoord = 1 << resolution;
+  const int vertexPerEdge = 1 + maxCoord;
   const int vertexPerSide = vertexPerEdge * (vertexPerEdge + 1) / 2;
   const int vertexCount = 4 * vertexPerSide;
 
   const int trianglesPerSide = 1 << (resolution * 2);
   const int indexCount = trianglesPerSide * 3 * 4;
 
-  std::vector<VertexPosUvNormTangent> vertices(vertexCount);
-  std::vector<IndexEntry> indices(indexCount);
-
-  VertexPosUvNormTangent* vertexTarget = &vertices[0];
-  IndexEntry* indexTarget = &indices[0];
+  mVertices.resize(vertexCount);
+  mIndices.resize(indexCount);
 
   const float p = 1.0f / sqrtf(3.0f);
   /// Tetraeder vertices
@@ -264,21 +525,52 @@ void GeosphereMeshNode::Operate() {
     vec3(-1, -1, 1) * p,
   };
 
-  int baseIndex = 0;
-  MakeGeosphereTriangle(tv[0], tv[2], tv[1], flatten, size, resolution,
-    &vertexTarget, &indexTarget, &baseIndex);
-  MakeGeosphereTriangle(tv[0], tv[3], tv[2], flatten, size, resolution,
-    &vertexTarget, &indexTarget, &baseIndex);
-  MakeGeosphereTriangle(tv[0], tv[1], tv[3], flatten, size, resolution,
-    &vertexTarget, &indexTarget, &baseIndex);
-  MakeGeosphereTriangle(tv[1], tv[2], tv[3], flatten, size, resolution,
-    &vertexTarget, &indexTarget, &baseIndex);
+  static const int faceCorners[4][3] =
+    { { 0, 2, 1 }, { 0, 3, 2 }, { 0, 1, 3 }, { 1, 2, 3 } };
+  GeosphereFace faces[4];
+  for (int i = 0; i < 4; i++) {
+    const vec3& p1 = tv[faceCorners[i][0]];
+    faces[i].mP1 = p1;
+    faces[i].mD1 = tv[faceCorners[i][1]] - p1;
+    faces[i].mD2 = tv[faceCorners[i][2]] - p1;
+    faces[i].mFlatNormal = normalize(cross(faces[i].mD2, faces[i].mD1));
+  }
 
-  mMesh->AllocateVertices(VertexPosUvNormTangent::mFormat, vertexCount);
-  mMesh->AllocateIndices(indexCount);
+  /// Faces are independent, and their rows and triangles are split further
+  std::vector<GeosphereJob> jobs;
+  for (int face = 0; face < 4; face++) {
+    for (int y = 0; y <= maxCoord; ) {
+      int endRow = y + 1;
+      while (endRow <= maxCoord && GetGeosphereRowStart(maxCoord, endRow) -
+        GetGeosphereRowStart(maxCoord, y) < GeosphereJobSize) endRow++;
+      jobs.push_back({ face, false, y, endRow });
+      y = endRow;
+    }
+    for (int i = 0; i < trianglesPerSide; i += GeosphereJobSize) {
+      jobs.push_back(
+        { face, true, i, std::min(i + GeosphereJobSize, trianglesPerSide) });
+    }
+  }
 
-  mMesh->UploadVertices(&vertices[0]);
-  mMesh->UploadIndices(&indices[0]);
+  auto runJob = [&](UINT jobIndex) {
+    const GeosphereJob& job = jobs[jobIndex];
+    if (job.mIsIndices) {
+      MakeGeosphereIndices(resolution, job.mFace * vertexPerSide, job.mFirst, job.mEnd,
+        &mIndices[job.mFace * trianglesPerSide * 3]);
+    }
+    else {
+      MakeGeosphereVertices(faces[job.mFace], flatten, resolution, job.mFirst, job.mEnd,
+        &mVertices[job.mFace * vertexPerSide]);
+    }
+  };
+  if (vertexCount < MinParallelVertexCount) {
+    for (UINT i = 0; i < UINT(jobs.size()); i++) runJob(i);
+  }
+  else {
+    ThreadPool::GetSharedPool().ParallelFor(UINT(jobs.size()), runJob);
+  }
+
+  if (isWelded) WeldGeosphere(resolution, faceCorners, mVertices, mIndices);
 }
 
 void GeosphereMeshNode::HandleMessage(Message* message) {
@@ -302,11 +594,15 @@ PlaneMeshNode::PlaneMeshNode()
   mSize.SetDefaultValue(1.0f);
 }
 
-void PlaneMeshNode::Operate() {
-  if (!mMesh) mMesh = std::make_shared<Mesh>();
+float PlaneMeshNode::GetSize() {
+  return mSize.Get();
+}
 
-  const int resolution = int(mResolution.Get());
-  const float size = mSize.Get();
+void PlaneMeshNode::Prepare() {
+  const int resolution = int(mResolution.GetCurrentValue());
+  if (resolution == mGeneratedResolution) return;
+  mGeneratedResolution = resolution;
+  mHasNewIndices = true;
 
   const int segmentsPerEdge = 1 << resolution;
   const int verticesPerEdge = segmentsPerEdge + 1;
@@ -314,11 +610,11 @@ void PlaneMeshNode::Operate() {
   const int vertexCount = verticesPerEdge * verticesPerEdge;
   const int indexCount = quadCount * 6;
 
-  std::vector<VertexPosUvNormTangent> vertices(vertexCount);
-  std::vector<IndexEntry> indices(indexCount);
+  mVertices.resize(vertexCount);
+  mIndices.resize(indexCount);
 
-  VertexPosUvNormTangent* vertexTarget = &vertices[0];
-  IndexEntry* indexTarget = &indices[0];
+  VertexPosUvNormTangent* vertexTarget = &mVertices[0];
+  IndexEntry* indexTarget = &mIndices[0];
 
   /// Generate vertices
   const float uvStep = 1.0f / float(segmentsPerEdge);
@@ -329,7 +625,7 @@ void PlaneMeshNode::Operate() {
     float xCoord = -1.0f;
     float u = 0.0f;
     for (int x = 0; x <= segmentsPerEdge; x++) {
-      vertexTarget->mPosition = vec3(xCoord, 0.0, yCoord) * size;
+      vertexTarget->mPosition = vec3(xCoord, 0.0, yCoord);
       vertexTarget->mUv = vec2(u, v);
       vertexTarget->mNormal = vec3(0, 1, 0);
       vertexTarget->mTangent = vec3(1, 0, 0);
@@ -359,11 +655,6 @@ void PlaneMeshNode::Operate() {
     indexTarget += 6;
   }
 
-  mMesh->AllocateVertices(VertexPosUvNormTangent::mFormat, vertexCount);
-  mMesh->AllocateIndices(indexCount);
-
-  mMesh->UploadVertices(&vertices[0]);
-  mMesh->UploadIndices(&indices[0]);
 }
 
 void PlaneMeshNode::HandleMessage(Message* message) {
@@ -388,12 +679,16 @@ PolarSphereMeshNode::PolarSphereMeshNode()
   mSize.SetDefaultValue(1.0f);
 }
 
-void PolarSphereMeshNode::Operate() {
-  if (!mMesh) mMesh = std::make_shared<Mesh>();
+float PolarSphereMeshNode::GetSize() {
+  return mSize.Get();
+}
 
-  int resolution = int(mResolution.Get());
+void PolarSphereMeshNode::Prepare() {
+  int resolution = int(mResolution.GetCurrentValue());
   if (resolution < 3) resolution = 3;
-  const float size = mSize.Get();
+  if (resolution == mGeneratedResolution) return;
+  mGeneratedResolution = resolution;
+  mHasNewIndices = true;
 
   const int longAxisVertices = resolution * 2;
   const int shortAxisVertices = resolution;
@@ -401,35 +696,65 @@ void PolarSphereMeshNode::Operate() {
   const int quadCount = (longAxisVertices - 1)* (shortAxisVertices - 1);
   const int indexCount = quadCount * 6;
 
-  std::vector<VertexPosUvNormTangent> vertices(vertexCount);
-  std::vector<IndexEntry> indices(indexCount);
+  mVertices.resize(vertexCount);
+  mIndices.resize(indexCount);
 
-  VertexPosUvNormTangent* vertexTarget = &vertices[0];
-  IndexEntry* indexTarget = &indices[0];
+  VertexPosUvNormTangent* vertexTarget = &mVertices[0];
+  IndexEntry* indexTarget = &mIndices[0];
 
-  /// Generate vertices
+  /// Generate vertices. Coordinates are accumulated along the rows and columns,
+  /// their sines and cosines are only computed once per row and column.
   const float yStep = Pi / float(shortAxisVertices - 1);
   const float xStep = 2.0f * Pi / float(longAxisVertices - 1);
   const float uStep = 1.0f / float(longAxisVertices - 1);
   const float vStep = 1.0f / float(shortAxisVertices - 1);
+
+  /// Padded to whole SSE batches
+  const int paddedColumnCount = (longAxisVertices + 3) & ~3;
+  std::vector<float> columnSin(paddedColumnCount, 0.0f);
+  std::vector<float> columnCos(paddedColumnCount, 0.0f);
+  std::vector<float> columnU(longAxisVertices);
+  float xCoord = 0.0f;
+  float u = 0.0f;
+  for (int x = 0; x < longAxisVertices; x++) {
+    columnSin[x] = sinf(xCoord);
+    columnCos[x] = cosf(xCoord);
+    columnU[x] = u;
+    xCoord += xStep;
+    u += uStep;
+  }
+
+  const Vec3SSE upVector = SplatSSE(vec3(0, 1, 0));
   float yCoord = 0.0f;
   float v = 0.0f;
   for (int y = 0; y < shortAxisVertices; y++) {
-    float xCoord = 0.0f;
-    float u = 0.0f;
-    for (int x = 0; x < longAxisVertices; x++) {
-      const float radius = sinf(yCoord);
-      const float yc = cosf(yCoord);
-      const float xc = sinf(xCoord) * radius;
-      const float zc = cosf(xCoord) * radius;
-      vec3 spherical(xc, yc, zc);
-      vertexTarget->mPosition = spherical * size;
-      vertexTarget->mUv = vec2(u, v);
-      vertexTarget->mNormal = spherical;
-      vertexTarget->mTangent = normalize(cross(vec3(0, 1, 0), spherical));
-      vertexTarget++;
-      xCoord += xStep;
-      u += uStep;
+    const float radius = sinf(yCoord);
+    const float yc = cosf(yCoord);
+    const __m128 radius4 = _mm_set1_ps(radius);
+    for (int x = 0; x < longAxisVertices; x += 4) {
+      const Vec3SSE spherical = {
+        _mm_mul_ps(_mm_loadu_ps(&columnSin[x]), radius4),
+        _mm_set1_ps(yc),
+        _mm_mul_ps(_mm_loadu_ps(&columnCos[x]), radius4),
+      };
+      const Vec3SSE tangent = NormalizeSSE(CrossSSE(upVector, spherical));
+
+      float lanes[6][4];
+      _mm_storeu_ps(lanes[0], spherical.x);
+      _mm_storeu_ps(lanes[1], spherical.y);
+      _mm_storeu_ps(lanes[2], spherical.z);
+      _mm_storeu_ps(lanes[3], tangent.x);
+      _mm_storeu_ps(lanes[4], tangent.y);
+      _mm_storeu_ps(lanes[5], tangent.z);
+      const int laneCount = std::min(4, longAxisVertices - x);
+      for (int i = 0; i < laneCount; i++) {
+        const vec3 normal(lanes[0][i], lanes[1][i], lanes[2][i]);
+        vertexTarget->mPosition = normal;
+        vertexTarget->mUv = vec2(columnU[x + i], v);
+        vertexTarget->mNormal = normal;
+        vertexTarget->mTangent = vec3(lanes[3][i], lanes[4][i], lanes[5][i]);
+        vertexTarget++;
+      }
     }
     yCoord += yStep;
     v += vStep;
@@ -449,11 +774,6 @@ void PolarSphereMeshNode::Operate() {
     }
   }
 
-  mMesh->AllocateVertices(VertexPosUvNormTangent::mFormat, vertexCount);
-  mMesh->AllocateIndices(indexCount);
-
-  mMesh->UploadVertices(&vertices[0]);
-  mMesh->UploadIndices(&indices[0]);
 }
 
 void PolarSphereMeshNode::HandleMessage(Message* message) {
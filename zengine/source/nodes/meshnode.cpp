@@ -8,6 +8,12 @@ const std::shared_ptr<Mesh>& MeshNode::GetMesh() const {
   return mMesh;
 }
 
+bool MeshNode::MakeMeshWritable() {
+  if (mMesh && mMesh.use_count() == 1) return false;
+  mMesh = std::make_shared<Mesh>();
+  return true;
+}
+
 StaticMeshNode::StaticMeshNode()
   : MeshNode()
 {}
@@ -0,0 +1,974 @@
+#include <include/nodes/meshprocessing.h>
+#include <include/base/threadpool.h>
+#include <include/resources/meshoptimizer.h>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cfloat>
+#include <queue>
+
+REGISTER_NODECLASS(WeldMeshNode, "Weld Mesh");
+REGISTER_NODECLASS(SmoothNormalsMeshNode, "Smooth Normals");
+REGISTER_NODECLASS(SimplifyMeshNode, "Simplify Mesh");
+REGISTER_NODECLASS(OptimizeMeshNode, "Optimize Mesh");
+
+using glm::vec3;
+using glm::vec2;
+
+namespace {
+  /// Passes over vertices or triangles are split into jobs of this many items
+  const UINT ItemsPerJob = 8192;
+
+  /// Weight of the planes keeping open boundaries in place during simplification
+  const double BoundaryWeight = 10.0;
+
+  /// Collapses may turn triangles by less than about 75 degrees. Larger turns
+  /// fold slivers over their neighbors.
+  const float MinCollapseNormalCosine = 0.25f;
+
+  /// Vertices closer than this, relative to the mesh size, are at the same
+  /// position. Generated meshes have rounding differences along their seams.
+  const float SamePositionTolerance = 1e-6f;
+
+  /// Calls job(begin, end) for consecutive ranges of [0, count). Small counts
+  /// run on the calling thread.
+  void ParallelRanges(UINT count, const std::function<void(UINT, UINT)>& job) {
+    const UINT jobCount = (count + ItemsPerJob - 1) / ItemsPerJob;
+    if (jobCount <= 1) {
+      job(0, count);
+      return;
+    }
+    ThreadPool::GetSharedPool().ParallelFor(jobCount, [&](UINT i) {
+      job(i * ItemsPerJob, std::min(count, (i + 1) * ItemsPerJob));
+    });
+  }
+
+  /// Keeps the items with a valid new index
+  template<typename T>
+  void RemapArray(std::vector<T>& items, const std::vector<int>& remap, UINT newCount) {
+    if (items.empty()) return;
+    std::vector<T> remapped(newCount);
+    ParallelRanges(UINT(remap.size()), [&](UINT begin, UINT end) {
+      for (UINT i = begin; i < end; i++) {
+        if (remap[i] >= 0) remapped[remap[i]] = items[i];
+      }
+    });
+    items.swap(remapped);
+  }
+
+  /// Removes the triangles with repeated vertices
+  void RemoveDegenerateTriangles(std::vector<IndexEntry>& indices) {
+    UINT kept = 0;
+    for (UINT i = 0; i + 2 < UINT(indices.size()); i += 3) {
+      const IndexEntry a = indices[i], b = indices[i + 1], c = indices[i + 2];
+      if (a == b || b == c || c == a) continue;
+      indices[kept++] = a;
+      indices[kept++] = b;
+      indices[kept++] = c;
+    }
+    indices.resize(kept);
+  }
+
+  /// Largest extent of the bounding box
+  float GetMeshSize(const std::vector<vec3>& positions) {
+    vec3 minPosition(FLT_MAX), maxPosition(-FLT_MAX);
+    for (const vec3& position : positions) {
+      minPosition = glm::min(minPosition, position);
+      maxPosition = glm::max(maxPosition, position);
+    }
+    const vec3 extent = maxPosition - minPosition;
+    return std::max(std::max(extent.x, extent.y), extent.z);
+  }
+
+  /// Vertex indices sorted by the grid cell of their position, and a hash table
+  /// of the cells. Cells are at least twice the search radius, so a search
+  /// touches at most 8 cells.
+  class SpatialHash {
+  public:
+    SpatialHash(const std::vector<vec3>& positions, float meshSize, float radius);
+
+    /// Calls visit(vertex) for the vertices in the cells within radius of the
+    /// position, in increasing vertex order in each cell
+    template<typename F> void ForEachNear(const vec3& position, F visit) const;
+
+  private:
+    struct Cell {
+      uint64_t mKey;
+      UINT mBegin;
+      UINT mEnd;
+    };
+
+    int64_t GetCellCoordinate(float coordinate) const;
+    static uint64_t GetCellKey(int64_t x, int64_t y, int64_t z);
+    const Cell* FindCell(uint64_t key) const;
+
+    float mRadius;
+    float mInverseCellSize;
+    std::vector<UINT> mVertices;
+
+    /// Open addressing, empty cells have mBegin == mEnd
+    std::vector<Cell> mCells;
+    UINT mCellMask;
+  };
+
+  SpatialHash::SpatialHash(const std::vector<vec3>& positions, float meshSize,
+    float radius)
+    : mRadius(radius)
+  {
+    /// Tiny radii still need a cell size that doesn't put the whole mesh into a
+    /// few cells
+    float cellSize = std::max(radius * 2.0f, meshSize / 1024.0f);
+    if (!(cellSize > 0.0f && cellSize < FLT_MAX)) cellSize = 1.0f;
+    mInverseCellSize = 1.0f / cellSize;
+
+    const UINT vertexCount = UINT(positions.size());
+    std::vector<std::pair<uint64_t, UINT>> entries(vertexCount);
+    ParallelRanges(vertexCount, [&](UINT begin, UINT end) {
+      for (UINT i = begin; i < end; i++) {
+        const vec3& p = positions[i];
+        entries[i] = std::make_pair(GetCellKey(GetCellCoordinate(p.x),
+          GetCellCoordinate(p.y), GetCellCoordinate(p.z)), i);
+      }
+    });
+    std::sort(entries.begin(), entries.end());
+
+    UINT cellCount = 0;
+    for (UINT i = 0; i < vertexCount; i++) {
+      if (i == 0 || entries[i].first != entries[i - 1].first) cellCount++;
+    }
+    UINT tableSize = 16;
+    while (tableSize < cellCount * 2) tableSize *= 2;
+    mCells.assign(tableSize, Cell{ 0, 0, 0 });
+    mCellMask = tableSize - 1;
+
+    mVertices.resize(vertexCount);
+    for (UINT begin = 0; begin < vertexCount; ) {
+      const uint64_t key = entries[begin].first;
+      UINT end = begin;
+      for (; end < vertexCount && entries[end].first == key; end++) {
+        mVertices[end] = entries[end].second;
+      }
+      UINT slot = UINT((key * 0x9e3779b97f4a7c15ull) >> 32) & mCellMask;
+      while (mCells[slot].mBegin != mCells[slot].mEnd) slot = (slot + 1) & mCellMask;
+      mCells[slot] = Cell{ key, begin, end };
+      begin = end;
+    }
+  }
+
+  int64_t SpatialHash::GetCellCoordinate(float coordinate) const {
+    /// Clamped, also catches NaN
+    const float limit = float(1ll << 40);
+    float cell = std::floor(coordinate * mInverseCellSize);
+    if (!(cell > -limit)) cell = -limit;
+    if (cell > limit) cell = limit;
+    return int64_t(cell);
+  }
+
+  uint64_t SpatialHash::GetCellKey(int64_t x, int64_t y, int64_t z) {
+    /// Far cells may share a key, it only costs a few more distance checks
+    const uint64_t mask = (1ull << 21) - 1;
+    return ((uint64_t(x) & mask) << 42) | ((uint64_t(y) & mask) << 21) |
+      (uint64_t(z) & mask);
+  }
+
+  const SpatialHash::Cell* SpatialHash::FindCell(uint64_t key) const {
+    UINT slot = UINT((key * 0x9e3779b97f4a7c15ull) >> 32) & mCellMask;
+    for (; mCells[slot].mBegin != mCells[slot].mEnd; slot = (slot + 1) & mCellMask) {
+      if (mCells[slot].mKey == key) return &mCells[slot];
+    }
+    return nullptr;
+  }
+
+  template<typename F>
+  void SpatialHash::ForEachNear(const vec3& position, F visit) const {
+    int64_t first[3], last[3];
+    for (int axis = 0; axis < 3; axis++) {
+      first[axis] = GetCellCoordinate(position[axis] - mRadius);
+      last[axis] = GetCellCoordinate(position[axis] + mRadius);
+    }
+    for (int64_t x = first[0]; x <= last[0]; x++) {
+      for (int64_t y = first[1]; y <= last[1]; y++) {
+        for (int64_t z = first[2]; z <= last[2]; z++) {
+          const Cell* cell = FindCell(GetCellKey(x, y, z));
+          if (cell == nullptr) continue;
+          for (UINT i = cell->mBegin; i < cell->mEnd; i++) visit(mVertices[i]);
+        }
+      }
+    }
+  }
+
+  /// For every vertex, the first vertex it's merged with. Vertices merge with
+  /// the first earlier vertex within the radius that isMergeable accepts, and
+  /// merging is transitive.
+  template<typename F>
+  std::vector<UINT> FindMergedVertices(const std::vector<vec3>& positions, float radius,
+    F isMergeable)
+  {
+    const UINT vertexCount = UINT(positions.size());
+    const SpatialHash hash(positions, GetMeshSize(positions), radius);
+    const float radiusSquared = radius * radius;
+    std::vector<UINT> merged(vertexCount);
+    ParallelRanges(vertexCount, [&](UINT begin, UINT end) {
+      for (UINT i = begin; i < end; i++) {
+        const vec3& position = positions[i];
+        UINT first = i;
+        hash.ForEachNear(position, [&](UINT other) {
+          if (other >= first) return;
+          const vec3 offset = positions[other] - position;
+          if (glm::dot(offset, offset) <= radiusSquared && isMergeable(other, i)) {
+            first = other;
+          }
+        });
+        merged[i] = first;
+      }
+    });
+
+    /// Earlier vertices are resolved first
+    for (UINT i = 0; i < vertexCount; i++) merged[i] = merged[merged[i]];
+    return merged;
+  }
+
+  /// For every vertex, the first vertex at the same position
+  std::vector<UINT> GetPositionGroups(const std::vector<vec3>& positions) {
+    const float radius = GetMeshSize(positions) * SamePositionTolerance;
+    return FindMergedVertices(positions, radius, [](UINT, UINT) { return true; });
+  }
+
+  /// Triangle corners grouped by a key of their vertex, CSR layout
+  struct CornerTable {
+    /// Corners of key k are mCorners[mOffsets[k]] to mCorners[mOffsets[k + 1]]
+    std::vector<UINT> mOffsets;
+    std::vector<UINT> mCorners;
+  };
+
+  /// Counting sort of the corners by getKey(vertex), keys are below keyCount
+  template<typename F>
+  CornerTable BuildCornerTable(const std::vector<IndexEntry>& indices, UINT keyCount,
+    F getKey)
+  {
+    CornerTable table;
+    table.mOffsets.assign(keyCount + 1, 0);
+    for (IndexEntry index : indices) table.mOffsets[getKey(index) + 1]++;
+    for (UINT i = 0; i < keyCount; i++) table.mOffsets[i + 1] += table.mOffsets[i];
+    std::vector<UINT> next(table.mOffsets.begin(), table.mOffsets.end() - 1);
+    table.mCorners.resize(indices.size());
+    for (UINT i = 0; i < UINT(indices.size()); i++) {
+      table.mCorners[next[getKey(indices[i])]++] = i;
+    }
+    return table;
+  }
+
+  /// Angle of the triangle at p0
+  float GetCornerAngle(const vec3& p0, const vec3& p1, const vec3& p2) {
+    const vec3 a = p1 - p0;
+    const vec3 b = p2 - p0;
+    return atan2f(glm::length(glm::cross(a, b)), glm::dot(a, b));
+  }
+
+  /// Normalized, or zero if the vector is too short
+  vec3 SafeNormalize(const vec3& v) {
+    const float length = glm::length(v);
+    return length > 1e-20f ? v * (1.0f / length) : vec3(0.0f);
+  }
+
+  /// Some unit vector perpendicular to the normal
+  vec3 GetPerpendicular(const vec3& normal) {
+    const vec3 axis = fabsf(normal.x) < 0.9f ? vec3(1, 0, 0) : vec3(0, 1, 0);
+    return SafeNormalize(glm::cross(axis, normal));
+  }
+
+  bool AreClose(const vec2& a, const vec2& b, float tolerance) {
+    return fabsf(a.x - b.x) <= tolerance && fabsf(a.y - b.y) <= tolerance;
+  }
+
+  bool AreClose(const vec3& a, const vec3& b, float tolerance) {
+    return fabsf(a.x - b.x) <= tolerance && fabsf(a.y - b.y) <= tolerance &&
+      fabsf(a.z - b.z) <= tolerance;
+  }
+
+  /// Symmetric 4x4 matrix of a quadric error metric, upper triangle
+  struct Quadric {
+    double mA00, mA01, mA02, mA03, mA11, mA12, mA13, mA22, mA23, mA33;
+
+    /// Squared distance from the plane n.p + d = 0, times the weight
+    static Quadric FromPlane(const vec3& normal, float d, double weight);
+
+    void Add(const Quadric& other);
+
+    /// Error of moving the vertex to p
+    double Evaluate(const vec3& p) const;
+  };
+
+  Quadric Quadric::FromPlane(const vec3& normal, float d, double weight) {
+    const double a = normal.x, b = normal.y, c = normal.z, dd = d;
+    return Quadric{ a * a * weight, a * b * weight, a * c * weight, a * dd * weight,
+      b * b * weight, b * c * weight, b * dd * weight, c * c * weight, c * dd * weight,
+      dd * dd * weight };
+  }
+
+  void Quadric::Add(const Quadric& other) {
+    mA00 += other.mA00; mA01 += other.mA01; mA02 += other.mA02; mA03 += other.mA03;
+    mA11 += other.mA11; mA12 += other.mA12; mA13 += other.mA13;
+    mA22 += other.mA22; mA23 += other.mA23;
+    mA33 += other.mA33;
+  }
+
+  double Quadric::Evaluate(const vec3& p) const {
+    const double x = p.x, y = p.y, z = p.z;
+    return x * x * mA00 + 2.0 * x * y * mA01 + 2.0 * x * z * mA02 + 2.0 * x * mA03 +
+      y * y * mA11 + 2.0 * y * z * mA12 + 2.0 * y * mA13 +
+      z * z * mA22 + 2.0 * z * mA23 + mA33;
+  }
+
+  /// Half-edge collapse of mFrom into mTo, valid while the version of mFrom
+  /// stays the same
+  struct Collapse {
+    double mCost;
+    UINT mFrom;
+    UINT mTo;
+    UINT mVersion;
+
+    bool operator<(const Collapse& other) const {
+      /// Cheapest on top of std::priority_queue
+      return mCost > other.mCost;
+    }
+  };
+
+  /// Mesh being simplified. Triangles keep their slot in the index array,
+  /// removed ones are flagged, removed vertices have no triangles.
+  class Simplifier {
+  public:
+    Simplifier(const std::vector<vec3>& positions, std::vector<IndexEntry>& indices);
+
+    /// Collapses edges until the triangle count reaches the target, then
+    /// compacts the index array
+    void Run(UINT targetTriangleCount);
+
+  private:
+    /// Temporary arrays of collapse searches, one for each thread
+    struct Scratch {
+      std::vector<UINT> mFromNeighbors;
+      std::vector<UINT> mToNeighbors;
+      std::vector<std::pair<double, UINT>> mCandidates;
+    };
+
+    /// Computes the quadrics, the seam and boundary flags of the vertices
+    void Initialize();
+
+    /// Cheapest valid collapse of the vertex, mCost is DBL_MAX if it has none
+    Collapse FindCollapse(UINT from, Scratch& scratch) const;
+
+    /// Needs the neighbors of "from" in scratch.mFromNeighbors
+    bool IsValidCollapse(UINT from, UINT to, Scratch& scratch) const;
+
+    void ApplyCollapse(UINT from, UINT to);
+
+    /// Vertices sharing a live triangle with the vertex, sorted
+    void GetNeighbors(UINT vertex, std::vector<UINT>& oNeighbors) const;
+
+    /// Live triangles containing both vertices
+    UINT GetSharedTriangleCount(UINT a, UINT b) const;
+
+    vec3 GetTriangleNormal(UINT triangle, UINT from, const vec3& fromPosition) const;
+
+    const std::vector<vec3>& mPositions;
+    std::vector<IndexEntry>& mIndices;
+
+    std::vector<std::vector<UINT>> mVertexTriangles;
+    std::vector<Quadric> mQuadrics;
+    std::vector<char> mIsTriangleAlive;
+    std::vector<char> mIsLocked;
+    std::vector<char> mIsOnBoundary;
+    std::vector<UINT> mVersions;
+    UINT mTriangleCount;
+  };
+
+  Simplifier::Simplifier(const std::vector<vec3>& positions,
+    std::vector<IndexEntry>& indices)
+    : mPositions(positions)
+    , mIndices(indices)
+    , mTriangleCount(UINT(indices.size()) / 3)
+  {}
+
+  void Simplifier::Initialize() {
+    const UINT vertexCount = UINT(mPositions.size());
+    const UINT triangleCount = mTriangleCount;
+    mIsTriangleAlive.assign(triangleCount, 1);
+    mVersions.assign(vertexCount, 0);
+
+    /// Face planes weighted by the triangle area
+    std::vector<vec3> faceNormals(triangleCount);
+    std::vector<Quadric> faceQuadrics(triangleCount);
+    ParallelRanges(triangleCount, [&](UINT begin, UINT end) {
+      for (UINT t = begin; t < end; t++) {
+        const vec3& p0 = mPositions[mIndices[t * 3]];
+        const vec3 normal = glm::cross(mPositions[mIndices[t * 3 + 1]] - p0,
+          mPositions[mIndices[t * 3 + 2]] - p0);
+        const float doubleArea = glm::length(normal);
+        faceNormals[t] = SafeNormalize(normal);
+        faceQuadrics[t] = Quadric::FromPlane(faceNormals[t],
+          -glm::dot(faceNormals[t], p0), double(doubleArea) * 0.5);
+      }
+    });
+
+    /// Vertices sharing their position with another one are on a seam, moving
+    /// them would open a crack
+    const std::vector<UINT> groups = GetPositionGroups(mPositions);
+    mIsLocked.assign(vertexCount, 0);
+    for (UINT i = 0; i < vertexCount; i++) {
+      if (groups[i] != i) mIsLocked[i] = mIsLocked[groups[i]] = 1;
+    }
+
+    const CornerTable table = BuildCornerTable(mIndices, vertexCount,
+      [](IndexEntry index) { return UINT(index); });
+    mVertexTriangles.resize(vertexCount);
+    mQuadrics.resize(vertexCount);
+    mIsOnBoundary.assign(vertexCount, 0);
+    ParallelRanges(vertexCount, [&](UINT begin, UINT end) {
+      std::vector<UINT> neighbors;
+      for (UINT v = begin; v < end; v++) {
+        std::vector<UINT>& triangles = mVertexTriangles[v];
+        Quadric& quadric = mQuadrics[v];
+        quadric = Quadric{};
+        for (UINT i = table.mOffsets[v]; i < table.mOffsets[v + 1]; i++) {
+          const UINT triangle = table.mCorners[i] / 3;
+          triangles.push_back(triangle);
+          quadric.Add(faceQuadrics[triangle]);
+        }
+
+        /// Edges used by one triangle only are on the boundary, they get a plane
+        /// perpendicular to their face
+        neighbors.clear();
+        for (UINT triangle : triangles) {
+          for (UINT corner = 0; corner < 3; corner++) {
+            if (mIndices[triangle * 3 + corner] != v) {
+              neighbors.push_back(UINT(mIndices[triangle * 3 + corner]));
+            }
+          }
+        }
+        std::sort(neighbors.begin(), neighbors.end());
+        for (UINT i = 0; i < UINT(neighbors.size()); i++) {
+          const bool isSingle = (i == 0 || neighbors[i] != neighbors[i - 1]) &&
+            (i + 1 == neighbors.size() || neighbors[i] != neighbors[i + 1]);
+          if (!isSingle) continue;
+          mIsOnBoundary[v] = 1;
+          for (UINT triangle : triangles) {
+            const IndexEntry* corners = &mIndices[triangle * 3];
+            if (corners[0] != neighbors[i] && corners[1] != neighbors[i] &&
+              corners[2] != neighbors[i]) continue;
+            const vec3 edge = mPositions[neighbors[i]] - mPositions[v];
+            const vec3 normal = SafeNormalize(glm::cross(edge, faceNormals[triangle]));
+            quadric.Add(Quadric::FromPlane(normal, -glm::dot(normal, mPositions[v]),
+              double(glm::dot(edge, edge)) * BoundaryWeight));
+            break;
+          }
+        }
+      }
+    });
+  }
+
+  void Simplifier::GetNeighbors(UINT vertex, std::vector<UINT>& oNeighbors) const {
+    oNeighbors.clear();
+    for (UINT triangle : mVertexTriangles[vertex]) {
+      if (!mIsTriangleAlive[triangle]) continue;
+      for (UINT corner = 0; corner < 3; corner++) {
+        const UINT other = UINT(mIndices[triangle * 3 + corner]);
+        if (other != vertex) oNeighbors.push_back(other);
+      }
+    }
+    std::sort(oNeighbors.begin(), oNeighbors.end());
+    oNeighbors.erase(std::unique(oNeighbors.begin(), oNeighbors.end()), oNeighbors.end());
+  }
+
+  UINT Simplifier::GetSharedTriangleCount(UINT a, UINT b) const {
+    UINT count = 0;
+    for (UINT triangle : mVertexTriangles[a]) {
+      if (!mIsTriangleAlive[triangle]) continue;
+      const IndexEntry* corners = &mIndices[triangle * 3];
+      if (corners[0] == b || corners[1] == b || corners[2] == b) count++;
+    }
+    return count;
+  }
+
+  vec3 Simplifier::GetTriangleNormal(UINT triangle, UINT from,
+    const vec3& fromPosition) const
+  {
+    vec3 p[3];
+    for (UINT corner = 0; corner < 3; corner++) {
+      const UINT vertex = UINT(mIndices[triangle * 3 + corner]);
+      p[corner] = vertex == from ? fromPosition : mPositions[vertex];
+    }
+    return glm::cross(p[1] - p[0], p[2] - p[0]);
+  }
+
+  bool Simplifier::IsValidCollapse(UINT from, UINT to, Scratch& scratch) const {
+    if (mIsLocked[from]) return false;
+
+    /// Boundary vertices only slide along the boundary
+    const UINT sharedTriangleCount = GetSharedTriangleCount(from, to);
+    if (sharedTriangleCount == 0) return false;
+    if (mIsOnBoundary[from] && (!mIsOnBoundary[to] || sharedTriangleCount != 1)) {
+      return false;
+    }
+
+    /// Link condition: the vertices have no common neighbors other than the
+    /// ones of their shared triangles, otherwise the surface pinches
+    const std::vector<UINT>& fromNeighbors = scratch.mFromNeighbors;
+    std::vector<UINT>& toNeighbors = scratch.mToNeighbors;
+    GetNeighbors(to, toNeighbors);
+    UINT commonCount = 0;
+    for (UINT i = 0, j = 0; i < fromNeighbors.size() && j < toNeighbors.size(); ) {
+      if (fromNeighbors[i] < toNeighbors[j]) i++;
+      else if (fromNeighbors[i] > toNeighbors[j]) j++;
+      else {
+        commonCount++;
+        i++;
+        j++;
+      }
+    }
+    if (commonCount != sharedTriangleCount) return false;
+
+    /// Remaining triangles must not flip, fold or degenerate
+    for (UINT triangle : mVertexTriangles[from]) {
+      if (!mIsTriangleAlive[triangle]) continue;
+      const IndexEntry* corners = &mIndices[triangle * 3];
+      if (corners[0] == to || corners[1] == to || corners[2] == to) continue;
+      const vec3 oldNormal = GetTriangleNormal(triangle, from, mPositions[from]);
+      const vec3 newNormal = GetTriangleNormal(triangle, from, mPositions[to]);
+      if (glm::dot(SafeNormalize(oldNormal), SafeNormalize(newNormal)) <
+        MinCollapseNormalCosine) return false;
+    }
+    return true;
+  }
+
+  Collapse Simplifier::FindCollapse(UINT from, Scratch& scratch) const {
+    Collapse collapse{ DBL_MAX, from, from, mVersions[from] };
+    if (mIsLocked[from]) return collapse;
+
+    /// Candidates are validated from the cheapest, usually the first one is
+    GetNeighbors(from, scratch.mFromNeighbors);
+    std::vector<std::pair<double, UINT>>& candidates = scratch.mCandidates;
+    candidates.clear();
+    for (UINT to : scratch.mFromNeighbors) {
+      Quadric quadric = mQuadrics[from];
+      quadric.Add(mQuadrics[to]);
+      candidates.push_back(std::make_pair(quadric.Evaluate(mPositions[to]), to));
+    }
+    std::sort(candidates.begin(), candidates.end());
+    for (const auto& candidate : candidates) {
+      if (!IsValidCollapse(from, candidate.second, scratch)) continue;
+      collapse.mCost = candidate.first;
+      collapse.mTo = candidate.second;
+      break;
+    }
+    return collapse;
+  }
+
+  void Simplifier::ApplyCollapse(UINT from, UINT to) {
+    for (UINT triangle : mVertexTriangles[from]) {
+      if (!mIsTriangleAlive[triangle]) continue;
+      IndexEntry* corners = &mIndices[triangle * 3];
+      if (corners[0] == to || corners[1] == to || corners[2] == to) {
+        mIsTriangleAlive[triangle] = 0;
+        mTriangleCount--;
+        continue;
+      }
+      for (UINT corner = 0; corner < 3; corner++) {
+        if (corners[corner] == from) corners[corner] = to;
+      }
+      mVertexTriangles[to].push_back(triangle);
+    }
+    std::vector<UINT>().swap(mVertexTriangles[from]);
+    mQuadrics[to].Add(mQuadrics[from]);
+
+    std::vector<UINT>& triangles = mVertexTriangles[to];
+    triangles.erase(std::remove_if(triangles.begin(), triangles.end(),
+      [&](UINT triangle) { return !mIsTriangleAlive[triangle]; }), triangles.end());
+  }
+
+  void Simplifier::Run(UINT targetTriangleCount) {
+    Initialize();
+
+    /// Every vertex has its cheapest collapse in the queue, entries of vertices
+    /// whose neighborhood changed since are skipped by their version
+    const UINT vertexCount = UINT(mPositions.size());
+    std::vector<Collapse> collapses(vertexCount);
+    ParallelRanges(vertexCount, [&](UINT begin, UINT end) {
+      Scratch scratch;
+      for (UINT v = begin; v < end; v++) collapses[v] = FindCollapse(v, scratch);
+    });
+    collapses.erase(std::remove_if(collapses.begin(), collapses.end(),
+      [](const Collapse& collapse) { return collapse.mCost == DBL_MAX; }),
+      collapses.end());
+    std::priority_queue<Collapse> queue(std::less<Collapse>(), std::move(collapses));
+
+    Scratch scratch;
+    std::vector<UINT> neighbors;
+    while (mTriangleCount > targetTriangleCount && !queue.empty()) {
+      const Collapse collapse = queue.top();
+      queue.pop();
+      const UINT from = collapse.mFrom;
+      if (collapse.mVersion != mVersions[from]) continue;
+      GetNeighbors(from, scratch.mFromNeighbors);
+      if (!IsValidCollapse(from, collapse.mTo, scratch)) {
+        mVersions[from]++;
+        const Collapse retry = FindCollapse(from, scratch);
+        if (retry.mCost != DBL_MAX) queue.push(retry);
+        continue;
+      }
+
+      ApplyCollapse(from, collapse.mTo);
+      mVersions[from]++;
+
+      /// Costs and validity changed around the kept vertex
+      GetNeighbors(collapse.mTo, neighbors);
+      neighbors.push_back(collapse.mTo);
+      for (UINT vertex : neighbors) {
+        mVersions[vertex]++;
+        const Collapse next = FindCollapse(vertex, scratch);
+        if (next.mCost != DBL_MAX) queue.push(next);
+      }
+    }
+
+    UINT kept = 0;
+    for (UINT t = 0; t < UINT(mIsTriangleAlive.size()); t++) {
+      if (!mIsTriangleAlive[t]) continue;
+      for (UINT corner = 0; corner < 3; corner++) {
+        mIndices[kept++] = mIndices[t * 3 + corner];
+      }
+    }
+    mIndices.resize(kept);
+  }
+}
+
+UINT MeshArrays::GetVertexCount() const {
+  return UINT(mPositions.size());
+}
+
+void MeshArrays::Read(const Mesh& mesh) {
+  const VertexFormat& format = *mesh.mFormat;
+  const UINT vertexCount = mesh.mVertexCount;
+  const char* source = static_cast<const char*>(mesh.mRawVertexData);
+  const auto readAttribute = [&](VertexAttributeUsage usage, auto& oItems) {
+    const VertexAttribute* attribute = format.mAttributesArray[UINT(usage)];
+    if (attribute == nullptr) {
+      oItems.clear();
+      return;
+    }
+    oItems.resize(vertexCount);
+    const int offset = attribute->Offset;
+    ParallelRanges(vertexCount, [&](UINT begin, UINT end) {
+      for (UINT i = begin; i < end; i++) {
+        memcpy(&oItems[i], source + i * format.mStride + offset, sizeof(oItems[i]));
+      }
+    });
+  };
+  readAttribute(VertexAttributeUsage::POSITION, mPositions);
+  readAttribute(VertexAttributeUsage::TEXCOORD, mUvs);
+  readAttribute(VertexAttributeUsage::NORMAL, mNormals);
+  readAttribute(VertexAttributeUsage::TANGENT, mTangents);
+
+  mIndices.clear();
+  if (mesh.mIndexData.empty()) {
+    mIndices.resize(vertexCount - vertexCount % 3);
+    for (UINT i = 0; i < UINT(mIndices.size()); i++) mIndices[i] = IndexEntry(i);
+    return;
+  }
+
+  /// Triangles referring to missing vertices are dropped
+  mIndices.reserve(mesh.mIndexData.size());
+  for (size_t i = 0; i + 2 < mesh.mIndexData.size(); i += 3) {
+    const IndexEntry* corners = &mesh.mIndexData[i];
+    if (corners[0] >= vertexCount || corners[1] >= vertexCount ||
+      corners[2] >= vertexCount) continue;
+    mIndices.insert(mIndices.end(), corners, corners + 3);
+  }
+}
+
+UINT MeshArrays::GetBinaryFormat() const {
+  UINT binaryFormat = VERTEXATTRIB_POSITION_MASK;
+  if (!mUvs.empty()) binaryFormat |= VERTEXATTRIB_TEXCOORD_MASK;
+  if (!mNormals.empty()) binaryFormat |= VERTEXATTRIB_NORMAL_MASK;
+  if (!mTangents.empty()) binaryFormat |= VERTEXATTRIB_TANGENT_MASK;
+  return binaryFormat;
+}
+
+void MeshArrays::WriteVertices(const VertexFormat& format, void* target) const {
+  char* destination = static_cast<char*>(target);
+  const auto writeAttribute = [&](VertexAttributeUsage usage, const auto& items) {
+    const VertexAttribute* attribute = format.mAttributesArray[UINT(usage)];
+    if (attribute == nullptr || items.empty()) return;
+    const int offset = attribute->Offset;
+    ParallelRanges(UINT(items.size()), [&](UINT begin, UINT end) {
+      for (UINT i = begin; i < end; i++) {
+        memcpy(destination + i * format.mStride + offset, &items[i], sizeof(items[i]));
+      }
+    });
+  };
+  writeAttribute(VertexAttributeUsage::POSITION, mPositions);
+  writeAttribute(VertexAttributeUsage::TEXCOORD, mUvs);
+  writeAttribute(VertexAttributeUsage::NORMAL, mNormals);
+  writeAttribute(VertexAttributeUsage::TANGENT, mTangents);
+}
+
+void MeshArrays::RemapVertices(const std::vector<int>& remap, UINT newVertexCount) {
+  RemapArray(mPositions, remap, newVertexCount);
+  RemapArray(mUvs, remap, newVertexCount);
+  RemapArray(mNormals, remap, newVertexCount);
+  RemapArray(mTangents, remap, newVertexCount);
+}
+
+MeshProcessorNode::MeshProcessorNode()
+  : mMeshSlot(this, "Mesh")
+{}
+
+ThreadAffinity MeshProcessorNode::GetThreadAffinity() const {
+  return ThreadAffinity::PREPARE_ON_ANY_THREAD;
+}
+
+void MeshProcessorNode::UpdateInputs() {
+  MeshNode::UpdateInputs();
+  const std::shared_ptr<MeshNode> meshNode = mMeshSlot.GetNode();
+  mInputMesh = meshNode ? meshNode->GetMesh() : nullptr;
+}
+
+void MeshProcessorNode::Prepare() {
+  const Mesh* mesh = mInputMesh.get();
+  if (mesh == nullptr || mesh->mRawVertexData == nullptr || !mesh->mFormat ||
+    !mesh->mFormat->HasAttribute(VertexAttributeUsage::POSITION))
+  {
+    mArrays = MeshArrays();
+    return;
+  }
+  mArrays.Read(*mesh);
+  Process(mArrays);
+}
+
+void MeshProcessorNode::Operate() {
+  /// Released here, the last reference would delete GL buffers
+  mInputMesh = nullptr;
+
+  MakeMeshWritable();
+  const UINT binaryFormat = mArrays.GetBinaryFormat();
+  if (!mFormat || mFormat->mBinaryFormat != binaryFormat) {
+    mFormat = std::make_shared<VertexFormat>(binaryFormat);
+  }
+
+  /// An empty index buffer would render the vertices without indices
+  const UINT vertexCount = mArrays.mIndices.empty() ? 0 : mArrays.GetVertexCount();
+  mMesh->AllocateVertices(mFormat, vertexCount);
+  if (vertexCount > 0) mArrays.WriteVertices(*mFormat, mMesh->mRawVertexData);
+  mMesh->UploadVertices(mMesh->mRawVertexData);
+  mMesh->AllocateIndices(UINT(mArrays.mIndices.size()));
+  mMesh->UploadIndices(mArrays.mIndices.data());
+}
+
+void MeshProcessorNode::HandleMessage(Message* message) {
+  switch (message->mType) {
+  case MessageType::VALUE_CHANGED:
+  case MessageType::SLOT_CONNECTION_CHANGED:
+    if (mIsUpToDate) {
+      mIsUpToDate = false;
+      SendMsg(MessageType::NEEDS_REDRAW);
+    }
+    break;
+  case MessageType::NEEDS_REDRAW:
+    /// The input mesh changed, Node already forwards the message
+    mIsUpToDate = false;
+    break;
+  default: break;
+  }
+}
+
+WeldMeshNode::WeldMeshNode()
+  : mTolerance(this, "Tolerance", false, true, true, 0.0f, 0.1f)
+  , mPositionsOnly(this, "Positions only", false, true, true, 0.0f, 1.0f)
+{
+  mTolerance.SetDefaultValue(0.0001f);
+  mPositionsOnly.SetDefaultValue(0);
+}
+
+void WeldMeshNode::UpdateInputs() {
+  MeshProcessorNode::UpdateInputs();
+  mToleranceValue = std::max(0.0f, mTolerance.Get());
+  mIsPositionsOnly = mPositionsOnly.Get() >= 0.5f;
+}
+
+void WeldMeshNode::Process(MeshArrays& arrays) {
+  const float tolerance = mToleranceValue;
+  const bool isPositionsOnly = mIsPositionsOnly;
+  const UINT vertexCount = arrays.GetVertexCount();
+  const std::vector<UINT> merged = FindMergedVertices(arrays.mPositions, tolerance,
+    [&](UINT a, UINT b) {
+      if (isPositionsOnly) return true;
+      return
+        (arrays.mUvs.empty() || AreClose(arrays.mUvs[a], arrays.mUvs[b], tolerance)) &&
+        (arrays.mNormals.empty() ||
+          AreClose(arrays.mNormals[a], arrays.mNormals[b], tolerance)) &&
+        (arrays.mTangents.empty() ||
+          AreClose(arrays.mTangents[a], arrays.mTangents[b], tolerance));
+    });
+
+  /// The first vertex of a merged set is kept
+  std::vector<int> welded(vertexCount);
+  std::vector<int> kept(vertexCount, -1);
+  UINT weldedCount = 0;
+  for (UINT i = 0; i < vertexCount; i++) {
+    welded[i] = merged[i] == i ? int(weldedCount++) : welded[merged[i]];
+    if (merged[i] == i) kept[i] = welded[i];
+  }
+
+  /// Merged normals and tangents are averaged
+  std::vector<vec3> normals, tangents;
+  if (isPositionsOnly && weldedCount < vertexCount) {
+    const auto sumVectors = [&](const std::vector<vec3>& items, std::vector<vec3>& oSums) {
+      if (items.empty()) return;
+      oSums.assign(weldedCount, vec3(0.0f));
+      for (UINT i = 0; i < vertexCount; i++) oSums[welded[i]] += items[i];
+      ParallelRanges(weldedCount, [&](UINT begin, UINT end) {
+        for (UINT i = begin; i < end; i++) oSums[i] = SafeNormalize(oSums[i]);
+      });
+    };
+    sumVectors(arrays.mNormals, normals);
+    sumVectors(arrays.mTangents, tangents);
+  }
+
+  arrays.RemapVertices(kept, weldedCount);
+  if (!normals.empty()) arrays.mNormals.swap(normals);
+  if (!tangents.empty()) arrays.mTangents.swap(tangents);
+
+  std::vector<IndexEntry>& indices = arrays.mIndices;
+  ParallelRanges(UINT(indices.size()), [&](UINT begin, UINT end) {
+    for (UINT i = begin; i < end; i++) indices[i] = IndexEntry(welded[indices[i]]);
+  });
+  RemoveDegenerateTriangles(indices);
+}
+
+SmoothNormalsMeshNode::SmoothNormalsMeshNode() = default;
+
+void SmoothNormalsMeshNode::Process(MeshArrays& arrays) {
+  const UINT vertexCount = arrays.GetVertexCount();
+  const std::vector<IndexEntry>& indices = arrays.mIndices;
+  const UINT triangleCount = UINT(indices.size()) / 3;
+  const bool hasTangents = !arrays.mUvs.empty();
+  const std::vector<vec3>& positions = arrays.mPositions;
+  const std::vector<vec2>& uvs = arrays.mUvs;
+
+  /// Face normals and tangents, and the angles of the corners
+  std::vector<vec3> faceNormals(triangleCount);
+  std::vector<vec3> faceTangents(hasTangents ? triangleCount : 0);
+  std::vector<float> cornerAngles(triangleCount * 3);
+  ParallelRanges(triangleCount, [&](UINT begin, UINT end) {
+    for (UINT t = begin; t < end; t++) {
+      const IndexEntry* corners = &indices[t * 3];
+      const vec3& p0 = positions[corners[0]];
+      const vec3& p1 = positions[corners[1]];
+      const vec3& p2 = positions[corners[2]];
+      const vec3 edge1 = p1 - p0;
+      const vec3 edge2 = p2 - p0;
+      faceNormals[t] = SafeNormalize(glm::cross(edge2, edge1));
+      cornerAngles[t * 3] = GetCornerAngle(p0, p1, p2);
+      cornerAngles[t * 3 + 1] = GetCornerAngle(p1, p2, p0);
+      cornerAngles[t * 3 + 2] = GetCornerAngle(p2, p0, p1);
+      if (!hasTangents) continue;
+
+      /// Direction of increasing u, mirrored texture coordinates flip it
+      const vec2 uv1 = uvs[corners[1]] - uvs[corners[0]];
+      const vec2 uv2 = uvs[corners[2]] - uvs[corners[0]];
+      const float determinant = uv1.x * uv2.y - uv2.x * uv1.y;
+      const vec3 tangent = edge1 * uv2.y - edge2 * uv1.y;
+      faceTangents[t] = determinant == 0.0f ? vec3(0.0f) :
+        SafeNormalize(determinant > 0.0f ? tangent : -tangent);
+    }
+  });
+
+  /// Vertices at the same position share their normal, the first vertex of the
+  /// group sums the faces around all of them
+  const std::vector<UINT> groups = GetPositionGroups(positions);
+  const CornerTable groupCorners = BuildCornerTable(indices, vertexCount,
+    [&](IndexEntry index) { return groups[index]; });
+  std::vector<vec3>& normals = arrays.mNormals;
+  normals.resize(vertexCount);
+  ParallelRanges(vertexCount, [&](UINT begin, UINT end) {
+    for (UINT v = begin; v < end; v++) {
+      if (groups[v] != v) continue;
+      vec3 normal(0.0f);
+      for (UINT i = groupCorners.mOffsets[v]; i < groupCorners.mOffsets[v + 1]; i++) {
+        const UINT corner = groupCorners.mCorners[i];
+        normal += faceNormals[corner / 3] * cornerAngles[corner];
+      }
+      normal = SafeNormalize(normal);
+      normals[v] = normal == vec3(0.0f) ? vec3(0, 1, 0) : normal;
+    }
+  });
+  ParallelRanges(vertexCount, [&](UINT begin, UINT end) {
+    for (UINT v = begin; v < end; v++) normals[v] = normals[groups[v]];
+  });
+
+  if (!hasTangents) {
+    arrays.mTangents.clear();
+    return;
+  }
+
+  /// Tangents are split along texture seams, they only sum the faces of the
+  /// vertex itself
+  const CornerTable vertexCorners = BuildCornerTable(indices, vertexCount,
+    [](IndexEntry index) { return UINT(index); });
+  std::vector<vec3>& tangents = arrays.mTangents;
+  tangents.resize(vertexCount);
+  ParallelRanges(vertexCount, [&](UINT begin, UINT end) {
+    for (UINT v = begin; v < end; v++) {
+      const vec3& normal = normals[v];
+      vec3 tangent(0.0f);
+      for (UINT i = vertexCorners.mOffsets[v]; i < vertexCorners.mOffsets[v + 1]; i++) {
+        const UINT corner = vertexCorners.mCorners[i];
+        const vec3& faceTangent = faceTangents[corner / 3];
+        const vec3 projected = faceTangent - normal * glm::dot(normal, faceTangent);
+        tangent += SafeNormalize(projected) * cornerAngles[corner];
+      }
+      tangent = SafeNormalize(tangent - normal * glm::dot(normal, tangent));
+      tangents[v] = tangent == vec3(0.0f) ? GetPerpendicular(normal) : tangent;
+    }
+  });
+}
+
+SimplifyMeshNode::SimplifyMeshNode()
+  : mTriangleCount(this, "Triangles", false, true, true, 0.0f, 100000.0f)
+{
+  mTriangleCount.SetDefaultValue(1000);
+}
+
+void SimplifyMeshNode::UpdateInputs() {
+  MeshProcessorNode::UpdateInputs();
+  mTargetTriangleCount = UINT(std::max(0.0f, mTriangleCount.Get()));
+}
+
+void SimplifyMeshNode::Process(MeshArrays& arrays) {
+  const UINT targetTriangleCount = mTargetTriangleCount;
+  if (targetTriangleCount >= arrays.mIndices.size() / 3) return;
+
+  RemoveDegenerateTriangles(arrays.mIndices);
+  Simplifier(arrays.mPositions, arrays.mIndices).Run(targetTriangleCount);
+
+  /// Removed vertices are dropped, the rest keep their order
+  const UINT vertexCount = arrays.GetVertexCount();
+  std::vector<char> isUsed(vertexCount, 0);
+  for (IndexEntry index : arrays.mIndices) isUsed[index] = 1;
+  std::vector<int> remap(vertexCount, -1);
+  UINT keptCount = 0;
+  for (UINT i = 0; i < vertexCount; i++) {
+    if (isUsed[i]) remap[i] = int(keptCount++);
+  }
+  arrays.RemapVertices(remap, keptCount);
+  for (IndexEntry& index : arrays.mIndices) index = IndexEntry(remap[index]);
+}
+
+OptimizeMeshNode::OptimizeMeshNode() = default;
+
+void OptimizeMeshNode::Process(MeshArrays& arrays) {
+  MeshOptimizer::OptimizeTriangleOrder(arrays.mIndices, arrays.mPositions);
+  std::vector<int> remap;
+  const UINT usedVertexCount = MeshOptimizer::OptimizeVertexFetch(
+    arrays.mIndices, arrays.GetVertexCount(), remap);
+  arrays.RemapVertices(remap, usedVertexCount);
+}
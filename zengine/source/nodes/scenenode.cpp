@@ -50,7 +50,7 @@ void SceneNode::Draw(RenderTarget* renderTarget, Globals* globals) {
 
   /// Simulate Fluids
   for (UINT i = 0; i < mFluidsSlot.GetMultiNodeCount(); i++) {
-    auto& fluid = PointerCast<FluidNode>(mFluidsSlot.GetReferencedMultiNode(i));
+    FluidNode* fluid = SafeCast<FluidNode*>(mFluidsSlot.GetReferencedMultiNodeRaw(i));
     fluid->Render(fluidAdvanceTime);
   }
 
@@ -58,7 +58,7 @@ void SceneNode::Draw(RenderTarget* renderTarget, Globals* globals) {
   const bool directToSquare = globals->DirectToSquare > 0.5f;
 
   /// Get camera
-  const auto& camera = mCamera.GetNode();
+  const CameraNode* camera = mCamera.GetNodeRaw();
   if (camera == nullptr) return;
 
   /// Pass #1: skylight shadow
@@ -76,7 +76,7 @@ void SceneNode::Draw(RenderTarget* renderTarget, Globals* globals) {
   /// Calculate shadow center
   vec3 shadowCenter(0, 0, 0);
   for (UINT i = 0; i < mDrawables.GetMultiNodeCount(); i++) {
-    auto& drawable = PointerCast<Drawable>(mDrawables.GetReferencedMultiNode(i));
+    const Drawable* drawable = SafeCast<Drawable*>(mDrawables.GetReferencedMultiNodeRaw(i));
     drawable->ComputeForcedShadowCenter(globals, shadowCenter);
   }
   globals->Camera = glm::translate(globals->Camera, -shadowCenter);
@@ -142,7 +142,7 @@ void SceneNode::Operate() {
 void SceneNode::RenderDrawables(Globals* globals, PassType passType) const
 {
   for (UINT i = 0; i < mDrawables.GetMultiNodeCount(); i++) {
-    auto& drawable = PointerCast<Drawable>(mDrawables.GetReferencedMultiNode(i));
+    Drawable* drawable = SafeCast<Drawable*>(mDrawables.GetReferencedMultiNodeRaw(i));
     drawable->Draw(globals, passType);
   }
 }
@@ -150,7 +150,11 @@ void SceneNode::RenderDrawables(Globals* globals, PassType passType) const
 void SceneNode::HandleMessage(Message* message) {
   switch (message->mType) {
   case MessageType::TRANSITIVE_CLOSURE_CHANGED:
-    mIsUpToDate = false;
+    /// Connecting scene time nodes doesn't change the dependencies
+    if (message->mSlot != &mSceneTimes) {
+      mSchedule.Invalidate();
+      mIsUpToDate = false;
+    }
     break;
   case MessageType::VALUE_CHANGED:
   case MessageType::SLOT_CONNECTION_CHANGED:
@@ -173,10 +177,8 @@ void SceneNode::HandleMessage(Message* message) {
 }
 
 void SceneNode::CalculateRenderDependencies() {
-  mTransitiveClosure.clear();
   mSceneTimes.DisconnectAll(false);
-  GenerateTransitiveClosure(mTransitiveClosure, true);
-  for (auto& node : mTransitiveClosure) {
+  for (auto& node : mSchedule.GetNodes()) {
     if (IsExactType<SceneTimeNode>(node)) {
       std::shared_ptr<SceneTimeNode> sceneTimeNode = PointerCast<SceneTimeNode>(node);
       ASSERT(sceneTimeNode);
@@ -187,9 +189,14 @@ void SceneNode::CalculateRenderDependencies() {
 
 void SceneNode::SetSceneTime(float beats) {
   Update();
+  TheMessageQueue.BeginBatch(true);
   for (auto& node : mSceneTimes.GetDirectMultiNodes()) {
     PointerCast<SceneTimeNode>(node)->Set(beats);
   }
+  TheMessageQueue.CommitBatch();
+
+  /// Only time-dependent nodes can change on a frame tick
+  mSchedule.UpdateTimeDependentNodes();
 }
 
 float SceneNode::GetSceneTime() const {
@@ -197,8 +204,5 @@ float SceneNode::GetSceneTime() const {
 }
 
 void SceneNode::UpdateDependencies() {
-  /// Update dependencies
-  for (auto& node : mTransitiveClosure) {
-    if (this != node.get()) node->Update();
-  }
+  mSchedule.Update();
 }
@@ -4,11 +4,125 @@
 #include <include/nodes/scenenode.h>
 #include <cmath>
 #include <memory>
+#include <algorithm>
+#include <emmintrin.h>
 
 REGISTER_NODECLASS(FloatSplineNode, "Float Spline");
 
 const float Epsilon = 0.0001f;
 
+/// Batch evaluation processes samples in chunks that fit on the stack
+const UINT BatchChunkSize = 256;
+
+/// Baking doesn't go beyond this sample rate, splines with discontinuities
+/// (eg. beat spikes) would never get within the error limit
+const float MaxBakeSamplesPerBeat = 256.0f;
+
+/// Number of points between samples where baking error is measured
+const UINT BakeChecksPerSample = 3;
+
+
+/// Floor for SSE2, valid if |x| < 2^31
+static __m128 FloorSSE(__m128 x) {
+  const __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+  const __m128 isGreater = _mm_cmpgt_ps(truncated, x);
+  return _mm_sub_ps(truncated, _mm_and_ps(isGreater, _mm_set1_ps(1.0f)));
+}
+
+/// Returns sin(x + quadrantOffset * pi/2). Range reduction is done in double
+/// precision so large arguments stay as accurate as sinf/cosf.
+static __m128 SinQuadrantSSE(__m128 x, int quadrantOffset) {
+  const __m128d twoOverPi = _mm_set1_pd(0.63661977236758134);
+  const __m128d piOverTwo = _mm_set1_pd(1.5707963267948966);
+
+  const __m128d xLow = _mm_cvtps_pd(x);
+  const __m128d xHigh = _mm_cvtps_pd(_mm_movehl_ps(x, x));
+  const __m128i quadrantLow = _mm_cvtpd_epi32(_mm_mul_pd(xLow, twoOverPi));
+  const __m128i quadrantHigh = _mm_cvtpd_epi32(_mm_mul_pd(xHigh, twoOverPi));
+  const __m128d reducedLow =
+    _mm_sub_pd(xLow, _mm_mul_pd(_mm_cvtepi32_pd(quadrantLow), piOverTwo));
+  const __m128d reducedHigh =
+    _mm_sub_pd(xHigh, _mm_mul_pd(_mm_cvtepi32_pd(quadrantHigh), piOverTwo));
+
+  /// r is in [-pi/4, pi/4]
+  const __m128 r = _mm_movelh_ps(_mm_cvtpd_ps(reducedLow), _mm_cvtpd_ps(reducedHigh));
+  const __m128i quadrant = _mm_add_epi32(_mm_unpacklo_epi64(quadrantLow, quadrantHigh),
+    _mm_set1_epi32(quadrantOffset));
+  const __m128 z = _mm_mul_ps(r, r);
+
+  /// Minimax polynomials of sin and cos
+  __m128 s = _mm_set1_ps(-1.9515295891e-4f);
+  s = _mm_add_ps(_mm_mul_ps(s, z), _mm_set1_ps(8.3321608736e-3f));
+  s = _mm_add_ps(_mm_mul_ps(s, z), _mm_set1_ps(-1.6666654611e-1f));
+  s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, z), r), r);
+
+  __m128 c = _mm_set1_ps(2.443315711809948e-5f);
+  c = _mm_add_ps(_mm_mul_ps(c, z), _mm_set1_ps(-1.388731625493765e-3f));
+  c = _mm_add_ps(_mm_mul_ps(c, z), _mm_set1_ps(4.166664568298827e-2f));
+  c = _mm_mul_ps(_mm_mul_ps(c, z), z);
+  c = _mm_add_ps(_mm_sub_ps(c, _mm_mul_ps(z, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+  /// Odd quadrants use cos, quadrants 2 and 3 are negated
+  const __m128 useCos = _mm_castsi128_ps(_mm_cmpeq_epi32(
+    _mm_and_si128(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+  const __m128 signMask = _mm_castsi128_ps(
+    _mm_slli_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(2)), 30));
+  const __m128 result = _mm_or_ps(_mm_and_ps(useCos, c), _mm_andnot_ps(useCos, s));
+  return _mm_xor_ps(result, signMask);
+}
+
+/// Natural logarithm for positive x
+static __m128 LogSSE(__m128 x) {
+  const __m128i bits = _mm_castps_si128(x);
+  __m128 exponent = _mm_cvtepi32_ps(
+    _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(126)));
+
+  /// Mantissa in [0.5, 1), shifted to [sqrt(0.5), sqrt(2))
+  __m128 m = _mm_castsi128_ps(_mm_or_si128(
+    _mm_and_si128(bits, _mm_set1_epi32(0x007fffff)), _mm_set1_epi32(0x3f000000)));
+  const __m128 isSmall = _mm_cmplt_ps(m, _mm_set1_ps(0.707106781186547524f));
+  exponent = _mm_sub_ps(exponent, _mm_and_ps(isSmall, _mm_set1_ps(1.0f)));
+  m = _mm_sub_ps(_mm_add_ps(m, _mm_and_ps(isSmall, m)), _mm_set1_ps(1.0f));
+
+  const __m128 z = _mm_mul_ps(m, m);
+  __m128 y = _mm_set1_ps(7.0376836292e-2f);
+  y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(-1.1514610310e-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(1.1676998740e-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(-1.2420140846e-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(1.4249322787e-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(-1.6668057665e-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(2.0000714765e-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(-2.4999993993e-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(3.3333331174e-1f));
+  y = _mm_mul_ps(_mm_mul_ps(y, m), z);
+  y = _mm_add_ps(y, _mm_mul_ps(exponent, _mm_set1_ps(-2.12194440e-4f)));
+  y = _mm_sub_ps(y, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+  return _mm_add_ps(_mm_add_ps(m, y), _mm_mul_ps(exponent, _mm_set1_ps(0.693359375f)));
+}
+
+/// Exponential function, the result underflows to zero below e^-87
+static __m128 ExpSSE(__m128 x) {
+  x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-87.3f)), _mm_set1_ps(88.3f));
+  const __m128 fx = FloorSSE(
+    _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f)), _mm_set1_ps(0.5f)));
+  x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(0.693359375f)));
+  x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(-2.12194440e-4f)));
+
+  const __m128 z = _mm_mul_ps(x, x);
+  __m128 y = _mm_set1_ps(1.9875691500e-4f);
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.3981999507e-3f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(8.3334519073e-3f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(4.1665795894e-2f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.6666665459e-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(5.0000001201e-1f));
+  y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(y, z), x), _mm_set1_ps(1.0f));
+
+  /// Multiply by 2^fx
+  const __m128i exponent = _mm_slli_epi32(
+    _mm_add_epi32(_mm_cvttps_epi32(fx), _mm_set1_epi32(127)), 23);
+  return _mm_mul_ps(y, _mm_castsi128_ps(exponent));
+}
+
 
 SplinePoint::SplinePoint() {
   mTangentBefore = mTangentAfter = 0.0f;
@@ -48,9 +162,16 @@ FloatSplineNode::~FloatSplineNode() {
 void FloatSplineNode::HandleMessage(Message* message) {
   switch (message->mType) {
     case MessageType::VALUE_CHANGED:
+      /// Only time changes keep baked values valid
+      if (message->mSlot != &mTimeSlot) Unbake();
       InvalidateCurrentValue();
       NotifyWatchers(&Watcher::OnTimeEdited, mSceneTimeNode->Get());
       break;
+    case MessageType::SLOT_CONNECTION_CHANGED:
+      /// Connected parameters can change any time, see Bake()
+      if (message->mSlot != &mTimeSlot) Unbake();
+      InvalidateCurrentValue();
+      break;
     default:
       break;
   }
@@ -58,11 +179,14 @@ void FloatSplineNode::HandleMessage(Message* message) {
 
 const float& FloatSplineNode::Get() {
   Update();
-  mCurrentValuePlusBaseOffset = currentValue + mBaseOffset;
   return mCurrentValuePlusBaseOffset;
 }
 
-float FloatSplineNode::GetNoiseValue(float time) {
+const float& FloatSplineNode::GetCurrentValue() const {
+  return mCurrentValuePlusBaseOffset;
+}
+
+float FloatSplineNode::GetNoiseValue(float time) const {
   if (mNoiseEnabled.Get() < 0.5f) return 0.0f;
   const float noiseVelocity = mNoiseVelocity.Get();
   const float noiseRatio = mNoiseLayer.Get(time) * 0.33f;
@@ -70,7 +194,7 @@ float FloatSplineNode::GetNoiseValue(float time) {
   return noiseRatio * (sinf(t * 0.67f) + cosf(t * 2.43f) + cosf(t * 3.81f + 0.5f));
 }
 
-float FloatSplineNode::GetBeatSpikeValue(float time) {
+float FloatSplineNode::GetBeatSpikeValue(float time) const {
   if (mBeatSpikeEnabled.Get() < 0.5f) return 0.0f;
 
   const float freq = mBeatSpikeFrequencyLayer.Get(time);
@@ -89,7 +213,7 @@ float FloatSplineNode::GetBeatSpikeValue(float time) {
   return intensity * powf(t, easing);
 }
 
-float FloatSplineNode::GetBeatQuantizerValue(float time) {
+float FloatSplineNode::GetBeatQuantizerValue(float time) const {
   const float freq = mBeatQuantizerFrequency.Get();
   if (freq < Epsilon) return 0.0f;
 
@@ -109,10 +233,13 @@ int SplineFloatComponent::AddPoint(float time, float value) {
   tmp.mIsLinear = i > 0 ? mPoints[i - 1].mIsLinear : false;
 
   mPoints.insert(mPoints.begin() + i, tmp);
+  mTimes.insert(mTimes.begin() + i, time);
+  mSegments.insert(mSegments.begin() + i + 1, SplineSegment());
 
   CalculateTangent(i - 1);
   CalculateTangent(i);
   CalculateTangent(i + 1);
+  UpdateSegments(i - 1, i + 1);
 
   return i;
 }
@@ -128,9 +255,23 @@ void SplineFloatComponent::SetPointValue(int index, float time, float value) {
 
   point.mTime = time;
   point.mValue = value;
+  mTimes[index] = time;
   CalculateTangent(index - 1);
   CalculateTangent(index);
   CalculateTangent(index + 1);
+  UpdateSegments(index - 1, index + 1);
+}
+
+void SplineFloatComponent::RemovePoint(int index) {
+  if (index < 0 || index >= int(mPoints.size())) return;
+  mPoints.erase(mPoints.begin() + index);
+  mTimes.erase(mTimes.begin() + index);
+  mSegments.erase(mSegments.begin() + index + 1);
+
+  /// Former neighbours are now adjacent
+  CalculateTangent(index - 1);
+  CalculateTangent(index);
+  UpdateSegments(index - 1, index);
 }
 
 void FloatSplineNode::SetAutoTangent(SplineLayer layer, int index, bool autoTangent) {
@@ -140,12 +281,14 @@ void FloatSplineNode::SetAutoTangent(SplineLayer layer, int index, bool autoTang
     SplinePoint& point = points[index];
     point.mIsAutoangent = autoTangent;
     component->CalculateTangent(index);
-    InvalidateCurrentValue();
+    component->UpdateSegments(index, index);
+    InvalidatePoints();
   }
 }
 
 void FloatSplineNode::SetBaseOffset(float baseOffset) {
   mBaseOffset = baseOffset;
+  mCurrentValuePlusBaseOffset = currentValue + mBaseOffset;
   SendMsg(MessageType::VALUE_CHANGED);
 }
 
@@ -169,30 +312,23 @@ void SplineFloatComponent::CalculateTangent(int index) {
   }
 }
 
-float FloatSplineNode::EvaluateLinearSpline(std::vector<SplinePoint>& points, float time) {
+float FloatSplineNode::EvaluateLinearSpline(const SplineComponent& component, float time) {
+  const std::vector<SplinePoint>& points = component.mPoints;
   if (points.empty()) return 0.0f;
-  if (points.size() == 1) return points[0].mValue;
-
-  /// Binary search
-  UINT i1 = 0;
-  UINT i2 = UINT(points.size() - 1);
-  while (i1 < i2) {
-    const UINT center = (i1 + i2 + 1) / 2;
-    if (points[center].mTime > time) {
-      i2 = center - 1;
-    } else {
-      i1 = center;
-    }
-  }
 
-  SplinePoint& p1 = points[i1];
-  SplinePoint& p2 = points[i1 + 1];
+  const int index = component.SearchPointIndexBefore(time);
+  if (index < 0) return points[0].mValue;
+  if (index >= int(points.size()) - 1) return points.back().mValue;
+
+  const SplinePoint& p1 = points[index];
+  const SplinePoint& p2 = points[index + 1];
   if (p2.mTime - p1.mTime < Epsilon) return p1.mValue;
   return p1.mValue + (p2.mValue - p1.mValue) * (time - p1.mTime) / (p2.mTime - p1.mTime);
 }
 
 void FloatSplineNode::InvalidateCurrentValue() {
   mBaseOffset = 0.0f;
+  mCurrentValuePlusBaseOffset = currentValue;
   if (mIsUpToDate) {
     mIsUpToDate = false;
     SendMsg(MessageType::VALUE_CHANGED);
@@ -200,57 +336,322 @@ void FloatSplineNode::InvalidateCurrentValue() {
   NotifyWatchers(&Watcher::OnRedraw);
 }
 
+void FloatSplineNode::InvalidatePoints() {
+  Unbake();
+  const bool wasUpToDate = mIsUpToDate;
+  InvalidateCurrentValue();
+
+  /// Edits must reach the journal even if the value wasn't evaluated since the
+  /// previous edit
+  if (!wasUpToDate) SendMsg(MessageType::VALUE_CHANGED);
+}
+
 void FloatSplineNode::Operate() {
   currentValue = GetValue(mTimeSlot.Get()) + mBaseOffset;
+  mCurrentValuePlusBaseOffset = currentValue + mBaseOffset;
 }
 
-float FloatSplineNode::GetValue(float time) {
+float FloatSplineNode::GetValue(float time) const {
+  const float position = time * mBakedSamplesPerBeat;
+  if (!mBakedValues.empty() && position >= 0.0f && 
+    position < float(mBakedValues.size() - 1)) 
+  {
+    const UINT index = UINT(position);
+    const float fraction = position - float(index);
+    return mBakedValues[index] + (mBakedValues[index + 1] - mBakedValues[index]) * fraction;
+  }
   return mBaseLayer.Get(time) + GetNoiseValue(time) + GetBeatSpikeValue(time) +
     GetBeatQuantizerValue(time);
 }
 
+void FloatSplineNode::GetValues(const float* times, float* values, UINT count) const {
+  if (!mBakedValues.empty()) {
+    for (UINT i = 0; i < count; i++) values[i] = GetValue(times[i]);
+    return;
+  }
+  mBaseLayer.GetValues(times, values, count);
+  AddNoiseValues(times, values, count);
+  AddBeatSpikeValues(times, values, count);
+  AddBeatQuantizerValues(times, values, count);
+}
+
+void FloatSplineNode::AddNoiseValues(const float* times, float* values, UINT count) const {
+  if (mNoiseEnabled.Get() < 0.5f) return;
+  const float velocity = mNoiseVelocity.Get();
+  const __m128 noiseVelocity = _mm_set1_ps(velocity);
+
+  float noiseRatios[BatchChunkSize];
+  for (UINT chunk = 0; chunk < count; chunk += BatchChunkSize) {
+    const UINT chunkSize = std::min(count - chunk, BatchChunkSize);
+    mNoiseLayer.GetValues(times + chunk, noiseRatios, chunkSize);
+
+    UINT i = 0;
+    for (; i + 4 <= chunkSize; i += 4) {
+      const __m128 t = _mm_mul_ps(_mm_loadu_ps(times + chunk + i), noiseVelocity);
+      const __m128 noiseRatio = 
+        _mm_mul_ps(_mm_loadu_ps(noiseRatios + i), _mm_set1_ps(0.33f));
+      __m128 noise = SinQuadrantSSE(_mm_mul_ps(t, _mm_set1_ps(0.67f)), 0);
+      noise = _mm_add_ps(noise, SinQuadrantSSE(_mm_mul_ps(t, _mm_set1_ps(2.43f)), 1));
+      noise = _mm_add_ps(noise, SinQuadrantSSE(
+        _mm_add_ps(_mm_mul_ps(t, _mm_set1_ps(3.81f)), _mm_set1_ps(0.5f)), 1));
+      float* value = values + chunk + i;
+      _mm_storeu_ps(value, _mm_add_ps(_mm_loadu_ps(value), _mm_mul_ps(noiseRatio, noise)));
+    }
+    for (; i < chunkSize; i++) {
+      const float t = times[chunk + i] * velocity;
+      values[chunk + i] += noiseRatios[i] * 0.33f *
+        (sinf(t * 0.67f) + cosf(t * 2.43f) + cosf(t * 3.81f + 0.5f));
+    }
+  }
+}
+
+float FloatSplineNode::Bake(float endTime, float samplesPerBeat, float maxError) {
+  Unbake();
+  if (endTime <= 0.0f || samplesPerBeat <= 0.0f) return -1.0f;
+
+  /// Parameters driven by other nodes can change any time
+  FloatSlot* parameters[] = { &mNoiseEnabled, &mNoiseVelocity, &mBeatSpikeEnabled,
+    &mBeatSpikeLength, &mBeatSpikeEasing, &mBeatQuantizerFrequency };
+  for (FloatSlot* slot : parameters) {
+    if (!slot->IsDefaulted()) return -1.0f;
+  }
+
+  /// Double the sample rate until the table is accurate enough
+  std::vector<float> times;
+  std::vector<float> values;
+  std::vector<float> analyticValues;
+  float error = 0.0f;
+  for (float rate = samplesPerBeat; rate <= MaxBakeSamplesPerBeat; rate *= 2.0f) {
+    const UINT sampleCount = UINT(ceilf(endTime * rate)) + 1;
+    times.resize(sampleCount);
+    values.resize(sampleCount);
+    for (UINT i = 0; i < sampleCount; i++) times[i] = float(i) / rate;
+    GetValues(&times[0], &values[0], sampleCount);
+
+    /// Compare linear interpolation to the analytic curve between samples
+    const UINT checkCount = (sampleCount - 1) * BakeChecksPerSample;
+    times.resize(checkCount);
+    analyticValues.resize(checkCount);
+    for (UINT i = 0; i < checkCount; i++) {
+      const float fraction = 
+        float(i % BakeChecksPerSample + 1) / float(BakeChecksPerSample + 1);
+      times[i] = (float(i / BakeChecksPerSample) + fraction) / rate;
+    }
+    GetValues(&times[0], &analyticValues[0], checkCount);
+
+    error = 0.0f;
+    for (UINT i = 0; i < checkCount; i++) {
+      const UINT index = i / BakeChecksPerSample;
+      const float fraction = (times[i] * rate) - float(index);
+      const float baked = values[index] + (values[index + 1] - values[index]) * fraction;
+      error = std::max(error, fabsf(baked - analyticValues[i]));
+    }
+    if (error <= maxError) {
+      mBakedValues.swap(values);
+      mBakedSamplesPerBeat = rate;
+      break;
+    }
+  }
+  return error;
+}
+
+void FloatSplineNode::Unbake() {
+  mBakedValues.clear();
+  mBakedValues.shrink_to_fit();
+}
+
+bool FloatSplineNode::IsBaked() const {
+  return !mBakedValues.empty();
+}
+
+UINT FloatSplineNode::GetBakedSampleCount() const {
+  return UINT(mBakedValues.size());
+}
+
+void FloatSplineNode::AddBeatSpikeValues(const float* times, float* values, UINT count) const {
+  if (mBeatSpikeEnabled.Get() < 0.5f) return;
+  const float length = mBeatSpikeLength.Get();
+  if (length < Epsilon) return;
+  const float easing = mBeatSpikeEasing.Get();
+
+  float frequencies[BatchChunkSize];
+  float intensities[BatchChunkSize];
+  for (UINT chunk = 0; chunk < count; chunk += BatchChunkSize) {
+    const UINT chunkSize = std::min(count - chunk, BatchChunkSize);
+    mBeatSpikeFrequencyLayer.GetValues(times + chunk, frequencies, chunkSize);
+    mBeatSpikeIntensityLayer.GetValues(times + chunk, intensities, chunkSize);
+
+    UINT i = 0;
+    for (; i + 4 <= chunkSize; i += 4) {
+      const __m128 time = _mm_loadu_ps(times + chunk + i);
+      const __m128 freq = _mm_loadu_ps(frequencies + i);
+      const __m128 subBeat =
+        _mm_sub_ps(time, _mm_mul_ps(freq, FloorSSE(_mm_div_ps(time, freq))));
+      const __m128 isSpike = _mm_and_ps(_mm_cmpge_ps(freq, _mm_set1_ps(Epsilon)),
+        _mm_cmple_ps(subBeat, _mm_set1_ps(length)));
+
+      /// powf(t, easing) = e^(easing * ln(t)), zero t underflows to zero
+      const __m128 t = 
+        _mm_sub_ps(_mm_set1_ps(1.0f), _mm_div_ps(subBeat, _mm_set1_ps(length)));
+      const __m128 spike = _mm_mul_ps(_mm_loadu_ps(intensities + i),
+        ExpSSE(_mm_mul_ps(_mm_set1_ps(easing), LogSSE(t))));
+      float* value = values + chunk + i;
+      _mm_storeu_ps(value, _mm_add_ps(_mm_loadu_ps(value), _mm_and_ps(isSpike, spike)));
+    }
+    for (; i < chunkSize; i++) {
+      const float time = times[chunk + i];
+      const float freq = frequencies[i];
+      if (freq < Epsilon) continue;
+      const float subBeat = time - freq * floorf(time / freq);
+      if (subBeat > length) continue;
+      values[chunk + i] += intensities[i] * powf(1.0f - subBeat / length, easing);
+    }
+  }
+}
+
+void FloatSplineNode::AddBeatQuantizerValues(const float* times, float* values, UINT count) const {
+  const float freq = mBeatQuantizerFrequency.Get();
+  if (freq < Epsilon) return;
+
+  float quantizedTimes[BatchChunkSize];
+  float quantizedValues[BatchChunkSize];
+  for (UINT chunk = 0; chunk < count; chunk += BatchChunkSize) {
+    const UINT chunkSize = std::min(count - chunk, BatchChunkSize);
+    for (UINT i = 0; i < chunkSize; i++) {
+      quantizedTimes[i] = freq * floorf(times[chunk + i] / freq);
+    }
+    mBeatQuantizerLayer.GetValues(quantizedTimes, quantizedValues, chunkSize);
+    for (UINT i = 0; i < chunkSize; i++) values[chunk + i] += quantizedValues[i];
+  }
+}
+
 
 const std::vector<SplinePoint>& SplineComponent::GetPoints() const
 {
   return mPoints;
 }
 
-int SplineComponent::FindPointIndexBefore(float time) {
-  int i = mLastIndex;
-  if (i >= int(mPoints.size())) i = -1;
-  while (i < int(mPoints.size()) - 1 && mPoints[i + 1].mTime <= time) i++;
-  while (i >= 0 && mPoints[i].mTime > time) i--;
-  mLastIndex = i;
-  return i;
+int SplineComponent::FindPointIndexBefore(float time, SplineCursor& cursor) const {
+  const int count = int(mTimes.size());
+
+  /// Samples usually fall into the same or the next segment
+  for (int i = cursor.mIndex; i <= cursor.mIndex + 1; i++) {
+    if (i < -1 || i >= count) break;
+    if ((i < 0 || mTimes[i] <= time) && (i + 1 >= count || mTimes[i + 1] > time)) {
+      cursor.mIndex = i;
+      return i;
+    }
+  }
+  cursor.mIndex = SearchPointIndexBefore(time);
+  return cursor.mIndex;
+}
+
+int SplineComponent::SearchPointIndexBefore(float time) const {
+  UINT count = UINT(mTimes.size());
+  if (count == 0) return -1;
+
+  /// The loop only depends on the number of points, the comparison compiles 
+  /// to a conditional move
+  const float* base = &mTimes[0];
+  while (count > 1) {
+    const UINT half = count / 2;
+    base = base[half] <= time ? base + half : base;
+    count -= half;
+  }
+  return int(base - &mTimes[0]) - (*base > time ? 1 : 0);
 }
 
-float SplineFloatComponent::Get(float time) {
-  const int index = FindPointIndexBefore(time);
+/// Evaluates a segment polynomial using Horner's method. Batch evaluation does
+/// the same operations in the same order, so both paths give identical results.
+static float EvaluateSegment(const SplineSegment& segment, float time) {
+  const float ft = (time - segment.mStartTime) * segment.mInvDuration;
+  return segment.mA + ft * (segment.mB + ft * (segment.mC + ft * segment.mD));
+}
 
-  SplinePoint* before = index >= 0 ? &mPoints[index] : nullptr;
-  SplinePoint* after = index < int(mPoints.size()) - 1 ? &mPoints[index + 1] : nullptr;
+SplineFloatComponent::SplineFloatComponent()
+  : mSegments(1, SplineSegment())
+{}
 
-  if (before && after)
-  {
-    if (before->mIsLinear) {
-      const float dt = after->mTime - before->mTime;
-      if (dt <= Epsilon) return before->mValue;
-      return (after->mValue * (time - before->mTime) + 
-        before->mValue * (after->mTime - time)) / dt;
-    }
-    const float dt = after->mTime - before->mTime;
-    const float ft = (time - before->mTime) / dt;
+float SplineFloatComponent::Get(float time) const {
+  return EvaluateSegment(mSegments[SearchPointIndexBefore(time) + 1], time);
+}
+
+float SplineFloatComponent::Get(float time, SplineCursor& cursor) const {
+  return EvaluateSegment(mSegments[FindPointIndexBefore(time, cursor) + 1], time);
+}
 
-    const float ea = before->mValue;
-    const float eb = dt * before->mTangentAfter;
-    const float ec = 3.0f * (after->mValue - before->mValue) - 
-      dt * (2.0f * before->mTangentAfter + after->mTangentBefore);
-    const float ed = -2.0f * (after->mValue - before->mValue) + 
-      dt * (before->mTangentAfter + after->mTangentBefore);
+void SplineFloatComponent::GetValues(const float* times, float* values, UINT count) const {
+  const SplineSegment* segments = &mSegments[0];
+  SplineCursor cursor;
+
+  /// Four samples at a time. Each segment fills two registers, transposing 
+  /// them yields the coefficients of the four samples side by side.
+  UINT i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const float* s0 = &segments[FindPointIndexBefore(times[i], cursor) + 1].mStartTime;
+    const float* s1 = &segments[FindPointIndexBefore(times[i + 1], cursor) + 1].mStartTime;
+    const float* s2 = &segments[FindPointIndexBefore(times[i + 2], cursor) + 1].mStartTime;
+    const float* s3 = &segments[FindPointIndexBefore(times[i + 3], cursor) + 1].mStartTime;
+
+    __m128 startTime = _mm_loadu_ps(s0);
+    __m128 invDuration = _mm_loadu_ps(s1);
+    __m128 a = _mm_loadu_ps(s2);
+    __m128 b = _mm_loadu_ps(s3);
+    _MM_TRANSPOSE4_PS(startTime, invDuration, a, b);
+    __m128 c = _mm_loadu_ps(s0 + 4);
+    __m128 d = _mm_loadu_ps(s1 + 4);
+    __m128 padding0 = _mm_loadu_ps(s2 + 4);
+    __m128 padding1 = _mm_loadu_ps(s3 + 4);
+    _MM_TRANSPOSE4_PS(c, d, padding0, padding1);
+
+    const __m128 ft = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(times + i), startTime), invDuration);
+    __m128 value = _mm_add_ps(_mm_mul_ps(d, ft), c);
+    value = _mm_add_ps(_mm_mul_ps(value, ft), b);
+    value = _mm_add_ps(_mm_mul_ps(value, ft), a);
+    _mm_storeu_ps(values + i, value);
+  }
+  for (; i < count; i++) {
+    values[i] = 
+      EvaluateSegment(segments[FindPointIndexBefore(times[i], cursor) + 1], times[i]);
+  }
+}
+
+void SplineFloatComponent::UpdateSegments(int firstPoint, int lastPoint) {
+  const int pointCount = int(mPoints.size());
+  const int lastSegment = std::min(lastPoint + 1, pointCount);
+  for (int i = std::max(firstPoint, 0); i <= lastSegment; i++) {
+    SplineSegment& segment = mSegments[i];
+    segment = SplineSegment();
+
+    /// Constant segments before the first and after the last point
+    if (i == 0) {
+      segment.mA = pointCount > 0 ? mPoints[0].mValue : 0.0f;
+      continue;
+    }
+    if (i == pointCount) {
+      segment.mA = mPoints[pointCount - 1].mValue;
+      continue;
+    }
 
-    return ea + ft*eb + ft*ft*ec + ft*ft*ft*ed;
+    const SplinePoint& before = mPoints[i - 1];
+    const SplinePoint& after = mPoints[i];
+    segment.mStartTime = before.mTime;
+    segment.mA = before.mValue;
+
+    const float dt = after.mTime - before.mTime;
+    if (before.mIsLinear) {
+      if (dt <= Epsilon) continue;
+      segment.mInvDuration = 1.0f / dt;
+      segment.mB = after.mValue - before.mValue;
+      continue;
+    }
+    segment.mInvDuration = dt > 0.0f ? 1.0f / dt : 0.0f;
+    segment.mB = dt * before.mTangentAfter;
+    segment.mC = 3.0f * (after.mValue - before.mValue) -
+      dt * (2.0f * before.mTangentAfter + after.mTangentBefore);
+    segment.mD = -2.0f * (after.mValue - before.mValue) +
+      dt * (before.mTangentAfter + after.mTangentBefore);
   }
-  return before ? before->mValue : after ? after->mValue : 0.0f;
 }
 
 
@@ -274,38 +675,39 @@ SplineFloatComponent* FloatSplineNode::GetComponent(SplineLayer layer) {
 
 int FloatSplineNode::AddPoint(SplineLayer layer, float time, float value) {
   const int index = GetComponent(layer)->AddPoint(time, value);
-  InvalidateCurrentValue();
+  InvalidatePoints();
   return index;
 }
 
 void FloatSplineNode::SetPointValue(SplineLayer layer, int index, float time, float value) {
   GetComponent(layer)->SetPointValue(index, time, value);
-  InvalidateCurrentValue();
+  InvalidatePoints();
 }
 
 void FloatSplineNode::RemovePoint(SplineLayer layer, int index) {
-  auto& points = GetComponent(layer)->mPoints;
-  points.erase(points.begin() + index);
-  InvalidateCurrentValue();
+  GetComponent(layer)->RemovePoint(index);
+  InvalidatePoints();
 }
 
 void FloatSplineNode::SetBreakpoint(SplineLayer layer, int index, bool breakpoint) {
-  SplineComponent* component = GetComponent(layer);
+  SplineFloatComponent* component = GetComponent(layer);
   auto& points = component->mPoints;
   if (index >= 0 && index < int(points.size())) {
     SplinePoint& point = points[index];
     point.mIsBreakpoint = breakpoint;
     component->CalculateTangent(index);
-    InvalidateCurrentValue();
+    component->UpdateSegments(index, index);
+    InvalidatePoints();
   }
 }
 
 void FloatSplineNode::SetLinear(SplineLayer layer, int index, bool linear) {
-  SplineComponent* component = GetComponent(layer);
+  SplineFloatComponent* component = GetComponent(layer);
   auto& points = component->mPoints;
   if (index >= 0 && index < int(points.size())) {
     SplinePoint& point = points[index];
     point.mIsLinear = linear;
-    InvalidateCurrentValue();
+    component->UpdateSegments(index, index);
+    InvalidatePoints();
   }
 }
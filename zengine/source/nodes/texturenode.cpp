@@ -24,6 +24,10 @@ const std::shared_ptr<Texture>& TextureFileNode::Get() {
   return mTexture;
 }
 
+const std::shared_ptr<Texture>& TextureFileNode::GetCurrentValue() const {
+  return mTexture;
+}
+
 void TextureFileNode::HandleMessage(Message* message) {
   switch (message->mType) {
   case MessageType::VALUE_CHANGED:
@@ -15,6 +15,16 @@ GlobalTimeNode::~GlobalTimeNode() {
   OnTimeChanged -= Delegate(this, &GlobalTimeNode::HandleTimeChange);
 }
 
+void GlobalTimeNode::SetGlobalTime(float beats) {
+  TheMessageQueue.BeginBatch(true);
+  OnTimeChanged(beats);
+  TheMessageQueue.CommitBatch();
+}
+
+bool GlobalTimeNode::IsTimeSource() const {
+  return true;
+}
+
 void GlobalTimeNode::HandleTimeChange(float beats) {
   Set(beats);
 }
@@ -29,3 +39,7 @@ void SceneTimeNode::EditTime(float time) {
   SendMsg(MessageType::SCENE_TIME_EDITED);
   SendMsg(MessageType::VALUE_CHANGED);
 }
+
+bool SceneTimeNode::IsTimeSource() const {
+  return true;
+}
@@ -17,6 +17,10 @@ const vec3& FloatsToVec3Node::Get() {
   return mValue;
 }
 
+const vec3& FloatsToVec3Node::GetCurrentValue() const {
+  return mValue;
+}
+
 void FloatsToVec3Node::HandleMessage(Message* message) {
   switch (message->mType) {
   case MessageType::SLOT_CONNECTION_CHANGED:
@@ -30,7 +34,11 @@ void FloatsToVec3Node::HandleMessage(Message* message) {
 }
 
 void FloatsToVec3Node::Operate() {
-  mValue = vec3(mX.Get(), mY.Get(), mZ.Get());
+  mValue = vec3(mX.GetCurrentValue(), mY.GetCurrentValue(), mZ.GetCurrentValue());
+}
+
+ThreadAffinity FloatsToVec3Node::GetThreadAffinity() const {
+  return ThreadAffinity::ANY_THREAD;
 }
 
 FloatToFloatNode::FloatToFloatNode()
@@ -43,6 +51,10 @@ const float& FloatToFloatNode::Get() {
   return mValue;
 }
 
+const float& FloatToFloatNode::GetCurrentValue() const {
+  return mValue;
+}
+
 void FloatToFloatNode::HandleMessage(Message* message) {
   switch (message->mType) {
   case MessageType::SLOT_CONNECTION_CHANGED:
@@ -56,7 +68,11 @@ void FloatToFloatNode::HandleMessage(Message* message) {
 }
 
 void FloatToFloatNode::Operate() {
-  mValue = mX.Get();
+  mValue = mX.GetCurrentValue();
+}
+
+ThreadAffinity FloatToFloatNode::GetThreadAffinity() const {
+  return ThreadAffinity::ANY_THREAD;
 }
 
 FloatsToVec4Node::FloatsToVec4Node()
@@ -72,6 +88,10 @@ const vec4& FloatsToVec4Node::Get() {
   return mValue;
 }
 
+const vec4& FloatsToVec4Node::GetCurrentValue() const {
+  return mValue;
+}
+
 void FloatsToVec4Node::HandleMessage(Message* message) {
   switch (message->mType) {
   case MessageType::SLOT_CONNECTION_CHANGED:
@@ -85,7 +105,12 @@ void FloatsToVec4Node::HandleMessage(Message* message) {
 }
 
 void FloatsToVec4Node::Operate() {
-  mValue = vec4(mX.Get(), mY.Get(), mZ.Get(), mW.Get());
+  mValue = vec4(mX.GetCurrentValue(), mY.GetCurrentValue(), mZ.GetCurrentValue(),
+    mW.GetCurrentValue());
+}
+
+ThreadAffinity FloatsToVec4Node::GetThreadAffinity() const {
+  return ThreadAffinity::ANY_THREAD;
 }
 
 MaddNode::MaddNode()
@@ -104,6 +129,10 @@ const float& MaddNode::Get() {
   return mValue;
 }
 
+const float& MaddNode::GetCurrentValue() const {
+  return mValue;
+}
+
 void MaddNode::HandleMessage(Message* message) {
   switch (message->mType) {
   case MessageType::SLOT_CONNECTION_CHANGED:
@@ -117,6 +146,10 @@ void MaddNode::HandleMessage(Message* message) {
 }
 
 void MaddNode::Operate() {
-  mValue = mA.Get() * mB.Get() + mC.Get();
+  mValue = mA.GetCurrentValue() * mB.GetCurrentValue() + mC.GetCurrentValue();
+}
+
+ThreadAffinity MaddNode::GetThreadAffinity() const {
+  return ThreadAffinity::ANY_THREAD;
 }
 
@@ -388,14 +388,14 @@ GLenum GetGLPrimitive(PrimitiveTypeEnum primitiveType) {
 
 
 void OpenGLAPI::Render(const std::shared_ptr<Buffer>& indexBuffer, UINT count,
-  PrimitiveTypeEnum primitiveType, UINT instanceCount) 
+  PrimitiveTypeEnum primitiveType, UINT instanceCount, bool hasShortIndices) 
 {
   CheckGLError();
   if (indexBuffer != nullptr && indexBuffer->GetHandle() > 0) {
     BindIndexBuffer(indexBuffer->GetHandle());
     CheckGLError();
-    glDrawElementsInstanced(
-      GetGLPrimitive(primitiveType), count, GL_UNSIGNED_INT, nullptr, instanceCount);
+    glDrawElementsInstanced(GetGLPrimitive(primitiveType), count,
+      hasShortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, nullptr, instanceCount);
   }
   else {
     glDrawArraysInstanced(GetGLPrimitive(primitiveType), 0, count, instanceCount);
@@ -545,8 +545,8 @@ UINT OpenGLAPI::GetTexelByteCount(TexelType type) {
   case TexelType::DEPTH32F:
     return 4;
   case TexelType::ARGB16:
-  case TexelType::ARGB16F:
     return 8;
+  case TexelType::ARGB16F:
   case TexelType::ARGB32F:
     return 16;
   }
@@ -607,9 +607,9 @@ std::shared_ptr<Texture> OpenGLAPI::MakeTexture(int width, int height, TexelType
   CheckGLError();
   std::shared_ptr<std::vector<char>> texelVector = nullptr;
   if (!gpuMemoryOnly) {
-    texelVector = std::make_shared<std::vector<char>>();
-    texelVector->resize(width * height * 4);
-    memcpy(&(*texelVector)[0], texelData, width * height * 4);
+    const size_t byteCount = size_t(width) * height * GetTexelByteCount(type);
+    texelVector = std::make_shared<std::vector<char>>(byteCount);
+    memcpy(&(*texelVector)[0], texelData, byteCount);
   }
   return std::make_shared<Texture>(handle, width, height, type,
     texelVector, isMultisample, doesRepeat, generateMipmaps);
@@ -661,6 +661,24 @@ void OpenGLAPI::UploadTextureGpuData(const std::shared_ptr<Texture>& texture,
 }
 
 
+std::shared_ptr<std::vector<char>> OpenGLAPI::ReadTextureGpuData(
+  const std::shared_ptr<Texture>& texture)
+{
+  if (texture->mIsMultisample) return nullptr;
+  GLint internalFormat;
+  GLenum format;
+  GLenum glType;
+  GetTextureType(texture->mType, internalFormat, format, glType);
+  auto texelData = std::make_shared<std::vector<char>>(size_t(texture->mWidth) *
+    texture->mHeight * GetTexelByteCount(texture->mType));
+  SetActiveTexture(0);
+  BindTexture(texture->mHandle);
+  glGetTexImage(GL_TEXTURE_2D, 0, format, glType, &(*texelData)[0]);
+  CheckGLError();
+  return texelData;
+}
+
+
 void OpenGLAPI::SetTexture(const ShaderProgram::Sampler& sampler,
   const std::shared_ptr<Texture>& texture, UINT slotIndex)
 {
@@ -3,6 +3,8 @@
 #include <include/resources/mesh.h>
 #include <include/render/drawingapi.h>
 #include <include/base/helpers.h>
+#include <algorithm>
+#include <cstdint>
 
 std::shared_ptr<VertexFormat> VertexPos::mFormat = std::make_shared<VertexFormat>(
   VERTEXATTRIB_POSITION_MASK);
@@ -44,7 +46,7 @@ VertexFormat::VertexFormat(UINT binaryFormat) {
 }
 
 Mesh::~Mesh() {
-  SafeDelete(mRawVertexData);
+  ReleaseRawVertexData();
 }
 
 void Mesh::Render(//const vector<ShaderProgram::Attribute>& usedAttributes,
@@ -62,11 +64,12 @@ void Mesh::Render(//const vector<ShaderProgram::Attribute>& usedAttributes,
 
   if (mIndexBuffer->IsEmpty()) {
     /// Render all vertices without index buffer
-    OpenGL->Render(nullptr, mVertexCount, primitive, instanceCount);
+    OpenGL->Render(nullptr, mVertexCount, primitive, instanceCount, false);
   }
   else {
     /// Render indexed mesh
-    OpenGL->Render(mIndexBuffer, mIndexCount, primitive, instanceCount);
+    OpenGL->Render(mIndexBuffer, mIndexCount, primitive, instanceCount,
+      mHasShortIndices);
   }
 }
 
@@ -75,30 +78,78 @@ void Mesh::AllocateVertices(const std::shared_ptr<VertexFormat>& format, UINT ve
   this->mVertexCount = vertexCount;
   const int newBufferSize = format->mStride * vertexCount;
 
-  if (mVertexBuffer->GetByteSize() != newBufferSize) {
+  const bool sizeChanged = mVertexBuffer->GetByteSize() != newBufferSize;
+  if (sizeChanged) {
     mVertexBuffer->Allocate(newBufferSize);
-    SafeDelete(mRawVertexData);
+  }
+  if (sizeChanged || mRawVertexDataOwner) {
+    ReleaseRawVertexData();
     mRawVertexData = new char[newBufferSize];
   }
 }
 
-void Mesh::AllocateIndices(UINT indexCount) {
-  if (mIndexCount != indexCount) {
-    mIndexCount = indexCount;
-    mIndexBuffer->Allocate(indexCount * sizeof(IndexEntry));
+void Mesh::BorrowVertices(const std::shared_ptr<VertexFormat>& format,
+  UINT vertexCount, const void* vertices, const std::shared_ptr<const void>& owner)
+{
+  ASSERT(owner != nullptr);
+  this->mFormat = format;
+  this->mVertexCount = vertexCount;
+  const int bufferSize = format->mStride * vertexCount;
+
+  if (mVertexBuffer->GetByteSize() != bufferSize) {
+    mVertexBuffer->Allocate(bufferSize);
   }
+  mVertexBuffer->UploadData(vertices, bufferSize);
+
+  ReleaseRawVertexData();
+  mRawVertexData = const_cast<void*>(vertices);
+  mRawVertexDataOwner = owner;
+}
+
+void Mesh::ReleaseRawVertexData() {
+  if (mRawVertexDataOwner) {
+    mRawVertexData = nullptr;
+    mRawVertexDataOwner = nullptr;
+  }
+  else {
+    SafeDelete(mRawVertexData);
+  }
+}
+
+void Mesh::AllocateIndices(UINT indexCount) {
+  /// The buffer is allocated on upload, when the index size is known
+  mIndexCount = indexCount;
 }
 
 void Mesh::UploadIndices(const IndexEntry* indices) {
-  mIndexBuffer->UploadData(indices, mIndexCount * sizeof(IndexEntry));
-  mIndexData.resize(mIndexCount);
-  memcpy(&mIndexData[0], indices, mIndexCount * sizeof(IndexEntry));
+  mIndexData.assign(indices, indices + mIndexCount);
+  const IndexEntry maxIndex = mIndexCount == 0 ? 0 :
+    *std::max_element(mIndexData.begin(), mIndexData.end());
+  mHasShortIndices = maxIndex <= 0xffff;
+  const int byteSize =
+    int(mIndexCount * (mHasShortIndices ? sizeof(uint16_t) : sizeof(IndexEntry)));
+
+  /// An empty index buffer renders the vertices without indices
+  if (mIndexBuffer->GetByteSize() != byteSize) mIndexBuffer->Allocate(byteSize);
+  if (mIndexCount == 0) return;
+
+  if (mHasShortIndices) {
+    const std::vector<uint16_t> shortIndices(mIndexData.begin(), mIndexData.end());
+    mIndexBuffer->UploadData(&shortIndices[0], byteSize);
+  }
+  else {
+    mIndexBuffer->UploadData(indices, byteSize);
+  }
 }
 
 void Mesh::UploadVertices(void* vertices) const
 {
+  ASSERT(mRawVertexDataOwner == nullptr);
   mVertexBuffer->UploadData(vertices, mVertexCount * mFormat->mStride);
 
+  /// Vertices may have been written into the raw data directly
+  if (vertices == mRawVertexData) return;
+
   /// TODO: use unique_ptr or OWNERSHIP instead of copying twice
   memcpy(mRawVertexData, vertices, mVertexCount * mFormat->mStride);
 }
@@ -106,6 +157,7 @@ void Mesh::UploadVertices(void* vertices) const
 
 void Mesh::UploadVertices(void* vertices, int vertexCount) const
 {
+  ASSERT(mRawVertexDataOwner == nullptr);
   mVertexBuffer->UploadData(vertices, vertexCount * mFormat->mStride);
 
   /// TODO: use unique_ptr or OWNERSHIP instead of copying twice
@@ -0,0 +1,321 @@
+#include <include/resources/meshoptimizer.h>
+#include <include/base/helpers.h>
+#include <algorithm>
+#include <cstring>
+
+using glm::vec3;
+
+namespace {
+  /// Triangles around each vertex, CSR layout
+  struct VertexTriangles {
+    VertexTriangles(const std::vector<IndexEntry>& indices, UINT vertexCount);
+
+    /// Triangles of vertex v are mTriangles[mOffsets[v]] to mTriangles[mOffsets[v + 1]]
+    std::vector<UINT> mOffsets;
+    std::vector<UINT> mTriangles;
+  };
+
+  VertexTriangles::VertexTriangles(const std::vector<IndexEntry>& indices,
+    UINT vertexCount)
+    : mOffsets(vertexCount + 1, 0)
+    , mTriangles(indices.size())
+  {
+    for (IndexEntry index : indices) mOffsets[index + 1]++;
+    for (UINT i = 0; i < vertexCount; i++) mOffsets[i + 1] += mOffsets[i];
+    std::vector<UINT> next(mOffsets.begin(), mOffsets.end() - 1);
+    for (UINT i = 0; i < UINT(indices.size()); i++) {
+      mTriangles[next[indices[i]]++] = i / 3;
+    }
+  }
+
+  /// FIFO cache simulated by timestamps: a vertex is cached while fewer than
+  /// cacheSize vertices were loaded after it
+  class CacheSimulator {
+  public:
+    CacheSimulator(UINT vertexCount, UINT cacheSize)
+      : mCacheSize(cacheSize)
+      , mLoadTimes(vertexCount, 0)
+      , mTime(cacheSize + 1)
+    {}
+
+    /// Returns true on a cache miss
+    bool Access(IndexEntry vertex) {
+      if (mTime - mLoadTimes[vertex] <= mCacheSize) return false;
+      mLoadTimes[vertex] = mTime++;
+      return true;
+    }
+
+    void Flush() {
+      mTime += mCacheSize + 1;
+    }
+
+  private:
+    const UINT mCacheSize;
+    std::vector<UINT> mLoadTimes;
+    UINT mTime;
+  };
+
+  /// Outward normal of a clockwise triangle, scaled by twice its area
+  vec3 GetTriangleNormal(const std::vector<vec3>& positions, const IndexEntry* corners) {
+    const vec3& p0 = positions[corners[0]];
+    return glm::cross(positions[corners[2]] - p0, positions[corners[1]] - p0);
+  }
+}
+
+MeshOptimizer::VertexCacheStatistics MeshOptimizer::AnalyzeVertexCache(
+  const std::vector<IndexEntry>& indices, UINT vertexCount, UINT cacheSize)
+{
+  VertexCacheStatistics statistics;
+  CacheSimulator cache(vertexCount, cacheSize);
+  std::vector<char> isUsed(vertexCount, 0);
+  UINT usedVertexCount = 0;
+  for (IndexEntry index : indices) {
+    if (cache.Access(index)) statistics.mTransformedVertexCount++;
+    if (!isUsed[index]) {
+      isUsed[index] = 1;
+      usedVertexCount++;
+    }
+  }
+  const UINT triangleCount = UINT(indices.size()) / 3;
+  if (triangleCount > 0) {
+    statistics.mACMR = float(statistics.mTransformedVertexCount) / float(triangleCount);
+    statistics.mATVR =
+      float(statistics.mTransformedVertexCount) / float(usedVertexCount);
+  }
+  return statistics;
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<IndexEntry>& indices,
+  UINT vertexCount, UINT cacheSize, std::vector<UINT>* oClusters)
+{
+  if (oClusters) oClusters->clear();
+  const UINT triangleCount = UINT(indices.size()) / 3;
+  if (triangleCount == 0) return;
+
+  const VertexTriangles adjacency(indices, vertexCount);
+  std::vector<UINT> liveTriangleCounts(vertexCount);
+  for (UINT v = 0; v < vertexCount; v++) {
+    liveTriangleCounts[v] = adjacency.mOffsets[v + 1] - adjacency.mOffsets[v];
+  }
+  std::vector<UINT> loadTimes(vertexCount, 0);
+  std::vector<char> isEmitted(triangleCount, 0);
+  std::vector<UINT> deadEnds;
+  std::vector<UINT> candidates;
+  std::vector<IndexEntry> output;
+  output.reserve(indices.size());
+  UINT time = cacheSize + 1;
+  UINT nextVertex = 0;
+
+  /// Restarts from a recently used vertex with triangles left, or from the
+  /// next one in input order. Returns -1 if all triangles are emitted.
+  const auto skipDeadEnd = [&]() -> int {
+    while (!deadEnds.empty()) {
+      const UINT vertex = deadEnds.back();
+      deadEnds.pop_back();
+      if (liveTriangleCounts[vertex] > 0) return int(vertex);
+    }
+    for (; nextVertex < vertexCount; nextVertex++) {
+      if (liveTriangleCounts[nextVertex] > 0) return int(nextVertex);
+    }
+    return -1;
+  };
+
+  int fanVertex = skipDeadEnd();
+  if (oClusters) oClusters->push_back(0);
+  while (fanVertex >= 0) {
+    /// Emits all remaining triangles around the fan vertex
+    candidates.clear();
+    for (UINT i = adjacency.mOffsets[fanVertex]; i < adjacency.mOffsets[fanVertex + 1];
+      i++)
+    {
+      const UINT triangle = adjacency.mTriangles[i];
+      if (isEmitted[triangle]) continue;
+      isEmitted[triangle] = 1;
+      for (UINT corner = 0; corner < 3; corner++) {
+        const IndexEntry vertex = indices[triangle * 3 + corner];
+        output.push_back(vertex);
+        deadEnds.push_back(vertex);
+        candidates.push_back(vertex);
+        liveTriangleCounts[vertex]--;
+        if (time - loadTimes[vertex] > cacheSize) loadTimes[vertex] = time++;
+      }
+    }
+
+    /// Next fan is the oldest vertex that stays in the cache while its
+    /// remaining triangles are emitted
+    int bestVertex = -1;
+    int bestPriority = -1;
+    for (UINT vertex : candidates) {
+      if (liveTriangleCounts[vertex] == 0) continue;
+      int priority = 0;
+      if (time - loadTimes[vertex] + 2 * liveTriangleCounts[vertex] <= cacheSize) {
+        priority = int(time - loadTimes[vertex]);
+      }
+      if (priority > bestPriority) {
+        bestPriority = priority;
+        bestVertex = int(vertex);
+      }
+    }
+    if (bestVertex < 0) {
+      bestVertex = skipDeadEnd();
+      if (bestVertex >= 0 && oClusters) oClusters->push_back(UINT(output.size()) / 3);
+    }
+    fanVertex = bestVertex;
+  }
+
+  indices.swap(output);
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<IndexEntry>& indices,
+  const std::vector<vec3>& positions, const std::vector<UINT>& clusters,
+  float threshold, UINT cacheSize)
+{
+  const UINT triangleCount = UINT(indices.size()) / 3;
+  if (triangleCount == 0) return;
+  const UINT vertexCount = UINT(positions.size());
+
+  /// Clusters are split where their own miss ratio got close enough to the one
+  /// of the whole mesh, sorting them can't hurt the cache much more than that
+  const float maxACMR =
+    AnalyzeVertexCache(indices, vertexCount, cacheSize).mACMR * threshold;
+  std::vector<UINT> splitClusters;
+  CacheSimulator cache(vertexCount, cacheSize);
+  for (UINT c = 0; c < UINT(clusters.size()); c++) {
+    const UINT end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+    UINT start = clusters[c];
+    UINT misses = 0;
+    cache.Flush();
+    splitClusters.push_back(start);
+    for (UINT t = start; t < end; t++) {
+      for (UINT corner = 0; corner < 3; corner++) {
+        if (cache.Access(indices[t * 3 + corner])) misses++;
+      }
+      if (t + 1 < end && float(misses) <= maxACMR * float(t + 1 - start)) {
+        start = t + 1;
+        misses = 0;
+        cache.Flush();
+        splitClusters.push_back(start);
+      }
+    }
+  }
+
+  /// Area weighted centroids and normals
+  const UINT clusterCount = UINT(splitClusters.size());
+  std::vector<vec3> centroids(clusterCount, vec3(0.0f));
+  std::vector<vec3> normals(clusterCount, vec3(0.0f));
+  std::vector<float> areas(clusterCount, 0.0f);
+  vec3 meshCentroid(0.0f);
+  float meshArea = 0;
+  for (UINT c = 0; c < clusterCount; c++) {
+    const UINT end = c + 1 < clusterCount ? splitClusters[c + 1] : triangleCount;
+    for (UINT t = splitClusters[c]; t < end; t++) {
+      const IndexEntry* corners = &indices[t * 3];
+      const vec3 normal = GetTriangleNormal(positions, corners);
+      const float area = glm::length(normal);
+      centroids[c] += (positions[corners[0]] + positions[corners[1]] +
+        positions[corners[2]]) * (area / 3.0f);
+      normals[c] += normal;
+      areas[c] += area;
+    }
+    meshCentroid += centroids[c];
+    meshArea += areas[c];
+  }
+  if (meshArea > 0) meshCentroid = meshCentroid * (1.0f / meshArea);
+
+  std::vector<float> facing(clusterCount, 0.0f);
+  for (UINT c = 0; c < clusterCount; c++) {
+    const float length = glm::length(normals[c]);
+    if (areas[c] <= 0 || length <= 0) continue;
+    const vec3 centroid = centroids[c] * (1.0f / areas[c]);
+    facing[c] = glm::dot(centroid - meshCentroid, normals[c] * (1.0f / length));
+  }
+
+  std::vector<UINT> order(clusterCount);
+  for (UINT c = 0; c < clusterCount; c++) order[c] = c;
+  std::stable_sort(order.begin(), order.end(),
+    [&](UINT a, UINT b) { return facing[a] > facing[b]; });
+
+  std::vector<IndexEntry> sorted;
+  sorted.reserve(indices.size());
+  for (UINT c : order) {
+    const UINT end = c + 1 < clusterCount ? splitClusters[c + 1] : triangleCount;
+    sorted.insert(sorted.end(), indices.begin() + splitClusters[c] * 3,
+      indices.begin() + end * 3);
+  }
+  indices.swap(sorted);
+}
+
+void MeshOptimizer::OptimizeTriangleOrder(std::vector<IndexEntry>& indices,
+  const std::vector<vec3>& positions)
+{
+  std::vector<UINT> clusters;
+  OptimizeVertexCache(indices, UINT(positions.size()), DefaultCacheSize, &clusters);
+  OptimizeOverdraw(indices, positions, clusters);
+}
+
+UINT MeshOptimizer::OptimizeVertexFetch(std::vector<IndexEntry>& indices,
+  UINT vertexCount, std::vector<int>& oRemap)
+{
+  oRemap.assign(vertexCount, -1);
+  UINT usedVertexCount = 0;
+  for (IndexEntry& index : indices) {
+    if (oRemap[index] < 0) oRemap[index] = int(usedVertexCount++);
+    index = IndexEntry(oRemap[index]);
+  }
+  return usedVertexCount;
+}
+
+bool MeshOptimizer::Optimize(const Mesh& mesh, OptimizedMesh& oResult) {
+  const std::shared_ptr<VertexFormat> format = mesh.mFormat;
+  if (mesh.mIndexData.empty() || mesh.mRawVertexData == nullptr || !format ||
+    !format->HasAttribute(VertexAttributeUsage::POSITION))
+  {
+    return false;
+  }
+
+  const UINT vertexCount = mesh.mVertexCount;
+  const UINT stride = format->mStride;
+  const char* vertices = static_cast<const char*>(mesh.mRawVertexData);
+  const int positionOffset =
+    format->mAttributesArray[UINT(VertexAttributeUsage::POSITION)]->Offset;
+  std::vector<vec3> positions(vertexCount);
+  for (UINT i = 0; i < vertexCount; i++) {
+    memcpy(&positions[i], vertices + i * stride + positionOffset, sizeof(vec3));
+  }
+
+  std::vector<IndexEntry>& indices = oResult.mIndices;
+  indices = mesh.mIndexData;
+  indices.resize(indices.size() - indices.size() % 3);
+  for (IndexEntry index : indices) {
+    if (index >= vertexCount) {
+      WARN("Mesh index out of range, mesh not optimized");
+      return false;
+    }
+  }
+  OptimizeTriangleOrder(indices, positions);
+  std::vector<int> remap;
+  const UINT usedVertexCount = OptimizeVertexFetch(indices, vertexCount, remap);
+
+  std::vector<char>& reordered = oResult.mVertices;
+  reordered.resize(size_t(usedVertexCount) * stride);
+  for (UINT i = 0; i < vertexCount; i++) {
+    if (remap[i] < 0) continue;
+    memcpy(&reordered[size_t(remap[i]) * stride], vertices + size_t(i) * stride, stride);
+  }
+  oResult.mVertexCount = usedVertexCount;
+  return true;
+}
+
+bool MeshOptimizer::Optimize(Mesh& mesh) {
+  /// Raw vertex data may be borrowed, the optimized copy goes into a new buffer
+  OptimizedMesh optimized;
+  if (!Optimize(mesh, optimized)) return false;
+  mesh.AllocateVertices(mesh.mFormat, optimized.mVertexCount);
+  if (!optimized.mVertices.empty()) {
+    memcpy(mesh.mRawVertexData, &optimized.mVertices[0], optimized.mVertices.size());
+  }
+  mesh.UploadVertices(mesh.mRawVertexData);
+  mesh.AllocateIndices(UINT(optimized.mIndices.size()));
+  mesh.UploadIndices(optimized.mIndices.data());
+  return true;
+}
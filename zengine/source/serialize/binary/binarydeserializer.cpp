@@ -0,0 +1,395 @@
+#include "binarydeserializer.h"
+#include <include/dom/ghost.h>
+#include <include/base/helpers.h>
+#include <cstring>
+
+BinaryDeserializer::BinaryDeserializer(const char* data, size_t size,
+  const std::shared_ptr<const void>& dataOwner)
+  : mData(data)
+  , mSize(size)
+  , mDataOwner(dataOwner)
+{
+  if (!ReadTables()) return;
+
+  INFO("Loading nodes...");
+  mNodes.reserve(mHeader->mNodeCount);
+  bool isValid = true;
+  for (uint32_t i = 0; i < mHeader->mNodeCount && isValid; i++) {
+    isValid = DeserializeNode(mBinaryNodes[i]);
+  }
+  mTextures.clear();
+  mMeshes.clear();
+  if (!isValid) {
+    ERR("Loading failed.");
+    mNodes.clear();
+    mDocument = nullptr;
+    return;
+  }
+
+  INFO("Loading connections...");
+  for (uint32_t i = 0; i < mHeader->mNodeCount; i++) {
+    ConnectSlots(mBinaryNodes[i], mNodes[i]);
+  }
+
+  INFO("Loading done.");
+}
+
+std::shared_ptr<Document> BinaryDeserializer::GetDocument() const
+{
+  return mDocument;
+}
+
+bool BinaryDeserializer::IsBinaryDocument(const char* data, size_t size) {
+  return size >= sizeof(BinaryHeader) &&
+    memcmp(data, BinaryFormat::Magic, sizeof(BinaryFormat::Magic)) == 0;
+}
+
+bool BinaryDeserializer::ReadTables() {
+  if (!IsBinaryDocument(mData, mSize)) {
+    ERR("Not a binary document");
+    return false;
+  }
+  mHeader = reinterpret_cast<const BinaryHeader*>(mData);
+  if (mHeader->mVersion != BinaryFormat::Version) {
+    ERR("Unsupported binary document version: %d", mHeader->mVersion);
+    return false;
+  }
+
+  /// Check that all tables fit into the data
+  const auto fits = [&](uint64_t offset, uint64_t count, uint64_t itemSize) {
+    return offset <= mSize && count <= (mSize - offset) / itemSize;
+  };
+  if (!fits(mHeader->mNodeTableOffset, mHeader->mNodeCount, sizeof(BinaryNode)) ||
+    !fits(mHeader->mSlotTableOffset, mHeader->mSlotCount, sizeof(BinarySlot)) ||
+    !fits(mHeader->mConnectionTableOffset, mHeader->mConnectionCount, sizeof(uint32_t)) ||
+    !fits(mHeader->mBlobTableOffset, mHeader->mBlobCount, sizeof(BinaryBlob))) {
+    ERR("Corrupt binary document: table out of bounds");
+    return false;
+  }
+
+  mBinaryNodes = reinterpret_cast<const BinaryNode*>(mData + mHeader->mNodeTableOffset);
+  mBinarySlots = reinterpret_cast<const BinarySlot*>(mData + mHeader->mSlotTableOffset);
+  mConnections =
+    reinterpret_cast<const uint32_t*>(mData + mHeader->mConnectionTableOffset);
+  mBlobs = reinterpret_cast<const BinaryBlob*>(mData + mHeader->mBlobTableOffset);
+
+  for (uint32_t i = 0; i < mHeader->mBlobCount; i++) {
+    if (!fits(mBlobs[i].mOffset, mBlobs[i].mSize, 1)) {
+      ERR("Corrupt binary document: blob out of bounds");
+      return false;
+    }
+  }
+  for (uint32_t i = 0; i < mHeader->mSlotCount; i++) {
+    const BinarySlot& slot = mBinarySlots[i];
+    if (slot.mFirstConnection > mHeader->mConnectionCount ||
+      slot.mConnectionCount > mHeader->mConnectionCount - slot.mFirstConnection) {
+      ERR("Corrupt binary document: connection out of bounds");
+      return false;
+    }
+  }
+  for (uint32_t i = 0; i < mHeader->mConnectionCount; i++) {
+    if (mConnections[i] >= mHeader->mNodeCount) {
+      ERR("Corrupt binary document: invalid node index");
+      return false;
+    }
+  }
+  for (uint32_t i = 0; i < mHeader->mNodeCount; i++) {
+    const BinaryNode& node = mBinaryNodes[i];
+    if (node.mFirstSlot > mHeader->mSlotCount ||
+      node.mSlotCount > mHeader->mSlotCount - node.mFirstSlot) {
+      ERR("Corrupt binary document: slot out of bounds");
+      return false;
+    }
+  }
+  return true;
+}
+
+const char* BinaryDeserializer::GetBlob(uint32_t index, uint64_t& oSize) const {
+  if (index == BinaryFormat::NoBlob || index >= mHeader->mBlobCount) {
+    oSize = 0;
+    return nullptr;
+  }
+  oSize = mBlobs[index].mSize;
+  return mData + mBlobs[index].mOffset;
+}
+
+std::string BinaryDeserializer::GetString(uint32_t index) const {
+  uint64_t size;
+  const char* blob = GetBlob(index, size);
+  return blob ? std::string(blob, size_t(size)) : std::string();
+}
+
+bool BinaryDeserializer::DeserializeNode(const BinaryNode& binaryNode) {
+  const std::string nodeClassName = GetString(binaryNode.mClassName);
+
+  std::shared_ptr<Node> node;
+  if (nodeClassName == "ghost") {
+    node = std::make_shared<Ghost>();
+  }
+  else {
+    NodeClass* nodeClass = NodeRegistry::GetInstance()->GetNodeClass(nodeClassName);
+    if (nodeClass == nullptr) {
+      ERR("Unknown node class: %s", nodeClassName.c_str());
+      return false;
+    }
+    node = nodeClass->Manufacture();
+  }
+  mNodes.push_back(node);
+
+  if (binaryNode.mName != BinaryFormat::NoBlob) {
+    node->SetName(GetString(binaryNode.mName));
+  }
+
+  if (binaryNode.mFlags & BinaryFormat::HasPositionFlag) {
+    node->SetPosition(vec2(binaryNode.mPosition[0], binaryNode.mPosition[1]));
+  }
+
+  const float* value = binaryNode.mValue;
+  if (IsExactType<FloatNode>(node)) {
+    PointerCast<FloatNode>(node)->Set(value[0]);
+  }
+  else if (IsExactType<Vec2Node>(node)) {
+    PointerCast<Vec2Node>(node)->Set(vec2(value[0], value[1]));
+  }
+  else if (IsExactType<Vec3Node>(node)) {
+    PointerCast<Vec3Node>(node)->Set(vec3(value[0], value[1], value[2]));
+  }
+  else if (IsExactType<Vec4Node>(node)) {
+    PointerCast<Vec4Node>(node)->Set(vec4(value[0], value[1], value[2], value[3]));
+  }
+  else if (IsExactType<FloatSplineNode>(node)) {
+    DeserializeFloatSplineNode(binaryNode, PointerCast<FloatSplineNode>(node));
+  }
+  else if (IsExactType<StaticTextureNode>(node)) {
+    return DeserializeStaticTextureNode(binaryNode, PointerCast<StaticTextureNode>(node));
+  }
+  else if (IsExactType<StaticMeshNode>(node)) {
+    return DeserializeStaticMeshNode(binaryNode, PointerCast<StaticMeshNode>(node));
+  }
+  else if (IsExactType<StubNode>(node)) {
+    DeserializeStubNode(binaryNode, PointerCast<StubNode>(node));
+  }
+  else if (IsExactType<Document>(node)) {
+    ASSERT(mDocument == nullptr);
+    mDocument = PointerCast<Document>(node);
+  }
+  return true;
+}
+
+void BinaryDeserializer::ConnectSlots(
+  const BinaryNode& binaryNode, const std::shared_ptr<Node>& node)
+{
+  const auto& slots = node->GetSerializableSlots();
+  const BinarySlot* binarySlots = mBinarySlots + binaryNode.mFirstSlot;
+
+  if (IsPointerOf<Ghost>(node)) {
+    /// Connect original node first
+    for (uint32_t i = 0; i < binaryNode.mSlotCount; i++) {
+      const BinarySlot& binarySlot = binarySlots[i];
+      if (binarySlot.mConnectionCount == 0) continue;
+      if (GetString(binarySlot.mName) != "Original") continue;
+      const uint32_t connIndex = mConnections[binarySlot.mFirstConnection];
+      PointerCast<Ghost>(node)->mOriginalNode.Connect(mNodes[connIndex]);
+    }
+  }
+
+  for (uint32_t i = 0; i < binaryNode.mSlotCount; i++) {
+    const BinarySlot& binarySlot = binarySlots[i];
+
+    /// Find slot
+    const std::string slotName = GetString(binarySlot.mName);
+    const auto it = slots.find(slotName);
+    if (it == slots.end()) {
+      ERR("No such slot: %s", slotName.c_str());
+      continue;
+    }
+    ConnectSlot(binarySlot, it->second);
+  }
+}
+
+void BinaryDeserializer::ConnectSlot(const BinarySlot& binarySlot, Slot* slot) {
+  /// Set ghost flag
+  if (binarySlot.mFlags & BinaryFormat::GhostSlotFlag) {
+    slot->SetGhost(true);
+  }
+
+  /// Connect to nodes
+  const bool isMultiSlot = (binarySlot.mFlags & BinaryFormat::MultiSlotFlag) != 0;
+  if (slot->mIsMultiSlot != isMultiSlot) {
+    ERR("Multi/single slot mismatch: %s", slot->mName.c_str());
+    return;
+  }
+  for (uint32_t i = 0; i < binarySlot.mConnectionCount; i++) {
+    slot->Connect(mNodes[mConnections[binarySlot.mFirstConnection + i]]);
+  }
+
+  /// Set default values
+  const float* d = binarySlot.mDefault;
+  switch (binarySlot.mDefaultType) {
+    case BinaryFormat::DefaultType::FLOAT:
+      if (dynamic_cast<FloatSlot*>(slot)) {
+        SafeCast<FloatSlot*>(slot)->SetDefaultValue(d[0]);
+      }
+      break;
+    case BinaryFormat::DefaultType::VEC2:
+      if (dynamic_cast<Vec2Slot*>(slot)) {
+        SafeCast<Vec2Slot*>(slot)->SetDefaultValue(vec2(d[0], d[1]));
+      }
+      break;
+    case BinaryFormat::DefaultType::VEC3:
+      if (dynamic_cast<Vec3Slot*>(slot)) {
+        SafeCast<Vec3Slot*>(slot)->SetDefaultValue(vec3(d[0], d[1], d[2]));
+      }
+      break;
+    case BinaryFormat::DefaultType::VEC4:
+      if (dynamic_cast<Vec4Slot*>(slot)) {
+        SafeCast<Vec4Slot*>(slot)->SetDefaultValue(vec4(d[0], d[1], d[2], d[3]));
+      }
+      break;
+    case BinaryFormat::DefaultType::STRING:
+      if (dynamic_cast<StringSlot*>(slot)) {
+        SafeCast<StringSlot*>(slot)->SetDefaultValue(GetString(binarySlot.mDefaultString));
+      }
+      break;
+    default: break;
+  }
+}
+
+void BinaryDeserializer::DeserializeFloatSplineNode(const BinaryNode& binaryNode,
+  const std::shared_ptr<FloatSplineNode>& node) const
+{
+  for (UINT l = UINT(SplineLayer::BASE); l < UINT(SplineLayer::COUNT); l++) {
+    uint64_t size;
+    const char* blob = GetBlob(binaryNode.mBlobs[l], size);
+    if (blob == nullptr) continue;
+
+    const SplineLayer layer = SplineLayer(l);
+    const UINT pointCount = UINT(size / sizeof(BinarySplinePoint));
+    for (UINT i = 0; i < pointCount; i++) {
+      BinarySplinePoint point;
+      memcpy(&point, blob + i * sizeof(BinarySplinePoint), sizeof(BinarySplinePoint));
+      const UINT flags = point.mFlags;
+      const int pIndex = node->AddPoint(layer, point.mTime, point.mValue);
+      node->SetAutoTangent(layer, pIndex, (flags & BinaryFormat::AutoTangentFlag) != 0);
+      node->SetBreakpoint(layer, pIndex, (flags & BinaryFormat::BreakpointFlag) != 0);
+      node->SetLinear(layer, pIndex, (flags & BinaryFormat::LinearFlag) != 0);
+    }
+  }
+}
+
+bool BinaryDeserializer::DeserializeStaticTextureNode(const BinaryNode& binaryNode,
+  const std::shared_ptr<StaticTextureNode>& node)
+{
+  const std::array<uint32_t, 4> key = {
+    binaryNode.mBlobs[BinaryFormat::TexelsBlob],
+    binaryNode.mParams[BinaryFormat::TextureWidthParam],
+    binaryNode.mParams[BinaryFormat::TextureHeightParam],
+    binaryNode.mParams[BinaryFormat::TextureTypeParam],
+  };
+  const auto it = mTextures.find(key);
+  if (it != mTextures.end()) {
+    node->Set(it->second);
+    return true;
+  }
+
+  uint64_t size;
+  const char* texels = GetBlob(binaryNode.mBlobs[BinaryFormat::TexelsBlob], size);
+  if (texels == nullptr) return true;
+  const int width = int(binaryNode.mParams[BinaryFormat::TextureWidthParam]);
+  const int height = int(binaryNode.mParams[BinaryFormat::TextureHeightParam]);
+  const TexelType texelType =
+    TexelType(binaryNode.mParams[BinaryFormat::TextureTypeParam]);
+  if (UINT(texelType) > UINT(TexelType::DEPTH32F)) {
+    ERR("Unknown texture type: %d", UINT(texelType));
+    return false;
+  }
+  if (width <= 0 || height <= 0 ||
+    size / OpenGLAPI::GetTexelByteCount(texelType) < uint64_t(width) * height) {
+    ERR("Texel data size mismatch");
+    return false;
+  }
+  const bool gpuMemoryOnly = mDataOwner != nullptr;
+  const std::shared_ptr<Texture> texture = OpenGL->MakeTexture(width, height, texelType,
+    texels, gpuMemoryOnly, false, true, true);
+  mTextures[key] = texture;
+  node->Set(texture);
+  return true;
+}
+
+bool BinaryDeserializer::DeserializeStaticMeshNode(const BinaryNode& binaryNode,
+  const std::shared_ptr<StaticMeshNode>& node)
+{
+  const UINT binaryFormat = binaryNode.mParams[BinaryFormat::MeshFormatParam];
+  const UINT vertexCount = binaryNode.mParams[BinaryFormat::MeshVertexCountParam];
+  const UINT indexCount = binaryNode.mParams[BinaryFormat::MeshIndexCountParam];
+  const std::array<uint32_t, 5> key = {
+    binaryNode.mBlobs[BinaryFormat::MeshVerticesBlob],
+    indexCount > 0
+      ? binaryNode.mBlobs[BinaryFormat::MeshIndicesBlob] : BinaryFormat::NoBlob,
+    binaryFormat, vertexCount, indexCount,
+  };
+  const auto it = mMeshes.find(key);
+  if (it != mMeshes.end()) {
+    node->Set(it->second);
+    return true;
+  }
+
+  const std::shared_ptr<VertexFormat> format = std::make_shared<VertexFormat>(binaryFormat);
+  std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>();
+
+  uint64_t size;
+  const char* vertices = GetBlob(binaryNode.mBlobs[BinaryFormat::MeshVerticesBlob], size);
+  if (size != uint64_t(vertexCount) * format->mStride) {
+    ERR("Vertex data size mismatch");
+    return false;
+  }
+  if (mDataOwner) {
+    mesh->BorrowVertices(format, vertexCount, vertices, mDataOwner);
+  }
+  else {
+    mesh->AllocateVertices(format, vertexCount);
+    mesh->UploadVertices(const_cast<char*>(vertices));
+  }
+
+  if (indexCount > 0) {
+    const char* indexBlob =
+      GetBlob(binaryNode.mBlobs[BinaryFormat::MeshIndicesBlob], size);
+    if (size != uint64_t(indexCount) * sizeof(uint32_t)) {
+      ERR("Index data size mismatch");
+      return false;
+    }
+    for (UINT i = 0; i < indexCount; i++) {
+      uint32_t index;
+      memcpy(&index, indexBlob + i * sizeof(uint32_t), sizeof(uint32_t));
+      if (index >= vertexCount) {
+        ERR("Vertex index out of range");
+        return false;
+      }
+    }
+    mesh->AllocateIndices(indexCount);
+    if (sizeof(IndexEntry) == sizeof(uint32_t)) {
+      /// Blobs are aligned, upload in place
+      mesh->UploadIndices(reinterpret_cast<const IndexEntry*>(indexBlob));
+    }
+    else {
+      std::vector<IndexEntry> indices(indexCount);
+      for (UINT i = 0; i < indexCount; i++) {
+        uint32_t index;
+        memcpy(&index, indexBlob + i * sizeof(uint32_t), sizeof(uint32_t));
+        indices[i] = IndexEntry(index);
+      }
+      mesh->UploadIndices(&indices[0]);
+    }
+  }
+
+  mMeshes[key] = mesh;
+  node->Set(mesh);
+  return true;
+}
+
+void BinaryDeserializer::DeserializeStubNode(const BinaryNode& binaryNode,
+  const std::shared_ptr<StubNode>& node) const
+{
+  node->mSource.SetDefaultValue(GetString(binaryNode.mBlobs[BinaryFormat::StubSourceBlob]));
+  node->Update();
+}
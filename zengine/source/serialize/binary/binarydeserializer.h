@@ -0,0 +1,67 @@
+#pragma once
+
+#include "binaryformat.h"
+#include <include/dom/document.h>
+#include <include/nodes/valuenodes.h>
+#include <include/nodes/meshnode.h>
+#include <include/nodes/texturenode.h>
+#include <include/nodes/splinenode.h>
+#include <include/shaders/stubnode.h>
+#include <array>
+#include <map>
+#include <string>
+#include <vector>
+
+class BinaryDeserializer {
+public:
+  /// When a data owner is given, the data is expected to outlive the load
+  /// (eg. a mapped file): meshes borrow their vertices from it and textures are
+  /// uploaded from it without keeping a CPU-side copy.
+  BinaryDeserializer(const char* data, size_t size,
+    const std::shared_ptr<const void>& dataOwner = nullptr);
+  std::shared_ptr<Document> GetDocument() const;
+
+  /// Checks the magic bytes of the container
+  static bool IsBinaryDocument(const char* data, size_t size);
+
+private:
+  /// Validates the header and the tables, returns false on corrupt input
+  bool ReadTables();
+
+  /// Return false on corrupt input, the load fails then
+  bool DeserializeNode(const BinaryNode& binaryNode);
+
+  void DeserializeFloatSplineNode(const BinaryNode& binaryNode,
+    const std::shared_ptr<FloatSplineNode>& node) const;
+  bool DeserializeStaticTextureNode(const BinaryNode& binaryNode,
+    const std::shared_ptr<StaticTextureNode>& node);
+  bool DeserializeStaticMeshNode(const BinaryNode& binaryNode,
+    const std::shared_ptr<StaticMeshNode>& node);
+  void DeserializeStubNode(const BinaryNode& binaryNode,
+    const std::shared_ptr<StubNode>& node) const;
+
+  void ConnectSlots(const BinaryNode& binaryNode, const std::shared_ptr<Node>& node);
+  void ConnectSlot(const BinarySlot& binarySlot, Slot* slot);
+
+  /// Blob access, return nullptr/empty for BinaryFormat::NoBlob
+  const char* GetBlob(uint32_t index, uint64_t& oSize) const;
+  std::string GetString(uint32_t index) const;
+
+  const char* mData;
+  size_t mSize;
+  std::shared_ptr<const void> mDataOwner;
+
+  const BinaryHeader* mHeader = nullptr;
+  const BinaryNode* mBinaryNodes = nullptr;
+  const BinarySlot* mBinarySlots = nullptr;
+  const uint32_t* mConnections = nullptr;
+  const BinaryBlob* mBlobs = nullptr;
+
+  std::vector<std::shared_ptr<Node>> mNodes;
+  std::shared_ptr<Document> mDocument;
+
+  /// Loaded assets by their blobs and parameters, nodes with equal content
+  /// refer to the same blobs and share these
+  std::map<std::array<uint32_t, 4>, std::shared_ptr<Texture>> mTextures;
+  std::map<std::array<uint32_t, 5>, std::shared_ptr<Mesh>> mMeshes;
+};
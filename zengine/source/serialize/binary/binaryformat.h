@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+
+/// Binary document container. Everything is little-endian, all tables and
+/// blobs start at an offset aligned to BinaryFormat::Alignment. Node indices
+/// refer to the node table, nodes are stored in post-order (dependencies first).
+/// Nodes with equal texels or mesh arrays refer to the same blob, loaders share
+/// the texture or mesh between them.
+///
+///   BinaryHeader
+///   BinaryNode[mNodeCount]
+///   BinarySlot[mSlotCount]
+///   uint32_t[mConnectionCount]       -- connected node indices
+///   BinaryBlob[mBlobCount]
+///   raw blob data
+
+namespace BinaryFormat {
+  const char Magic[4] = { 'Z', 'E', 'N', 'B' };
+  const uint32_t Version = 1;
+  const uint64_t Alignment = 16;
+
+  /// Blob index used for missing content
+  const uint32_t NoBlob = 0xffffffff;
+
+  /// Number of node content blob references, one for each spline layer
+  const uint32_t NodeBlobCount = 5;
+
+  /// Indices into BinaryNode::mBlobs
+  const uint32_t MeshVerticesBlob = 0;
+  const uint32_t MeshIndicesBlob = 1;
+  const uint32_t TexelsBlob = 0;
+  const uint32_t StubSourceBlob = 0;
+
+  /// Indices into BinaryNode::mParams
+  const uint32_t TextureWidthParam = 0;
+  const uint32_t TextureHeightParam = 1;
+  const uint32_t TextureTypeParam = 2;
+  const uint32_t MeshFormatParam = 0;
+  const uint32_t MeshVertexCountParam = 1;
+  const uint32_t MeshIndexCountParam = 2;
+
+  /// BinaryNode::mFlags
+  const uint32_t HasPositionFlag = 1;
+
+  /// BinarySlot::mFlags
+  const uint32_t GhostSlotFlag = 1;
+  const uint32_t MultiSlotFlag = 2;
+
+  /// BinarySplinePoint::mFlags
+  const uint32_t AutoTangentFlag = 1;
+  const uint32_t BreakpointFlag = 2;
+  const uint32_t LinearFlag = 4;
+
+  /// BinarySlot::mDefaultType
+  enum class DefaultType : uint32_t {
+    NONE,
+    FLOAT,
+    VEC2,
+    VEC3,
+    VEC4,
+    STRING,
+  };
+}
+
+struct BinaryHeader {
+  char mMagic[4];
+  uint32_t mVersion;
+
+  uint32_t mNodeCount;
+  uint32_t mSlotCount;
+  uint32_t mConnectionCount;
+  uint32_t mBlobCount;
+
+  uint64_t mNodeTableOffset;
+  uint64_t mSlotTableOffset;
+  uint64_t mConnectionTableOffset;
+  uint64_t mBlobTableOffset;
+};
+
+struct BinaryNode {
+  /// String blobs. Class name is "ghost" for ghost nodes.
+  uint32_t mClassName;
+  uint32_t mName;
+
+  uint32_t mFlags;
+  float mPosition[2];
+
+  /// Range in the slot table
+  uint32_t mFirstSlot;
+  uint32_t mSlotCount;
+
+  /// Value of float and vector nodes
+  float mValue[4];
+
+  /// Node content: spline layers, mesh vertices and indices, texels, stub source
+  uint32_t mBlobs[BinaryFormat::NodeBlobCount];
+
+  /// Texture size and type, mesh format and sizes
+  uint32_t mParams[3];
+};
+
+struct BinarySlot {
+  uint32_t mName;
+  uint32_t mFlags;
+
+  /// Range in the connection table
+  uint32_t mFirstConnection;
+  uint32_t mConnectionCount;
+
+  BinaryFormat::DefaultType mDefaultType;
+  uint32_t mDefaultString;
+  float mDefault[4];
+};
+
+struct BinaryBlob {
+  uint64_t mOffset;
+  uint64_t mSize;
+};
+
+struct BinarySplinePoint {
+  float mTime;
+  float mValue;
+  uint32_t mFlags;
+};
+
+static_assert(sizeof(BinaryHeader) == 56, "Unexpected binary header layout");
+static_assert(sizeof(BinaryNode) == 76, "Unexpected binary node layout");
+static_assert(sizeof(BinarySlot) == 40, "Unexpected binary slot layout");
+static_assert(sizeof(BinaryBlob) == 16, "Unexpected binary blob layout");
+static_assert(sizeof(BinarySplinePoint) == 12, "Unexpected spline point layout");
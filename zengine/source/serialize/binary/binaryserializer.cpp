@@ -0,0 +1,332 @@
+#include "binaryserializer.h"
+#include <include/dom/graph.h>
+#include <include/dom/ghost.h>
+#include <include/base/helpers.h>
+#include "../compression.h"
+#include <cstring>
+
+static_assert(UINT(SplineLayer::COUNT) == BinaryFormat::NodeBlobCount,
+  "Binary format needs a blob for each spline layer");
+
+static uint64_t AlignOffset(uint64_t offset) {
+  return (offset + BinaryFormat::Alignment - 1) & ~(BinaryFormat::Alignment - 1);
+}
+
+BinarySerializer::BinarySerializer(const std::shared_ptr<Node>& root) {
+  Traverse(root);
+
+  mBinaryNodes.reserve(mNodesList.size());
+  for (auto& node : mNodesList) {
+    Serialize(node);
+  }
+
+  Assemble();
+}
+
+const std::vector<char>& BinarySerializer::GetData() const
+{
+  return mData;
+}
+
+void BinarySerializer::Traverse(const std::shared_ptr<Node>& root) {
+  /// Mark as visited, the final index is known after the children
+  mNodes[root] = BinaryFormat::NoBlob;
+
+  for (const auto& slotPair : root->GetSerializableSlots()) {
+    Slot* slot = slotPair.second;
+    if (slot->mIsMultiSlot) {
+      for (auto& node : slot->GetDirectMultiNodes()) {
+        if (mNodes.find(node) == mNodes.end()) {
+          Traverse(node);
+        }
+      }
+    }
+    else {
+      std::shared_ptr<Node> node = slot->GetDirectNode();
+      if (node == nullptr || slot->IsDefaulted()) continue;
+      if (mNodes.find(node) == mNodes.end()) {
+        Traverse(node);
+      }
+    }
+  }
+
+  mNodes[root] = uint32_t(mNodesList.size());
+  mNodesList.push_back(root);
+}
+
+void BinarySerializer::Serialize(const std::shared_ptr<Node>& node) {
+  BinaryNode binaryNode;
+  memset(&binaryNode, 0, sizeof(BinaryNode));
+  for (uint32_t& blob : binaryNode.mBlobs) blob = BinaryFormat::NoBlob;
+
+  /// Save class type
+  if (node->IsGhostNode()) {
+    binaryNode.mClassName = AddString("ghost");
+  }
+  else {
+    NodeClass* nodeClass = NodeRegistry::GetInstance()->GetNodeClass(node);
+    binaryNode.mClassName = AddString(nodeClass->mClassName);
+  }
+
+  /// Save node name
+  binaryNode.mName = node->GetName().empty()
+    ? BinaryFormat::NoBlob : AddString(node->GetName());
+
+  /// Save graph position
+  if (!IsPointerOf<Graph>(node) && !IsPointerOf<Document>(node)) {
+    const vec2 position = node->GetPosition();
+    binaryNode.mFlags |= BinaryFormat::HasPositionFlag;
+    binaryNode.mPosition[0] = position.x;
+    binaryNode.mPosition[1] = position.y;
+  }
+
+  /// Save node content
+  if (IsExactType<FloatNode>(node)) {
+    binaryNode.mValue[0] = PointerCast<FloatNode>(node)->Get();
+  }
+  else if (IsExactType<Vec2Node>(node)) {
+    const vec2 value = PointerCast<Vec2Node>(node)->Get();
+    memcpy(binaryNode.mValue, &value, sizeof(vec2));
+  }
+  else if (IsExactType<Vec3Node>(node)) {
+    const vec3 value = PointerCast<Vec3Node>(node)->Get();
+    memcpy(binaryNode.mValue, &value, sizeof(vec3));
+  }
+  else if (IsExactType<Vec4Node>(node)) {
+    const vec4 value = PointerCast<Vec4Node>(node)->Get();
+    memcpy(binaryNode.mValue, &value, sizeof(vec4));
+  }
+  else if (IsExactType<FloatSplineNode>(node)) {
+    SerializeFloatSplineNode(binaryNode, PointerCast<FloatSplineNode>(node));
+  }
+  else if (IsExactType<StaticTextureNode>(node)) {
+    SerializeStaticTextureNode(binaryNode, PointerCast<StaticTextureNode>(node));
+  }
+  else if (IsExactType<StaticMeshNode>(node)) {
+    SerializeStaticMeshNode(binaryNode, PointerCast<StaticMeshNode>(node));
+  }
+  else if (IsExactType<StubNode>(node)) {
+    binaryNode.mBlobs[BinaryFormat::StubSourceBlob] =
+      AddString(PointerCast<StubNode>(node)->mSource.Get());
+  }
+
+  SerializeSlots(binaryNode, node);
+  mBinaryNodes.push_back(binaryNode);
+}
+
+void BinarySerializer::SerializeSlots(
+  BinaryNode& binaryNode, const std::shared_ptr<Node>& node)
+{
+  const auto& slots = node->GetSerializableSlots();
+  binaryNode.mFirstSlot = uint32_t(mBinarySlots.size());
+  binaryNode.mSlotCount = uint32_t(slots.size());
+
+  for (const auto& slotPair : slots) {
+    Slot* slot = slotPair.second;
+    ASSERT(!slot->mName.empty());
+    BinarySlot binarySlot;
+    memset(&binarySlot, 0, sizeof(BinarySlot));
+    binarySlot.mName = AddString(slot->mName);
+    binarySlot.mDefaultType = BinaryFormat::DefaultType::NONE;
+    binarySlot.mDefaultString = BinaryFormat::NoBlob;
+    binarySlot.mFirstConnection = uint32_t(mConnections.size());
+
+    /// Save ghost flag
+    if (slot->IsGhost()) {
+      binarySlot.mFlags |= BinaryFormat::GhostSlotFlag;
+    }
+
+    if (slot->mIsMultiSlot) {
+      /// Save connections
+      binarySlot.mFlags |= BinaryFormat::MultiSlotFlag;
+      for (const auto& connectedNode : slot->GetDirectMultiNodes()) {
+        mConnections.push_back(mNodes.at(connectedNode));
+      }
+    }
+    else {
+      /// Save connection
+      const auto& connectedNode = slot->GetDirectNode();
+      if (connectedNode != nullptr && !slot->IsDefaulted()) {
+        mConnections.push_back(mNodes.at(connectedNode));
+      }
+
+      /// Save default values
+      FloatSlot* floatSlot;
+      Vec2Slot* vec2Slot;
+      Vec3Slot* vec3Slot;
+      Vec4Slot* vec4Slot;
+      StringSlot* stringSlot;
+
+      if ((floatSlot = dynamic_cast<FloatSlot*>(slot)) != nullptr) {
+        binarySlot.mDefaultType = BinaryFormat::DefaultType::FLOAT;
+        binarySlot.mDefault[0] = floatSlot->GetDefaultValue();
+      }
+      else if ((vec2Slot = dynamic_cast<Vec2Slot*>(slot)) != nullptr) {
+        const vec2 value = vec2Slot->GetDefaultValue();
+        binarySlot.mDefaultType = BinaryFormat::DefaultType::VEC2;
+        memcpy(binarySlot.mDefault, &value, sizeof(vec2));
+      }
+      else if ((vec3Slot = dynamic_cast<Vec3Slot*>(slot)) != nullptr) {
+        const vec3 value = vec3Slot->GetDefaultValue();
+        binarySlot.mDefaultType = BinaryFormat::DefaultType::VEC3;
+        memcpy(binarySlot.mDefault, &value, sizeof(vec3));
+      }
+      else if ((vec4Slot = dynamic_cast<Vec4Slot*>(slot)) != nullptr) {
+        const vec4 value = vec4Slot->GetDefaultValue();
+        binarySlot.mDefaultType = BinaryFormat::DefaultType::VEC4;
+        memcpy(binarySlot.mDefault, &value, sizeof(vec4));
+      }
+      else if ((stringSlot = dynamic_cast<StringSlot*>(slot)) != nullptr) {
+        binarySlot.mDefaultType = BinaryFormat::DefaultType::STRING;
+        binarySlot.mDefaultString = AddString(stringSlot->GetDefaultValue());
+      }
+    }
+
+    binarySlot.mConnectionCount =
+      uint32_t(mConnections.size()) - binarySlot.mFirstConnection;
+    mBinarySlots.push_back(binarySlot);
+  }
+}
+
+void BinarySerializer::SerializeFloatSplineNode(
+  BinaryNode& binaryNode, const std::shared_ptr<FloatSplineNode>& node)
+{
+  std::vector<BinarySplinePoint> binaryPoints;
+  for (UINT layer = UINT(SplineLayer::BASE); layer < UINT(SplineLayer::COUNT); layer++) {
+    const auto& points = node->GetComponent(SplineLayer(layer))->GetPoints();
+    if (points.empty()) continue;
+    binaryPoints.resize(points.size());
+    for (UINT i = 0; i < points.size(); i++) {
+      const SplinePoint& point = points[i];
+      BinarySplinePoint& binaryPoint = binaryPoints[i];
+      binaryPoint.mTime = point.mTime;
+      binaryPoint.mValue = point.mValue;
+      binaryPoint.mFlags =
+        (point.mIsAutoangent ? BinaryFormat::AutoTangentFlag : 0) |
+        (point.mIsBreakpoint ? BinaryFormat::BreakpointFlag : 0) |
+        (point.mIsLinear ? BinaryFormat::LinearFlag : 0);
+    }
+    binaryNode.mBlobs[layer] =
+      AddBlob(&binaryPoints[0], binaryPoints.size() * sizeof(BinarySplinePoint));
+  }
+}
+
+void BinarySerializer::SerializeStaticTextureNode(
+  BinaryNode& binaryNode, const std::shared_ptr<StaticTextureNode>& node)
+{
+  const std::shared_ptr<Texture>& texture = node->Get();
+  if (texture == nullptr) return;
+  const std::shared_ptr<std::vector<char>> texels = texture->mTexelData
+    ? texture->mTexelData : OpenGL->ReadTextureGpuData(texture);
+  if (texels == nullptr) return;
+  binaryNode.mParams[BinaryFormat::TextureWidthParam] = texture->mWidth;
+  binaryNode.mParams[BinaryFormat::TextureHeightParam] = texture->mHeight;
+  binaryNode.mParams[BinaryFormat::TextureTypeParam] = uint32_t(texture->mType);
+  binaryNode.mBlobs[BinaryFormat::TexelsBlob] =
+    AddContentBlob(texels->data(), texels->size());
+}
+
+void BinarySerializer::SerializeStaticMeshNode(
+  BinaryNode& binaryNode, const std::shared_ptr<StaticMeshNode>& node)
+{
+  const std::shared_ptr<Mesh>& mesh = node->GetMesh();
+  ASSERT(mesh->mRawVertexData != nullptr);
+  binaryNode.mParams[BinaryFormat::MeshFormatParam] = mesh->mFormat->mBinaryFormat;
+  binaryNode.mParams[BinaryFormat::MeshVertexCountParam] = mesh->mVertexCount;
+  binaryNode.mParams[BinaryFormat::MeshIndexCountParam] = mesh->mIndexCount;
+
+  binaryNode.mBlobs[BinaryFormat::MeshVerticesBlob] = AddContentBlob(
+    mesh->mRawVertexData, size_t(mesh->mVertexCount) * mesh->mFormat->mStride);
+
+  if (mesh->mIndexCount > 0) {
+    /// Indices are always stored as 32-bit
+    std::vector<uint32_t> indices(mesh->mIndexCount);
+    for (UINT i = 0; i < mesh->mIndexCount; i++) {
+      indices[i] = uint32_t(mesh->mIndexData[i]);
+    }
+    binaryNode.mBlobs[BinaryFormat::MeshIndicesBlob] =
+      AddContentBlob(&indices[0], indices.size() * sizeof(uint32_t));
+  }
+}
+
+uint32_t BinarySerializer::AddBlob(const void* data, size_t size) {
+  BinaryBlob blob;
+  blob.mOffset = AlignOffset(mBlobData.size());
+  blob.mSize = size;
+  mBlobData.resize(size_t(blob.mOffset + size));
+  if (size > 0) memcpy(&mBlobData[size_t(blob.mOffset)], data, size);
+  mBlobTable.push_back(blob);
+  return uint32_t(mBlobTable.size() - 1);
+}
+
+uint32_t BinarySerializer::AddString(const std::string& text) {
+  const auto it = mStrings.find(text);
+  if (it != mStrings.end()) return it->second;
+  const uint32_t index = AddBlob(text.c_str(), text.size());
+  mStrings[text] = index;
+  return index;
+}
+
+uint32_t BinarySerializer::AddContentBlob(const void* data, size_t size) {
+  const std::string hash = Compression::GetContentHash(data, size);
+  const auto it = mContentBlobs.find(hash);
+  if (it != mContentBlobs.end()) {
+    const BinaryBlob& blob = mBlobTable[it->second];
+    if (blob.mSize == size &&
+      (size == 0 || memcmp(&mBlobData[size_t(blob.mOffset)], data, size) == 0))
+    {
+      return it->second;
+    }
+  }
+  const uint32_t index = AddBlob(data, size);
+  mContentBlobs[hash] = index;
+  return index;
+}
+
+void BinarySerializer::Assemble() {
+  BinaryHeader header;
+  memset(&header, 0, sizeof(BinaryHeader));
+  memcpy(header.mMagic, BinaryFormat::Magic, sizeof(header.mMagic));
+  header.mVersion = BinaryFormat::Version;
+  header.mNodeCount = uint32_t(mBinaryNodes.size());
+  header.mSlotCount = uint32_t(mBinarySlots.size());
+  header.mConnectionCount = uint32_t(mConnections.size());
+  header.mBlobCount = uint32_t(mBlobTable.size());
+
+  header.mNodeTableOffset = AlignOffset(sizeof(BinaryHeader));
+  header.mSlotTableOffset =
+    AlignOffset(header.mNodeTableOffset + mBinaryNodes.size() * sizeof(BinaryNode));
+  header.mConnectionTableOffset =
+    AlignOffset(header.mSlotTableOffset + mBinarySlots.size() * sizeof(BinarySlot));
+  header.mBlobTableOffset = AlignOffset(
+    header.mConnectionTableOffset + mConnections.size() * sizeof(uint32_t));
+  const uint64_t blobDataOffset =
+    AlignOffset(header.mBlobTableOffset + mBlobTable.size() * sizeof(BinaryBlob));
+
+  for (BinaryBlob& blob : mBlobTable) {
+    blob.mOffset += blobDataOffset;
+  }
+
+  mData.assign(size_t(blobDataOffset + mBlobData.size()), 0);
+  char* data = &mData[0];
+  memcpy(data, &header, sizeof(BinaryHeader));
+  if (!mBinaryNodes.empty()) {
+    memcpy(data + header.mNodeTableOffset, &mBinaryNodes[0],
+      mBinaryNodes.size() * sizeof(BinaryNode));
+  }
+  if (!mBinarySlots.empty()) {
+    memcpy(data + header.mSlotTableOffset, &mBinarySlots[0],
+      mBinarySlots.size() * sizeof(BinarySlot));
+  }
+  if (!mConnections.empty()) {
+    memcpy(data + header.mConnectionTableOffset, &mConnections[0],
+      mConnections.size() * sizeof(uint32_t));
+  }
+  if (!mBlobTable.empty()) {
+    memcpy(data + header.mBlobTableOffset, &mBlobTable[0],
+      mBlobTable.size() * sizeof(BinaryBlob));
+  }
+  if (!mBlobData.empty()) {
+    memcpy(data + blobDataOffset, &mBlobData[0], mBlobData.size());
+  }
+}
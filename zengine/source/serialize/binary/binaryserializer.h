@@ -0,0 +1,64 @@
+#pragma once
+
+#include "binaryformat.h"
+#include <include/dom/document.h>
+#include <include/nodes/valuenodes.h>
+#include <include/nodes/meshnode.h>
+#include <include/nodes/texturenode.h>
+#include <include/nodes/splinenode.h>
+#include <include/shaders/stubnode.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class BinarySerializer {
+public:
+  BinarySerializer(const std::shared_ptr<Node>& root);
+  const std::vector<char>& GetData() const;
+
+private:
+  /// Collect nodes in the transitive close of root
+  void Traverse(const std::shared_ptr<Node>& root);
+
+  /// Fills the node, slot and connection tables
+  void Serialize(const std::shared_ptr<Node>& node);
+
+  /// Node serializers
+  void SerializeFloatSplineNode(
+    BinaryNode& binaryNode, const std::shared_ptr<FloatSplineNode>& node);
+  void SerializeStaticTextureNode(
+    BinaryNode& binaryNode, const std::shared_ptr<StaticTextureNode>& node);
+  void SerializeStaticMeshNode(
+    BinaryNode& binaryNode, const std::shared_ptr<StaticMeshNode>& node);
+  void SerializeSlots(BinaryNode& binaryNode, const std::shared_ptr<Node>& node);
+
+  /// Adds a blob, returns its index
+  uint32_t AddBlob(const void* data, size_t size);
+  uint32_t AddString(const std::string& text);
+
+  /// Adds a blob, or returns the index of an earlier one with the same content
+  uint32_t AddContentBlob(const void* data, size_t size);
+
+  /// Writes all tables and blobs into mData
+  void Assemble();
+
+  /// All nodes to save, index in the node table
+  std::unordered_map<std::shared_ptr<Node>, uint32_t> mNodes;
+  std::vector<std::shared_ptr<Node>> mNodesList;
+
+  std::vector<BinaryNode> mBinaryNodes;
+  std::vector<BinarySlot> mBinarySlots;
+  std::vector<uint32_t> mConnections;
+
+  /// Blob offsets are relative to mBlobData until Assemble()
+  std::vector<BinaryBlob> mBlobTable;
+  std::vector<char> mBlobData;
+
+  /// Identical strings (slot and class names) share a blob
+  std::unordered_map<std::string, uint32_t> mStrings;
+
+  /// Texel and mesh blobs by content hash
+  std::unordered_map<std::string, uint32_t> mContentBlobs;
+
+  std::vector<char> mData;
+};
@@ -0,0 +1,124 @@
+#include "compression.h"
+#include <include/base/threadpool.h>
+#include <include/base/helpers.h>
+#include <zstd/zstd.h>
+#define XXH_INLINE_ALL
+#include <zstd/common/xxhash.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+  /// Location of a frame in the compressed data and its content
+  struct Frame {
+    size_t mCompressedOffset;
+    size_t mCompressedSize;
+    size_t mContentOffset;
+    size_t mContentSize;
+  };
+
+  void RunJobs(UINT count, ThreadPool* threadPool, const std::function<void(UINT)>& job) {
+    if (threadPool && count > 1) {
+      threadPool->ParallelFor(count, job);
+    }
+    else {
+      for (UINT i = 0; i < count; i++) job(i);
+    }
+  }
+}
+
+bool Compression::IsCompressed(const void* data, size_t size) {
+  if (size < 4) return false;
+  uint32_t magic;
+  memcpy(&magic, data, sizeof(magic));
+  return magic == ZSTD_MAGICNUMBER;
+}
+
+std::vector<char> Compression::Compress(const void* data, size_t size, int level,
+  ThreadPool* threadPool)
+{
+  const char* bytes = static_cast<const char*>(data);
+  const UINT frameCount = UINT(size == 0 ? 1 : (size + FrameSize - 1) / FrameSize);
+  std::vector<std::vector<char>> frames(frameCount);
+  std::atomic<bool> failed{ false };
+  RunJobs(frameCount, threadPool, [&](UINT i) {
+    const size_t offset = size_t(i) * FrameSize;
+    const size_t frameSize = std::min(FrameSize, size - offset);
+    std::vector<char>& frame = frames[i];
+    frame.resize(ZSTD_compressBound(frameSize));
+    const size_t compressedSize =
+      ZSTD_compress(frame.data(), frame.size(), bytes + offset, frameSize, level);
+    if (ZSTD_isError(compressedSize)) failed = true;
+    else frame.resize(compressedSize);
+  });
+  if (failed) {
+    ERR("zstd compression failed");
+    return std::vector<char>();
+  }
+
+  std::vector<char> compressed;
+  for (const std::vector<char>& frame : frames) {
+    compressed.insert(compressed.end(), frame.begin(), frame.end());
+  }
+  return compressed;
+}
+
+bool Compression::Decompress(const void* data, size_t size, std::vector<char>& oContent,
+  ThreadPool* threadPool)
+{
+  /// The frame headers tell where each frame's content goes
+  const char* bytes = static_cast<const char*>(data);
+  std::vector<Frame> frames;
+  unsigned long long contentSize = 0;
+  for (size_t offset = 0; offset < size; ) {
+    const size_t compressedSize = ZSTD_findFrameCompressedSize(bytes + offset, size - offset);
+    const unsigned long long frameContentSize =
+      ZSTD_getFrameContentSize(bytes + offset, size - offset);
+    if (ZSTD_isError(compressedSize) || frameContentSize == ZSTD_CONTENTSIZE_ERROR ||
+      frameContentSize == ZSTD_CONTENTSIZE_UNKNOWN)
+    {
+      return false;
+    }
+
+    /// Content sizes come from the data, don't trust them
+    if (frameContentSize / MaxCompressionRatio > compressedSize ||
+      frameContentSize > SIZE_MAX - contentSize)
+    {
+      ERR("zstd frame content size out of range: %llu", frameContentSize);
+      return false;
+    }
+    frames.push_back({ offset, compressedSize, size_t(contentSize),
+      size_t(frameContentSize) });
+    offset += compressedSize;
+    contentSize += frameContentSize;
+  }
+
+  try {
+    oContent.resize(size_t(contentSize));
+  }
+  catch (const std::exception&) {
+    ERR("Can't allocate %llu bytes for decompression", contentSize);
+    return false;
+  }
+  std::atomic<bool> failed{ false };
+  RunJobs(UINT(frames.size()), threadPool, [&](UINT i) {
+    const Frame& frame = frames[i];
+    const size_t decompressedSize = ZSTD_decompress(
+      oContent.data() + frame.mContentOffset, frame.mContentSize,
+      bytes + frame.mCompressedOffset, frame.mCompressedSize);
+    if (decompressedSize != frame.mContentSize) failed = true;
+  });
+  return !failed;
+}
+
+std::string Compression::GetContentHash(const void* data, size_t size) {
+  /// zstd's copy of xxHash leaves out XXH3
+  const XXH64_hash_t high = XXH64(data, size, 0);
+  const XXH64_hash_t low = XXH64(data, size, 0x9e3779b97f4a7c15ull);
+  char text[33];
+  snprintf(text, sizeof(text), "%016llx%016llx",
+    (unsigned long long)high, (unsigned long long)low);
+  return text;
+}
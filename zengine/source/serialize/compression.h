@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+/// zstd compression of documents and embedded blobs, see components/zstd.
+/// Compressed data is a sequence of independent zstd frames, each holding its
+/// content size, so it can be decompressed in parallel straight into place.
+namespace Compression {
+  /// Decompression speed is about the same on every level, higher levels only
+  /// make saving slower
+  const int DefaultLevel = 3;
+
+  /// Uncompressed bytes per frame
+  const size_t FrameSize = 4 * 1024 * 1024;
+
+  /// Upper bound of the zstd compression ratio, a 128 KB block can't get
+  /// smaller than 4 bytes. Frames claiming more content are rejected before
+  /// anything is allocated.
+  const size_t MaxCompressionRatio = 32 * 1024;
+
+  /// Checks the zstd magic number
+  bool IsCompressed(const void* data, size_t size);
+
+  /// Frames are compressed on the thread pool when given
+  std::vector<char> Compress(const void* data, size_t size,
+    int level = DefaultLevel, ThreadPool* threadPool = nullptr);
+
+  /// Returns false for damaged data, frames without content size, or content
+  /// sizes beyond MaxCompressionRatio. Frames
+  /// are decompressed on the thread pool when given, otherwise it's thread safe.
+  bool Decompress(const void* data, size_t size, std::vector<char>& oContent,
+    ThreadPool* threadPool = nullptr);
+
+  /// Content address of a blob as 32 hex digits: two differently seeded XXH64
+  /// hashes of the data, from the xxHash that comes with zstd. Thread safe.
+  std::string GetContentHash(const void* data, size_t size);
+}
@@ -0,0 +1,283 @@
+#include "base64simd.h"
+#include <include/base/defines.h>
+#include <intrin.h>
+#include <immintrin.h>
+
+/// SIMD encoding and decoding after Wojciech Mula's and Daniel Lemire's
+/// "Faster Base64 Encoding and Decoding Using AVX2 Instructions".
+
+namespace {
+  enum class InstructionSet {
+    SCALAR,
+    SSE41,
+    AVX2,
+  };
+
+  InstructionSet DetectInstructionSet() {
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+    if (maxLeaf < 1) return InstructionSet::SCALAR;
+
+    __cpuid(info, 1);
+    const bool hasSsse3 = (info[2] & (1 << 9)) != 0;
+    const bool hasSse41 = (info[2] & (1 << 19)) != 0;
+    const bool hasOsxsave = (info[2] & (1 << 27)) != 0;
+    const bool hasAvx = (info[2] & (1 << 28)) != 0;
+
+    /// AVX2 also needs the OS to save YMM registers
+    if (maxLeaf >= 7 && hasOsxsave && hasAvx && (_xgetbv(0) & 6) == 6) {
+      __cpuidex(info, 7, 0);
+      if (info[1] & (1 << 5)) return InstructionSet::AVX2;
+    }
+    if (hasSsse3 && hasSse41) return InstructionSet::SSE41;
+    return InstructionSet::SCALAR;
+  }
+
+  const InstructionSet SupportedInstructionSet = DetectInstructionSet();
+
+  const char EncodeTable[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+  /// Maps characters to 6-bit values, InvalidValue for everything else
+  const unsigned char InvalidValue = 0xff;
+
+  struct DecodeTable {
+    DecodeTable() {
+      for (UINT i = 0; i < 256; i++) mValues[i] = InvalidValue;
+      for (UINT i = 0; i < 64; i++) mValues[UINT(UCHAR(EncodeTable[i]))] = UCHAR(i);
+    }
+    unsigned char mValues[256];
+  };
+
+  const DecodeTable DecodeValues;
+
+  void EncodeScalar(const unsigned char* src, size_t byteCount, char* dst) {
+    size_t i = 0;
+    for (; i + 3 <= byteCount; i += 3) {
+      const UINT triple = (UINT(src[i]) << 16) | (UINT(src[i + 1]) << 8) | UINT(src[i + 2]);
+      dst[0] = EncodeTable[(triple >> 18) & 0x3f];
+      dst[1] = EncodeTable[(triple >> 12) & 0x3f];
+      dst[2] = EncodeTable[(triple >> 6) & 0x3f];
+      dst[3] = EncodeTable[triple & 0x3f];
+      dst += 4;
+    }
+
+    const size_t remainder = byteCount - i;
+    if (remainder == 0) return;
+    const UINT triple = (UINT(src[i]) << 16) |
+      (remainder == 2 ? UINT(src[i + 1]) << 8 : 0);
+    dst[0] = EncodeTable[(triple >> 18) & 0x3f];
+    dst[1] = EncodeTable[(triple >> 12) & 0x3f];
+    dst[2] = remainder == 2 ? EncodeTable[(triple >> 6) & 0x3f] : '=';
+    dst[3] = '=';
+  }
+
+  size_t DecodeScalar(const char* src, size_t charCount, unsigned char* dst) {
+    unsigned char* const start = dst;
+    UINT accumulator = 0;
+    UINT valueCount = 0;
+    for (size_t i = 0; i < charCount; i++) {
+      const unsigned char value = DecodeValues.mValues[UCHAR(src[i])];
+      if (value == InvalidValue) break;
+      accumulator = (accumulator << 6) | value;
+      if (++valueCount == 4) {
+        dst[0] = UCHAR(accumulator >> 16);
+        dst[1] = UCHAR(accumulator >> 8);
+        dst[2] = UCHAR(accumulator);
+        dst += 3;
+        accumulator = 0;
+        valueCount = 0;
+      }
+    }
+
+    /// Incomplete last group, like base64_decode does
+    if (valueCount == 2) {
+      *dst++ = UCHAR(accumulator >> 4);
+    }
+    else if (valueCount == 3) {
+      *dst++ = UCHAR(accumulator >> 10);
+      *dst++ = UCHAR(accumulator >> 2);
+    }
+    return size_t(dst - start);
+  }
+
+  /// Spreads 12 bytes to 16 six-bit values in the low 6 bits of every byte.
+  /// Works on each 128-bit lane independently.
+  __m128i EncodeReshuffle(__m128i input) {
+    const __m128i shuffled = _mm_shuffle_epi8(input,
+      _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m128i t0 = _mm_and_si128(shuffled, _mm_set1_epi32(0x0fc0fc00));
+    const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    const __m128i t2 = _mm_and_si128(shuffled, _mm_set1_epi32(0x003f03f0));
+    const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t1, t3);
+  }
+
+  /// Six-bit values to ASCII
+  __m128i EncodeTranslate(__m128i values) {
+    const __m128i offsetLookup = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+      '/' - 63, 'A', 0, 0);
+    __m128i index = _mm_subs_epu8(values, _mm_set1_epi8(51));
+    const __m128i isLetterUpper = _mm_cmpgt_epi8(_mm_set1_epi8(26), values);
+    index = _mm_or_si128(index, _mm_and_si128(isLetterUpper, _mm_set1_epi8(13)));
+    return _mm_add_epi8(values, _mm_shuffle_epi8(offsetLookup, index));
+  }
+
+  __m256i EncodeReshuffle(__m256i input) {
+    const __m256i shuffled = _mm256_shuffle_epi8(input, _mm256_set_epi8(
+      10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+      10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m256i t0 = _mm256_and_si256(shuffled, _mm256_set1_epi32(0x0fc0fc00));
+    const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    const __m256i t2 = _mm256_and_si256(shuffled, _mm256_set1_epi32(0x003f03f0));
+    const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    return _mm256_or_si256(t1, t3);
+  }
+
+  __m256i EncodeTranslate(__m256i values) {
+    const __m256i offsetLookup = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+      '/' - 63, 'A', 0, 0,
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+      '/' - 63, 'A', 0, 0);
+    __m256i index = _mm256_subs_epu8(values, _mm256_set1_epi8(51));
+    const __m256i isLetterUpper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), values);
+    index = _mm256_or_si256(index, _mm256_and_si256(isLetterUpper, _mm256_set1_epi8(13)));
+    return _mm256_add_epi8(values, _mm256_shuffle_epi8(offsetLookup, index));
+  }
+
+  /// Encodes 12 bytes, reads 16
+  void EncodeBlockSse41(const unsigned char* src, char* dst) {
+    const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    const __m128i text = EncodeTranslate(EncodeReshuffle(input));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), text);
+  }
+
+  /// Encodes 24 bytes, reads 28
+  void EncodeBlockAvx2(const unsigned char* src, char* dst) {
+    const __m256i input = _mm256_inserti128_si256(_mm256_castsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(src))),
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 12)), 1);
+    const __m256i text = EncodeTranslate(EncodeReshuffle(input));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), text);
+  }
+
+  /// Decodes 16 characters to 12 bytes, writes 16. Returns false without writing
+  /// if the block contains a non-base64 character.
+  bool DecodeBlockSse41(const char* src, unsigned char* dst) {
+    const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    const __m128i highNibbles = _mm_and_si128(_mm_srli_epi32(input, 4), _mm_set1_epi8(0x0f));
+    const __m128i lowNibbles = _mm_and_si128(input, _mm_set1_epi8(0x0f));
+
+    /// Every character class has a bit, valid characters have no common bit
+    /// between their low and high nibble lookups
+    const __m128i lowLookup = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+      0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+    const __m128i highLookup = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lowClass = _mm_shuffle_epi8(lowLookup, lowNibbles);
+    const __m128i highClass = _mm_shuffle_epi8(highLookup, highNibbles);
+    if (!_mm_testz_si128(lowClass, highClass)) return false;
+
+    /// Offset by high nibble, '/' shares its high nibble with '+'
+    const __m128i offsetLookup = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+      0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i isSlash = _mm_cmpeq_epi8(input, _mm_set1_epi8('/'));
+    const __m128i offset =
+      _mm_shuffle_epi8(offsetLookup, _mm_add_epi8(isSlash, highNibbles));
+    const __m128i values = _mm_add_epi8(input, offset);
+
+    /// Pack four 6-bit values to three bytes
+    const __m128i pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    const __m128i triples = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+    const __m128i packed = _mm_shuffle_epi8(triples,
+      _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), packed);
+    return true;
+  }
+
+  /// Decodes 32 characters to 24 bytes, writes 32
+  bool DecodeBlockAvx2(const char* src, unsigned char* dst) {
+    const __m256i input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+    const __m256i highNibbles =
+      _mm256_and_si256(_mm256_srli_epi32(input, 4), _mm256_set1_epi8(0x0f));
+    const __m256i lowNibbles = _mm256_and_si256(input, _mm256_set1_epi8(0x0f));
+
+    const __m256i lowLookup = _mm256_setr_epi8(
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+    const __m256i highLookup = _mm256_setr_epi8(
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lowClass = _mm256_shuffle_epi8(lowLookup, lowNibbles);
+    const __m256i highClass = _mm256_shuffle_epi8(highLookup, highNibbles);
+    if (!_mm256_testz_si256(lowClass, highClass)) return false;
+
+    const __m256i offsetLookup = _mm256_setr_epi8(
+      0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+      0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i isSlash = _mm256_cmpeq_epi8(input, _mm256_set1_epi8('/'));
+    const __m256i offset =
+      _mm256_shuffle_epi8(offsetLookup, _mm256_add_epi8(isSlash, highNibbles));
+    const __m256i values = _mm256_add_epi8(input, offset);
+
+    const __m256i pairs = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+    const __m256i triples = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+    const __m256i packed = _mm256_shuffle_epi8(triples, _mm256_setr_epi8(
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+
+    /// Move the 12 bytes of the high lane next to the low lane's
+    const __m256i compacted = _mm256_permutevar8x32_epi32(packed,
+      _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), compacted);
+    return true;
+  }
+}
+
+size_t Base64::GetEncodedSize(size_t byteCount) {
+  return (byteCount + 2) / 3 * 4;
+}
+
+size_t Base64::GetDecodedMaxSize(size_t charCount) {
+  return (charCount + 3) / 4 * 3;
+}
+
+void Base64::Encode(const void* bytes, size_t byteCount, char* oText) {
+  const unsigned char* src = static_cast<const unsigned char*>(bytes);
+  const unsigned char* const end = src + byteCount;
+  char* dst = oText;
+
+  /// Blocks read past the bytes they encode, stop while the input lasts
+  if (SupportedInstructionSet >= InstructionSet::AVX2) {
+    for (; end - src >= 28; src += 24, dst += 32) EncodeBlockAvx2(src, dst);
+    _mm256_zeroupper();
+  }
+  if (SupportedInstructionSet >= InstructionSet::SSE41) {
+    for (; end - src >= 16; src += 12, dst += 16) EncodeBlockSse41(src, dst);
+  }
+  EncodeScalar(src, size_t(end - src), dst);
+}
+
+size_t Base64::Decode(const char* text, size_t charCount, void* oBytes) {
+  const char* src = text;
+  const char* const end = text + charCount;
+  unsigned char* const start = static_cast<unsigned char*>(oBytes);
+  unsigned char* dst = start;
+
+  /// Blocks write past the bytes they decode, stop early enough to stay inside
+  /// GetDecodedMaxSize. Blocks with padding or invalid characters are left to
+  /// the scalar decoder.
+  if (SupportedInstructionSet >= InstructionSet::AVX2) {
+    for (; end - src >= 48 && DecodeBlockAvx2(src, dst); src += 32, dst += 24);
+    _mm256_zeroupper();
+  }
+  if (SupportedInstructionSet >= InstructionSet::SSE41) {
+    for (; end - src >= 24 && DecodeBlockSse41(src, dst); src += 16, dst += 12);
+  }
+  dst += DecodeScalar(src, size_t(end - src), dst);
+  return size_t(dst - start);
+}
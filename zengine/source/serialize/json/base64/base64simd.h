@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+
+/// Base64 codec writing into caller-provided buffers. AVX2 and SSE4.1 paths are
+/// selected at runtime, with a scalar fallback. Results are the same as
+/// base64_encode and base64_decode.
+namespace Base64 {
+  /// Size of the encoded text, including '=' padding
+  size_t GetEncodedSize(size_t byteCount);
+
+  /// Output buffer size needed by Decode
+  size_t GetDecodedMaxSize(size_t charCount);
+
+  /// Writes GetEncodedSize(byteCount) characters, without terminating zero
+  void Encode(const void* bytes, size_t byteCount, char* oText);
+
+  /// Decodes until the first '=' or non-base64 character. oBytes must hold
+  /// GetDecodedMaxSize(charCount) bytes. Returns the number of bytes written.
+  size_t Decode(const char* text, size_t charCount, void* oBytes);
+}
@@ -0,0 +1,103 @@
+#include "compactarrays.h"
+#include "base64/base64simd.h"
+#include "../compression.h"
+#include <algorithm>
+#include <cstring>
+
+static const float QuantizedMaxValue = float((1 << CompactArrays::QuantizedBits) - 1);
+
+std::vector<char> CompactArrays::DecodeBlob(const char* base64, size_t base64Size,
+  bool isCompressed)
+{
+  std::vector<char> payload(Base64::GetDecodedMaxSize(base64Size));
+  payload.resize(Base64::Decode(base64, base64Size, payload.data()));
+  if (!isCompressed) return payload;
+
+  std::vector<char> content;
+  if (!Compression::IsCompressed(payload.data(), payload.size()) ||
+    !Compression::Decompress(payload.data(), payload.size(), content))
+  {
+    return std::vector<char>();
+  }
+  return content;
+}
+
+void CompactArrays::GetComponentRanges(const float* vertices, size_t floatCount,
+  UINT componentCount, std::vector<float>& oMinimum, std::vector<float>& oMaximum)
+{
+  oMinimum.assign(componentCount, 0.0f);
+  oMaximum.assign(componentCount, 0.0f);
+  if (floatCount < componentCount) return;
+
+  std::copy_n(vertices, componentCount, oMinimum.begin());
+  std::copy_n(vertices, componentCount, oMaximum.begin());
+  for (size_t i = componentCount; i < floatCount; i++) {
+    const UINT component = UINT(i % componentCount);
+    oMinimum[component] = std::min(oMinimum[component], vertices[i]);
+    oMaximum[component] = std::max(oMaximum[component], vertices[i]);
+  }
+}
+
+void CompactArrays::Quantize(const float* vertices, size_t floatCount,
+  const std::vector<float>& minimum, const std::vector<float>& maximum,
+  uint16_t* oValues)
+{
+  const UINT componentCount = UINT(minimum.size());
+  for (size_t i = 0; i < floatCount; i++) {
+    const UINT component = UINT(i % componentCount);
+    const float range = maximum[component] - minimum[component];
+    const float fraction = range > 0.0f ? (vertices[i] - minimum[component]) / range : 0.0f;
+    const float value = std::min(std::max(fraction, 0.0f), 1.0f) * QuantizedMaxValue;
+    oValues[i] = uint16_t(value + 0.5f);
+  }
+}
+
+size_t CompactArrays::DecodeVertices(const char* base64, size_t base64Size,
+  bool isCompressed, UINT bits, const std::vector<float>& minimum,
+  const std::vector<float>& maximum, float* oVertices, size_t capacity)
+{
+  const std::vector<char> payload = DecodeBlob(base64, base64Size, isCompressed);
+
+  if (bits == 32) {
+    const size_t count = payload.size() / sizeof(float);
+    memcpy(oVertices, payload.data(), std::min(count, capacity) * sizeof(float));
+    return count;
+  }
+
+  if (bits == QuantizedBits) {
+    const UINT componentCount = UINT(minimum.size());
+    if (componentCount == 0 || maximum.size() != componentCount) return 0;
+    const size_t count = payload.size() / sizeof(uint16_t);
+    const uint16_t* values = reinterpret_cast<const uint16_t*>(payload.data());
+    for (size_t i = 0; i < count && i < capacity; i++) {
+      const UINT component = UINT(i % componentCount);
+      const float range = maximum[component] - minimum[component];
+      oVertices[i] = minimum[component] + float(values[i]) / QuantizedMaxValue * range;
+    }
+    return count;
+  }
+
+  return 0;
+}
+
+size_t CompactArrays::DecodeIndices(const char* base64, size_t base64Size,
+  bool isCompressed, UINT bits, IndexEntry* oIndices, size_t capacity)
+{
+  const std::vector<char> payload = DecodeBlob(base64, base64Size, isCompressed);
+
+  if (bits == 16) {
+    const size_t count = payload.size() / sizeof(uint16_t);
+    const uint16_t* values = reinterpret_cast<const uint16_t*>(payload.data());
+    std::copy_n(values, std::min(count, capacity), oIndices);
+    return count;
+  }
+
+  if (bits == 32) {
+    const size_t count = payload.size() / sizeof(uint32_t);
+    const uint32_t* values = reinterpret_cast<const uint32_t*>(payload.data());
+    std::copy_n(values, std::min(count, capacity), oIndices);
+    return count;
+  }
+
+  return 0;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <include/base/defines.h>
+#include <include/resources/mesh.h>
+#include <cstdint>
+#include <vector>
+
+/// Compact JSON encoding of mesh vertex and index arrays. Instead of an array
+/// of numbers, the value is an object with little-endian binary data in base64:
+///
+///   "vertices": { "bits": 32, "base64": "..." }
+///   "vertices": { "bits": 16, "min": [...], "max": [...], "base64": "..." }
+///   "indices": { "bits": 16 or 32, "base64": "..." }
+///
+/// 16-bit vertices are quantized: every float of a vertex is stored as a
+/// fraction of the range of that float across all vertices, given by "min"
+/// and "max". Readers accept both the compact and the number array form.
+///
+/// Blobs with a "compression": "zstd" member hold the binary data compressed,
+/// see serialize/compression.h. Texture texels use the same blob members.
+///
+/// Complete documents keep every distinct blob once, in a top-level "blobs"
+/// object keyed by Compression::GetContentHash(), and refer to it by hash:
+///
+///   "indices": { "bits": 16, "blob": "<hash>" }
+///   "blobs": { "<hash>": { "compression": "zstd", "base64": "..." }, ... }
+///
+/// Different content with an equal hash is stored under "<hash>-1", "-2", ...
+/// Loaders share one Mesh or Texture between nodes with equal content.
+namespace CompactArrays {
+  /// Bits per float of quantized vertices
+  const UINT QuantizedBits = 16;
+
+  /// Finds the range of each of the componentCount floats of a vertex
+  void GetComponentRanges(const float* vertices, size_t floatCount, UINT componentCount,
+    std::vector<float>& oMinimum, std::vector<float>& oMaximum);
+
+  void Quantize(const float* vertices, size_t floatCount,
+    const std::vector<float>& minimum, const std::vector<float>& maximum,
+    uint16_t* oValues);
+
+  /// Returns the binary data of a blob, empty for malformed data. Thread safe.
+  std::vector<char> DecodeBlob(const char* base64, size_t base64Size,
+    bool isCompressed);
+
+  /// Decoders return the number of values found, zero for malformed data.
+  /// Values beyond capacity are dropped. Thread safe.
+  size_t DecodeVertices(const char* base64, size_t base64Size, bool isCompressed,
+    UINT bits, const std::vector<float>& minimum, const std::vector<float>& maximum,
+    float* oVertices, size_t capacity);
+  size_t DecodeIndices(const char* base64, size_t base64Size, bool isCompressed,
+    UINT bits, IndexEntry* oIndices, size_t capacity);
+}
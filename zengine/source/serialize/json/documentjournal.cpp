@@ -0,0 +1,224 @@
+#include <include/serialize/documentjournal.h>
+#include "jsonserializer.h"
+#include <rapidjson/document.h>
+#include <rapidjson/prettywriter.h>
+#include <rapidjson/stringbuffer.h>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+  typedef std::unordered_map<int, rapidjson::Value> RecordMap;
+
+  /// Returns false if the value isn't a node record
+  bool GetRecordID(const rapidjson::Value& record, int& oID) {
+    if (!record.IsObject() || !record.HasMember("id") || !record.HasMember("node")) {
+      return false;
+    }
+    if (!record["id"].IsInt() || !record["node"].IsString()) return false;
+    oID = record["id"].GetInt();
+    return true;
+  }
+
+  /// Moves the records reachable from "id" to oNodes, dependencies first, in
+  /// the order JSONSerializer::Traverse saves them
+  void CollectRecords(int id, RecordMap& records, std::unordered_set<int>& visited,
+    rapidjson::Value& oNodes, rapidjson::Document::AllocatorType& allocator)
+  {
+    const auto it = records.find(id);
+    if (it == records.end() || !visited.insert(id).second) return;
+    rapidjson::Value& record = it->second;
+
+    if (record.HasMember("slots") && record["slots"].IsObject()) {
+      const rapidjson::Value& slots = record["slots"];
+      for (auto slot = slots.MemberBegin(); slot != slots.MemberEnd(); ++slot) {
+        if (!slot->value.IsObject() || !slot->value.HasMember("connect")) continue;
+        const rapidjson::Value& connect = slot->value["connect"];
+        if (connect.IsInt()) {
+          CollectRecords(connect.GetInt(), records, visited, oNodes, allocator);
+        }
+        else if (connect.IsArray()) {
+          for (rapidjson::SizeType i = 0; i < connect.Size(); i++) {
+            if (!connect[i].IsInt()) continue;
+            CollectRecords(connect[i].GetInt(), records, visited, oNodes, allocator);
+          }
+        }
+      }
+    }
+
+    oNodes.PushBack(record, allocator);
+  }
+
+  /// Adds the keys of the shared blobs a value refers to, see compactarrays.h
+  void CollectBlobReferences(const rapidjson::Value& value,
+    std::unordered_set<std::string>& oKeys)
+  {
+    if (value.IsObject()) {
+      for (auto member = value.MemberBegin(); member != value.MemberEnd(); ++member) {
+        if (member->value.IsString() && strcmp(member->name.GetString(), "blob") == 0) {
+          oKeys.emplace(member->value.GetString(), member->value.GetStringLength());
+        }
+        else CollectBlobReferences(member->value, oKeys);
+      }
+    }
+    else if (value.IsArray()) {
+      for (rapidjson::SizeType i = 0; i < value.Size(); i++) {
+        CollectBlobReferences(value[i], oKeys);
+      }
+    }
+  }
+}
+
+JSONCapture::JSONCapture(JSONSerializer* serializer, bool isRecords)
+  : mSerializer(serializer)
+  , mIsRecords(isRecords)
+{}
+
+JSONCapture::~JSONCapture() = default;
+
+std::string JSONCapture::GetJSON() {
+  return mIsRecords ? mSerializer->GetJSONRecords() : mSerializer->GetJSON();
+}
+
+DocumentJournal::DocumentJournal(const std::shared_ptr<Document>& document,
+  MeshArrayEncoding meshArrayEncoding, BlobCompression blobCompression)
+  : mDocument(document)
+  , mMeshArrayEncoding(meshArrayEncoding)
+  , mBlobCompression(blobCompression)
+{
+  TheMessageQueue.mOnMessageDelivered += Delegate(this, &DocumentJournal::HandleMessage);
+}
+
+DocumentJournal::~DocumentJournal() {
+  TheMessageQueue.mOnMessageDelivered -= Delegate(this, &DocumentJournal::HandleMessage);
+}
+
+std::shared_ptr<JSONCapture> DocumentJournal::CaptureSnapshot() {
+  /// Records written from now on refer to the IDs of this snapshot
+  mChangedNodes.clear();
+  mNodeIDs = JSONNodeIDs();
+  return std::shared_ptr<JSONCapture>(new JSONCapture(
+    new JSONSerializer(mDocument, mNodeIDs, mMeshArrayEncoding, mBlobCompression),
+    false));
+}
+
+std::shared_ptr<JSONCapture> DocumentJournal::CaptureRecords() {
+  if (mChangedNodes.empty()) return nullptr;
+  const std::vector<std::shared_ptr<Node>> nodes(
+    mChangedNodes.begin(), mChangedNodes.end());
+  mChangedNodes.clear();
+  return std::shared_ptr<JSONCapture>(new JSONCapture(
+    new JSONSerializer(nodes, mNodeIDs, mMeshArrayEncoding, mBlobCompression),
+    true));
+}
+
+std::string DocumentJournal::GetSnapshot() {
+  return CaptureSnapshot()->GetJSON();
+}
+
+std::string DocumentJournal::GetRecords() {
+  const std::shared_ptr<JSONCapture> capture = CaptureRecords();
+  return capture ? capture->GetJSON() : std::string();
+}
+
+bool DocumentJournal::HasChanges() const {
+  return !mChangedNodes.empty();
+}
+
+void DocumentJournal::HandleMessage(Message* message) {
+  /// Time ticks don't change saved content
+  if (TheMessageQueue.IsDeliveringTimeTick()) return;
+
+  switch (message->mType) {
+  case MessageType::SLOT_CONNECTION_CHANGED:
+    /// The connected node might have changed while it had no dependants to notify
+    if (message->mSource != nullptr) mChangedNodes.insert(message->mSource);
+    mChangedNodes.insert(message->mTarget);
+    break;
+  case MessageType::SLOT_STRUCTURE_CHANGED:
+  case MessageType::SLOT_GHOST_FLAG_CHANGED:
+    mChangedNodes.insert(message->mTarget);
+    break;
+  case MessageType::VALUE_CHANGED:
+    /// Default values are saved by the slot owner
+    if (message->mSlot != nullptr && message->mSlot->IsDefaulted()) {
+      mChangedNodes.insert(message->mTarget);
+    }
+    else if (message->mSource != nullptr) {
+      mChangedNodes.insert(message->mSource);
+    }
+    break;
+  case MessageType::NODE_NAME_CHANGED:
+  case MessageType::NODE_POSITION_CHANGED:
+    /// Nodes send these to themselves, the rest is forwarding
+    if (message->mSource == nullptr) mChangedNodes.insert(message->mTarget);
+    break;
+  default: break;
+  }
+}
+
+std::string DocumentJournal::Compact(const char* snapshot, size_t snapshotSize,
+  const char* journal, size_t journalSize)
+{
+  rapidjson::Document document;
+  document.Parse(snapshot, snapshotSize);
+  if (document.HasParseError() || !document.IsObject() ||
+    !document.HasMember("nodes") || !document["nodes"].IsArray())
+  {
+    return std::string();
+  }
+  rapidjson::Document::AllocatorType& allocator = document.GetAllocator();
+
+  /// Snapshot nodes, then journal records in the order they were written
+  RecordMap records;
+  int documentID = 0;
+  rapidjson::Value& nodes = document["nodes"];
+  for (rapidjson::SizeType i = 0; i < nodes.Size(); i++) {
+    int id;
+    if (!GetRecordID(nodes[i], id)) continue;
+    if (strcmp(nodes[i]["node"].GetString(), "Document") == 0) documentID = id;
+    records[id] = nodes[i];
+  }
+
+  const char* journalEnd = journal + journalSize;
+  for (const char* line = journal; line < journalEnd; ) {
+    const char* lineEnd = std::find(line, journalEnd, '\n');
+    rapidjson::Document record(&allocator);
+    record.Parse(line, lineEnd - line);
+    line = lineEnd + 1;
+    int id;
+    if (record.HasParseError() || !GetRecordID(record, id)) continue;
+    if (strcmp(record["node"].GetString(), "Document") == 0) documentID = id;
+    records[id] = record;
+  }
+  if (records.find(documentID) == records.end()) return std::string();
+
+  /// Nodes removed since the snapshot aren't reachable anymore
+  rapidjson::Value mergedNodes(rapidjson::kArrayType);
+  std::unordered_set<int> visited;
+  CollectRecords(documentID, records, visited, mergedNodes, allocator);
+  nodes = mergedNodes;
+
+  /// Records keep their blobs inline, so blobs of removed or replaced assets
+  /// aren't referenced anymore
+  if (document.HasMember("blobs") && document["blobs"].IsObject()) {
+    std::unordered_set<std::string> referencedKeys;
+    CollectBlobReferences(nodes, referencedKeys);
+    rapidjson::Value& blobs = document["blobs"];
+    rapidjson::Value keptBlobs(rapidjson::kObjectType);
+    for (auto blob = blobs.MemberBegin(); blob != blobs.MemberEnd(); ++blob) {
+      const std::string key(blob->name.GetString(), blob->name.GetStringLength());
+      if (referencedKeys.find(key) == referencedKeys.end()) continue;
+      keptBlobs.AddMember(blob->name, blob->value, allocator);
+    }
+    blobs = keptBlobs;
+  }
+
+  rapidjson::StringBuffer buffer;
+  rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+  writer.SetIndent(' ', 1);
+  document.Accept(writer);
+  return buffer.GetString();
+}
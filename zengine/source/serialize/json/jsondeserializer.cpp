@@ -1,11 +1,53 @@
 #include <algorithm>
 #include "jsondeserializer.h"
 #include "jsonserializer.h"
-#include "base64/base64.h"
+#include "compactarrays.h"
 #include <include/dom/ghost.h>
 #include <memory>
 #include <memory>
 #include <memory>
+#include <cstring>
+#include <string>
+
+/// Checks the "compression" member of a blob object, see compactarrays.h
+static bool IsCompressedBlob(const rapidjson::Value& blobValue) {
+  if (!blobValue.HasMember("compression")) return false;
+  const char* compression = blobValue["compression"].GetString();
+  if (strcmp(compression, "zstd") != 0) {
+    ERR("Unknown compression: %s", compression);
+  }
+  return true;
+}
+
+/// Key of a compact array that refers to a shared blob, empty otherwise.
+/// Arrays with the same key decode to the same values.
+static std::string GetCompactArrayKey(const rapidjson::Value& arrayValue) {
+  if (!arrayValue.IsObject() || !arrayValue.HasMember("blob")) return std::string();
+  std::string key = std::to_string(arrayValue["bits"].GetUint()) + ':' +
+    arrayValue["blob"].GetString();
+  for (const char* range : { "min", "max" }) {
+    if (!arrayValue.HasMember(range)) continue;
+    const rapidjson::Value& values = arrayValue[range];
+    for (UINT i = 0; i < values.Size(); i++) {
+      const float value = float(values[i].GetDouble());
+      key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+  }
+  return key;
+}
+
+/// Key of a mesh made of shared blobs, empty otherwise
+static std::string GetMeshKey(const rapidjson::Value& value) {
+  std::string key = GetCompactArrayKey(value["vertices"]);
+  if (key.empty()) return key;
+  if (value.HasMember("indices")) {
+    const std::string indexKey = GetCompactArrayKey(value["indices"]);
+    if (indexKey.empty()) return indexKey;
+    key += '/' + std::to_string(value["indexcount"].GetInt()) + ':' + indexKey;
+  }
+  return std::to_string(value["format"].GetInt()) + '/' +
+    std::to_string(value["vertexcount"].GetInt()) + ':' + key;
+}
 
 JSONDeserializer::JSONDeserializer(const std::string& json) {
   rapidjson::Document d;
@@ -13,10 +55,22 @@ JSONDeserializer::JSONDeserializer(const std::string& json) {
 
   rapidjson::Value& jsonNodes = d["nodes"];
   ASSERT(jsonNodes.IsArray());
+  if (d.HasMember("blobs")) mBlobs = &d["blobs"];
 
   INFO("Loading nodes...");
-  for (UINT i = 0; i < jsonNodes.Size(); i++) {
-    DeserializeNode(jsonNodes[i]);
+  bool isValid = true;
+  for (UINT i = 0; i < jsonNodes.Size() && isValid; i++) {
+    isValid = DeserializeNode(jsonNodes[i]);
+  }
+
+  mBlobs = nullptr;
+  mTextures.clear();
+  mMeshes.clear();
+  if (!isValid) {
+    ERR("Loading failed.");
+    mNodes.clear();
+    mDocument = nullptr;
+    return;
   }
 
   INFO("Loading connections...");
@@ -29,11 +83,10 @@ JSONDeserializer::JSONDeserializer(const std::string& json) {
 
 std::shared_ptr<Document> JSONDeserializer::GetDocument() const
 {
-  ASSERT(mDocument);
   return mDocument;
 }
 
-void JSONDeserializer::DeserializeNode(rapidjson::Value& value) {
+bool JSONDeserializer::DeserializeNode(rapidjson::Value& value) {
   const std::string nodeClassName = value["node"].GetString();
   const int id = value["id"].GetInt();
   ASSERT(mNodes.find(id) == mNodes.end());
@@ -73,10 +126,10 @@ void JSONDeserializer::DeserializeNode(rapidjson::Value& value) {
     DeserializeFloatSplineNode(value, PointerCast<FloatSplineNode>(node));
   }
   else if (IsExactType<StaticTextureNode>(node)) {
-    DeserializeStaticTextureNode(value, PointerCast<StaticTextureNode>(node));
+    return DeserializeStaticTextureNode(value, PointerCast<StaticTextureNode>(node));
   }
   else if (IsExactType<StaticMeshNode>(node)) {
-    DeserializeStaticMeshNode(value, PointerCast<StaticMeshNode>(node));
+    return DeserializeStaticMeshNode(value, PointerCast<StaticMeshNode>(node));
   }
   else if (IsExactType<StubNode>(node)) {
     DeserializeStubNode(value, PointerCast<StubNode>(node));
@@ -85,6 +138,7 @@ void JSONDeserializer::DeserializeNode(rapidjson::Value& value) {
     ASSERT(mDocument == nullptr);
     mDocument = PointerCast<Document>(node);
   }
+  return true;
 }
 
 vec2 JSONDeserializer::DeserializeVec2(const rapidjson::Value& value) {
@@ -195,52 +249,161 @@ void JSONDeserializer::ConnectSlots(rapidjson::Value& value) {
   }
 }
 
-void JSONDeserializer::DeserializeStaticTextureNode(const rapidjson::Value& value,
-  const std::shared_ptr<StaticTextureNode>& node) const
+const rapidjson::Value* JSONDeserializer::GetBlob(const rapidjson::Value& blobValue) const
+{
+  if (!blobValue.HasMember("blob")) return &blobValue;
+  const char* hash = blobValue["blob"].GetString();
+  if (mBlobs == nullptr || !mBlobs->HasMember(hash)) {
+    ERR("No such blob: %s", hash);
+    return nullptr;
+  }
+  return &(*mBlobs)[hash];
+}
+
+bool JSONDeserializer::DeserializeStaticTextureNode(const rapidjson::Value& value,
+  const std::shared_ptr<StaticTextureNode>& node)
 {
   const int width = value["width"].GetInt();
   const int height = value["height"].GetInt();
   const char* typeString = value["type"].GetString();
-  const char* texelString = value["base64"].GetString();
+
+  /// Nodes with the same texels share the texture
+  std::string key;
+  if (value.HasMember("blob")) {
+    key = std::string(typeString) + '/' + std::to_string(width) + 'x' +
+      std::to_string(height) + ':' + value["blob"].GetString();
+    const auto it = mTextures.find(key);
+    if (it != mTextures.end()) {
+      node->Set(it->second);
+      return true;
+    }
+  }
+
   const TexelType texelType = TexelTypeMapper.GetEnum(typeString);
   if (signed(texelType) < 0) {
     ERR("Unknown texture type: %s", typeString);
+    return false;
+  }
+  const rapidjson::Value* blob = GetBlob(value);
+  if (blob == nullptr) return false;
+  const rapidjson::Value& texelText = (*blob)["base64"];
+  const std::vector<char> texelContent = CompactArrays::DecodeBlob(
+    texelText.GetString(), texelText.GetStringLength(), IsCompressedBlob(*blob));
+  if (texelContent.empty()) {
+    ERR("Can't decode texels");
+    return false;
+  }
+  if (width <= 0 || height <= 0 ||
+    texelContent.size() / OpenGLAPI::GetTexelByteCount(texelType) <
+    uint64_t(width) * height)
+  {
+    ERR("Texel data doesn't match texture size %dx%d", width, height);
+    return false;
   }
-  const std::string texelContent = base64_decode(texelString);
   const std::shared_ptr<Texture> texture = OpenGL->MakeTexture(width, height, texelType, 
-    texelContent.c_str(), false, false, true, true);
+    texelContent.data(), false, false, true, true);
+  if (!key.empty()) mTextures[key] = texture;
   node->Set(texture);
+  return true;
 }
 
 
-void JSONDeserializer::DeserializeStaticMeshNode(const rapidjson::Value& value,
-  const std::shared_ptr<StaticMeshNode>& node) const
+bool JSONDeserializer::DeserializeStaticMeshNode(const rapidjson::Value& value,
+  const std::shared_ptr<StaticMeshNode>& node)
 {
+  /// Nodes with the same vertices and indices share the mesh
+  const std::string key = GetMeshKey(value);
+  if (!key.empty()) {
+    const auto it = mMeshes.find(key);
+    if (it != mMeshes.end()) {
+      node->Set(it->second);
+      return true;
+    }
+  }
+
   int binaryFormat = value["format"].GetInt();
   const UINT vertexCount = value["vertexcount"].GetInt();
   const std::shared_ptr<VertexFormat> format = std::make_shared<VertexFormat>(binaryFormat);
   std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>();
 
+  /// Parse straight into the mesh's raw vertex data
   mesh->AllocateVertices(format, vertexCount);
-  std::vector<float> rawVertices(vertexCount * format->mStride / sizeof(float));
+  float* rawVertices = static_cast<float*>(mesh->mRawVertexData);
+  const UINT floatCount = vertexCount * format->mStride / sizeof(float);
   const rapidjson::Value& jsonVertices = value["vertices"];
-  for (UINT i = 0; i < jsonVertices.Size(); i++) {
-    rawVertices[i] = float(jsonVertices[i].GetDouble());
+  size_t decodedFloatCount = 0;
+  if (jsonVertices.IsObject()) {
+    /// Compact encoding
+    std::vector<float> minimum, maximum;
+    if (jsonVertices.HasMember("min") && jsonVertices.HasMember("max")) {
+      for (UINT i = 0; i < jsonVertices["min"].Size(); i++) {
+        minimum.push_back(float(jsonVertices["min"][i].GetDouble()));
+      }
+      for (UINT i = 0; i < jsonVertices["max"].Size(); i++) {
+        maximum.push_back(float(jsonVertices["max"][i].GetDouble()));
+      }
+    }
+    const rapidjson::Value* blob = GetBlob(jsonVertices);
+    if (blob == nullptr) return false;
+    const rapidjson::Value& base64 = (*blob)["base64"];
+    decodedFloatCount = CompactArrays::DecodeVertices(base64.GetString(),
+      base64.GetStringLength(), IsCompressedBlob(*blob),
+      jsonVertices["bits"].GetUint(), minimum, maximum, rawVertices, floatCount);
+  }
+  else {
+    decodedFloatCount = jsonVertices.Size();
+    for (UINT i = 0; i < jsonVertices.Size() && i < floatCount; i++) {
+      rawVertices[i] = float(jsonVertices[i].GetDouble());
+    }
+  }
+  if (decodedFloatCount != floatCount) {
+    ERR("Vertex data doesn't match vertex count %d", vertexCount);
+    return false;
   }
-  mesh->UploadVertices(&rawVertices[0]);
 
-  if (value.HasMember("indices")) {
+  /// Indices are checked before anything is uploaded
+  const bool hasIndices = value.HasMember("indices");
+  std::vector<IndexEntry> indices;
+  if (hasIndices) {
     const UINT indexCount = value["indexcount"].GetInt();
-    mesh->AllocateIndices(indexCount);
-    std::vector<IndexEntry> indices(indexCount);
+    indices.resize(indexCount);
+    size_t decodedIndexCount = 0;
     const rapidjson::Value& jsonIndices = value["indices"];
-    for (UINT i = 0; i < jsonIndices.Size(); i++) {
-      indices[i] = IndexEntry(jsonIndices[i].GetUint());
+    if (jsonIndices.IsObject()) {
+      const rapidjson::Value* blob = GetBlob(jsonIndices);
+      if (blob == nullptr) return false;
+      const rapidjson::Value& base64 = (*blob)["base64"];
+      decodedIndexCount = CompactArrays::DecodeIndices(base64.GetString(),
+        base64.GetStringLength(), IsCompressedBlob(*blob),
+        jsonIndices["bits"].GetUint(), indices.data(), indexCount);
+    }
+    else {
+      decodedIndexCount = jsonIndices.Size();
+      for (UINT i = 0; i < jsonIndices.Size() && i < indexCount; i++) {
+        indices[i] = IndexEntry(jsonIndices[i].GetUint());
+      }
     }
-    mesh->UploadIndices(&indices[0]);
+    if (decodedIndexCount != indexCount) {
+      ERR("Index data doesn't match index count %d", indexCount);
+      return false;
+    }
+    for (IndexEntry index : indices) {
+      if (index >= vertexCount) {
+        ERR("Vertex index out of range: %d", UINT(index));
+        return false;
+      }
+    }
+  }
+
+  mesh->UploadVertices(rawVertices);
+  if (hasIndices) {
+    mesh->AllocateIndices(UINT(indices.size()));
+    mesh->UploadIndices(indices.data());
   }
 
+  if (!key.empty()) mMeshes[key] = mesh;
   node->Set(mesh);
+  return true;
 }
 
 
@@ -16,7 +16,8 @@ public:
   std::shared_ptr<Document> GetDocument() const;
 
 private:
-  void DeserializeNode(rapidjson::Value& value);
+  /// Returns false on corrupt input, the load fails then
+  bool DeserializeNode(rapidjson::Value& value);
 
   static void DeserializeFloatNode(const rapidjson::Value& value, 
     const std::shared_ptr<FloatNode>& node);
@@ -29,12 +30,16 @@ private:
   static void DeserializeFloatSplineNode(const rapidjson::Value& value, 
     const std::shared_ptr<FloatSplineNode>& node);
 
-  void DeserializeStaticTextureNode(const rapidjson::Value& value, 
-    const std::shared_ptr<StaticTextureNode>& node) const;
+  bool DeserializeStaticTextureNode(const rapidjson::Value& value, 
+    const std::shared_ptr<StaticTextureNode>& node);
   static void DeserializeStubNode(const rapidjson::Value& value, 
     const std::shared_ptr<StubNode>& node);
-  void DeserializeStaticMeshNode(const rapidjson::Value& value, 
-    const std::shared_ptr<StaticMeshNode>& node) const;
+  bool DeserializeStaticMeshNode(const rapidjson::Value& value, 
+    const std::shared_ptr<StaticMeshNode>& node);
+
+  /// Returns the object holding the base64 text of a blob, the shared one from
+  /// "blobs" if the blob refers to it, nullptr if that is missing
+  const rapidjson::Value* GetBlob(const rapidjson::Value& blobValue) const;
 
   void ConnectSlots(rapidjson::Value& value);
   
@@ -47,5 +52,12 @@ private:
 
   std::unordered_map<int, std::shared_ptr<Node>> mNodes;
 
+  /// Shared blobs of the document being loaded
+  const rapidjson::Value* mBlobs = nullptr;
+
+  /// Assets made of shared blobs, by content, see compactarrays.h
+  std::unordered_map<std::string, std::shared_ptr<Texture>> mTextures;
+  std::unordered_map<std::string, std::shared_ptr<Mesh>> mMeshes;
+
   std::shared_ptr<Document> mDocument;
 };
\ No newline at end of file
@@ -2,9 +2,14 @@
 #include <include/dom/graph.h>
 #include <include/base/helpers.h>
 #include <include/nodes/valuenodes.h>
-#include "base64/base64.h"
+#include "base64/base64simd.h"
+#include "compactarrays.h"
+#include "../compression.h"
 #include <rapidjson/prettywriter.h>
+#include <rapidjson/writer.h>
 #include <rapidjson/stringbuffer.h>
+#include <algorithm>
+#include <cstring>
 
 const EnumMapA<TexelType> TexelTypeMapper = {
   {"RGBA8", TexelType::ARGB8},
@@ -21,18 +26,66 @@ const EnumMapA<SplineLayer> SplineLayerMapper = {
   {"beat_quantizer", SplineLayer::BEAT_QUANTIZER},
 };
 
-JSONSerializer::JSONSerializer(const std::shared_ptr<Node>& root) {
+/// Converts mesh indices to the saved index size
+template<typename T>
+static const void* CopyIndices(const std::vector<IndexEntry>& indices,
+  std::vector<char>& buffer)
+{
+  buffer.resize(indices.size() * sizeof(T));
+  std::copy(indices.begin(), indices.end(), reinterpret_cast<T*>(buffer.data()));
+  return buffer.data();
+}
+
+JSONSerializer::JSONSerializer(const std::shared_ptr<Node>& root,
+  MeshArrayEncoding meshArrayEncoding, BlobCompression blobCompression,
+  MeshOptimization meshOptimization)
+  : JSONSerializer(root, mOwnNodeIDs, meshArrayEncoding, blobCompression,
+    meshOptimization)
+{}
+
+JSONSerializer::JSONSerializer(const std::shared_ptr<Node>& root, 
+  JSONNodeIDs& nodeIDs, MeshArrayEncoding meshArrayEncoding,
+  BlobCompression blobCompression, MeshOptimization meshOptimization)
+  : mMeshArrayEncoding(meshArrayEncoding)
+  , mBlobCompression(blobCompression)
+  , mMeshOptimization(meshOptimization)
+  , mNodeIDs(nodeIDs)
+  , mIsPartial(false)
+{
   mJsonDocument.SetObject();
   mAllocator = &mJsonDocument.GetAllocator();
 
-  mNodeCount = 0;
   Traverse(root);
 
   DumpNodes();
 }
 
-std::string JSONSerializer::GetJSON() const
+JSONSerializer::JSONSerializer(const std::vector<std::shared_ptr<Node>>& nodes,
+  JSONNodeIDs& nodeIDs, MeshArrayEncoding meshArrayEncoding,
+  BlobCompression blobCompression)
+  : mMeshArrayEncoding(meshArrayEncoding)
+  , mBlobCompression(blobCompression)
+  , mMeshOptimization(MeshOptimization::NONE)
+  , mNodeIDs(nodeIDs)
+  , mIsPartial(true)
 {
+  mJsonDocument.SetObject();
+  mAllocator = &mJsonDocument.GetAllocator();
+
+  for (const auto& node : nodes) {
+    /// Nodes without an ID aren't part of the saved document, unless a saved 
+    /// node refers to them
+    if (mNodeIDs.mIDs.find(node) == mNodeIDs.mIDs.end()) continue;
+    if (mTraversedNodes.find(node) != mTraversedNodes.end()) continue;
+    Traverse(node);
+  }
+
+  DumpNodes();
+}
+
+std::string JSONSerializer::GetJSON()
+{
+  EncodePayloads();
   rapidjson::StringBuffer buffer;
   rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
   writer.SetIndent(' ', 1);
@@ -41,16 +94,36 @@ std::string JSONSerializer::GetJSON() const
   return buffer.GetString();
 }
 
+std::string JSONSerializer::GetJSONRecords()
+{
+  EncodePayloads();
+  rapidjson::StringBuffer buffer;
+  const rapidjson::Value& nodesArray = mJsonDocument["nodes"];
+  for (rapidjson::SizeType i = 0; i < nodesArray.Size(); i++) {
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    nodesArray[i].Accept(writer);
+    buffer.Put('\n');
+  }
+  return buffer.GetString();
+}
+
+bool JSONSerializer::ShouldTraverse(const std::shared_ptr<Node>& node) const {
+  if (mTraversedNodes.find(node) != mTraversedNodes.end()) return false;
+  return !mIsPartial || mNodeIDs.mIDs.find(node) == mNodeIDs.mIDs.end();
+}
+
 void JSONSerializer::Traverse(const std::shared_ptr<Node>& root) {
-  mNodes[root] = ++mNodeCount;
+  mTraversedNodes.insert(root);
+  if (mNodeIDs.mIDs.find(root) == mNodeIDs.mIDs.end()) {
+    mNodeIDs.mIDs[root] = ++mNodeIDs.mLastID;
+  }
 
   /// Traverse slots
   for (const auto& slotPair : root->GetSerializableSlots()) {
     Slot* slot = slotPair.second;
     if (slot->mIsMultiSlot) {
       for (auto& node : slot->GetDirectMultiNodes()) {
-        auto it = mNodes.find(node);
-        if (it == mNodes.end()) {
+        if (ShouldTraverse(node)) {
           Traverse(node);
         }
       }
@@ -58,8 +131,7 @@ void JSONSerializer::Traverse(const std::shared_ptr<Node>& root) {
     else {
       std::shared_ptr<Node> node = slot->GetDirectNode();
       if (node == nullptr || slot->IsDefaulted()) continue;
-      auto it = mNodes.find(node);
-      if (it == mNodes.end()) {
+      if (ShouldTraverse(node)) {
         Traverse(node);
       }
     }
@@ -90,7 +162,7 @@ rapidjson::Value JSONSerializer::Serialize(const std::shared_ptr<Node>& node) {
   }
 
   /// Save node ID
-  const int nodeID = mNodes.at(node);
+  const int nodeID = mNodeIDs.mIDs.at(node);
   v.AddMember("id", nodeID, *mAllocator);
 
   /// Save node name
@@ -119,8 +191,8 @@ rapidjson::Value JSONSerializer::Serialize(const std::shared_ptr<Node>& node) {
   else if (IsExactType<FloatSplineNode>(node)) {
     SerializeFloatSplineNode(v, PointerCast<FloatSplineNode>(node));
   }
-  else if (IsExactType<TextureNode>(node)) {
-    SerializeTextureNode(v, PointerCast<TextureNode>(node));
+  else if (IsExactType<StaticTextureNode>(node)) {
+    SerializeStaticTextureNode(v, PointerCast<StaticTextureNode>(node));
   }
   else if (IsExactType<StaticMeshNode>(node)) {
     SerializeStaticMeshNode(v, PointerCast<StaticMeshNode>(node));
@@ -160,6 +232,125 @@ rapidjson::Value JSONSerializer::SerializeVec4(const vec4& vec) const
   return jsonObject;
 }
 
+void JSONSerializer::SerializeBlob(rapidjson::Value& blobValue, size_t byteCount,
+  PayloadSource source)
+{
+  char* placeholder = static_cast<char*>(mAllocator->Malloc(1));
+  placeholder[0] = 0;
+  const bool isShared = !mIsPartial;
+  mPayloads.push_back({ placeholder, byteCount, std::move(source), isShared });
+  if (isShared) {
+    blobValue.AddMember("blob", rapidjson::StringRef(placeholder, 0), *mAllocator);
+    return;
+  }
+  if (mBlobCompression == BlobCompression::ZSTD) {
+    blobValue.AddMember("compression", "zstd", *mAllocator);
+  }
+  blobValue.AddMember("base64", rapidjson::StringRef(placeholder, 0), *mAllocator);
+}
+
+rapidjson::Value JSONSerializer::SerializeCompactArray(UINT bits, size_t byteCount,
+  PayloadSource source)
+{
+  rapidjson::Value jsonObject(rapidjson::kObjectType);
+  jsonObject.AddMember("bits", bits, *mAllocator);
+  SerializeBlob(jsonObject, byteCount, std::move(source));
+  return jsonObject;
+}
+
+void JSONSerializer::EncodePayloads() {
+  if (mArePayloadsEncoded) return;
+  mArePayloadsEncoded = true;
+  if (mPayloads.empty()) return;
+
+  PlaceholderMap placeholders;
+  for (const Payload& payload : mPayloads) {
+    placeholders[payload.mPlaceholder] = &payload;
+  }
+
+  /// Blobs come after the nodes, in the order of their first use
+  rapidjson::Value blobs(rapidjson::kObjectType);
+  EncodePayloads(mJsonDocument["nodes"], placeholders, blobs);
+  if (!mIsPartial) mJsonDocument.AddMember("blobs", blobs, *mAllocator);
+  mStoredBlobs.clear();
+  mStoredBlobBuffers.clear();
+}
+
+void JSONSerializer::EncodePayloads(rapidjson::Value& value,
+  const PlaceholderMap& placeholders, rapidjson::Value& blobs)
+{
+  if (value.IsObject()) {
+    for (auto member = value.MemberBegin(); member != value.MemberEnd(); ++member) {
+      EncodePayloads(member->value, placeholders, blobs);
+    }
+    return;
+  }
+  if (value.IsArray()) {
+    for (rapidjson::SizeType i = 0; i < value.Size(); i++) {
+      EncodePayloads(value[i], placeholders, blobs);
+    }
+    return;
+  }
+  if (!value.IsString() || value.GetStringLength() != 0) return;
+  const auto it = placeholders.find(value.GetString());
+  if (it == placeholders.end()) return;
+
+  /// Payload sources are kept, they may hold the last reference to a mesh
+  const Payload& payload = *it->second;
+  std::vector<char> buffer;
+  const void* bytes = payload.mSource(buffer);
+  if (!payload.mIsShared) {
+    value = EncodeBlobText(bytes, payload.mByteCount);
+    return;
+  }
+
+  /// Equal content is only encoded for its first use. Different content with
+  /// the same hash gets its own key, so a collision can't swap data.
+  const std::string hash = Compression::GetContentHash(bytes, payload.mByteCount);
+  std::vector<StoredBlob>& candidates = mStoredBlobs[hash];
+  for (const StoredBlob& stored : candidates) {
+    if (stored.mByteCount == payload.mByteCount &&
+      memcmp(stored.mBytes, bytes, payload.mByteCount) == 0)
+    {
+      value.SetString(stored.mKey, *mAllocator);
+      return;
+    }
+  }
+  std::string key = hash;
+  if (!candidates.empty()) key += '-' + std::to_string(candidates.size());
+  value.SetString(key, *mAllocator);
+
+  /// Captured data stays alive with the payload sources, converted data
+  /// only with its buffer
+  if (bytes == buffer.data() && !buffer.empty()) {
+    mStoredBlobBuffers.push_back(std::move(buffer));
+    bytes = mStoredBlobBuffers.back().data();
+  }
+  candidates.push_back({ bytes, payload.mByteCount, key });
+
+  rapidjson::Value blobValue(rapidjson::kObjectType);
+  if (mBlobCompression == BlobCompression::ZSTD) {
+    blobValue.AddMember("compression", "zstd", *mAllocator);
+  }
+  blobValue.AddMember("base64", EncodeBlobText(bytes, payload.mByteCount), *mAllocator);
+  blobs.AddMember(rapidjson::Value(key, *mAllocator), blobValue, *mAllocator);
+}
+
+rapidjson::Value JSONSerializer::EncodeBlobText(const void* bytes, size_t byteCount) {
+  std::vector<char> compressed;
+  if (mBlobCompression == BlobCompression::ZSTD) {
+    compressed = Compression::Compress(bytes, byteCount);
+    bytes = compressed.data();
+    byteCount = compressed.size();
+  }
+
+  const size_t textSize = Base64::GetEncodedSize(byteCount);
+  char* text = static_cast<char*>(mAllocator->Malloc(textSize + 1));
+  Base64::Encode(bytes, byteCount, text);
+  text[textSize] = 0;
+  return rapidjson::Value(rapidjson::StringRef(text, rapidjson::SizeType(textSize)));
+}
+
 
 void JSONSerializer::SerializeGeneralNode(
   rapidjson::Value& nodeValue, const std::shared_ptr<Node>& node)
@@ -181,7 +372,7 @@ void JSONSerializer::SerializeGeneralNode(
         /// Save connections
         rapidjson::Value connections(rapidjson::kArrayType);
         for (const auto& connectedNode : slot->GetDirectMultiNodes()) {
-          const int connectedID = mNodes.at(connectedNode);
+          const int connectedID = mNodeIDs.mIDs.at(connectedNode);
           connections.PushBack(connectedID, *mAllocator);
         }
         slotObject.AddMember("connect", connections, *mAllocator);
@@ -190,7 +381,7 @@ void JSONSerializer::SerializeGeneralNode(
         /// Save connection
         const auto& connectedNode = slot->GetDirectNode();
         if (connectedNode != nullptr && !slot->IsDefaulted()) {
-          const int connectedID = mNodes.at(connectedNode);
+          const int connectedID = mNodeIDs.mIDs.at(connectedNode);
           slotObject.AddMember("connect", connectedID, *mAllocator);
         }
 
@@ -275,46 +466,127 @@ void JSONSerializer::SerializeFloatSplineNode(
   }
 }
 
-void JSONSerializer::SerializeTextureNode(rapidjson::Value& nodeValue,
-  const std::shared_ptr<TextureNode>& node) const
+void JSONSerializer::SerializeStaticTextureNode(rapidjson::Value& nodeValue,
+  const std::shared_ptr<StaticTextureNode>& node)
 {
   const std::shared_ptr<Texture>& texture = node->Get();
-  ASSERT(texture->mTexelData);
-  const std::string b64 = base64_encode(reinterpret_cast<UCHAR*>(&(*texture->mTexelData)[0]),
-    UINT((*texture->mTexelData).size()));
+  const std::shared_ptr<std::vector<char>> texels = texture->mTexelData
+    ? texture->mTexelData : OpenGL->ReadTextureGpuData(texture);
+  ASSERT(texels);
   nodeValue.AddMember("width", texture->mWidth, *mAllocator);
   nodeValue.AddMember("height", texture->mHeight, *mAllocator);
   nodeValue.AddMember("type", rapidjson::Value(
     TexelTypeMapper.GetName(texture->mType), *mAllocator), *mAllocator);
-  nodeValue.AddMember("base64", b64, *mAllocator);
+  SerializeBlob(nodeValue, texels->size(),
+    [texels](std::vector<char>&) -> const void* { return texels->data(); });
 }
 
 void JSONSerializer::SerializeStaticMeshNode(rapidjson::Value& nodeValue,
-  const std::shared_ptr<StaticMeshNode>& node) const
+  const std::shared_ptr<StaticMeshNode>& node)
 {
-  const std::shared_ptr<Mesh>& mesh = node->GetMesh();
+  const std::shared_ptr<Mesh> mesh = node->GetMesh();
   ASSERT(mesh->mRawVertexData != nullptr);
-  nodeValue.AddMember("format", mesh->mFormat->mBinaryFormat, *mAllocator);
-  nodeValue.AddMember("vertexcount", mesh->mVertexCount, *mAllocator);
-  nodeValue.AddMember("indexcount", mesh->mIndexCount, *mAllocator);
 
-  const UINT floatCount = mesh->mVertexCount * mesh->mFormat->mStride / sizeof(float);
-  float* attributes = reinterpret_cast<float*>(mesh->mRawVertexData);
-  rapidjson::Value attributeArray(rapidjson::kArrayType);
-  for (UINT i = 0; i < floatCount; i++) {
-    attributeArray.PushBack(double(attributes[i]), *mAllocator);
+  /// Saved arrays, either the mesh's own or an optimized copy. Payloads keep
+  /// their owner alive until they're encoded.
+  std::shared_ptr<const void> owner = mesh;
+  const void* rawVertices = mesh->mRawVertexData;
+  UINT vertexCount = mesh->mVertexCount;
+  const std::vector<IndexEntry>* indexData = &mesh->mIndexData;
+  if (const std::shared_ptr<MeshOptimizer::OptimizedMesh> optimized =
+    GetOptimizedMesh(mesh))
+  {
+    owner = optimized;
+    rawVertices = optimized->mVertices.data();
+    vertexCount = optimized->mVertexCount;
+    indexData = &optimized->mIndices;
   }
-  nodeValue.AddMember("vertices", attributeArray, *mAllocator);
+  const UINT indexCount = UINT(indexData->size());
 
-  if (mesh->mIndexCount > 0) {
-    rapidjson::Value indexArray(rapidjson::kArrayType);
-    for (UINT i = 0; i < mesh->mIndexCount; i++) {
-      indexArray.PushBack(UINT(mesh->mIndexData[i]), *mAllocator);
+  nodeValue.AddMember("format", mesh->mFormat->mBinaryFormat, *mAllocator);
+  nodeValue.AddMember("vertexcount", vertexCount, *mAllocator);
+  nodeValue.AddMember("indexcount", indexCount, *mAllocator);
+
+  const UINT floatCount = vertexCount * mesh->mFormat->mStride / sizeof(float);
+  const float* attributes = static_cast<const float*>(rawVertices);
+  if (mMeshArrayEncoding == MeshArrayEncoding::NUMBERS) {
+    rapidjson::Value attributeArray(rapidjson::kArrayType);
+    for (UINT i = 0; i < floatCount; i++) {
+      attributeArray.PushBack(double(attributes[i]), *mAllocator);
+    }
+    nodeValue.AddMember("vertices", attributeArray, *mAllocator);
+  }
+  else if (mMeshArrayEncoding == MeshArrayEncoding::QUANTIZED) {
+    std::vector<float> minimum, maximum;
+    CompactArrays::GetComponentRanges(attributes, floatCount,
+      mesh->mFormat->mStride / sizeof(float), minimum, maximum);
+    rapidjson::Value minimumArray(rapidjson::kArrayType);
+    rapidjson::Value maximumArray(rapidjson::kArrayType);
+    for (UINT i = 0; i < minimum.size(); i++) {
+      minimumArray.PushBack(double(minimum[i]), *mAllocator);
+      maximumArray.PushBack(double(maximum[i]), *mAllocator);
+    }
+    rapidjson::Value compactArray = SerializeCompactArray(CompactArrays::QuantizedBits,
+      floatCount * sizeof(uint16_t),
+      [owner, attributes, floatCount, minimum, maximum](std::vector<char>& buffer)
+        -> const void*
+      {
+        buffer.resize(floatCount * sizeof(uint16_t));
+        CompactArrays::Quantize(attributes, floatCount, minimum, maximum,
+          reinterpret_cast<uint16_t*>(buffer.data()));
+        return buffer.data();
+      });
+    compactArray.AddMember("min", minimumArray, *mAllocator);
+    compactArray.AddMember("max", maximumArray, *mAllocator);
+    nodeValue.AddMember("vertices", compactArray, *mAllocator);
+  }
+  else {
+    nodeValue.AddMember("vertices", SerializeCompactArray(32, floatCount * sizeof(float),
+      [owner, rawVertices](std::vector<char>&) -> const void* { return rawVertices; }),
+      *mAllocator);
+  }
+
+  if (indexCount > 0) {
+    if (mMeshArrayEncoding == MeshArrayEncoding::NUMBERS) {
+      rapidjson::Value indexArray(rapidjson::kArrayType);
+      for (UINT i = 0; i < indexCount; i++) {
+        indexArray.PushBack(UINT((*indexData)[i]), *mAllocator);
+      }
+      nodeValue.AddMember("indices", indexArray, *mAllocator);
+    }
+    else {
+      if (*std::max_element(indexData->begin(), indexData->end()) <= 0xffff) {
+        nodeValue.AddMember("indices", SerializeCompactArray(16,
+          indexCount * sizeof(uint16_t),
+          [owner, indexData](std::vector<char>& buffer) -> const void* {
+            return CopyIndices<uint16_t>(*indexData, buffer);
+          }), *mAllocator);
+      }
+      else {
+        nodeValue.AddMember("indices", SerializeCompactArray(32,
+          indexCount * sizeof(uint32_t),
+          [owner, indexData](std::vector<char>& buffer) -> const void* {
+            return CopyIndices<uint32_t>(*indexData, buffer);
+          }), *mAllocator);
+      }
     }
-    nodeValue.AddMember("indices", indexArray, *mAllocator);
   }
 }
 
+std::shared_ptr<MeshOptimizer::OptimizedMesh> JSONSerializer::GetOptimizedMesh(
+  const std::shared_ptr<Mesh>& mesh)
+{
+  if (mMeshOptimization != MeshOptimization::OPTIMIZE) return nullptr;
+
+  /// Nodes sharing a mesh share the optimized copy too
+  const auto it = mOptimizedMeshes.find(mesh.get());
+  if (it != mOptimizedMeshes.end()) return it->second;
+  auto optimized = std::make_shared<MeshOptimizer::OptimizedMesh>();
+  if (!MeshOptimizer::Optimize(*mesh, *optimized)) optimized = nullptr;
+  mOptimizedMeshes[mesh.get()] = optimized;
+  return optimized;
+}
+
 void JSONSerializer::SerializeStubNode(
   rapidjson::Value& nodeValue, const std::shared_ptr<StubNode>& node) const
 {
@@ -7,22 +7,59 @@
 #include <include/nodes/texturenode.h>
 #include <include/nodes/splinenode.h>
 #include <include/shaders/stubnode.h>
+#include <include/base/helpers.h>
+#include <include/serialize/documentjournal.h>
+#include <include/resources/meshoptimizer.h>
 #include <string>
 #include <rapidjson/document.h>
 #include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <deque>
 
 extern const EnumMapA<TexelType> TexelTypeMapper;
 extern const EnumMapA<SplineLayer> SplineLayerMapper;
 
+/// Saving has two steps. The constructor captures the nodes into a JSON DOM on
+/// the main thread. Meshes and textures are referenced rather than copied, they
+/// don't change once they belong to a node. GetJSON() compresses and encodes
+/// them and writes the text without touching nodes, so it can run on any
+/// thread. The serializer must be destroyed on the main thread, it may hold the
+/// last mesh reference.
+///
+/// Complete documents store each distinct blob once, in the "blobs" object by
+/// content hash, see compactarrays.h. Journal records are replayed without the
+/// document around them, so partial saves keep their blobs inline.
 class JSONSerializer {
 public:
-  JSONSerializer(const std::shared_ptr<Node>& root);
-  std::string GetJSON() const;
+  JSONSerializer(const std::shared_ptr<Node>& root,
+    MeshArrayEncoding meshArrayEncoding = MeshArrayEncoding::BINARY,
+    BlobCompression blobCompression = BlobCompression::NONE,
+    MeshOptimization meshOptimization = MeshOptimization::NONE);
+
+  /// Saves the transitive closure of root, node IDs are kept in nodeIDs
+  JSONSerializer(const std::shared_ptr<Node>& root, JSONNodeIDs& nodeIDs,
+    MeshArrayEncoding meshArrayEncoding, BlobCompression blobCompression,
+    MeshOptimization meshOptimization = MeshOptimization::NONE);
+
+  /// Saves the given nodes that already have an ID in nodeIDs. Nodes they refer 
+  /// to that have no ID yet are new, those are saved as well.
+  JSONSerializer(const std::vector<std::shared_ptr<Node>>& nodes, 
+    JSONNodeIDs& nodeIDs, MeshArrayEncoding meshArrayEncoding,
+    BlobCompression blobCompression);
+
+  std::string GetJSON();
+
+  /// Saved nodes as journal records, see DocumentJournal
+  std::string GetJSONRecords();
 
 private:
   /// Collect nodes in the transitive close of root
   void Traverse(const std::shared_ptr<Node>& root);
 
+  /// True if Traverse needs to visit the node
+  bool ShouldTraverse(const std::shared_ptr<Node>& node) const;
+
   /// Creates a JSON document from all the nodes
   void DumpNodes();
 
@@ -40,12 +77,16 @@ private:
     rapidjson::Value& nodeValue, const std::shared_ptr<Vec4Node>& node) const;
   void SerializeFloatSplineNode(
     rapidjson::Value& nodeValue, const std::shared_ptr<FloatSplineNode>& node) const;
-  void SerializeTextureNode(
-    rapidjson::Value& nodeValue, const std::shared_ptr<TextureNode>& node) const;
+  void SerializeStaticTextureNode(
+    rapidjson::Value& nodeValue, const std::shared_ptr<StaticTextureNode>& node);
   void SerializeStubNode(
     rapidjson::Value& nodeValue, const std::shared_ptr<StubNode>& node) const;
   void SerializeStaticMeshNode(
-    rapidjson::Value& nodeValue, const std::shared_ptr<StaticMeshNode>& node) const;
+    rapidjson::Value& nodeValue, const std::shared_ptr<StaticMeshNode>& node);
+
+  /// Optimized copy of a mesh if asked for, nullptr otherwise
+  std::shared_ptr<MeshOptimizer::OptimizedMesh> GetOptimizedMesh(
+    const std::shared_ptr<Mesh>& mesh);
   void SerializeGeneralNode(
     rapidjson::Value& nodeValue, const std::shared_ptr<Node>& node);
 
@@ -54,11 +95,74 @@ private:
   rapidjson::Value SerializeVec3(const vec3& vec) const;
   rapidjson::Value SerializeVec4(const vec4& vec) const;
 
-  /// Number of nodes to save
-  int mNodeCount;
+  /// Returns the bytes of a payload, using the buffer if the data needs
+  /// converting. Must only use data that doesn't change after capturing.
+  typedef std::function<const void*(std::vector<char>& buffer)> PayloadSource;
+
+  /// Blob captured by SerializeBlob, not encoded yet
+  struct Payload {
+    /// Unique address of the empty placeholder string
+    const char* mPlaceholder;
+    size_t mByteCount;
+    PayloadSource mSource;
+
+    /// Stored in "blobs" and referred to by hash instead of inline
+    bool mIsShared;
+  };
+  typedef std::unordered_map<const char*, const Payload*> PlaceholderMap;
+
+  /// Blob already added to "blobs", compared byte by byte on a hash match
+  struct StoredBlob {
+    const void* mBytes;
+    size_t mByteCount;
+    std::string mKey;
+  };
+
+  /// Adds the "base64" member to a blob object, and "compression" if needed,
+  /// or "blob" for shared blobs. The text is a placeholder until
+  /// EncodePayloads().
+  void SerializeBlob(rapidjson::Value& blobValue, size_t byteCount,
+    PayloadSource source);
+
+  /// Compact mesh array object, see compactarrays.h
+  rapidjson::Value SerializeCompactArray(UINT bits, size_t byteCount,
+    PayloadSource source);
+
+  /// Replaces the placeholders with base64 text stored in the document's
+  /// memory, or with the hash of a shared blob added to "blobs". Values don't
+  /// move anymore once the DOM is complete.
+  void EncodePayloads();
+  void EncodePayloads(rapidjson::Value& value, const PlaceholderMap& placeholders,
+    rapidjson::Value& blobs);
+
+  /// Compresses if needed, the text is stored in the document's memory
+  rapidjson::Value EncodeBlobText(const void* bytes, size_t byteCount);
+
+  std::vector<Payload> mPayloads;
+  bool mArePayloadsEncoded = false;
+
+  /// Stored blobs by content hash, more than one only if hashes collide.
+  /// Converted bytes are kept in the buffers until encoding is done.
+  std::unordered_map<std::string, std::vector<StoredBlob>> mStoredBlobs;
+  std::deque<std::vector<char>> mStoredBlobBuffers;
+
+  const MeshArrayEncoding mMeshArrayEncoding;
+  const BlobCompression mBlobCompression;
+  const MeshOptimization mMeshOptimization;
+
+  /// Optimized copies by mesh, nullptr for meshes that can't be optimized
+  std::unordered_map<const Mesh*, std::shared_ptr<MeshOptimizer::OptimizedMesh>>
+    mOptimizedMeshes;
+
+  /// Node IDs, either owned or kept by a DocumentJournal
+  JSONNodeIDs mOwnNodeIDs;
+  JSONNodeIDs& mNodeIDs;
+
+  /// Partial saves don't descend into nodes saved earlier
+  const bool mIsPartial;
 
   /// All nodes to save
-  std::unordered_map<std::shared_ptr<Node>, int> mNodes;
+  std::unordered_set<std::shared_ptr<Node>> mTraversedNodes;
   std::vector<std::shared_ptr<Node>> mNodesList;
 
   rapidjson::Document mJsonDocument;
@@ -0,0 +1,878 @@
+#include "jsonstreamdeserializer.h"
+#include "jsonserializer.h"
+#include "compactarrays.h"
+#include <include/dom/ghost.h>
+#include <rapidjson/memorystream.h>
+#include <rapidjson/error/en.h>
+#include <algorithm>
+#include <cstring>
+
+/// Compares a SAX key to a literal
+static bool IsKey(const char* text, rapidjson::SizeType length, const char* key) {
+  return strlen(key) == length && memcmp(text, key, length) == 0;
+}
+
+/// SAX handler storing the numbers of a JSON array, or a single JSON number.
+/// Numbers are converted the same way as in the DOM, values beyond the
+/// capacity are only counted.
+template <typename T>
+class NumberReader {
+public:
+  NumberReader(T* target, size_t capacity)
+    : mTarget(target), mCapacity(capacity) {}
+
+  bool Null() { return false; }
+  bool Bool(bool) { return false; }
+  bool Int(int value) { return Add(double(value)); }
+  bool Uint(unsigned value) { return Add(double(value)); }
+  bool Int64(int64_t value) { return Add(double(value)); }
+  bool Uint64(uint64_t value) { return Add(double(value)); }
+  bool Double(double value) { return Add(value); }
+  bool RawNumber(const char*, rapidjson::SizeType, bool) { return false; }
+  bool String(const char*, rapidjson::SizeType, bool) { return false; }
+  bool StartObject() { return false; }
+  bool Key(const char*, rapidjson::SizeType, bool) { return false; }
+  bool EndObject(rapidjson::SizeType) { return false; }
+  bool StartArray() { return true; }
+  bool EndArray(rapidjson::SizeType) { return true; }
+
+  size_t mCount = 0;
+
+private:
+  bool Add(double value) {
+    if (mCount < mCapacity) mTarget[mCount] = T(value);
+    mCount++;
+    return true;
+  }
+
+  T* const mTarget;
+  const size_t mCapacity;
+};
+
+/// Value of a blob's "compression" member, see compactarrays.h. Returns false
+/// for unknown compressions, the blob can't be decoded then.
+static bool ParseCompression(const char* text, rapidjson::SizeType length,
+  bool& oIsCompressed)
+{
+  if (!IsKey(text, length, "zstd")) {
+    ERR("Unknown compression: %s", std::string(text, length).c_str());
+    return false;
+  }
+  oIsCompressed = true;
+  return true;
+}
+
+/// Parses JSON numbers into target, returns the number count found
+template <typename T>
+static size_t ParseNumbers(const char* json, size_t size, T* target, size_t capacity) {
+  rapidjson::MemoryStream stream(json, size);
+  NumberReader<T> handler(target, capacity);
+  rapidjson::Reader reader;
+  if (reader.Parse(stream, handler).IsError()) return 0;
+  return handler.mCount;
+}
+
+/// Appends a raw number to a numeric array collected as JSON text
+static void AppendNumber(std::string& array, const char* text, rapidjson::SizeType length) {
+  if (array.back() != '[') array += ',';
+  array.append(text, length);
+}
+
+JSONStreamDeserializer::JSONStreamDeserializer(const char* json, size_t size,
+  ThreadPool* threadPool)
+{
+  rapidjson::MemoryStream stream(json, size);
+  rapidjson::Reader reader;
+
+  /// Numbers are converted in the handler, numeric arrays of meshes are only
+  /// collected and parsed later by the decode jobs
+  INFO("Loading nodes...");
+  const rapidjson::ParseResult result =
+    reader.Parse<rapidjson::kParseNumbersAsStringsFlag>(stream, *this);
+  if (result.IsError()) {
+    ERR("JSON parse error at %d: %s", UINT(result.Offset()),
+      rapidjson::GetParseError_En(result.Code()));
+    mDocument = nullptr;
+    return;
+  }
+
+  INFO("Loading assets...");
+  if (!LoadAssets(threadPool)) {
+    ERR("Loading failed.");
+    mDocument = nullptr;
+    return;
+  }
+
+  INFO("Loading connections...");
+  for (UINT i = 0; i < mPendingSlots.size(); ) {
+    UINT slotCount = 1;
+    while (i + slotCount < mPendingSlots.size() &&
+      mPendingSlots[i + slotCount].mNodeIndex == mPendingSlots[i].mNodeIndex) {
+      slotCount++;
+    }
+    ConnectSlots(i, slotCount);
+    i += slotCount;
+  }
+
+  INFO("Loading done.");
+}
+
+std::shared_ptr<Document> JSONStreamDeserializer::GetDocument() const
+{
+  return mDocument;
+}
+
+bool JSONStreamDeserializer::Null() {
+  return true;
+}
+
+bool JSONStreamDeserializer::Bool(bool value) {
+  if (mContextStack.empty()) return true;
+  switch (mContextStack.back()) {
+    case Context::SPLINE_POINT:
+    {
+      PendingPoint& point = mPendingNode.mSplinePoints[mSplineLayer].back();
+      if (mField == Field::AUTOTANGENT) point.mIsAutoTangent = value;
+      else if (mField == Field::BREAKPOINT) point.mIsBreakpoint = value;
+      else if (mField == Field::LINEAR) point.mIsLinear = value;
+      break;
+    }
+    case Context::SLOT:
+      if (mField == Field::GHOST) {
+        mPendingSlots.back().mHasGhost = true;
+        mPendingSlots.back().mIsGhost = value;
+      }
+      break;
+    default: break;
+  }
+  return true;
+}
+
+bool JSONStreamDeserializer::Int(int value) {
+  return Number(double(value));
+}
+
+bool JSONStreamDeserializer::Uint(unsigned value) {
+  return Number(double(value));
+}
+
+bool JSONStreamDeserializer::Int64(int64_t value) {
+  return Number(double(value));
+}
+
+bool JSONStreamDeserializer::Uint64(uint64_t value) {
+  return Number(double(value));
+}
+
+bool JSONStreamDeserializer::Double(double value) {
+  return Number(value);
+}
+
+bool JSONStreamDeserializer::RawNumber(const char* text, rapidjson::SizeType length,
+  bool)
+{
+  if (mContextStack.empty()) return true;
+  switch (mContextStack.back()) {
+    case Context::VERTICES:
+      AppendNumber(mPendingNode.mVertexText, text, length);
+      return true;
+    case Context::INDICES:
+      AppendNumber(mPendingNode.mIndexText, text, length);
+      return true;
+    default:
+    {
+      double value = 0;
+      if (ParseNumbers(text, length, &value, 1) != 1) return false;
+      return Number(value);
+    }
+  }
+}
+
+bool JSONStreamDeserializer::Number(double value) {
+  if (mContextStack.empty()) return true;
+  switch (mContextStack.back()) {
+    case Context::VECTOR:
+      if (mVectorComponent >= 0) mVector[mVectorComponent] = float(value);
+      break;
+    case Context::SPLINE_POINT:
+    {
+      PendingPoint& point = mPendingNode.mSplinePoints[mSplineLayer].back();
+      if (mField == Field::TIME) point.mTime = float(value);
+      else if (mField == Field::VALUE) point.mValue = float(value);
+      break;
+    }
+    case Context::CONNECTIONS:
+      mConnections.push_back(int(value));
+      break;
+    case Context::COMPACT_ARRAY:
+      if (mField == Field::BITS) mCompactArray->mBits = UINT(value);
+      break;
+    case Context::COMPACT_RANGE:
+      mCompactRange->push_back(float(value));
+      break;
+    case Context::SLOT:
+    {
+      PendingSlot& slot = mPendingSlots.back();
+      if (mField == Field::CONNECT) {
+        slot.mHasConnect = true;
+        slot.mConnectionCount = 1;
+        mConnections.push_back(int(value));
+      }
+      else if (mField == Field::DEFAULT) {
+        slot.mDefaultType = DefaultType::NUMBER;
+        slot.mDefault[0] = float(value);
+      }
+      break;
+    }
+    case Context::NODE:
+      switch (mNodeField) {
+        case NodeField::ID: mPendingNode.mId = int(value); break;
+        case NodeField::VALUE: mPendingNode.mValue[0] = float(value); break;
+        case NodeField::WIDTH: mPendingNode.mWidth = int(value); break;
+        case NodeField::HEIGHT: mPendingNode.mHeight = int(value); break;
+        case NodeField::FORMAT: mPendingNode.mFormat = int(value); break;
+        case NodeField::VERTEX_COUNT: mPendingNode.mVertexCount = UINT(value); break;
+        case NodeField::INDEX_COUNT: mPendingNode.mIndexCount = UINT(value); break;
+        default: break;
+      }
+      break;
+    default: break;
+  }
+  return true;
+}
+
+bool JSONStreamDeserializer::String(const char* text, rapidjson::SizeType length, bool) {
+  if (mContextStack.empty()) return true;
+  switch (mContextStack.back()) {
+    case Context::NODE:
+      switch (mNodeField) {
+        case NodeField::CLASS: mPendingNode.mClassName.assign(text, length); break;
+        case NodeField::NAME:
+          mPendingNode.mName.assign(text, length);
+          mPendingNode.mHasName = true;
+          break;
+        case NodeField::TEXEL_TYPE: mPendingNode.mTexelType.assign(text, length); break;
+        case NodeField::TEXELS: mPendingNode.mBase64.assign(text, length); break;
+        case NodeField::TEXEL_COMPRESSION:
+          if (!ParseCompression(text, length, mPendingNode.mIsTexelCompressed)) {
+            return false;
+          }
+          break;
+        case NodeField::TEXEL_BLOB: mPendingNode.mTexelBlob.assign(text, length); break;
+        case NodeField::SOURCE: mPendingNode.mSource.assign(text, length); break;
+        default: break;
+      }
+      break;
+    case Context::SLOT:
+      if (mField == Field::DEFAULT) {
+        mPendingSlots.back().mDefaultType = DefaultType::STRING;
+        mPendingSlots.back().mDefaultString.assign(text, length);
+      }
+      break;
+    case Context::COMPACT_ARRAY:
+      if (mField == Field::BASE64) mCompactArray->mBase64.assign(text, length);
+      else if (mField == Field::COMPRESSION) {
+        if (!ParseCompression(text, length, mCompactArray->mIsCompressed)) return false;
+      }
+      else if (mField == Field::BLOB) mCompactArray->mBlob.assign(text, length);
+      break;
+    default: break;
+  }
+  return true;
+}
+
+bool JSONStreamDeserializer::Key(const char* text, rapidjson::SizeType length, bool) {
+  switch (mContextStack.back()) {
+    case Context::ROOT:
+      mRootKey.assign(text, length);
+      break;
+    case Context::NODE:
+    {
+      mNodeField = NodeField::UNKNOWN;
+      if (IsKey(text, length, "node")) mNodeField = NodeField::CLASS;
+      else if (IsKey(text, length, "id")) mNodeField = NodeField::ID;
+      else if (IsKey(text, length, "name")) mNodeField = NodeField::NAME;
+      else if (IsKey(text, length, "position")) mNodeField = NodeField::POSITION;
+      else if (IsKey(text, length, "value")) mNodeField = NodeField::VALUE;
+      else if (IsKey(text, length, "width")) mNodeField = NodeField::WIDTH;
+      else if (IsKey(text, length, "height")) mNodeField = NodeField::HEIGHT;
+      else if (IsKey(text, length, "type")) mNodeField = NodeField::TEXEL_TYPE;
+      else if (IsKey(text, length, "base64")) mNodeField = NodeField::TEXELS;
+      else if (IsKey(text, length, "compression")) {
+        mNodeField = NodeField::TEXEL_COMPRESSION;
+      }
+      else if (IsKey(text, length, "blob")) mNodeField = NodeField::TEXEL_BLOB;
+      else if (IsKey(text, length, "format")) mNodeField = NodeField::FORMAT;
+      else if (IsKey(text, length, "vertexcount")) mNodeField = NodeField::VERTEX_COUNT;
+      else if (IsKey(text, length, "indexcount")) mNodeField = NodeField::INDEX_COUNT;
+      else if (IsKey(text, length, "vertices")) mNodeField = NodeField::VERTICES;
+      else if (IsKey(text, length, "indices")) mNodeField = NodeField::INDICES;
+      else if (IsKey(text, length, "source")) mNodeField = NodeField::SOURCE;
+      else if (IsKey(text, length, "slots")) mNodeField = NodeField::SLOTS;
+      else {
+        for (UINT l = UINT(SplineLayer::BASE); l < UINT(SplineLayer::COUNT); l++) {
+          if (IsKey(text, length, SplineLayerMapper.GetName(SplineLayer(l)))) {
+            mNodeField = NodeField::SPLINE_LAYER;
+            mSplineLayer = l;
+            break;
+          }
+        }
+      }
+      break;
+    }
+    case Context::VECTOR:
+      mVectorComponent = -1;
+      if (length == 1) {
+        switch (text[0]) {
+          case 'x': mVectorComponent = 0; break;
+          case 'y': mVectorComponent = 1; break;
+          case 'z': mVectorComponent = 2; break;
+          case 'w': mVectorComponent = 3; break;
+          default: break;
+        }
+      }
+      break;
+    case Context::SPLINE_POINT:
+      mField = Field::UNKNOWN;
+      if (IsKey(text, length, "time")) mField = Field::TIME;
+      else if (IsKey(text, length, "value")) mField = Field::VALUE;
+      else if (IsKey(text, length, "autotangent")) mField = Field::AUTOTANGENT;
+      else if (IsKey(text, length, "breakpoint")) mField = Field::BREAKPOINT;
+      else if (IsKey(text, length, "linear")) mField = Field::LINEAR;
+      break;
+    case Context::SLOTS:
+    {
+      PendingSlot slot;
+      slot.mNodeIndex = UINT(mNodeList.size());
+      slot.mName.assign(text, length);
+      mPendingSlots.push_back(slot);
+      break;
+    }
+    case Context::SLOT:
+      mField = Field::UNKNOWN;
+      if (IsKey(text, length, "ghost")) mField = Field::GHOST;
+      else if (IsKey(text, length, "connect")) mField = Field::CONNECT;
+      else if (IsKey(text, length, "default")) mField = Field::DEFAULT;
+      break;
+    case Context::COMPACT_ARRAY:
+      mField = Field::UNKNOWN;
+      if (IsKey(text, length, "bits")) mField = Field::BITS;
+      else if (IsKey(text, length, "min")) mField = Field::MINIMUM;
+      else if (IsKey(text, length, "max")) mField = Field::MAXIMUM;
+      else if (IsKey(text, length, "base64")) mField = Field::BASE64;
+      else if (IsKey(text, length, "compression")) mField = Field::COMPRESSION;
+      else if (IsKey(text, length, "blob")) mField = Field::BLOB;
+      break;
+    case Context::BLOBS:
+      mCompactArray = &mBlobs[std::string(text, length)];
+      break;
+    default: break;
+  }
+  return true;
+}
+
+bool JSONStreamDeserializer::StartObject() {
+  Context context = Context::SKIP;
+  if (mContextStack.empty()) {
+    context = Context::ROOT;
+  }
+  else {
+    switch (mContextStack.back()) {
+      case Context::ROOT:
+        if (mRootKey == "blobs") context = Context::BLOBS;
+        break;
+      case Context::BLOBS:
+        context = Context::COMPACT_ARRAY;
+        break;
+      case Context::NODES:
+        mPendingNode = PendingNode();
+        context = Context::NODE;
+        break;
+      case Context::NODE:
+        if (mNodeField == NodeField::POSITION) {
+          mPendingNode.mHasPosition = true;
+          mVector = mPendingNode.mPosition;
+          context = Context::VECTOR;
+        }
+        else if (mNodeField == NodeField::VALUE) {
+          mVector = mPendingNode.mValue;
+          context = Context::VECTOR;
+        }
+        else if (mNodeField == NodeField::SLOTS) {
+          context = Context::SLOTS;
+        }
+        else if (mNodeField == NodeField::VERTICES) {
+          mCompactArray = &mPendingNode.mCompactVertices;
+          context = Context::COMPACT_ARRAY;
+        }
+        else if (mNodeField == NodeField::INDICES) {
+          mPendingNode.mHasIndices = true;
+          mCompactArray = &mPendingNode.mCompactIndices;
+          context = Context::COMPACT_ARRAY;
+        }
+        break;
+      case Context::SPLINE_LAYER:
+        mPendingNode.mSplinePoints[mSplineLayer].push_back(PendingPoint());
+        context = Context::SPLINE_POINT;
+        break;
+      case Context::SLOTS:
+        context = Context::SLOT;
+        break;
+      case Context::SLOT:
+        if (mField == Field::DEFAULT) {
+          mPendingSlots.back().mDefaultType = DefaultType::VECTOR;
+          mVector = mPendingSlots.back().mDefault;
+          context = Context::VECTOR;
+        }
+        break;
+      default: break;
+    }
+  }
+  mVectorComponent = -1;
+  mContextStack.push_back(context);
+  return true;
+}
+
+bool JSONStreamDeserializer::EndObject(rapidjson::SizeType) {
+  const Context context = mContextStack.back();
+  mContextStack.pop_back();
+  if (context == Context::NODE) return FinishNode();
+  return true;
+}
+
+bool JSONStreamDeserializer::StartArray() {
+  Context context = Context::SKIP;
+  if (!mContextStack.empty()) {
+    switch (mContextStack.back()) {
+      case Context::ROOT:
+        if (mRootKey == "nodes") context = Context::NODES;
+        break;
+      case Context::NODE:
+        if (mNodeField == NodeField::SPLINE_LAYER) context = Context::SPLINE_LAYER;
+        else if (mNodeField == NodeField::VERTICES) {
+          mPendingNode.mVertexText = "[";
+          context = Context::VERTICES;
+        }
+        else if (mNodeField == NodeField::INDICES) {
+          mPendingNode.mHasIndices = true;
+          mPendingNode.mIndexText = "[";
+          context = Context::INDICES;
+        }
+        break;
+      case Context::COMPACT_ARRAY:
+        if (mField == Field::MINIMUM) {
+          mCompactRange = &mCompactArray->mMinimum;
+          context = Context::COMPACT_RANGE;
+        }
+        else if (mField == Field::MAXIMUM) {
+          mCompactRange = &mCompactArray->mMaximum;
+          context = Context::COMPACT_RANGE;
+        }
+        break;
+      case Context::SLOT:
+        if (mField == Field::CONNECT) {
+          PendingSlot& slot = mPendingSlots.back();
+          slot.mHasConnect = true;
+          slot.mIsConnectArray = true;
+          slot.mFirstConnection = UINT(mConnections.size());
+          context = Context::CONNECTIONS;
+        }
+        break;
+      default: break;
+    }
+  }
+  mContextStack.push_back(context);
+  return true;
+}
+
+bool JSONStreamDeserializer::EndArray(rapidjson::SizeType) {
+  const Context context = mContextStack.back();
+  mContextStack.pop_back();
+  if (context == Context::CONNECTIONS) {
+    PendingSlot& slot = mPendingSlots.back();
+    slot.mConnectionCount = UINT(mConnections.size()) - slot.mFirstConnection;
+  }
+  else if (context == Context::VERTICES) mPendingNode.mVertexText += ']';
+  else if (context == Context::INDICES) mPendingNode.mIndexText += ']';
+  return true;
+}
+
+bool JSONStreamDeserializer::FinishNode() {
+  PendingNode& pending = mPendingNode;
+  ASSERT(mNodes.find(pending.mId) == mNodes.end());
+
+  std::shared_ptr<Node> node;
+  if (pending.mClassName == "ghost") {
+    node = std::make_shared<Ghost>();
+  }
+  else {
+    NodeClass* nodeClass = NodeRegistry::GetInstance()->GetNodeClass(pending.mClassName);
+    if (nodeClass == nullptr) {
+      ERR("Unknown node class: %s", pending.mClassName.c_str());
+      mNodeList.push_back(nullptr);
+      return true;
+    }
+    node = nodeClass->Manufacture();
+  }
+  mNodes[pending.mId] = node;
+  mNodeList.push_back(node);
+
+  if (pending.mHasName) {
+    node->SetName(pending.mName);
+  }
+
+  if (pending.mHasPosition) {
+    node->SetPosition(vec2(pending.mPosition[0], pending.mPosition[1]));
+  }
+
+  const float* value = pending.mValue;
+  if (IsExactType<FloatNode>(node)) {
+    PointerCast<FloatNode>(node)->Set(value[0]);
+  }
+  else if (IsExactType<Vec2Node>(node)) {
+    PointerCast<Vec2Node>(node)->Set(vec2(value[0], value[1]));
+  }
+  else if (IsExactType<Vec3Node>(node)) {
+    PointerCast<Vec3Node>(node)->Set(vec3(value[0], value[1], value[2]));
+  }
+  else if (IsExactType<Vec4Node>(node)) {
+    PointerCast<Vec4Node>(node)->Set(vec4(value[0], value[1], value[2], value[3]));
+  }
+  else if (IsExactType<FloatSplineNode>(node)) {
+    DeserializeFloatSplineNode(PointerCast<FloatSplineNode>(node));
+  }
+  else if (IsExactType<StaticTextureNode>(node)) {
+    if (!QueueStaticTextureNode(PointerCast<StaticTextureNode>(node))) return false;
+  }
+  else if (IsExactType<StaticMeshNode>(node)) {
+    QueueStaticMeshNode(PointerCast<StaticMeshNode>(node));
+  }
+  else if (IsExactType<StubNode>(node)) {
+    PointerCast<StubNode>(node)->mSource.SetDefaultValue(pending.mSource);
+    PointerCast<StubNode>(node)->Update();
+  }
+  else if (IsExactType<Document>(node)) {
+    ASSERT(mDocument == nullptr);
+    mDocument = PointerCast<Document>(node);
+  }
+
+  /// Release large buffers before the next node
+  pending = PendingNode();
+  return true;
+}
+
+bool JSONStreamDeserializer::QueueStaticTextureNode(
+  const std::shared_ptr<StaticTextureNode>& node)
+{
+  const TexelType texelType = TexelTypeMapper.GetEnum(mPendingNode.mTexelType.c_str());
+  if (signed(texelType) < 0) {
+    ERR("Unknown texture type: %s", mPendingNode.mTexelType.c_str());
+    return false;
+  }
+
+  /// Nodes with the same texels share the texture
+  if (!mPendingNode.mTexelBlob.empty()) {
+    const std::string key = mPendingNode.mTexelType + '/' +
+      std::to_string(mPendingNode.mWidth) + 'x' + std::to_string(mPendingNode.mHeight) +
+      ':' + mPendingNode.mTexelBlob;
+    const auto it = mSharedTextureJobs.find(key);
+    if (it != mSharedTextureJobs.end()) {
+      mTextureJobs[it->second].mNodes.push_back(node);
+      return true;
+    }
+    mSharedTextureJobs[key] = UINT(mTextureJobs.size());
+  }
+
+  TextureJob job;
+  job.mNodes.push_back(node);
+  job.mWidth = mPendingNode.mWidth;
+  job.mHeight = mPendingNode.mHeight;
+  job.mTexelType = texelType;
+  job.mBase64 = std::move(mPendingNode.mBase64);
+  job.mIsCompressed = mPendingNode.mIsTexelCompressed;
+  job.mBlob = std::move(mPendingNode.mTexelBlob);
+  mTextureJobs.push_back(std::move(job));
+  return true;
+}
+
+void JSONStreamDeserializer::QueueStaticMeshNode(
+  const std::shared_ptr<StaticMeshNode>& node)
+{
+  /// Nodes with the same vertices and indices share the mesh
+  std::string key = GetCompactArrayKey(mPendingNode.mCompactVertices);
+  if (!key.empty() && mPendingNode.mHasIndices) {
+    const std::string indexKey = GetCompactArrayKey(mPendingNode.mCompactIndices);
+    key = indexKey.empty() ? indexKey
+      : key + '/' + std::to_string(mPendingNode.mIndexCount) + ':' + indexKey;
+  }
+  if (!key.empty()) {
+    key = std::to_string(mPendingNode.mFormat) + '/' +
+      std::to_string(mPendingNode.mVertexCount) + ':' + key;
+    const auto it = mSharedMeshJobs.find(key);
+    if (it != mSharedMeshJobs.end()) {
+      mMeshJobs[it->second].mNodes.push_back(node);
+      return;
+    }
+    mSharedMeshJobs[key] = UINT(mMeshJobs.size());
+  }
+
+  MeshJob job;
+  job.mNodes.push_back(node);
+  job.mMesh = std::make_shared<Mesh>();
+  job.mMesh->AllocateVertices(std::make_shared<VertexFormat>(mPendingNode.mFormat),
+    mPendingNode.mVertexCount);
+  job.mVertexText = std::move(mPendingNode.mVertexText);
+  job.mCompactVertices = std::move(mPendingNode.mCompactVertices);
+  job.mHasIndices = mPendingNode.mHasIndices;
+  job.mIndices.resize(mPendingNode.mHasIndices ? mPendingNode.mIndexCount : 0);
+  job.mIndexText = std::move(mPendingNode.mIndexText);
+  job.mCompactIndices = std::move(mPendingNode.mCompactIndices);
+  mMeshJobs.push_back(std::move(job));
+}
+
+bool JSONStreamDeserializer::LoadAssets(ThreadPool* threadPool) {
+  const UINT textureCount = UINT(mTextureJobs.size());
+  const UINT jobCount = textureCount + UINT(mMeshJobs.size());
+  const auto decode = [this, textureCount](UINT i) {
+    if (i < textureCount) DecodeTexture(mTextureJobs[i]);
+    else DecodeMesh(mMeshJobs[i - textureCount]);
+  };
+  if (threadPool) {
+    threadPool->ParallelFor(jobCount, decode);
+  }
+  else {
+    for (UINT i = 0; i < jobCount; i++) decode(i);
+  }
+
+  bool isValid = true;
+  for (const TextureJob& job : mTextureJobs) isValid = isValid && UploadTexture(job);
+  for (const MeshJob& job : mMeshJobs) isValid = isValid && UploadMesh(job);
+  mTextureJobs.clear();
+  mMeshJobs.clear();
+  mBlobs.clear();
+  mSharedTextureJobs.clear();
+  mSharedMeshJobs.clear();
+  return isValid;
+}
+
+const JSONStreamDeserializer::PendingCompactArray*
+  JSONStreamDeserializer::FindBlob(const std::string& hash) const
+{
+  const auto it = mBlobs.find(hash);
+  return it == mBlobs.end() ? nullptr : &it->second;
+}
+
+const JSONStreamDeserializer::PendingCompactArray&
+  JSONStreamDeserializer::GetBlob(const PendingCompactArray& array) const
+{
+  if (array.mBlob.empty()) return array;
+
+  /// Missing blobs decode to nothing, that's reported on upload
+  static const PendingCompactArray missingBlob;
+  const PendingCompactArray* blob = FindBlob(array.mBlob);
+  return blob ? *blob : missingBlob;
+}
+
+std::string JSONStreamDeserializer::GetCompactArrayKey(const PendingCompactArray& array)
+{
+  if (array.mBlob.empty()) return std::string();
+  std::string key = std::to_string(array.mBits) + ':' + array.mBlob;
+  for (const std::vector<float>* range : { &array.mMinimum, &array.mMaximum }) {
+    key.append(reinterpret_cast<const char*>(range->data()),
+      range->size() * sizeof(float));
+  }
+  return key;
+}
+
+void JSONStreamDeserializer::DecodeTexture(TextureJob& job) const {
+  if (job.mBlob.empty()) {
+    job.mTexels = CompactArrays::DecodeBlob(job.mBase64.data(), job.mBase64.size(),
+      job.mIsCompressed);
+  }
+  else if (const PendingCompactArray* blob = FindBlob(job.mBlob)) {
+    job.mTexels = CompactArrays::DecodeBlob(blob->mBase64.data(), blob->mBase64.size(),
+      blob->mIsCompressed);
+  }
+  job.mBase64 = std::string();
+}
+
+void JSONStreamDeserializer::DecodeMesh(MeshJob& job) const {
+  const Mesh* mesh = job.mMesh.get();
+  const UINT floatCount = mesh->mVertexCount * mesh->mFormat->mStride / sizeof(float);
+  float* vertices = static_cast<float*>(mesh->mRawVertexData);
+  const PendingCompactArray& compactVertices = job.mCompactVertices;
+  if (compactVertices.mBits != 0) {
+    const PendingCompactArray& blob = GetBlob(compactVertices);
+    job.mParsedVertexFloats = CompactArrays::DecodeVertices(
+      blob.mBase64.data(), blob.mBase64.size(), blob.mIsCompressed,
+      compactVertices.mBits, compactVertices.mMinimum, compactVertices.mMaximum,
+      vertices, floatCount);
+  }
+  else {
+    job.mParsedVertexFloats = ParseNumbers(job.mVertexText.data(),
+      job.mVertexText.size(), vertices, floatCount);
+  }
+  job.mVertexText = std::string();
+  job.mCompactVertices = PendingCompactArray();
+
+  if (job.mHasIndices) {
+    const PendingCompactArray& compactIndices = job.mCompactIndices;
+    if (compactIndices.mBits != 0) {
+      const PendingCompactArray& blob = GetBlob(compactIndices);
+      job.mParsedIndices = CompactArrays::DecodeIndices(blob.mBase64.data(),
+        blob.mBase64.size(), blob.mIsCompressed,
+        compactIndices.mBits, job.mIndices.data(), job.mIndices.size());
+    }
+    else {
+      job.mParsedIndices = ParseNumbers(job.mIndexText.data(), job.mIndexText.size(),
+        job.mIndices.data(), job.mIndices.size());
+    }
+    job.mIndexText = std::string();
+    job.mCompactIndices = PendingCompactArray();
+  }
+}
+
+bool JSONStreamDeserializer::UploadTexture(const TextureJob& job) {
+  if (job.mTexels.empty()) {
+    ERR("Can't decode texels");
+    return false;
+  }
+  if (job.mWidth <= 0 || job.mHeight <= 0 ||
+    job.mTexels.size() / OpenGLAPI::GetTexelByteCount(job.mTexelType) <
+    uint64_t(job.mWidth) * job.mHeight)
+  {
+    ERR("Texel data doesn't match texture size %dx%d", job.mWidth, job.mHeight);
+    return false;
+  }
+  const std::shared_ptr<Texture> texture = OpenGL->MakeTexture(job.mWidth, job.mHeight,
+    job.mTexelType, job.mTexels.data(), false, false, true, true);
+  for (const auto& node : job.mNodes) node->Set(texture);
+  return true;
+}
+
+bool JSONStreamDeserializer::UploadMesh(const MeshJob& job) {
+  const std::shared_ptr<Mesh>& mesh = job.mMesh;
+  if (job.mParsedVertexFloats !=
+    mesh->mVertexCount * mesh->mFormat->mStride / sizeof(float))
+  {
+    ERR("Vertex data doesn't match vertex count %d", mesh->mVertexCount);
+    return false;
+  }
+  if (job.mHasIndices) {
+    if (job.mParsedIndices != job.mIndices.size()) {
+      ERR("Index data doesn't match index count %d", UINT(job.mIndices.size()));
+      return false;
+    }
+    for (IndexEntry index : job.mIndices) {
+      if (index >= mesh->mVertexCount) {
+        ERR("Vertex index out of range: %d", UINT(index));
+        return false;
+      }
+    }
+  }
+
+  mesh->UploadVertices(mesh->mRawVertexData);
+  if (job.mHasIndices) {
+    mesh->AllocateIndices(UINT(job.mIndices.size()));
+    mesh->UploadIndices(job.mIndices.data());
+  }
+
+  for (const auto& node : job.mNodes) node->Set(mesh);
+  return true;
+}
+
+void JSONStreamDeserializer::DeserializeFloatSplineNode(
+  const std::shared_ptr<FloatSplineNode>& node) const
+{
+  for (UINT l = UINT(SplineLayer::BASE); l < UINT(SplineLayer::COUNT); l++) {
+    const SplineLayer layer = SplineLayer(l);
+    for (const PendingPoint& point : mPendingNode.mSplinePoints[l]) {
+      const int pIndex = node->AddPoint(layer, point.mTime, point.mValue);
+      node->SetAutoTangent(layer, pIndex, point.mIsAutoTangent);
+      node->SetBreakpoint(layer, pIndex, point.mIsBreakpoint);
+      node->SetLinear(layer, pIndex, point.mIsLinear);
+    }
+  }
+}
+
+std::shared_ptr<Node> JSONStreamDeserializer::GetNodeById(int id) const {
+  const auto it = mNodes.find(id);
+  if (it == mNodes.end()) {
+    ERR("No such node id: %d", id);
+    return nullptr;
+  }
+  return it->second;
+}
+
+void JSONStreamDeserializer::ConnectSlots(UINT firstSlot, UINT slotCount) {
+  const std::shared_ptr<Node>& node = mNodeList[mPendingSlots[firstSlot].mNodeIndex];
+  if (node == nullptr) return;
+  const auto& slots = node->GetSerializableSlots();
+
+  if (IsPointerOf<Ghost>(node)) {
+    /// Connect original node first
+    for (UINT i = firstSlot; i < firstSlot + slotCount; i++) {
+      const PendingSlot& pendingSlot = mPendingSlots[i];
+      if (pendingSlot.mName != "Original" || pendingSlot.mConnectionCount == 0) continue;
+      const std::shared_ptr<Node> connNode =
+        GetNodeById(mConnections[pendingSlot.mFirstConnection]);
+      if (connNode) PointerCast<Ghost>(node)->mOriginalNode.Connect(connNode);
+    }
+  }
+
+  for (UINT i = firstSlot; i < firstSlot + slotCount; i++) {
+    const PendingSlot& pendingSlot = mPendingSlots[i];
+
+    /// Find slot
+    const auto it = slots.find(pendingSlot.mName);
+    if (it == slots.end()) {
+      ERR("No such slot: %s", pendingSlot.mName.c_str());
+      continue;
+    }
+    ConnectSlot(pendingSlot, it->second);
+  }
+}
+
+void JSONStreamDeserializer::ConnectSlot(const PendingSlot& pendingSlot, Slot* slot) {
+  /// Set ghost flag
+  if (pendingSlot.mHasGhost) {
+    slot->SetGhost(pendingSlot.mIsGhost);
+  }
+
+  /// Connect to nodes
+  if (pendingSlot.mHasConnect) {
+    if (slot->mIsMultiSlot != pendingSlot.mIsConnectArray) {
+      ERR("Multi/single slot mismatch: %s", pendingSlot.mName.c_str());
+      return;
+    }
+    for (UINT i = 0; i < pendingSlot.mConnectionCount; i++) {
+      const std::shared_ptr<Node> connNode =
+        GetNodeById(mConnections[pendingSlot.mFirstConnection + i]);
+      if (connNode) slot->Connect(connNode);
+    }
+  }
+
+  /// Set default values
+  const float* d = pendingSlot.mDefault;
+  if (pendingSlot.mDefaultType == DefaultType::STRING) {
+    if (dynamic_cast<StringSlot*>(slot)) {
+      SafeCast<StringSlot*>(slot)->SetDefaultValue(pendingSlot.mDefaultString);
+    }
+  }
+  else if (pendingSlot.mDefaultType == DefaultType::NUMBER) {
+    if (dynamic_cast<FloatSlot*>(slot)) {
+      SafeCast<FloatSlot*>(slot)->SetDefaultValue(d[0]);
+    }
+  }
+  else if (pendingSlot.mDefaultType == DefaultType::VECTOR) {
+    if (dynamic_cast<Vec2Slot*>(slot)) {
+      SafeCast<Vec2Slot*>(slot)->SetDefaultValue(vec2(d[0], d[1]));
+    }
+    else if (dynamic_cast<Vec3Slot*>(slot)) {
+      SafeCast<Vec3Slot*>(slot)->SetDefaultValue(vec3(d[0], d[1], d[2]));
+    }
+    else if (dynamic_cast<Vec4Slot*>(slot)) {
+      SafeCast<Vec4Slot*>(slot)->SetDefaultValue(vec4(d[0], d[1], d[2], d[3]));
+    }
+  }
+}
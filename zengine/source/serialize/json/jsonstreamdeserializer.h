@@ -0,0 +1,272 @@
+#pragma once
+
+#include <include/dom/document.h>
+#include <include/base/threadpool.h>
+#include <include/nodes/valuenodes.h>
+#include <include/nodes/meshnode.h>
+#include <include/nodes/texturenode.h>
+#include <include/nodes/splinenode.h>
+#include <include/shaders/stubnode.h>
+#include <rapidjson/reader.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// Loads the same JSON documents as JSONDeserializer without building a DOM.
+/// Nodes are created in a single streaming pass, slot connections and default
+/// values are recorded in a compact list and applied after all nodes exist,
+/// in the same order as JSONDeserializer does.
+/// Embedded textures and meshes are decoded after the node graph is built, in
+/// parallel when a thread pool is given. OpenGL uploads stay on the calling thread.
+/// Nodes with the same shared blobs get a single texture or mesh, it's decoded
+/// and uploaded once.
+class JSONStreamDeserializer {
+public:
+  JSONStreamDeserializer(const char* json, size_t size, ThreadPool* threadPool = nullptr);
+  std::shared_ptr<Document> GetDocument() const;
+
+  /// rapidjson SAX handler interface
+  bool Null();
+  bool Bool(bool value);
+  bool Int(int value);
+  bool Uint(unsigned value);
+  bool Int64(int64_t value);
+  bool Uint64(uint64_t value);
+  bool Double(double value);
+  bool RawNumber(const char* text, rapidjson::SizeType length, bool copy);
+  bool String(const char* text, rapidjson::SizeType length, bool copy);
+  bool StartObject();
+  bool Key(const char* text, rapidjson::SizeType length, bool copy);
+  bool EndObject(rapidjson::SizeType memberCount);
+  bool StartArray();
+  bool EndArray(rapidjson::SizeType elementCount);
+
+private:
+  /// Parser position
+  enum class Context {
+    ROOT,
+    NODES,
+    NODE,
+    VECTOR,
+    SPLINE_LAYER,
+    SPLINE_POINT,
+    VERTICES,
+    INDICES,
+    COMPACT_ARRAY,
+    COMPACT_RANGE,
+    BLOBS,
+    SLOTS,
+    SLOT,
+    CONNECTIONS,
+    SKIP,
+  };
+
+  /// Node object members
+  enum class NodeField {
+    UNKNOWN,
+    CLASS,
+    ID,
+    NAME,
+    POSITION,
+    VALUE,
+    SPLINE_LAYER,
+    WIDTH,
+    HEIGHT,
+    TEXEL_TYPE,
+    TEXELS,
+    TEXEL_COMPRESSION,
+    TEXEL_BLOB,
+    FORMAT,
+    VERTEX_COUNT,
+    INDEX_COUNT,
+    VERTICES,
+    INDICES,
+    SOURCE,
+    SLOTS,
+  };
+
+  /// Slot, spline point and compact array object members
+  enum class Field {
+    UNKNOWN,
+    GHOST,
+    CONNECT,
+    DEFAULT,
+    TIME,
+    VALUE,
+    AUTOTANGENT,
+    BREAKPOINT,
+    LINEAR,
+    BITS,
+    MINIMUM,
+    MAXIMUM,
+    BASE64,
+    COMPRESSION,
+    BLOB,
+  };
+
+  enum class DefaultType {
+    NONE,
+    NUMBER,
+    VECTOR,
+    STRING,
+  };
+
+  struct PendingPoint {
+    float mTime = 0;
+    float mValue = 0;
+    bool mIsAutoTangent = false;
+    bool mIsBreakpoint = false;
+    bool mIsLinear = false;
+  };
+
+  /// Mesh array in compact encoding, see compactarrays.h. Entries of the
+  /// "blobs" object are parsed into the same struct, without bits.
+  struct PendingCompactArray {
+    UINT mBits = 0;
+    std::vector<float> mMinimum;
+    std::vector<float> mMaximum;
+    std::string mBase64;
+    bool mIsCompressed = false;
+
+    /// Hash of the shared blob holding the data instead of mBase64
+    std::string mBlob;
+  };
+
+  /// Content of the node object being parsed
+  struct PendingNode {
+    std::string mClassName;
+    int mId = 0;
+    std::string mName;
+    bool mHasName = false;
+    float mPosition[4]{};
+    bool mHasPosition = false;
+    float mValue[4]{};
+    std::vector<PendingPoint> mSplinePoints[UINT(SplineLayer::COUNT)];
+    int mWidth = 0;
+    int mHeight = 0;
+    std::string mTexelType;
+    std::string mBase64;
+    bool mIsTexelCompressed = false;
+    std::string mTexelBlob;
+    int mFormat = 0;
+    UINT mVertexCount = 0;
+    UINT mIndexCount = 0;
+
+    /// Numeric arrays as JSON text or in compact encoding, decoded by the jobs
+    std::string mVertexText;
+    std::string mIndexText;
+    PendingCompactArray mCompactVertices;
+    PendingCompactArray mCompactIndices;
+    bool mHasIndices = false;
+    std::string mSource;
+  };
+
+  /// Slot state to apply after all nodes are created
+  struct PendingSlot {
+    UINT mNodeIndex = 0;
+    std::string mName;
+    bool mHasGhost = false;
+    bool mIsGhost = false;
+    bool mHasConnect = false;
+    bool mIsConnectArray = false;
+    UINT mFirstConnection = 0;
+    UINT mConnectionCount = 0;
+    DefaultType mDefaultType = DefaultType::NONE;
+    float mDefault[4]{};
+    std::string mDefaultString;
+  };
+
+  /// Texture decode job, mTexels is the output
+  struct TextureJob {
+    /// Nodes sharing the texture
+    std::vector<std::shared_ptr<StaticTextureNode>> mNodes;
+    int mWidth = 0;
+    int mHeight = 0;
+    TexelType mTexelType = TexelType(0);
+    std::string mBase64;
+    bool mIsCompressed = false;
+    std::string mBlob;
+    std::vector<char> mTexels;
+  };
+
+  /// Mesh decode job, vertices are parsed straight into the mesh's raw buffer
+  struct MeshJob {
+    /// Nodes sharing the mesh
+    std::vector<std::shared_ptr<StaticMeshNode>> mNodes;
+    std::shared_ptr<Mesh> mMesh;
+    std::string mVertexText;
+    PendingCompactArray mCompactVertices;
+    size_t mParsedVertexFloats = 0;
+    bool mHasIndices = false;
+    std::string mIndexText;
+    PendingCompactArray mCompactIndices;
+    std::vector<IndexEntry> mIndices;
+    size_t mParsedIndices = 0;
+  };
+
+  bool Number(double value);
+
+  /// Creates the node from mPendingNode. Returns false for corrupt nodes, which
+  /// aborts parsing.
+  bool FinishNode();
+
+  bool QueueStaticTextureNode(const std::shared_ptr<StaticTextureNode>& node);
+  void QueueStaticMeshNode(const std::shared_ptr<StaticMeshNode>& node);
+  void DeserializeFloatSplineNode(const std::shared_ptr<FloatSplineNode>& node) const;
+
+  /// Runs the decode jobs, then uploads and assigns the results. Returns false
+  /// if any asset doesn't match its declared size.
+  bool LoadAssets(ThreadPool* threadPool);
+
+  /// Decoding is thread safe, uploading must run on the OpenGL thread
+  void DecodeTexture(TextureJob& job) const;
+  void DecodeMesh(MeshJob& job) const;
+  static bool UploadTexture(const TextureJob& job);
+  static bool UploadMesh(const MeshJob& job);
+
+  /// Returns the shared blob an array refers to, or the array itself
+  const PendingCompactArray& GetBlob(const PendingCompactArray& array) const;
+  const PendingCompactArray* FindBlob(const std::string& hash) const;
+
+  /// Key of a compact array that refers to a shared blob, empty otherwise.
+  /// Arrays with the same key decode to the same values.
+  static std::string GetCompactArrayKey(const PendingCompactArray& array);
+
+  /// Applies pending slots of a single node
+  void ConnectSlots(UINT firstSlot, UINT slotCount);
+  void ConnectSlot(const PendingSlot& pendingSlot, Slot* slot);
+  std::shared_ptr<Node> GetNodeById(int id) const;
+
+  std::vector<Context> mContextStack;
+  std::string mRootKey;
+  NodeField mNodeField = NodeField::UNKNOWN;
+  Field mField = Field::UNKNOWN;
+  UINT mSplineLayer = 0;
+
+  /// Target of x/y/z/w members
+  float* mVector = nullptr;
+  int mVectorComponent = -1;
+
+  /// Compact array being parsed, and its min or max array
+  PendingCompactArray* mCompactArray = nullptr;
+  std::vector<float>* mCompactRange = nullptr;
+
+  PendingNode mPendingNode;
+  std::vector<PendingSlot> mPendingSlots;
+  std::vector<TextureJob> mTextureJobs;
+  std::vector<MeshJob> mMeshJobs;
+
+  /// Shared blobs by hash, and the jobs of assets made of them by content
+  std::unordered_map<std::string, PendingCompactArray> mBlobs;
+  std::unordered_map<std::string, UINT> mSharedTextureJobs;
+  std::unordered_map<std::string, UINT> mSharedMeshJobs;
+
+  /// Connected node ids of all pending slots
+  std::vector<int> mConnections;
+
+  /// Nodes by id, and in file order (nullptr for nodes that failed to load)
+  std::unordered_map<int, std::shared_ptr<Node>> mNodes;
+  std::vector<std::shared_ptr<Node>> mNodeList;
+
+  std::shared_ptr<Document> mDocument;
+};
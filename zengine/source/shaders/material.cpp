@@ -20,12 +20,12 @@ void Material::HandleMessage(Message* message) {
   }
 }
 
-std::shared_ptr<Pass> Material::GetPass(PassType passType) {
+Pass* Material::GetPass(PassType passType) const {
   switch (passType) {
-    case PassType::SHADOW: return mShadowPass.GetNode();
-    case PassType::SOLID: return mSolidPass.GetNode();
-    case PassType::ZPOST: return mZPostPass.GetNode();
-    case PassType::FLUID_PAINT: return mFluidPaintPass.GetNode();
+    case PassType::SHADOW: return mShadowPass.GetNodeRaw();
+    case PassType::SOLID: return mSolidPass.GetNodeRaw();
+    case PassType::ZPOST: return mZPostPass.GetNodeRaw();
+    case PassType::FLUID_PAINT: return mFluidPaintPass.GetNodeRaw();
   }
   SHOULD_NOT_HAPPEN;
   return nullptr;
@@ -34,7 +34,8 @@ std::shared_ptr<Pass> Material::GetPass(PassType passType) {
 REGISTER_NODECLASS(SolidMaterial, "Solid Material");
 
 SolidMaterial::SolidMaterial()
-  : mMaterial(std::make_shared<Material>())
+  : Node(true)
+  , mMaterial(std::make_shared<Material>())
   , mSolidPass(std::make_shared<Pass>())
   , mSolidVertexStub(std::make_shared<StubNode>())
   , mSolidFragmentStub(std::make_shared<StubNode>())
@@ -37,12 +37,22 @@ void Pass::HandleMessage(Message* message) {
       BuildShaderSource();
     }
     EnqueueMessage(MessageType::NEEDS_REDRAW);
+    if (!TheMessageQueue.IsDeliveringTimeTick()) mStaticUniformsDirty = true;
+    break;
+  case MessageType::NEEDS_REDRAW:
+    /// Uniform values changed, either by time or by an edit
+    if (!TheMessageQueue.IsDeliveringTimeTick()) mStaticUniformsDirty = true;
+    break;
+  case MessageType::TRANSITIVE_CLOSURE_CHANGED:
+    mSchedule.Invalidate();
+    mStaticUniformsDirty = true;
     break;
   default: break;
   }
 }
 
 void Pass::Operate() {
+  mStaticUniformsDirty = true;
   mShaderProgram.reset();
   if (!mShaderSource) return;
 
@@ -64,12 +74,17 @@ void Pass::Operate() {
   /// Allocate space for uniform array
   ASSERT(mShaderProgram->mUniformBlockSize <= MAX_UNIFORM_BUFFER_SIZE);
   mUniformBuffer->Allocate(mShaderProgram->mUniformBlockSize);
+  mUniformArray.assign(mShaderProgram->mUniformBlockSize, 0);
 }
 
 void Pass::BuildShaderSource()
 {
   mIsUpToDate = false;
 
+  /// Stub parameters may have changed
+  mSchedule.Invalidate();
+  mStaticUniformsDirty = true;
+
   /// Generate shader source
   mShaderSource.reset();
   mShaderSource = 
@@ -81,6 +96,21 @@ void Pass::BuildShaderSource()
 
 void Pass::Set(Globals* globals) {
   Update();
+
+  /// Static dependencies are frozen between edits, frame ticks only evaluate
+  /// the time-dependent part of the graph
+  const bool updateStaticUniforms = mStaticUniformsDirty;
+  if (updateStaticUniforms) {
+    mSchedule.Update();
+    mIsUniformTimeDependent.clear();
+    for (const auto& uniformMapper : mUniforms.GetResources()) {
+      Node* node = uniformMapper.mSource->mNode.get();
+      mIsUniformTimeDependent.push_back(
+        node != nullptr && mSchedule.IsTimeDependent(node));
+    }
+    mStaticUniformsDirty = false;
+  }
+  else mSchedule.UpdateTimeDependentNodes();
   if (!mShaderProgram) return;
 
   RenderState::FaceMode faceMode = RenderState::FaceMode::FRONT;
@@ -98,36 +128,40 @@ void Pass::Set(Globals* globals) {
   OpenGL->SetRenderState(&mRenderstate);
 
   if (mFluidSourceSlot.GetMultiNodeCount() > 0) {
-    auto& fluidSource = PointerCast<FluidNode>(mFluidSourceSlot.GetReferencedMultiNode(0));
+    FluidNode* fluidSource = 
+      SafeCast<FluidNode*>(mFluidSourceSlot.GetReferencedMultiNodeRaw(0));
     fluidSource->SetGlobalFluidTextures(globals);
   }
   if (mFluidColorTargetSlot.GetMultiNodeCount() > 0) {
-    auto& fluid = PointerCast<FluidNode>(mFluidColorTargetSlot.GetReferencedMultiNode(0));
+    FluidNode* fluid = 
+      SafeCast<FluidNode*>(mFluidColorTargetSlot.GetReferencedMultiNodeRaw(0));
     fluid->SetColorRenderTarget();
   }
   if (mFluidVelocityTargetSlot.GetMultiNodeCount() > 0) {
-    auto& fluid = PointerCast<FluidNode>(mFluidVelocityTargetSlot.GetReferencedMultiNode(0));
+    FluidNode* fluid = 
+      SafeCast<FluidNode*>(mFluidVelocityTargetSlot.GetReferencedMultiNodeRaw(0));
     fluid->SetVelocityRenderTarget();
   }
 
-  char uniformArray[MAX_UNIFORM_BUFFER_SIZE];
+  char* uniformArray = mUniformArray.data();
 
   /// Fill uniform array item by item, take value from Nodes and put them
   /// into the array using the uniform offset. Not particularly nice code,
   /// but fast enough.
-  for (const auto& uniformMapper : mUniforms.GetResources()) {
-    const ShaderSource::Uniform* source = uniformMapper.mSource;
-    const ShaderProgram::Uniform* target = uniformMapper.mTarget;
+  const auto& uniformResources = mUniforms.GetResources();
+  for (UINT i = 0; i < uniformResources.size(); i++) {
+    const ShaderSource::Uniform* source = uniformResources[i].mSource;
+    const ShaderProgram::Uniform* target = uniformResources[i].mTarget;
     if (source->mGlobalType == GlobalUniformUsage::LOCAL) {
-      /// Local uniform, takes value from a slot
+      /// Local uniform, takes value from a slot. Static values are kept.
       ASSERT(source->mNode != nullptr);
+      if (!updateStaticUniforms && !mIsUniformTimeDependent[i]) continue;
       switch (source->mType) {
 #undef ITEM
 #define ITEM(name) \
 				  case name: { \
-            auto& vNode = \
-              PointerCast<ValueNode<ValueTypes<name>::Type>>(source->mNode); \
-            vNode->Update(); \
+            auto vNode = \
+              SafeCast<ValueNode<ValueTypes<name>::Type>*>(source->mNode.get()); \
             *(reinterpret_cast<ValueTypes<name>::Type*>( \
               &uniformArray[target->mOffset])) = vNode->Get(); \
 					  break; \
@@ -176,7 +210,7 @@ void Pass::Set(Globals* globals) {
     std::shared_ptr<Texture> tex = nullptr;
     if (samplerMapper.mSource->mGlobalType == GlobalSamplerUsage::LOCAL) {
       ASSERT(samplerMapper.mSource->mNode != nullptr);
-      tex = PointerCast<TextureNode>(samplerMapper.mSource->mNode)->Get();
+      tex = SafeCast<TextureNode*>(samplerMapper.mSource->mNode.get())->Get();
     }
     else {
       /// Global uniform, takes value from the Globals object
@@ -191,7 +225,7 @@ void Pass::Set(Globals* globals) {
   for (const auto& ssbo : mSSBOs.GetResources()) {
     const ShaderProgram::SSBO* target = ssbo.mTarget;
     std::shared_ptr<Buffer> buffer = 
-      PointerCast<BufferNode>(ssbo.mSource->mNode)->GetBuffer();
+      SafeCast<BufferNode*>(ssbo.mSource->mNode.get())->GetBuffer();
     
     if (!buffer) continue;
     OpenGLAPI::SetSsbo(target->mIndex, buffer);
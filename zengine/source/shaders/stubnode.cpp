@@ -51,11 +51,22 @@ StubNode::~StubNode() {
   mParameterNameSlotMap.clear();
   ClearSlots();
   SafeDelete(mMetadata);
+  SafeDelete(mPreparedMetadata);
+}
+
+ThreadAffinity StubNode::GetThreadAffinity() const {
+  return ThreadAffinity::PREPARE_ON_ANY_THREAD;
+}
+
+void StubNode::Prepare() {
+  SafeDelete(mPreparedMetadata);
+  mPreparedMetadata = StubAnalyzer::FromText(mSource.GetCurrentValue().c_str());
 }
 
 void StubNode::Operate() {
   /// Regenerate metadata
-  StubMetadata* metadata = StubAnalyzer::FromText(mSource.Get().c_str());
+  StubMetadata* metadata = mPreparedMetadata;
+  mPreparedMetadata = nullptr;
   if (metadata == nullptr) {
     /// Keep old shader. Not strictly correct, but better than deleting everything 
     /// with a typo.
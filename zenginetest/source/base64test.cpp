@@ -0,0 +1,89 @@
+#include "test.h"
+#include <source/serialize/json/base64/base64.h>
+#include <source/serialize/json/base64/base64simd.h>
+#include <cstdio>
+#include <string>
+
+namespace {
+  /// Deterministic bytes covering all values
+  std::vector<unsigned char> MakeBytes(size_t count, UINT seed) {
+    std::vector<unsigned char> bytes(count);
+    UINT state = seed * 2654435761u + 1;
+    for (size_t i = 0; i < count; i++) {
+      state = state * 1664525u + 1013904223u;
+      bytes[i] = static_cast<unsigned char>(state >> 24);
+    }
+    return bytes;
+  }
+
+  std::string Encode(const unsigned char* bytes, size_t count) {
+    std::string text(Base64::GetEncodedSize(count), '\0');
+    if (!text.empty()) Base64::Encode(bytes, count, &text[0]);
+    return text;
+  }
+
+  std::string Decode(const std::string& text) {
+    std::string bytes(Base64::GetDecodedMaxSize(text.size()), '\0');
+    bytes.resize(Base64::Decode(text.data(), text.size(), &bytes[0]));
+    return bytes;
+  }
+}
+
+/// Sizes around the SSE and AVX2 block sizes, at unaligned offsets
+TEST(Base64MatchesReference) {
+  const std::vector<unsigned char> bytes = MakeBytes(1024 + 16, 1);
+  for (size_t offset = 0; offset < 4; offset++) {
+    for (size_t count = 0; count <= 1024; count += (count < 100 ? 1 : 37)) {
+      const unsigned char* data = &bytes[offset];
+      const std::string text = Encode(data, count);
+      CHECK(text == base64_encode(data, UINT(count)));
+      CHECK(Decode(text) == base64_decode(text));
+      CHECK(Decode(text) == std::string(data, data + count));
+    }
+  }
+}
+
+TEST(Base64DecodeStopsLikeReference) {
+  const std::vector<unsigned char> bytes = MakeBytes(200, 2);
+  const std::string text = Encode(&bytes[0], bytes.size());
+  for (size_t position : { size_t(0), size_t(1), size_t(5), size_t(31), size_t(32),
+    size_t(33), size_t(64), size_t(150) })
+  {
+    for (char invalid : { '=', '\n', '-', '\0' }) {
+      std::string corrupt = text;
+      corrupt[position] = invalid;
+      CHECK(Decode(corrupt) == base64_decode(corrupt));
+    }
+  }
+
+  /// Unpadded text
+  const std::string unpadded = text.substr(0, text.find('='));
+  CHECK(Decode(unpadded) == base64_decode(unpadded));
+}
+
+BENCHMARK(Base64Throughput) {
+  const size_t byteCount = 64 << 20;
+  const std::vector<unsigned char> bytes = MakeBytes(byteCount, 3);
+  const double megabytes = double(byteCount) / (1 << 20);
+
+  double start = Test::GetTime();
+  const std::string reference = base64_encode(&bytes[0], UINT(byteCount));
+  const double referenceEncode = Test::GetTime() - start;
+  start = Test::GetTime();
+  const std::string text = Encode(&bytes[0], byteCount);
+  const double encode = Test::GetTime() - start;
+  CHECK(text == reference);
+
+  start = Test::GetTime();
+  const std::string referenceBytes = base64_decode(text);
+  const double referenceDecode = Test::GetTime() - start;
+  start = Test::GetTime();
+  const std::string decoded = Decode(text);
+  const double decode = Test::GetTime() - start;
+  CHECK(decoded == referenceBytes);
+
+  printf("  encode: %.0f MB/s, reference %.0f MB/s\n",
+    megabytes / encode, megabytes / referenceEncode);
+  printf("  decode: %.0f MB/s, reference %.0f MB/s\n",
+    megabytes / decode, megabytes / referenceDecode);
+}
@@ -0,0 +1,225 @@
+#include <Windows.h>
+
+#include "test.h"
+#include <source/serialize/binary/binaryformat.h>
+#include <include/base/system.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace {
+  const int TextureSize = 4;
+  const VertexPos MeshVertices[3] = { {vec3(0, 0, 0)}, {vec3(1, 0, 0)}, {vec3(0, 1, 0)} };
+
+  /// A document with a texture and an indexed mesh
+  std::shared_ptr<Document> MakeDocument(bool gpuMemoryOnly = false) {
+    std::vector<char> texels(TextureSize * TextureSize * 4);
+    for (size_t i = 0; i < texels.size(); i++) texels[i] = char(i * 7);
+    auto textureNode = std::make_shared<StaticTextureNode>();
+    textureNode->Set(OpenGL->MakeTexture(TextureSize, TextureSize, TexelType::ARGB8,
+      &texels[0], gpuMemoryOnly, false, true, true));
+
+    VertexPos vertices[3] = { MeshVertices[0], MeshVertices[1], MeshVertices[2] };
+    const IndexEntry indices[3] = { 0, 1, 2 };
+    auto mesh = std::make_shared<Mesh>();
+    mesh->AllocateVertices(VertexPos::mFormat, 3);
+    mesh->UploadVertices(vertices);
+    mesh->AllocateIndices(3);
+    mesh->UploadIndices(indices);
+    auto meshNode = std::make_shared<StaticMeshNode>();
+    meshNode->Set(mesh);
+
+    auto graph = std::make_shared<Graph>();
+    graph->mNodes.Connect(textureNode);
+    graph->mNodes.Connect(meshNode);
+    auto document = std::make_shared<Document>();
+    document->mGraphs.Connect(graph);
+    return document;
+  }
+
+  /// Mesh of the first static mesh node in the graphs of a document
+  std::shared_ptr<Mesh> FindMesh(const std::shared_ptr<Document>& document) {
+    for (const std::shared_ptr<Node>& graph : document->mGraphs.GetDirectMultiNodes()) {
+      for (const std::shared_ptr<Node>& node :
+        PointerCast<Graph>(graph)->mNodes.GetDirectMultiNodes())
+      {
+        if (IsExactType<StaticMeshNode>(node)) {
+          return PointerCast<StaticMeshNode>(node)->GetMesh();
+        }
+      }
+    }
+    return nullptr;
+  }
+
+  /// Writes the data to a new temporary file, returns its name
+  std::wstring WriteTempFile(const std::vector<char>& data) {
+    wchar_t folder[MAX_PATH];
+    wchar_t fileName[MAX_PATH];
+    GetTempPathW(MAX_PATH, folder);
+    GetTempFileNameW(folder, L"zen", 0, fileName);
+    FILE* file = _wfopen(fileName, L"wb");
+    fwrite(&data[0], 1, data.size(), file);
+    fclose(file);
+    return fileName;
+  }
+
+  /// Returns the data of a blob in a binary document
+  char* GetBlob(std::vector<char>& binary, uint32_t index) {
+    const BinaryHeader* header = reinterpret_cast<const BinaryHeader*>(&binary[0]);
+    const BinaryBlob* blobs =
+      reinterpret_cast<const BinaryBlob*>(&binary[header->mBlobTableOffset]);
+    return &binary[blobs[index].mOffset];
+  }
+
+  /// Finds the first node of a class in a binary document
+  BinaryNode* FindNode(std::vector<char>& binary, const char* className) {
+    const BinaryHeader* header = reinterpret_cast<const BinaryHeader*>(&binary[0]);
+    BinaryNode* nodes = reinterpret_cast<BinaryNode*>(&binary[header->mNodeTableOffset]);
+    for (uint32_t i = 0; i < header->mNodeCount; i++) {
+      if (strncmp(GetBlob(binary, nodes[i].mClassName), className, strlen(className)) == 0) {
+        return &nodes[i];
+      }
+    }
+    return nullptr;
+  }
+}
+
+TEST(BinaryRoundTrip) {
+  std::vector<char> binary = ToBinary(MakeDocument());
+  const std::shared_ptr<Document> document = FromBinary(&binary[0], binary.size());
+  CHECK(document != nullptr);
+}
+
+/// Textures without a CPU copy are read back from the GPU
+TEST(BinarySavesGpuMemoryOnlyTexture) {
+  CHECK(ToBinary(MakeDocument(true)) == ToBinary(MakeDocument()));
+}
+
+TEST(BinaryRejectsShortTexelData) {
+  std::vector<char> binary = ToBinary(MakeDocument());
+  BinaryNode* node = FindNode(binary, "Texture");
+  CHECK(node != nullptr);
+  if (!node) return;
+  node->mParams[BinaryFormat::TextureHeightParam] = TextureSize * 2;
+  CHECK(FromBinary(&binary[0], binary.size()) == nullptr);
+
+  /// Sizes that overflow 32 bits
+  node->mParams[BinaryFormat::TextureWidthParam] = 0x10000;
+  node->mParams[BinaryFormat::TextureHeightParam] = 0x10000;
+  CHECK(FromBinary(&binary[0], binary.size()) == nullptr);
+}
+
+TEST(BinaryRejectsUnknownTexelType) {
+  std::vector<char> binary = ToBinary(MakeDocument());
+  BinaryNode* node = FindNode(binary, "Texture");
+  CHECK(node != nullptr);
+  if (!node) return;
+  node->mParams[BinaryFormat::TextureTypeParam] = 100;
+  CHECK(FromBinary(&binary[0], binary.size()) == nullptr);
+}
+
+TEST(BinaryRejectsUnknownNodeClass) {
+  std::vector<char> binary = ToBinary(MakeDocument());
+  BinaryNode* node = FindNode(binary, "Texture");
+  CHECK(node != nullptr);
+  if (!node) return;
+  GetBlob(binary, node->mClassName)[0] = '?';
+  CHECK(FromBinary(&binary[0], binary.size()) == nullptr);
+}
+
+TEST(BinaryRejectsIndexOutOfRange) {
+  std::vector<char> binary = ToBinary(MakeDocument());
+  BinaryNode* node = FindNode(binary, "Static Mesh");
+  CHECK(node != nullptr);
+  if (!node) return;
+  const uint32_t index = 3;
+  memcpy(GetBlob(binary, node->mBlobs[BinaryFormat::MeshIndicesBlob]), &index, 
+    sizeof(uint32_t));
+  CHECK(FromBinary(&binary[0], binary.size()) == nullptr);
+}
+
+/// The document keeps the mapping alive, meshes use the mapped vertices
+TEST(BinaryMappedLoadOutlivesFile) {
+  const std::wstring fileName = WriteTempFile(ToBinary(MakeDocument()));
+  std::shared_ptr<MappedFile> file = System::MapFile(fileName.c_str());
+  CHECK(file != nullptr);
+  if (!file) return;
+  const char* begin = file->GetData();
+  const char* end = begin + file->GetSize();
+  const std::weak_ptr<MappedFile> weakFile = file;
+  std::shared_ptr<Document> document = FromBinary(file);
+  file.reset();
+  CHECK(document != nullptr);
+  CHECK(!weakFile.expired());
+
+  std::shared_ptr<Mesh> mesh = document ? FindMesh(document) : nullptr;
+  CHECK(mesh != nullptr);
+  if (mesh) {
+    const char* vertices = static_cast<const char*>(mesh->mRawVertexData);
+    CHECK(vertices >= begin && vertices < end);
+    CHECK(mesh->mVertexCount == 3);
+    CHECK(memcmp(vertices, MeshVertices, sizeof(MeshVertices)) == 0);
+    CHECK(mesh->mIndexData == std::vector<IndexEntry>({ 0, 1, 2 }));
+  }
+
+  /// The mesh holds the mapping too, the file stays open
+  document.reset();
+  CHECK(mesh == nullptr || !weakFile.expired());
+  CHECK(mesh == nullptr || !DeleteFileW(fileName.c_str()));
+  mesh.reset();
+  CHECK(weakFile.expired());
+  CHECK(DeleteFileW(fileName.c_str()));
+}
+
+/// Load time and private memory of a document with a large mesh and texture,
+/// mapped and read into memory
+BENCHMARK(BinaryMappedLoad) {
+  const UINT vertexCount = 1 << 20;
+  std::vector<VertexPos> vertices(vertexCount);
+  for (UINT i = 0; i < vertexCount; i++) vertices[i].mPosition = vec3(float(i), 1, 2);
+  std::vector<IndexEntry> indices(vertexCount);
+  for (UINT i = 0; i < vertexCount; i++) indices[i] = i;
+  auto mesh = std::make_shared<Mesh>();
+  mesh->AllocateVertices(VertexPos::mFormat, vertexCount);
+  mesh->UploadVertices(&vertices[0]);
+  mesh->AllocateIndices(vertexCount);
+  mesh->UploadIndices(&indices[0]);
+  auto meshNode = std::make_shared<StaticMeshNode>();
+  meshNode->Set(mesh);
+
+  const int textureSize = 2048;
+  std::vector<char> texels(textureSize * textureSize * 4, 1);
+  auto textureNode = std::make_shared<StaticTextureNode>();
+  textureNode->Set(OpenGL->MakeTexture(textureSize, textureSize, TexelType::ARGB8,
+    &texels[0], false, false, true, true));
+
+  auto graph = std::make_shared<Graph>();
+  graph->mNodes.Connect(meshNode);
+  graph->mNodes.Connect(textureNode);
+  auto document = std::make_shared<Document>();
+  document->mGraphs.Connect(graph);
+  const std::wstring fileName = WriteTempFile(ToBinary(document));
+  document.reset();
+  graph.reset();
+  meshNode.reset();
+  textureNode.reset();
+  mesh.reset();
+
+  for (bool isMapped : { true, false }) {
+    const size_t privateBytes = Test::GetPrivateBytes();
+    const double start = Test::GetTime();
+    std::shared_ptr<Document> loaded;
+    if (isMapped) loaded = FromBinary(System::MapFile(fileName.c_str()));
+    else {
+      size_t size = 0;
+      char* data = System::ReadFile(fileName.c_str(), &size);
+      loaded = FromBinary(data, size);
+      delete[] data;
+    }
+    const double time = Test::GetTime() - start;
+    CHECK(loaded != nullptr);
+    printf("  %s: %.1f ms, %.1f MB private memory held\n", isMapped ? "mapped" : "read",
+      time * 1000.0, double(Test::GetPrivateBytes() - privateBytes) / (1 << 20));
+  }
+  DeleteFileW(fileName.c_str());
+}
@@ -0,0 +1,58 @@
+#include "test.h"
+#include <source/serialize/compression.h>
+#include <cstring>
+
+namespace {
+  std::vector<char> MakeContent(size_t size) {
+    std::vector<char> content(size);
+    for (size_t i = 0; i < size; i++) content[i] = char((i * i) >> 7);
+    return content;
+  }
+
+  /// A single-segment zstd frame with an empty raw block that claims to hold
+  /// contentSize bytes
+  std::vector<char> MakeForgedFrame(unsigned long long contentSize) {
+    std::vector<char> frame(4 + 1 + 8 + 3, 0);
+    const uint32_t magic = 0xFD2FB528;
+    memcpy(&frame[0], &magic, sizeof(magic));
+    /// 8-byte content size, single segment
+    frame[4] = char(0xE0);
+    memcpy(&frame[5], &contentSize, sizeof(contentSize));
+    /// Last block, raw, size 0
+    frame[13] = 1;
+    return frame;
+  }
+}
+
+TEST(CompressionRoundTrip) {
+  ThreadPool threadPool;
+  for (size_t size : { size_t(0), size_t(1), size_t(1000),
+    Compression::FrameSize * 2 + 12345 })
+  {
+    const std::vector<char> content = MakeContent(size);
+    const std::vector<char> compressed =
+      Compression::Compress(content.data(), content.size(), 1, &threadPool);
+    CHECK(Compression::IsCompressed(compressed.data(), compressed.size()));
+    std::vector<char> decompressed;
+    CHECK(Compression::Decompress(compressed.data(), compressed.size(), decompressed,
+      &threadPool));
+    CHECK(decompressed == content);
+  }
+}
+
+TEST(CompressionRejectsTruncatedData) {
+  const std::vector<char> content = MakeContent(100000);
+  const std::vector<char> compressed = Compression::Compress(content.data(), content.size());
+  std::vector<char> decompressed;
+  CHECK(!Compression::Decompress(compressed.data(), compressed.size() - 1, decompressed));
+}
+
+TEST(CompressionRejectsForgedContentSize) {
+  std::vector<char> decompressed;
+  const std::vector<char> lying = MakeForgedFrame(100);
+  CHECK(!Compression::Decompress(lying.data(), lying.size(), decompressed));
+
+  /// Must fail before allocating
+  const std::vector<char> huge = MakeForgedFrame(1ull << 60);
+  CHECK(!Compression::Decompress(huge.data(), huge.size(), decompressed));
+}
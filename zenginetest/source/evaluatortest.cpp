@@ -0,0 +1,113 @@
+#include "test.h"
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
+namespace {
+  const UINT NodeCount = 64;
+
+  /// Nodes reading the same spline, in topological order
+  struct SplineGraph {
+    std::shared_ptr<FloatSplineNode> mSpline;
+    std::vector<std::shared_ptr<MaddNode>> mMadds;
+    std::vector<std::shared_ptr<FloatsToVec3Node>> mVectors;
+
+    SplineGraph() {
+      mSpline = std::make_shared<FloatSplineNode>();
+      mSpline->AddPoint(SplineLayer::BASE, 0.0f, 1.0f);
+      mSpline->AddPoint(SplineLayer::BASE, 4.0f, -3.0f);
+      mSpline->AddPoint(SplineLayer::BASE, 9.0f, 5.0f);
+      for (UINT i = 0; i < NodeCount; i++) {
+        auto madd = std::make_shared<MaddNode>();
+        madd->mA.Connect(mSpline);
+        madd->mB.SetDefaultValue(float(i));
+        auto vector = std::make_shared<FloatsToVec3Node>();
+        vector->mX.Connect(mSpline);
+        vector->mY.Connect(madd);
+        vector->mZ.SetDefaultValue(float(i));
+        mMadds.push_back(madd);
+        mVectors.push_back(vector);
+      }
+    }
+
+    std::vector<std::shared_ptr<Node>> GetNodes(bool includeSpline) const {
+      std::vector<std::shared_ptr<Node>> nodes;
+      if (includeSpline) nodes.push_back(mSpline);
+      nodes.insert(nodes.end(), mMadds.begin(), mMadds.end());
+      nodes.insert(nodes.end(), mVectors.begin(), mVectors.end());
+      return nodes;
+    }
+
+    /// Checks the results without reevaluating anything
+    void Check(float time) const {
+      const float value = mSpline->GetValue(time);
+      for (UINT i = 0; i < NodeCount; i++) {
+        const vec3 expected(value, value * float(i), float(i));
+        CHECK(mVectors[i]->GetCurrentValue() == expected);
+      }
+    }
+  };
+}
+
+TEST(ParallelEvaluationMatchesSerial) {
+  ThreadPool threadPool;
+  ParallelEvaluator evaluator(&threadPool);
+  SplineGraph graph;
+  for (float time : { 0.5f, 3.0f, 7.25f, 12.0f }) {
+    graph.mSpline->mSceneTimeNode->EditTime(time);
+    evaluator.Update(graph.GetNodes(true));
+    graph.Check(time);
+  }
+}
+
+/// The spline is outside of the evaluated nodes, it's evaluated on demand on
+/// the main thread before the workers read it
+TEST(ParallelEvaluationUpdatesInputsOutsideClosure) {
+  ThreadPool threadPool;
+  ParallelEvaluator evaluator(&threadPool);
+  SplineGraph graph;
+  for (float time : { 1.5f, 6.0f }) {
+    graph.mSpline->mSceneTimeNode->EditTime(time);
+    evaluator.Update(graph.GetNodes(false));
+    graph.Check(time);
+  }
+}
+
+/// Independent mesh generators evaluated with 1 to N worker threads. The
+/// resolution stays below the vertex count where a generator splits its own
+/// work across the shared pool, so only the evaluator's workers add threads.
+/// Operate() uploads on the main thread in every case.
+BENCHMARK(ParallelMeshGenerators) {
+  const UINT generatorCount = 256;
+  const int repeatCount = 10;
+  std::vector<std::shared_ptr<Node>> nodes;
+  std::vector<std::shared_ptr<GeosphereMeshNode>> geospheres;
+  for (UINT i = 0; i < generatorCount; i++) {
+    auto geosphere = std::make_shared<GeosphereMeshNode>();
+    geosphere->mResolution.SetDefaultValue(5.0f);
+    geospheres.push_back(geosphere);
+    nodes.push_back(geosphere);
+  }
+
+  const UINT maxWorkerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+  double singleWorkerTime = 0.0;
+  for (UINT workerCount = 1; workerCount <= maxWorkerCount; workerCount++) {
+    ThreadPool threadPool(workerCount);
+    ParallelEvaluator evaluator(&threadPool);
+    double time = 0.0;
+    for (int i = 0; i < repeatCount; i++) {
+      /// Every edit generates the geometry again
+      for (const auto& geosphere : geospheres) {
+        geosphere->mFlatten.SetDefaultValue((i % 2) ? 0.001f : 0.0f);
+      }
+      const double start = Test::GetTime();
+      evaluator.Update(nodes);
+      time += Test::GetTime() - start;
+    }
+    time /= repeatCount;
+    if (workerCount == 1) singleWorkerTime = time;
+    printf("  %u workers: %.2f ms per update, %.2fx\n", workerCount, time * 1000.0,
+      singleWorkerTime / time);
+  }
+  for (const auto& geosphere : geospheres) CHECK(geosphere->GetMesh()->mVertexCount > 0);
+}
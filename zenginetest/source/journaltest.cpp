@@ -0,0 +1,130 @@
+#include "test.h"
+
+namespace {
+  std::shared_ptr<Mesh> MakeMesh(float height) {
+    VertexPos vertices[4] = {
+      {vec3(0, 0, 0)}, {vec3(1, 0, 0)}, {vec3(0, 1, 0)}, {vec3(1, 1, height)} };
+    const IndexEntry indices[6] = { 0, 1, 2, 2, 1, 3 };
+    auto mesh = std::make_shared<Mesh>();
+    mesh->AllocateVertices(VertexPos::mFormat, 4);
+    mesh->UploadVertices(vertices);
+    mesh->AllocateIndices(6);
+    mesh->UploadIndices(indices);
+    return mesh;
+  }
+
+  /// A document with values, a spline and a mesh in one graph
+  struct JournaledDocument {
+    std::shared_ptr<Document> mDocument = std::make_shared<Document>();
+    std::shared_ptr<Graph> mGraph = std::make_shared<Graph>();
+    std::shared_ptr<FloatNode> mFloat = std::make_shared<FloatNode>();
+    std::shared_ptr<Vec3Node> mVector = std::make_shared<Vec3Node>();
+    std::shared_ptr<FloatSplineNode> mSpline = std::make_shared<FloatSplineNode>();
+    std::shared_ptr<StaticMeshNode> mMesh = std::make_shared<StaticMeshNode>();
+
+    JournaledDocument() {
+      mFloat->Set(0.25f);
+      mVector->Set(vec3(1.5f, -2.0f, 1e-3f));
+      mSpline->AddPoint(SplineLayer::BASE, 0.0f, 1.0f);
+      mSpline->AddPoint(SplineLayer::BASE, 4.0f, -3.0f);
+      mMesh->Set(MakeMesh(0.5f));
+      mGraph->mNodes.Connect(mFloat);
+      mGraph->mNodes.Connect(mVector);
+      mGraph->mNodes.Connect(mSpline);
+      mGraph->mNodes.Connect(mMesh);
+      mDocument->mGraphs.Connect(mGraph);
+    }
+
+    /// Snapshot with the journal replayed, saved again after loading
+    std::string Reload(const std::string& snapshot, const std::string& journal) const {
+      const std::string json = DocumentJournal::Compact(
+        snapshot.data(), snapshot.size(), journal.data(), journal.size());
+      CHECK(!json.empty());
+      const std::shared_ptr<Document> document = FromJson(json);
+      CHECK(document != nullptr);
+      return document ? ToJson(document) : std::string();
+    }
+  };
+}
+
+TEST(JournalReplayMatchesDocument) {
+  JournaledDocument document;
+  DocumentJournal journal(document.mDocument);
+  const std::string snapshot = journal.GetSnapshot();
+  CHECK(!journal.HasChanges());
+  CHECK(document.Reload(snapshot, std::string()) == ToJson(document.mDocument));
+
+  /// Changed values, a new node connected to an old one, changed defaults
+  document.mFloat->Set(3.0f);
+  auto madd = std::make_shared<MaddNode>();
+  madd->mA.Connect(document.mFloat);
+  madd->mB.SetDefaultValue(5.0f);
+  document.mGraph->mNodes.Connect(madd);
+  CHECK(journal.HasChanges());
+  std::string records = journal.GetRecords();
+  CHECK(!journal.HasChanges());
+  CHECK(journal.GetRecords().empty());
+
+  /// Removed node, new spline point, new mesh
+  document.mGraph->mNodes.Disconnect(document.mVector);
+  document.mSpline->AddPoint(SplineLayer::BASE, 9.0f, 5.0f);
+  document.mMesh->Set(MakeMesh(-2.0f));
+  records += journal.GetRecords();
+
+  const std::string expected = ToJson(document.mDocument);
+  CHECK(document.Reload(snapshot, records) == expected);
+
+  /// The last line of an interrupted write is skipped
+  CHECK(document.Reload(snapshot, records + "{\"id\": 2, \"node\": \"Fl") == expected);
+}
+
+/// A snapshot that doesn't parse can't be compacted. The next save is then a
+/// complete snapshot, and records written after it replay over it.
+TEST(JournalRestartsAfterFailedCompaction) {
+  JournaledDocument document;
+  DocumentJournal journal(document.mDocument);
+  const std::string snapshot = journal.GetSnapshot();
+  document.mFloat->Set(3.0f);
+  const std::string records = journal.GetRecords();
+  const std::string damaged = snapshot.substr(0, snapshot.size() / 2);
+  CHECK(DocumentJournal::Compact(damaged.data(), damaged.size(),
+    records.data(), records.size()).empty());
+
+  const std::string fullSnapshot = journal.GetSnapshot();
+  document.mSpline->AddPoint(SplineLayer::BASE, 9.0f, 5.0f);
+  document.mGraph->mNodes.Connect(std::make_shared<FloatNode>());
+  CHECK(document.Reload(fullSnapshot, journal.GetRecords()) ==
+    ToJson(document.mDocument));
+}
+
+namespace {
+  UINT CountBlobs(const std::string& json) {
+    UINT count = 0;
+    for (size_t i = json.find("\"base64\""); i != std::string::npos;
+      i = json.find("\"base64\"", i + 1)) count++;
+    return count;
+  }
+}
+
+/// Replaced and removed meshes don't keep their shared blobs in the compacted
+/// file, the records carry the new ones inline
+TEST(JournalCompactionDropsUnusedBlobs) {
+  JournaledDocument document;
+  DocumentJournal journal(document.mDocument);
+  const std::string snapshot = journal.GetSnapshot();
+  CHECK(CountBlobs(snapshot) > 0);
+
+  document.mMesh->Set(MakeMesh(-2.0f));
+  std::string records = journal.GetRecords();
+  std::string json = DocumentJournal::Compact(
+    snapshot.data(), snapshot.size(), records.data(), records.size());
+  CHECK(CountBlobs(json) == CountBlobs(ToJson(document.mDocument)));
+
+  document.mGraph->mNodes.Disconnect(document.mMesh);
+  records += journal.GetRecords();
+  json = DocumentJournal::Compact(
+    snapshot.data(), snapshot.size(), records.data(), records.size());
+  CHECK(!json.empty());
+  CHECK(CountBlobs(json) == 0);
+  CHECK(document.Reload(snapshot, records) == ToJson(document.mDocument));
+}
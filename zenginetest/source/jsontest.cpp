@@ -0,0 +1,381 @@
+#include "test.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+namespace {
+  const int TextureSize = 4;
+
+  std::shared_ptr<Texture> MakeTexture(int texelStep, bool gpuMemoryOnly = false) {
+    std::vector<char> texels(TextureSize * TextureSize * 4);
+    for (size_t i = 0; i < texels.size(); i++) texels[i] = char(i * texelStep);
+    return OpenGL->MakeTexture(TextureSize, TextureSize, TexelType::ARGB8,
+      &texels[0], gpuMemoryOnly, false, true, true);
+  }
+
+  std::shared_ptr<Mesh> MakeMesh(float height) {
+    VertexPos vertices[4] = {
+      {vec3(0, 0, 0)}, {vec3(1, 0, 0)}, {vec3(0, 1, 0)}, {vec3(1, 1, height)} };
+    const IndexEntry indices[6] = { 0, 1, 2, 2, 1, 3 };
+    auto mesh = std::make_shared<Mesh>();
+    mesh->AllocateVertices(VertexPos::mFormat, 4);
+    mesh->UploadVertices(vertices);
+    mesh->AllocateIndices(6);
+    mesh->UploadIndices(indices);
+    return mesh;
+  }
+
+  /// A document with values, a spline, a texture and an indexed mesh
+  std::shared_ptr<Document> MakeDocument(bool gpuMemoryOnly = false) {
+    auto floatNode = std::make_shared<FloatNode>();
+    floatNode->Set(0.25f);
+    auto vectorNode = std::make_shared<Vec3Node>();
+    vectorNode->Set(vec3(1.5f, -2.0f, 1e-3f));
+    auto spline = std::make_shared<FloatSplineNode>();
+    spline->AddPoint(SplineLayer::BASE, 0.0f, 1.0f);
+    spline->AddPoint(SplineLayer::BASE, 4.0f, -3.0f);
+    spline->AddPoint(SplineLayer::NOISE, 2.0f, 0.5f);
+
+    auto textureNode = std::make_shared<StaticTextureNode>();
+    textureNode->Set(MakeTexture(7, gpuMemoryOnly));
+    auto meshNode = std::make_shared<StaticMeshNode>();
+    meshNode->Set(MakeMesh(0.5f));
+
+    auto graph = std::make_shared<Graph>();
+    graph->mNodes.Connect(floatNode);
+    graph->mNodes.Connect(vectorNode);
+    graph->mNodes.Connect(spline);
+    graph->mNodes.Connect(textureNode);
+    graph->mNodes.Connect(meshNode);
+    auto document = std::make_shared<Document>();
+    document->mGraphs.Connect(graph);
+    return document;
+  }
+
+  /// Replaces the value after the first occurrence of a key
+  std::string ReplaceValue(const std::string& json, const char* key, const char* value) {
+    const size_t keyPosition = json.find(key);
+    if (keyPosition == std::string::npos) return json;
+    const size_t begin = json.find_first_not_of(": ", keyPosition + strlen(key));
+    const size_t end = json.find_first_of(",\r\n}", begin);
+    return json.substr(0, begin) + value + json.substr(end);
+  }
+
+  /// Finds the first node of a class in the graphs of a document
+  template<typename T>
+  std::shared_ptr<T> FindNode(const std::shared_ptr<Document>& document) {
+    for (const std::shared_ptr<Node>& graph : document->mGraphs.GetDirectMultiNodes()) {
+      for (const std::shared_ptr<Node>& node :
+        PointerCast<Graph>(graph)->mNodes.GetDirectMultiNodes())
+      {
+        if (IsExactType<T>(node)) return PointerCast<T>(node);
+      }
+    }
+    return nullptr;
+  }
+
+  std::shared_ptr<Document> LoadStream(const std::string& json) {
+    return FromJsonStream(json.data(), json.size());
+  }
+}
+
+TEST(JsonStreamMatchesDom) {
+  const std::shared_ptr<Document> document = MakeDocument();
+  for (MeshArrayEncoding encoding : { MeshArrayEncoding::NUMBERS,
+    MeshArrayEncoding::BINARY, MeshArrayEncoding::QUANTIZED })
+  {
+    for (BlobCompression compression : { BlobCompression::NONE, BlobCompression::ZSTD }) {
+      const std::string json = ToJson(document, encoding, compression);
+      const std::shared_ptr<Document> domDocument = FromJson(json);
+      const std::shared_ptr<Document> streamDocument = LoadStream(json);
+      CHECK(domDocument != nullptr);
+      CHECK(streamDocument != nullptr);
+      if (!domDocument || !streamDocument) continue;
+      CHECK(ToJson(domDocument, encoding, compression) ==
+        ToJson(streamDocument, encoding, compression));
+
+      ThreadPool threadPool;
+      const std::shared_ptr<Document> parallelDocument =
+        FromJsonStream(json.data(), json.size(), &threadPool);
+      CHECK(parallelDocument != nullptr);
+      if (!parallelDocument) continue;
+      CHECK(ToJson(domDocument, encoding, compression) ==
+        ToJson(parallelDocument, encoding, compression));
+    }
+  }
+}
+
+/// Textures without a CPU copy are read back from the GPU
+TEST(JsonSavesGpuMemoryOnlyTexture) {
+  CHECK(ToJson(MakeDocument(true)) == ToJson(MakeDocument()));
+}
+
+TEST(JsonStreamRejectsUnknownTexelType) {
+  const std::string json = ToJson(MakeDocument());
+  CHECK(LoadStream(json) != nullptr);
+  CHECK(LoadStream(ReplaceValue(json, "\"type\"", "\"RGBA9\"")) == nullptr);
+}
+
+TEST(JsonStreamRejectsShortTexelData) {
+  const std::string json = ToJson(MakeDocument());
+  CHECK(LoadStream(ReplaceValue(json, "\"height\"", "8")) == nullptr);
+  CHECK(LoadStream(ReplaceValue(json, "\"height\"", "0")) == nullptr);
+}
+
+TEST(JsonStreamRejectsUnknownCompression) {
+  const std::string json =
+    ToJson(MakeDocument(), MeshArrayEncoding::BINARY, BlobCompression::ZSTD);
+  CHECK(LoadStream(json) != nullptr);
+  CHECK(LoadStream(ReplaceValue(json, "\"compression\"", "\"lz77\"")) == nullptr);
+}
+
+TEST(JsonStreamRejectsMeshSizeMismatch) {
+  for (MeshArrayEncoding encoding :
+    { MeshArrayEncoding::NUMBERS, MeshArrayEncoding::BINARY })
+  {
+    const std::string json = ToJson(MakeDocument(), encoding);
+    CHECK(LoadStream(ReplaceValue(json, "\"vertexcount\"", "5")) == nullptr);
+    CHECK(LoadStream(ReplaceValue(json, "\"indexcount\"", "9")) == nullptr);
+  }
+}
+
+TEST(JsonStreamRejectsIndexOutOfRange) {
+  const std::string json = ToJson(MakeDocument(), MeshArrayEncoding::NUMBERS);
+  const size_t indices = json.find("\"indices\"");
+  CHECK(indices != std::string::npos);
+  if (indices == std::string::npos) return;
+  const size_t first = json.find_first_of("0123456789", indices);
+  std::string corrupt = json;
+  corrupt.replace(first, 1, "7");
+  CHECK(LoadStream(corrupt) == nullptr);
+}
+
+namespace {
+  /// Points the first blob reference after a key to a blob that doesn't exist
+  std::string BreakBlobAfter(const std::string& json, const char* key) {
+    const size_t keyPosition = json.find(key);
+    if (keyPosition == std::string::npos) return json;
+    return json.substr(0, keyPosition) +
+      ReplaceValue(json.substr(keyPosition), "\"blob\"", "\"missing\"");
+  }
+}
+
+/// Both loaders fail on corrupt textures. Short texel data would be read past
+/// its end when the texture is made.
+TEST(JsonRejectsCorruptTexture) {
+  const std::string json = ToJson(MakeDocument());
+  CHECK(FromJson(json) != nullptr);
+  for (const std::string& corrupt : {
+    ReplaceValue(json, "\"type\"", "\"RGBA9\""),
+    ReplaceValue(json, "\"height\"", "8"),
+    ReplaceValue(json, "\"height\"", "0"),
+    BreakBlobAfter(json, "\"width\"") })
+  {
+    CHECK(corrupt != json);
+    CHECK(FromJson(corrupt) == nullptr);
+    CHECK(LoadStream(corrupt) == nullptr);
+  }
+}
+
+/// Both loaders fail on corrupt meshes instead of leaving a node without one
+TEST(JsonRejectsCorruptMesh) {
+  const std::string numbers = ToJson(MakeDocument(), MeshArrayEncoding::NUMBERS);
+  const std::string binary = ToJson(MakeDocument(), MeshArrayEncoding::BINARY);
+  CHECK(FromJson(numbers) != nullptr);
+  CHECK(FromJson(binary) != nullptr);
+
+  std::string outOfRange = numbers;
+  const size_t indices = outOfRange.find("\"indices\"");
+  CHECK(indices != std::string::npos);
+  if (indices == std::string::npos) return;
+  outOfRange.replace(outOfRange.find_first_of("0123456789", indices), 1, "7");
+
+  for (const std::string& json : {
+    ReplaceValue(numbers, "\"vertexcount\"", "5"),
+    ReplaceValue(numbers, "\"indexcount\"", "9"),
+    ReplaceValue(binary, "\"vertexcount\"", "5"),
+    ReplaceValue(binary, "\"indexcount\"", "9"),
+    BreakBlobAfter(binary, "\"vertices\""),
+    BreakBlobAfter(binary, "\"indices\""),
+    outOfRange })
+  {
+    CHECK(json != numbers && json != binary);
+    CHECK(FromJson(json) == nullptr);
+    CHECK(LoadStream(json) == nullptr);
+  }
+}
+
+/// Textures with equal texels refer to one blob, different ones to their own
+TEST(JsonStoresEqualBlobsOnce) {
+  auto graph = std::make_shared<Graph>();
+  for (int texelStep : { 7, 3, 7 }) {
+    auto textureNode = std::make_shared<StaticTextureNode>();
+    textureNode->Set(MakeTexture(texelStep));
+    graph->mNodes.Connect(textureNode);
+  }
+  auto document = std::make_shared<Document>();
+  document->mGraphs.Connect(graph);
+
+  const std::string json = ToJson(document);
+  int blobCount = 0;
+  int referenceCount = 0;
+  for (size_t i = json.find("\"base64\""); i != std::string::npos;
+    i = json.find("\"base64\"", i + 1)) blobCount++;
+  for (size_t i = json.find("\"blob\""); i != std::string::npos;
+    i = json.find("\"blob\"", i + 1)) referenceCount++;
+  CHECK(blobCount == 2);
+  CHECK(referenceCount == 3);
+
+  const std::shared_ptr<Document> loaded = FromJson(json);
+  CHECK(loaded != nullptr);
+  if (loaded) CHECK(ToJson(loaded) == json);
+}
+
+/// The snapshot is written on another thread after the document changed, it
+/// must still be the same as a synchronous save at the time of the capture
+TEST(JsonCaptureMatchesSynchronousSave) {
+  for (MeshArrayEncoding encoding : { MeshArrayEncoding::NUMBERS,
+    MeshArrayEncoding::BINARY, MeshArrayEncoding::QUANTIZED })
+  {
+    const std::shared_ptr<Document> document = MakeDocument();
+    const std::string expected = ToJson(document, encoding);
+    std::shared_ptr<JSONCapture> capture;
+    {
+      DocumentJournal journal(document, encoding);
+      capture = journal.CaptureSnapshot();
+    }
+
+    const std::shared_ptr<FloatNode> floatNode = FindNode<FloatNode>(document);
+    const std::shared_ptr<FloatSplineNode> spline = FindNode<FloatSplineNode>(document);
+    const std::shared_ptr<StaticTextureNode> textureNode =
+      FindNode<StaticTextureNode>(document);
+    const std::shared_ptr<StaticMeshNode> meshNode = FindNode<StaticMeshNode>(document);
+    CHECK(floatNode && spline && textureNode && meshNode);
+    if (!floatNode || !spline || !textureNode || !meshNode) continue;
+    floatNode->Set(-8.0f);
+    spline->AddPoint(SplineLayer::BASE, 6.0f, 2.0f);
+    textureNode->Set(MakeTexture(3));
+    meshNode->Set(MakeMesh(-2.0f));
+    auto graph = PointerCast<Graph>(document->mGraphs.GetDirectMultiNodes()[0]);
+    graph->mNodes.Connect(std::make_shared<Vec4Node>());
+    CHECK(ToJson(document, encoding) != expected);
+
+    std::string json;
+    std::thread thread([&]() { json = capture->GetJSON(); });
+    thread.join();
+    CHECK(json == expected);
+
+    /// Released on the main thread, it may hold the last mesh reference
+    capture.reset();
+  }
+}
+
+/// Load time of a document with many embedded assets, decoded on the loading
+/// thread and on a thread pool
+BENCHMARK(JsonParallelDecode) {
+  const int assetCount = 16;
+  const int textureSize = 512;
+  const UINT vertexCount = 1 << 16;
+  auto graph = std::make_shared<Graph>();
+  for (int a = 0; a < assetCount; a++) {
+    std::vector<char> texels(textureSize * textureSize * 4);
+    for (size_t i = 0; i < texels.size(); i++) texels[i] = char((i * (a + 3)) >> 4);
+    auto textureNode = std::make_shared<StaticTextureNode>();
+    textureNode->Set(OpenGL->MakeTexture(textureSize, textureSize, TexelType::ARGB8,
+      &texels[0], false, false, true, true));
+    graph->mNodes.Connect(textureNode);
+
+    std::vector<VertexPos> vertices(vertexCount);
+    std::vector<IndexEntry> indices(vertexCount);
+    for (UINT i = 0; i < vertexCount; i++) {
+      vertices[i].mPosition = vec3(float(i % 256), float(i / 256), float(a));
+      indices[i] = i;
+    }
+    auto mesh = std::make_shared<Mesh>();
+    mesh->AllocateVertices(VertexPos::mFormat, vertexCount);
+    mesh->UploadVertices(&vertices[0]);
+    mesh->AllocateIndices(vertexCount);
+    mesh->UploadIndices(&indices[0]);
+    auto meshNode = std::make_shared<StaticMeshNode>();
+    meshNode->Set(mesh);
+    graph->mNodes.Connect(meshNode);
+  }
+  auto document = std::make_shared<Document>();
+  document->mGraphs.Connect(graph);
+
+  ThreadPool threadPool;
+  for (BlobCompression compression : { BlobCompression::NONE, BlobCompression::ZSTD }) {
+    const std::string json = ToJson(document, MeshArrayEncoding::BINARY, compression);
+    double start = Test::GetTime();
+    const std::shared_ptr<Document> serial = FromJsonStream(json.data(), json.size());
+    const double serialTime = Test::GetTime() - start;
+    start = Test::GetTime();
+    const std::shared_ptr<Document> parallel =
+      FromJsonStream(json.data(), json.size(), &threadPool);
+    const double parallelTime = Test::GetTime() - start;
+    CHECK(serial != nullptr && parallel != nullptr);
+
+    printf("  %s, %.1f MB: %.1f ms with %u workers, %.1f ms on one thread\n",
+      compression == BlobCompression::ZSTD ? "zstd" : "uncompressed",
+      double(json.size()) / (1 << 20), parallelTime * 1000.0,
+      threadPool.GetWorkerCount(), serialTime * 1000.0);
+  }
+}
+
+/// Load time and peak private memory of a document of about 200 MB, with the
+/// DOM loader and the streaming one. The peak is sampled on another thread.
+BENCHMARK(JsonLargeDocumentMemory) {
+  const UINT meshCount = 10;
+  const UINT vertexCount = 1 << 20;
+  auto graph = std::make_shared<Graph>();
+  for (UINT m = 0; m < meshCount; m++) {
+    /// Distinct content, shared blobs would shrink the document
+    std::vector<VertexPos> vertices(vertexCount);
+    std::vector<IndexEntry> indices(vertexCount);
+    for (UINT i = 0; i < vertexCount; i++) {
+      vertices[i].mPosition = vec3(float(i), float(m), 1.0f);
+      indices[i] = (i + m) % vertexCount;
+    }
+    auto mesh = std::make_shared<Mesh>();
+    mesh->AllocateVertices(VertexPos::mFormat, vertexCount);
+    mesh->UploadVertices(&vertices[0]);
+    mesh->AllocateIndices(vertexCount);
+    mesh->UploadIndices(&indices[0]);
+    auto meshNode = std::make_shared<StaticMeshNode>();
+    meshNode->Set(mesh);
+    graph->mNodes.Connect(meshNode);
+  }
+  auto document = std::make_shared<Document>();
+  document->mGraphs.Connect(graph);
+  const std::string json = ToJson(document);
+  document.reset();
+  graph.reset();
+  printf("  document: %.1f MB\n", double(json.size()) / (1 << 20));
+
+  for (bool isStream : { false, true }) {
+    const size_t privateBytes = Test::GetPrivateBytes();
+    size_t peakBytes = privateBytes;
+    std::atomic<bool> isLoading(true);
+    std::thread sampler([&]() {
+      while (isLoading) {
+        peakBytes = std::max(peakBytes, Test::GetPrivateBytes());
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    });
+    const double start = Test::GetTime();
+    std::shared_ptr<Document> loaded = isStream ? LoadStream(json) : FromJson(json);
+    const double time = Test::GetTime() - start;
+    isLoading = false;
+    sampler.join();
+    const size_t heldBytes = Test::GetPrivateBytes();
+    peakBytes = std::max(peakBytes, heldBytes);
+    CHECK(loaded != nullptr);
+    printf("  %s: %.1f ms, %.1f MB peak private memory, %.1f MB held\n",
+      isStream ? "FromJsonStream" : "FromJson", time * 1000.0,
+      double(peakBytes - privateBytes) / (1 << 20),
+      double(heldBytes - privateBytes) / (1 << 20));
+  }
+}
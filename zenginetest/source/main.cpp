@@ -0,0 +1,62 @@
+#include <Windows.h>
+
+#define GLEW_STATIC
+#include <glew/glew.h>
+#include <gl/GL.h>
+
+#include "test.h"
+#include <cstdio>
+#include <cstring>
+
+/// Node classes are registered by static objects of the engine library, the
+/// linker only keeps them if they are referenced
+void ForceNodeRegistration() {
+#define FORCE(a) a force_##a;
+  FORCE(Document);
+  FORCE(Graph);
+  FORCE(StubNode);
+  FORCE(FloatsToVec3Node);
+  FORCE(FloatsToVec4Node);
+  FORCE(FloatToFloatNode);
+  FORCE(MaddNode);
+  FORCE(FloatSplineNode);
+  FORCE(StaticMeshNode);
+  FORCE(StaticTextureNode);
+  FORCE(GeosphereMeshNode);
+  FORCE(PlaneMeshNode);
+  FORCE(PolarSphereMeshNode);
+  FORCE(OptimizeMeshNode);
+}
+
+static PIXELFORMATDESCRIPTOR pfd = {
+  sizeof(PIXELFORMATDESCRIPTOR),
+  1, PFD_DRAW_TO_WINDOW | PFD_SUPPORT_OPENGL | PFD_DOUBLEBUFFER,
+  PFD_TYPE_RGBA, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  32, 0, 0, PFD_MAIN_PLANE, 0, 0, 0, 0, 0
+};
+
+void Log(LogMessage message) {
+  if (message.severity == LOG_INFO) return;
+  wprintf(L"  %s\n", message.message);
+}
+
+/// Runs the tests, "--benchmark" runs the benchmarks too. The exit code is
+/// nonzero if a test failed.
+int main(int argc, char** argv) {
+  TheLogger->onLog += Log;
+
+  /// Meshes and textures need an OpenGL context, a hidden window provides it
+  const HWND hwnd = CreateWindowW(L"static", nullptr, WS_POPUP, 0, 0, 64, 64,
+    nullptr, nullptr, nullptr, nullptr);
+  const HDC hdc = GetDC(hwnd);  // NOLINT(misc-misplaced-const)
+  SetPixelFormat(hdc, ChoosePixelFormat(hdc, &pfd), &pfd);
+  wglMakeCurrent(hdc, wglCreateContext(hdc));
+  InitZengine();
+
+  const bool runBenchmarks = argc >= 2 && strcmp(argv[1], "--benchmark") == 0;
+  const int failedCount = Test::RunAll(runBenchmarks);
+
+  CloseZengine();
+  DestroyWindow(hwnd);
+  return failedCount > 0 ? 1 : 0;
+}
@@ -0,0 +1,344 @@
+#include "test.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+
+namespace {
+  const float Epsilon = 1e-5f;
+
+  /// The scalar geosphere generator the SSE2 version replaced, one face
+  void MakeReferenceFace(const vec3& p1, const vec3& p2, const vec3& p3, float flatten,
+    float size, int resolution, std::vector<VertexPosUvNormTangent>& oVertices,
+    std::vector<IndexEntry>& oIndices)
+  {
+    const int baseIndex = int(oVertices.size());
+    const vec3 d1 = p2 - p1;
+    const vec3 d2 = p3 - p1;
+    const vec3 flatNormal = normalize(cross(d2, d1));
+    const vec3 upVector(0, 1, 0);
+    const int maxCoord = 1 << resolution;
+    const float vRecip = 1.0f / float(maxCoord);
+    for (int y = 0; y <= maxCoord; y++) {
+      const float yr = float(y) * vRecip;
+      for (int x = 0; x <= maxCoord - y; x++) {
+        const float xr = float(x) * vRecip;
+        const vec3 p = p1 + d1 * xr + d2 * yr;
+        const vec3 spherical = normalize(p);
+        VertexPosUvNormTangent vertex;
+        vertex.mPosition = (spherical + (p - spherical) * flatten) * size;
+        vertex.mNormal = spherical + (flatNormal - spherical) * flatten;
+        vertex.mTangent = normalize(cross(upVector, vertex.mNormal));
+        const float urad = atan2f(spherical.x, spherical.z);
+        const float xz = sqrtf(spherical.x * spherical.x + spherical.z * spherical.z);
+        const float vrad = atan2f(xz, spherical.y);
+        vertex.mUv = vec2((urad / Pi) * 0.5f + 0.5f, vrad / Pi + 0.5f);
+        oVertices.push_back(vertex);
+      }
+    }
+
+    const int ox[4] = { 0, 0, 1, 1 };
+    const int oy[4] = { 0, 1, 1, 0 };
+    const int dir[4] = { 1, 1, -1, 1 };
+    const int trianglesPerSide = 1 << (resolution * 2);
+    const int verticesPerSide = (maxCoord + 1) * (maxCoord + 2) / 2;
+    for (int i = 0; i < trianglesPerSide; i++) {
+      int k = i;
+      int x[3] = { 0, 1, 0 };
+      int y[3] = { 0, 0, 1 };
+      int step = 1;
+      while (k > 0) {
+        const int sel = k & 3;
+        for (int c = 0; c < 3; c++) {
+          x[c] = x[c] * dir[sel] + step * ox[sel];
+          y[c] = y[c] * dir[sel] + step * oy[sel];
+        }
+        step <<= 1;
+        k >>= 2;
+      }
+      for (int c = 0; c < 3; c++) {
+        oIndices.push_back(baseIndex + x[c] + verticesPerSide -
+          ((maxCoord - y[c] + 1) * (maxCoord - y[c] + 2) / 2));
+      }
+    }
+  }
+
+  void MakeReferenceGeosphere(float flatten, float size, int resolution,
+    std::vector<VertexPosUvNormTangent>& oVertices, std::vector<IndexEntry>& oIndices)
+  {
+    const float p = 1.0f / sqrtf(3.0f);
+    const vec3 tv[] = {
+      vec3(1, 1, 1) * p, vec3(1, -1, -1) * p, vec3(-1, 1, -1) * p, vec3(-1, -1, 1) * p,
+    };
+    oVertices.clear();
+    oIndices.clear();
+    MakeReferenceFace(tv[0], tv[2], tv[1], flatten, size, resolution, oVertices, oIndices);
+    MakeReferenceFace(tv[0], tv[3], tv[2], flatten, size, resolution, oVertices, oIndices);
+    MakeReferenceFace(tv[0], tv[1], tv[3], flatten, size, resolution, oVertices, oIndices);
+    MakeReferenceFace(tv[1], tv[2], tv[3], flatten, size, resolution, oVertices, oIndices);
+  }
+
+  /// Tangents at the poles are NaN in both versions
+  bool IsNear(float a, float b) {
+    return (std::isnan(a) && std::isnan(b)) || fabsf(a - b) <= Epsilon;
+  }
+
+  bool IsNear(const vec3& a, const vec3& b) {
+    return IsNear(a.x, b.x) && IsNear(a.y, b.y) && IsNear(a.z, b.z);
+  }
+
+  std::shared_ptr<GeosphereMeshNode> MakeGeosphere(int resolution, float flatten,
+    float size)
+  {
+    auto node = std::make_shared<GeosphereMeshNode>();
+    node->mResolution.SetDefaultValue(float(resolution));
+    node->mFlatten.SetDefaultValue(flatten);
+    node->mSize.SetDefaultValue(size);
+    node->Update();
+    return node;
+  }
+}
+
+TEST(GeosphereMatchesReference) {
+  std::vector<VertexPosUvNormTangent> vertices;
+  std::vector<IndexEntry> indices;
+  for (int resolution = 0; resolution <= 6; resolution++) {
+    for (float flatten : { 0.0f, 0.5f }) {
+      const float size = 2.0f;
+      MakeReferenceGeosphere(flatten, size, resolution, vertices, indices);
+      const std::shared_ptr<Mesh> mesh =
+        MakeGeosphere(resolution, flatten, size)->GetMesh();
+      CHECK(mesh->mVertexCount == vertices.size());
+      CHECK(mesh->mIndexData == indices);
+      if (mesh->mVertexCount != vertices.size()) continue;
+
+      const VertexPosUvNormTangent* generated =
+        static_cast<const VertexPosUvNormTangent*>(mesh->mRawVertexData);
+      UINT mismatchCount = 0;
+      for (UINT i = 0; i < mesh->mVertexCount; i++) {
+        const VertexPosUvNormTangent& a = generated[i];
+        const VertexPosUvNormTangent& b = vertices[i];
+        if (!IsNear(a.mPosition, b.mPosition) || !IsNear(a.mNormal, b.mNormal) ||
+          !IsNear(a.mTangent, b.mTangent) || !IsNear(a.mUv.x, b.mUv.x) ||
+          !IsNear(a.mUv.y, b.mUv.y)) mismatchCount++;
+      }
+      CHECK(mismatchCount == 0);
+    }
+  }
+}
+
+BENCHMARK(GeosphereGeneration) {
+  std::vector<VertexPosUvNormTangent> vertices;
+  std::vector<IndexEntry> indices;
+  for (int resolution = 4; resolution <= 8; resolution++) {
+    const int repeatCount = 1 << (2 * (8 - resolution));
+    double start = Test::GetTime();
+    for (int i = 0; i < repeatCount; i++) {
+      MakeReferenceGeosphere(0.0f, 1.0f, resolution, vertices, indices);
+    }
+    const double reference = (Test::GetTime() - start) / repeatCount;
+
+    start = Test::GetTime();
+    for (int i = 0; i < repeatCount; i++) MakeGeosphere(resolution, 0.0f, 1.0f);
+    const double generated = (Test::GetTime() - start) / repeatCount;
+
+    printf("  resolution %d: %.3f ms, scalar reference %.3f ms\n", resolution,
+      generated * 1000.0, reference * 1000.0);
+  }
+}
+
+/// Size-only edits rescale into the same mesh and buffers. A mesh that is also
+/// held by someone else is replaced instead, and keeps its content.
+TEST(GeneratorSizeChangeKeepsMesh) {
+  const auto node = MakeGeosphere(4, 0.0f, 1.0f);
+  const Mesh* mesh = node->GetMesh().get();
+  const void* rawVertexData = mesh->mRawVertexData;
+  const int vertexBufferSize = mesh->mVertexBuffer->GetByteSize();
+  const int indexBufferSize = mesh->mIndexBuffer->GetByteSize();
+  const VertexPosUvNormTangent* vertices =
+    static_cast<const VertexPosUvNormTangent*>(rawVertexData);
+  std::vector<vec3> positions;
+  for (UINT i = 0; i < mesh->mVertexCount; i++) positions.push_back(vertices[i].mPosition);
+
+  node->mSize.SetDefaultValue(3.0f);
+  node->Update();
+  CHECK(node->GetMesh().get() == mesh);
+  CHECK(mesh->mRawVertexData == rawVertexData);
+  CHECK(mesh->mVertexBuffer->GetByteSize() == vertexBufferSize);
+  CHECK(mesh->mIndexBuffer->GetByteSize() == indexBufferSize);
+  CHECK(mesh->mVertexCount == UINT(positions.size()));
+  UINT mismatchCount = 0;
+  for (UINT i = 0; i < UINT(positions.size()); i++) {
+    if (!IsNear(vertices[i].mPosition, positions[i] * 3.0f)) mismatchCount++;
+  }
+  CHECK(mismatchCount == 0);
+
+  const std::shared_ptr<Mesh> snapshot = node->GetMesh();
+  node->mSize.SetDefaultValue(5.0f);
+  node->Update();
+  CHECK(node->GetMesh() != snapshot);
+  CHECK(node->GetMesh()->mVertexCount == snapshot->mVertexCount);
+  CHECK(IsNear(static_cast<const VertexPosUvNormTangent*>(
+    snapshot->mRawVertexData)[1].mPosition, positions[1] * 3.0f));
+}
+
+namespace {
+  /// Scrubs the size of a generator, prints the allocations and time per edit
+  template<typename T>
+  void ScrubSize(const char* name, const std::shared_ptr<T>& node) {
+    const int editCount = 100;
+    node->Update();
+    const size_t allocationCount = Test::GetAllocationCount();
+    const double start = Test::GetTime();
+    for (int i = 0; i < editCount; i++) {
+      node->mSize.SetDefaultValue(1.0f + float(i) * 0.01f);
+      node->Update();
+    }
+    const double time = (Test::GetTime() - start) / editCount;
+    printf("  %s: %.1f allocations, %.3f ms per size edit\n", name,
+      double(Test::GetAllocationCount() - allocationCount) / editCount, time * 1000.0);
+  }
+}
+
+/// Size edits while scrubbing, compared with edits that generate the geometry
+/// again, which is what every edit did before
+BENCHMARK(GeneratorSizeScrubbing) {
+  for (int resolution : { 5, 8 }) {
+    const auto geosphere = MakeGeosphere(resolution, 0.0f, 1.0f);
+    const std::string name = "geosphere resolution " + std::to_string(resolution);
+    ScrubSize(name.c_str(), geosphere);
+
+    const int editCount = 20;
+    const size_t allocationCount = Test::GetAllocationCount();
+    const double start = Test::GetTime();
+    for (int i = 0; i < editCount; i++) {
+      geosphere->mFlatten.SetDefaultValue((i % 2) ? 0.001f : 0.0f);
+      geosphere->Update();
+    }
+    const double time = (Test::GetTime() - start) / editCount;
+    printf("  %s: %.1f allocations, %.3f ms per regenerating edit\n", name.c_str(),
+      double(Test::GetAllocationCount() - allocationCount) / editCount, time * 1000.0);
+  }
+
+  auto plane = std::make_shared<PlaneMeshNode>();
+  plane->mResolution.SetDefaultValue(6.0f);
+  ScrubSize("plane resolution 6", plane);
+  ScrubSize("polar sphere", std::make_shared<PolarSphereMeshNode>());
+}
+
+/// Index buffers hold 16-bit indices while every vertex can be addressed with
+/// them. mIndexData keeps the full indices either way.
+TEST(MeshIndexWidth) {
+  for (UINT vertexCount : { 3u, 65536u, 65537u, 200000u }) {
+    std::vector<VertexPos> vertices(vertexCount);
+    const IndexEntry indices[3] =
+      { 0, IndexEntry(vertexCount / 2), IndexEntry(vertexCount - 1) };
+    Mesh mesh;
+    mesh.AllocateVertices(VertexPos::mFormat, vertexCount);
+    mesh.UploadVertices(&vertices[0]);
+    mesh.AllocateIndices(3);
+    mesh.UploadIndices(indices);
+    const bool isShort = vertexCount <= 0x10000;
+    CHECK(mesh.mHasShortIndices == isShort);
+    CHECK(mesh.mIndexBuffer->GetByteSize() ==
+      int(3 * (isShort ? sizeof(uint16_t) : sizeof(IndexEntry))));
+    CHECK(mesh.mIndexData == std::vector<IndexEntry>(indices, indices + 3));
+
+    /// The width follows the indices of the last upload
+    const IndexEntry firstIndices[3] = { 0, 1, 2 };
+    mesh.UploadIndices(firstIndices);
+    CHECK(mesh.mHasShortIndices);
+    CHECK(mesh.mIndexBuffer->GetByteSize() == int(3 * sizeof(uint16_t)));
+  }
+
+  /// 33540 and 132612 vertices
+  for (int resolution : { 7, 8 }) {
+    const std::shared_ptr<Mesh> mesh = MakeGeosphere(resolution, 0.0f, 1.0f)->GetMesh();
+    const bool isShort = mesh->mVertexCount <= 0x10000;
+    CHECK(isShort == (resolution == 7));
+    CHECK(mesh->mHasShortIndices == isShort);
+    CHECK(mesh->mIndexBuffer->GetByteSize() ==
+      int(mesh->mIndexCount * (isShort ? sizeof(uint16_t) : sizeof(IndexEntry))));
+  }
+}
+
+/// Welded geospheres share the vertices on the tetrahedron edges. Only the
+/// vertices of triangles wrapping around the texture seam are split.
+TEST(GeosphereWelding) {
+  std::vector<VertexPosUvNormTangent> vertices;
+  std::vector<IndexEntry> indices;
+  for (int resolution = 0; resolution <= 6; resolution++) {
+    const int maxCoord = 1 << resolution;
+    const UINT sharedCount = UINT(2 * maxCoord * maxCoord + 2);
+    MakeReferenceGeosphere(0.0f, 1.0f, resolution, vertices, indices);
+    const auto node = MakeGeosphere(resolution, 0.0f, 1.0f);
+    node->mWelded.SetDefaultValue(1.0f);
+    node->Update();
+    const std::shared_ptr<Mesh> mesh = node->GetMesh();
+    CHECK(mesh->mVertexCount >= sharedCount);
+    CHECK(mesh->mVertexCount < vertices.size());
+    CHECK(mesh->mIndexCount == indices.size());
+    if (mesh->mVertexCount < sharedCount || mesh->mIndexCount != indices.size()) continue;
+    const VertexPosUvNormTangent* welded =
+      static_cast<const VertexPosUvNormTangent*>(mesh->mRawVertexData);
+
+    /// Same triangles as the unwelded geosphere. Away from the poles, where u
+    /// is arbitrary, no welded triangle spans more than half of the texture.
+    UINT mismatchCount = 0;
+    UINT wrappingCount = 0;
+    UINT referenceWrappingCount = 0;
+    for (size_t i = 0; i < indices.size(); i += 3) {
+      float minU = 2.0f, maxU = -2.0f;
+      float referenceMinU = 2.0f, referenceMaxU = -2.0f;
+      for (size_t o = i; o < i + 3; o++) {
+        const VertexPosUvNormTangent& vertex = welded[mesh->mIndexData[o]];
+        const VertexPosUvNormTangent& reference = vertices[indices[o]];
+        if (!IsNear(vertex.mPosition, reference.mPosition)) mismatchCount++;
+        if (IsNear(fabsf(vertex.mPosition.y), 1.0f)) continue;
+        minU = std::min(minU, vertex.mUv.x);
+        maxU = std::max(maxU, vertex.mUv.x);
+        referenceMinU = std::min(referenceMinU, reference.mUv.x);
+        referenceMaxU = std::max(referenceMaxU, reference.mUv.x);
+      }
+      if (maxU - minU > 0.5f) wrappingCount++;
+      if (referenceMaxU - referenceMinU > 0.5f) referenceWrappingCount++;
+    }
+    CHECK(mismatchCount == 0);
+
+    /// Low resolutions have triangles spanning half of the texture anyway
+    if (resolution >= 3) {
+      CHECK(referenceWrappingCount > 0);
+      CHECK(wrappingCount == 0);
+    }
+
+    /// The vertices after the shared ones are seam copies, moved by one in u
+    UINT orphanCount = 0;
+    for (UINT i = sharedCount; i < mesh->mVertexCount; i++) {
+      bool hasOriginal = false;
+      for (UINT o = 0; o < sharedCount && !hasOriginal; o++) {
+        hasOriginal = IsNear(welded[o].mPosition, welded[i].mPosition) &&
+          IsNear(welded[o].mUv.x - 1.0f, welded[i].mUv.x);
+      }
+      if (!hasOriginal) orphanCount++;
+    }
+    CHECK(orphanCount == 0);
+
+    /// Shared vertices are distinct
+    if (resolution > 4) continue;
+    UINT duplicateCount = 0;
+    for (UINT i = 0; i < sharedCount; i++) {
+      for (UINT o = i + 1; o < sharedCount; o++) {
+        if (IsNear(welded[i].mPosition, welded[o].mPosition)) duplicateCount++;
+      }
+    }
+    CHECK(duplicateCount == 0);
+  }
+
+  /// Flattened faces keep their own edge vertices for the hard edges
+  MakeReferenceGeosphere(0.5f, 1.0f, 4, vertices, indices);
+  const auto flattened = MakeGeosphere(4, 0.5f, 1.0f);
+  flattened->mWelded.SetDefaultValue(1.0f);
+  flattened->Update();
+  CHECK(flattened->GetMesh()->mVertexCount == vertices.size());
+  CHECK(flattened->GetMesh()->mIndexData == indices);
+}
@@ -0,0 +1,178 @@
+#include "test.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <set>
+
+namespace {
+  typedef std::multiset<std::vector<char>> TriangleSet;
+
+  /// Triangles by vertex content, rotated to start at the smallest corner, so
+  /// the set only changes if a triangle or its winding changes
+  TriangleSet GetTriangles(const std::vector<char>& vertices, UINT stride,
+    const std::vector<IndexEntry>& indices)
+  {
+    TriangleSet triangles;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+      std::vector<char> corners[3];
+      for (int c = 0; c < 3; c++) {
+        const char* vertex = &vertices[size_t(indices[i + c]) * stride];
+        corners[c].assign(vertex, vertex + stride);
+      }
+      int first = 0;
+      for (int c = 1; c < 3; c++) if (corners[c] < corners[first]) first = c;
+      std::vector<char> triangle;
+      for (int c = 0; c < 3; c++) {
+        const std::vector<char>& corner = corners[(first + c) % 3];
+        triangle.insert(triangle.end(), corner.begin(), corner.end());
+      }
+      triangles.insert(triangle);
+    }
+    return triangles;
+  }
+
+  TriangleSet GetTriangles(const Mesh& mesh) {
+    const char* raw = static_cast<const char*>(mesh.mRawVertexData);
+    const std::vector<char> vertices(raw, raw + mesh.mVertexCount * mesh.mFormat->mStride);
+    return GetTriangles(vertices, mesh.mFormat->mStride, mesh.mIndexData);
+  }
+
+  /// Copy of the mesh of a generator, with triangles in random order
+  std::shared_ptr<Mesh> MakeMesh(const std::shared_ptr<MeshNode>& node, bool shuffle) {
+    node->Update();
+    const std::shared_ptr<Mesh> source = node->GetMesh();
+    std::vector<IndexEntry> indices = source->mIndexData;
+    if (shuffle) {
+      const UINT triangleCount = UINT(indices.size() / 3);
+      std::vector<UINT> order(triangleCount);
+      for (UINT i = 0; i < triangleCount; i++) order[i] = i;
+      std::shuffle(order.begin(), order.end(), std::mt19937(1));
+      for (UINT i = 0; i < triangleCount; i++) {
+        for (int c = 0; c < 3; c++) indices[i * 3 + c] = source->mIndexData[order[i] * 3 + c];
+      }
+    }
+    auto mesh = std::make_shared<Mesh>();
+    mesh->AllocateVertices(source->mFormat, source->mVertexCount);
+    memcpy(mesh->mRawVertexData, source->mRawVertexData,
+      source->mVertexCount * source->mFormat->mStride);
+    mesh->UploadVertices(mesh->mRawVertexData);
+    mesh->AllocateIndices(UINT(indices.size()));
+    mesh->UploadIndices(indices.data());
+    return mesh;
+  }
+
+  std::shared_ptr<Mesh> MakeGeosphere(int resolution, bool shuffle) {
+    auto node = std::make_shared<GeosphereMeshNode>();
+    node->mResolution.SetDefaultValue(float(resolution));
+    node->mWelded.SetDefaultValue(1);
+    return MakeMesh(node, shuffle);
+  }
+
+  std::shared_ptr<Mesh> MakePlane(int resolution, bool shuffle) {
+    auto node = std::make_shared<PlaneMeshNode>();
+    node->mResolution.SetDefaultValue(float(resolution));
+    return MakeMesh(node, shuffle);
+  }
+
+  bool IsInFirstUseOrder(const std::vector<IndexEntry>& indices) {
+    IndexEntry next = 0;
+    for (IndexEntry index : indices) {
+      if (index > next) return false;
+      if (index == next) next++;
+    }
+    return true;
+  }
+
+  float GetACMR(const std::vector<IndexEntry>& indices, UINT vertexCount) {
+    return MeshOptimizer::AnalyzeVertexCache(indices, vertexCount).mACMR;
+  }
+
+  std::shared_ptr<Document> MakeDocument(const std::shared_ptr<Mesh>& mesh) {
+    auto meshNode = std::make_shared<StaticMeshNode>();
+    meshNode->Set(mesh);
+    auto graph = std::make_shared<Graph>();
+    graph->mNodes.Connect(meshNode);
+    auto document = std::make_shared<Document>();
+    document->mGraphs.Connect(graph);
+    return document;
+  }
+
+  std::shared_ptr<Mesh> GetMesh(const std::shared_ptr<Document>& document) {
+    for (const auto& graph : document->mGraphs.GetDirectMultiNodes()) {
+      for (const auto& node : PointerCast<Graph>(graph)->mNodes.GetDirectMultiNodes()) {
+        auto meshNode = std::dynamic_pointer_cast<StaticMeshNode>(node);
+        if (meshNode) return meshNode->GetMesh();
+      }
+    }
+    return nullptr;
+  }
+}
+
+TEST(OptimizeKeepsTriangles) {
+  for (bool shuffle : { false, true }) {
+    const std::shared_ptr<Mesh> mesh = MakeGeosphere(4, shuffle);
+    const TriangleSet triangles = GetTriangles(*mesh);
+    const float acmr = GetACMR(mesh->mIndexData, mesh->mVertexCount);
+    CHECK(MeshOptimizer::Optimize(*mesh));
+    CHECK(GetTriangles(*mesh) == triangles);
+    CHECK(IsInFirstUseOrder(mesh->mIndexData));
+    CHECK(GetACMR(mesh->mIndexData, mesh->mVertexCount) <= acmr);
+  }
+}
+
+TEST(OptimizeCopyLeavesMeshUnchanged) {
+  const std::shared_ptr<Mesh> mesh = MakePlane(4, true);
+  const std::vector<IndexEntry> indices = mesh->mIndexData;
+  const void* rawVertexData = mesh->mRawVertexData;
+  MeshOptimizer::OptimizedMesh optimized;
+  CHECK(MeshOptimizer::Optimize(*mesh, optimized));
+  CHECK(mesh->mIndexData == indices);
+  CHECK(mesh->mRawVertexData == rawVertexData);
+  CHECK(optimized.mVertices.size() == optimized.mVertexCount * mesh->mFormat->mStride);
+  CHECK(GetTriangles(optimized.mVertices, mesh->mFormat->mStride, optimized.mIndices) ==
+    GetTriangles(*mesh));
+}
+
+/// The .zenz save optimizes the saved meshes, not the ones in the document
+TEST(JsonSaveOptimizesCopies) {
+  const std::shared_ptr<Mesh> mesh = MakeGeosphere(3, true);
+  const std::vector<IndexEntry> indices = mesh->mIndexData;
+  const std::shared_ptr<Document> document = MakeDocument(mesh);
+  const std::string plain = ToJson(document, MeshArrayEncoding::BINARY);
+  const std::string optimized = ToJson(document, MeshArrayEncoding::BINARY,
+    BlobCompression::NONE, MeshOptimization::OPTIMIZE);
+  CHECK(mesh->mIndexData == indices);
+  CHECK(ToJson(document, MeshArrayEncoding::BINARY) == plain);
+  CHECK(optimized != plain);
+
+  const std::shared_ptr<Document> loaded = FromJson(optimized);
+  CHECK(loaded != nullptr);
+  if (!loaded) return;
+  const std::shared_ptr<Mesh> loadedMesh = GetMesh(loaded);
+  CHECK(loadedMesh != nullptr);
+  if (!loadedMesh) return;
+  CHECK(GetTriangles(*loadedMesh) == GetTriangles(*mesh));
+  CHECK(IsInFirstUseOrder(loadedMesh->mIndexData));
+}
+
+BENCHMARK(MeshOptimization) {
+  struct Case { const char* mName; std::shared_ptr<Mesh> mMesh; };
+  const Case cases[] = {
+    { "geosphere 5", MakeGeosphere(5, false) },
+    { "geosphere 8", MakeGeosphere(8, false) },
+    { "geosphere 8 shuffled", MakeGeosphere(8, true) },
+    { "plane 8", MakePlane(8, false) },
+    { "plane 8 shuffled", MakePlane(8, true) },
+  };
+  for (const Case& c : cases) {
+    const Mesh& mesh = *c.mMesh;
+    MeshOptimizer::OptimizedMesh optimized;
+    const double start = Test::GetTime();
+    MeshOptimizer::Optimize(mesh, optimized);
+    const double time = Test::GetTime() - start;
+    printf("  %s, %d triangles: ACMR %.3f -> %.3f, %.2f ms\n", c.mName,
+      int(mesh.mIndexData.size() / 3), GetACMR(mesh.mIndexData, mesh.mVertexCount),
+      GetACMR(optimized.mIndices, optimized.mVertexCount), time * 1000.0);
+  }
+}
@@ -0,0 +1,81 @@
+#include "test.h"
+
+namespace {
+  /// Geosphere welded by a tolerance node, then simplified
+  struct ProcessorChain {
+    std::shared_ptr<GeosphereMeshNode> mGeosphere;
+    std::shared_ptr<FloatNode> mTolerance;
+    std::shared_ptr<WeldMeshNode> mWeld;
+    std::shared_ptr<SimplifyMeshNode> mSimplify;
+
+    ProcessorChain() {
+      mGeosphere = std::make_shared<GeosphereMeshNode>();
+      mGeosphere->mResolution.SetDefaultValue(4);
+      mTolerance = std::make_shared<FloatNode>();
+      mTolerance->Set(0.001f);
+      mWeld = std::make_shared<WeldMeshNode>();
+      mWeld->mMeshSlot.Connect(mGeosphere);
+      mWeld->mTolerance.Connect(mTolerance);
+      mWeld->mPositionsOnly.SetDefaultValue(1);
+      mSimplify = std::make_shared<SimplifyMeshNode>();
+      mSimplify->mMeshSlot.Connect(mWeld);
+      mSimplify->mTriangleCount.SetDefaultValue(200);
+    }
+  };
+}
+
+/// The inputs outside of the evaluated nodes are read on the main thread
+TEST(ParallelMeshProcessingMatchesSerial) {
+  ProcessorChain serial;
+  serial.mSimplify->Update();
+
+  ParallelEvaluator evaluator(&ThreadPool::GetSharedPool());
+  ProcessorChain parallel;
+  evaluator.Update({ parallel.mWeld, parallel.mSimplify });
+
+  const std::shared_ptr<Mesh> expected = serial.mSimplify->GetMesh();
+  const std::shared_ptr<Mesh> mesh = parallel.mSimplify->GetMesh();
+  CHECK(mesh != nullptr);
+  if (!mesh) return;
+  CHECK(expected->mIndexCount > 0);
+  CHECK(expected->mIndexCount <= 200 * 3);
+  CHECK(mesh->mVertexCount == expected->mVertexCount);
+  CHECK(mesh->mIndexData == expected->mIndexData);
+  CHECK(serial.mWeld->GetMesh()->mVertexCount < serial.mGeosphere->GetMesh()->mVertexCount);
+}
+
+/// Scenes and documents evaluate their cached schedules, the processors must
+/// capture their inputs there too
+TEST(ScheduledMeshProcessingMatchesUpdate) {
+  ProcessorChain expected;
+  expected.mSimplify->Update();
+
+  ProcessorChain sceneChain;
+  auto drawable = std::make_shared<Drawable>();
+  drawable->mMesh.Connect(sceneChain.mSimplify);
+  auto scene = std::make_shared<SceneNode>();
+  scene->mDrawables.Connect(drawable);
+  scene->UpdateDependencies();
+
+  ProcessorChain documentChain;
+  auto graph = std::make_shared<Graph>();
+  graph->mNodes.Connect(documentChain.mTolerance);
+  graph->mNodes.Connect(documentChain.mGeosphere);
+  graph->mNodes.Connect(documentChain.mWeld);
+  graph->mNodes.Connect(documentChain.mSimplify);
+  auto document = std::make_shared<Document>();
+  document->mGraphs.Connect(graph);
+  document->UpdateDependencies(nullptr);
+
+  const std::shared_ptr<Mesh> expectedMesh = expected.mSimplify->GetMesh();
+  for (const ProcessorChain* chain : { &sceneChain, &documentChain }) {
+    const std::shared_ptr<Mesh> mesh = chain->mSimplify->GetMesh();
+    CHECK(mesh != nullptr);
+    if (!mesh) continue;
+    CHECK(mesh->mIndexCount > 0);
+    CHECK(mesh->mVertexCount == expectedMesh->mVertexCount);
+    CHECK(mesh->mIndexData == expectedMesh->mIndexData);
+    CHECK(chain->mWeld->GetMesh()->mVertexCount ==
+      expected.mWeld->GetMesh()->mVertexCount);
+  }
+}
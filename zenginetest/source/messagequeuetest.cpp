@@ -0,0 +1,305 @@
+#include "test.h"
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <set>
+#include <tuple>
+
+namespace {
+  /// Targets of the delivered messages, in order
+  std::vector<Node*> DeliveredTargets;
+
+  void RecordDelivery(Message* message) {
+    DeliveredTargets.push_back(message->mTarget.get());
+  }
+
+  UINT CountDeliveries(const std::shared_ptr<Node>& node) {
+    return UINT(std::count(DeliveredTargets.begin(), DeliveredTargets.end(), node.get()));
+  }
+
+  UINT FindFirstDelivery(const std::shared_ptr<Node>& node) {
+    return UINT(std::find(DeliveredTargets.begin(), DeliveredTargets.end(), node.get()) -
+      DeliveredTargets.begin());
+  }
+
+  /// Delivered messages, in order
+  std::vector<QueuedMessage> DeliveredMessages;
+
+  void RecordMessage(Message* message) {
+    DeliveredMessages.push_back({ message->mSource.get(), message->mTarget.get(),
+      message->mSlot, message->mType });
+  }
+
+  /// Sources, each one connected to its own sink
+  struct Pairs {
+    std::vector<std::shared_ptr<FloatNode>> mSources;
+    std::vector<std::shared_ptr<FloatToFloatNode>> mSinks;
+
+    explicit Pairs(UINT count) {
+      for (UINT i = 0; i < count; i++) {
+        mSources.push_back(std::make_shared<FloatNode>());
+        mSinks.push_back(std::make_shared<FloatToFloatNode>());
+        mSinks[i]->mX.Connect(mSources[i]);
+      }
+    }
+  };
+
+  /// FloatToFloatNodes connected one after the other, each one forwards 
+  /// VALUE_CHANGED to the next
+  struct Chain {
+    std::shared_ptr<FloatNode> mSource = std::make_shared<FloatNode>();
+    std::vector<std::shared_ptr<FloatToFloatNode>> mNodes;
+
+    explicit Chain(UINT length) {
+      std::shared_ptr<Node> previous = mSource;
+      for (UINT i = 0; i < length; i++) {
+        auto node = std::make_shared<FloatToFloatNode>();
+        node->mX.Connect(previous);
+        mNodes.push_back(node);
+        previous = node;
+      }
+    }
+
+    /// Destroyed from the end, otherwise every node would notify the rest
+    ~Chain() {
+      while (!mNodes.empty()) mNodes.pop_back();
+    }
+  };
+
+  /// Message of the former queue, with shared pointers
+  struct ReferenceMessage {
+    std::shared_ptr<Node> mSource;
+    std::shared_ptr<Node> mTarget;
+    Slot* mSlot;
+    MessageType mType;
+
+    bool operator < (const ReferenceMessage& other) const {
+      return std::tie(mTarget, mSource, mSlot, mType) <
+        std::tie(other.mTarget, other.mSource, other.mSlot, other.mType);
+    }
+  };
+
+  /// Passes a change down the chain with the containers of the former queue,
+  /// std::set for deduplication and std::deque for the order. Messages aren't
+  /// delivered to the nodes. Returns the number of messages.
+  UINT RunReferenceQueue(const Chain& chain) {
+    std::set<ReferenceMessage> messageSet;
+    std::deque<ReferenceMessage> messageQueue;
+    const auto enqueue = [&](const ReferenceMessage& message) {
+      if (messageSet.find(message) != messageSet.end()) return;
+      messageQueue.push_back(message);
+      messageSet.insert(message);
+    };
+    enqueue({ chain.mSource, chain.mNodes[0], &chain.mNodes[0]->mX,
+      MessageType::VALUE_CHANGED });
+
+    UINT count = 0;
+    while (!messageQueue.empty()) {
+      const ReferenceMessage message = messageQueue.front();
+      messageQueue.pop_front();
+      messageSet.erase(message);
+      count++;
+      for (Slot* slot : message.mTarget->GetDependants()) {
+        enqueue({ message.mTarget, slot->GetOwner(), slot, MessageType::VALUE_CHANGED });
+      }
+    }
+    return count;
+  }
+}
+
+/// The source feeds a chain and its end directly. In FIFO order the end 
+/// would forward the change twice, once for each path.
+TEST(BatchDeliversInTopologicalOrder) {
+  auto source = std::make_shared<FloatNode>();
+  auto first = std::make_shared<MaddNode>();
+  auto second = std::make_shared<MaddNode>();
+  auto last = std::make_shared<MaddNode>();
+  auto sink = std::make_shared<FloatToFloatNode>();
+  first->mA.Connect(source);
+  second->mA.Connect(first);
+  last->mA.Connect(second);
+  last->mB.Connect(source);
+  sink->mX.Connect(last);
+
+  DeliveredTargets.clear();
+  TheMessageQueue.mOnMessageDelivered += RecordDelivery;
+  TheMessageQueue.BeginBatch();
+  source->Set(2.0f);
+  TheMessageQueue.CommitBatch();
+  TheMessageQueue.mOnMessageDelivered -= RecordDelivery;
+
+  CHECK(CountDeliveries(first) == 1);
+  CHECK(CountDeliveries(second) == 1);
+  CHECK(CountDeliveries(last) == 2);
+  CHECK(CountDeliveries(sink) == 1);
+  CHECK(FindFirstDelivery(first) < FindFirstDelivery(second));
+  CHECK(FindFirstDelivery(second) < FindFirstDelivery(last));
+  CHECK(FindFirstDelivery(last) < FindFirstDelivery(sink));
+  CHECK(sink->Get() == 4.0f);
+}
+
+namespace {
+  /// Connects the sink to the node the first message of the batch goes to
+  std::shared_ptr<FloatToFloatNode> LateSink;
+
+  void ConnectLateSink(Message* message) {
+    if (LateSink == nullptr || LateSink->mX.GetReferencedNode()) return;
+    LateSink->mX.Connect(message->mTarget);
+  }
+}
+
+/// Levels are calculated once per batch, and again when delivery connects a
+/// node that has no level yet
+TEST(BatchRecalculatesLevelsAfterConnecting) {
+  auto source = std::make_shared<FloatNode>();
+  auto first = std::make_shared<FloatToFloatNode>();
+  auto second = std::make_shared<FloatToFloatNode>();
+  first->mX.Connect(source);
+  second->mX.Connect(first);
+  LateSink = std::make_shared<FloatToFloatNode>();
+
+  DeliveredTargets.clear();
+  TheMessageQueue.mOnMessageDelivered += ConnectLateSink;
+  TheMessageQueue.mOnMessageDelivered += RecordDelivery;
+  TheMessageQueue.BeginBatch();
+  source->Set(3.0f);
+  TheMessageQueue.CommitBatch();
+  TheMessageQueue.mOnMessageDelivered -= RecordDelivery;
+  TheMessageQueue.mOnMessageDelivered -= ConnectLateSink;
+
+  CHECK(LateSink->mX.GetReferencedNode() == first);
+  CHECK(CountDeliveries(second) == 1);
+  CHECK(FindFirstDelivery(first) < FindFirstDelivery(LateSink));
+  CHECK(LateSink->Get() == 3.0f);
+  LateSink.reset();
+}
+
+/// Nodes destroyed during the batch don't receive their messages
+TEST(BatchSkipsRemovedNodes) {
+  auto source = std::make_shared<FloatNode>();
+  auto kept = std::make_shared<FloatToFloatNode>();
+  auto removed = std::make_shared<FloatToFloatNode>();
+  kept->mX.Connect(source);
+  removed->mX.Connect(source);
+
+  DeliveredTargets.clear();
+  TheMessageQueue.mOnMessageDelivered += RecordDelivery;
+  TheMessageQueue.BeginBatch();
+  source->Set(1.0f);
+  Node* removedAddress = removed.get();
+  removed.reset();
+  TheMessageQueue.CommitBatch();
+  TheMessageQueue.mOnMessageDelivered -= RecordDelivery;
+
+  CHECK(CountDeliveries(kept) == 1);
+  CHECK(std::count(DeliveredTargets.begin(), DeliveredTargets.end(), removedAddress) == 0);
+}
+
+/// More messages than the initial ring and dedup table sizes. Every round
+/// empties the dedup table, stale entries would merge the next round's messages.
+TEST(QueueGrowsAndMergesDuplicates) {
+  const UINT count = 1000;
+  Pairs pairs(count);
+  for (int round = 0; round < 3; round++) {
+    DeliveredTargets.clear();
+    TheMessageQueue.ResetStatistics();
+    TheMessageQueue.mOnMessageDelivered += RecordDelivery;
+    TheMessageQueue.BeginBatch();
+    for (UINT i = 0; i < count; i++) {
+      pairs.mSources[i]->Set(float(round * 2 + 1));
+      pairs.mSources[i]->Set(float(round * 2 + 2));
+    }
+    TheMessageQueue.CommitBatch();
+    TheMessageQueue.mOnMessageDelivered -= RecordDelivery;
+
+    CHECK(TheMessageQueue.GetStatistics().mMergedCount == count);
+    CHECK(TheMessageQueue.GetStatistics().mDeliveredCount == count);
+    for (UINT i = 0; i < count; i++) CHECK(CountDeliveries(pairs.mSinks[i]) == 1);
+  }
+}
+
+/// Removed targets leave tombstones in the ring. Messages from removed sources
+/// are still delivered, without a source.
+TEST(QueueRemovesDestroyedNodes) {
+  const UINT count = 1000;
+  Pairs pairs(count);
+  std::vector<Node*> removedSinks;
+  std::vector<Node*> orphanedSinks;
+
+  DeliveredMessages.clear();
+  TheMessageQueue.mOnMessageDelivered += RecordMessage;
+  TheMessageQueue.BeginBatch();
+  for (UINT i = 0; i < count; i++) pairs.mSources[i]->Set(1.0f);
+  for (UINT i = 0; i < count; i++) {
+    if (i % 3 == 0) {
+      removedSinks.push_back(pairs.mSinks[i].get());
+      pairs.mSinks[i].reset();
+    }
+    else if (i % 3 == 1) {
+      orphanedSinks.push_back(pairs.mSinks[i].get());
+      pairs.mSources[i].reset();
+    }
+  }
+  TheMessageQueue.CommitBatch();
+  TheMessageQueue.mOnMessageDelivered -= RecordMessage;
+
+  for (const QueuedMessage& message : DeliveredMessages) {
+    CHECK(std::find(removedSinks.begin(), removedSinks.end(), message.mTarget) ==
+      removedSinks.end());
+  }
+  for (Node* sink : orphanedSinks) {
+    const auto it = std::find_if(DeliveredMessages.begin(), DeliveredMessages.end(),
+      [sink](const QueuedMessage& message) {
+      return message.mTarget == sink && message.mType == MessageType::VALUE_CHANGED;
+    });
+    CHECK(it != DeliveredMessages.end());
+    if (it != DeliveredMessages.end()) CHECK(it->mSource == nullptr);
+  }
+  for (UINT i = 2; i < count; i += 3) {
+    CHECK(std::count_if(DeliveredMessages.begin(), DeliveredMessages.end(),
+      [&](const QueuedMessage& message) {
+      return message.mTarget == pairs.mSinks[i].get() &&
+        message.mSource == pairs.mSources[i].get();
+    }) == 1);
+  }
+}
+
+/// A change travelling down a chain of 10k nodes, compared with the containers
+/// of the former std::set + std::deque queue. The reference doesn't deliver the
+/// messages, so it only measures queueing.
+BENCHMARK(MessageQueueChain) {
+  const UINT length = 10000;
+  const int repeatCount = 100;
+  Chain chain(length);
+
+  TheMessageQueue.ResetStatistics();
+  double start = Test::GetTime();
+  for (int i = 0; i < repeatCount; i++) chain.mSource->Set(float(i + 1));
+  const double queue = Test::GetTime() - start;
+  const UINT messageCount = TheMessageQueue.GetStatistics().mDeliveredCount;
+  CHECK(messageCount == length * repeatCount);
+
+  UINT referenceCount = 0;
+  start = Test::GetTime();
+  for (int i = 0; i < repeatCount; i++) referenceCount += RunReferenceQueue(chain);
+  const double reference = Test::GetTime() - start;
+  CHECK(referenceCount == messageCount);
+
+  printf("  %.2fM messages/s, reference containers %.2fM messages/s\n",
+    messageCount / queue * 1e-6, referenceCount / reference * 1e-6);
+
+  /// The same changes committed as batches, delivered level by level down
+  /// the whole depth of the chain
+  TheMessageQueue.ResetStatistics();
+  start = Test::GetTime();
+  for (int i = 0; i < repeatCount; i++) {
+    TheMessageQueue.BeginBatch();
+    chain.mSource->Set(float(i + 1));
+    TheMessageQueue.CommitBatch();
+  }
+  const double batched = Test::GetTime() - start;
+  const UINT batchedCount = TheMessageQueue.GetStatistics().mDeliveredCount;
+  CHECK(batchedCount == length * repeatCount);
+  printf("  batched, depth %u: %.2fM messages/s, %.3f ms per commit\n", length,
+    batchedCount / batched * 1e-6, batched / repeatCount * 1000.0);
+}
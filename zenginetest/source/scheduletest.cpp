@@ -0,0 +1,145 @@
+#include "test.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+  /// Counts its evaluations
+  class CountingNode: public FloatToFloatNode {
+  public:
+    UINT mOperateCount = 0;
+
+  protected:
+    void Operate() override {
+      mOperateCount++;
+      FloatToFloatNode::Operate();
+    }
+  };
+
+  /// Time ticks delivered to nodes, and edits delivered during time ticks
+  std::vector<Node*> TimeTickTargets;
+  UINT EditCount = 0;
+
+  void RecordTimeTick(Message* message) {
+    if (TheMessageQueue.IsDeliveringTimeTick()) {
+      TimeTickTargets.push_back(message->mTarget.get());
+    }
+    else EditCount++;
+  }
+
+  /// A scene with drawables scaled by a spline or by static values. Drawables
+  /// aren't properly connected without a mesh, they aren't evaluated.
+  struct TimedScene {
+    std::shared_ptr<SceneNode> mScene = std::make_shared<SceneNode>();
+    std::shared_ptr<FloatSplineNode> mSpline = std::make_shared<FloatSplineNode>();
+    std::shared_ptr<FloatNode> mValue = std::make_shared<FloatNode>();
+    std::vector<std::shared_ptr<CountingNode>> mTimedNodes;
+    std::vector<std::shared_ptr<CountingNode>> mStaticNodes;
+
+    TimedScene(UINT timedCount, UINT staticCount) {
+      mSpline->AddPoint(SplineLayer::BASE, 0.0f, 1.0f);
+      mSpline->AddPoint(SplineLayer::BASE, 4.0f, -3.0f);
+      mValue->Set(2.0f);
+      for (UINT i = 0; i < timedCount + staticCount; i++) {
+        auto node = std::make_shared<CountingNode>();
+        if (i < timedCount) {
+          node->mX.Connect(mSpline);
+          mTimedNodes.push_back(node);
+        } else {
+          node->mX.Connect(mValue);
+          mStaticNodes.push_back(node);
+        }
+        auto drawable = std::make_shared<Drawable>();
+        drawable->mScale.Connect(node);
+        mScene->mDrawables.Connect(drawable);
+      }
+
+      /// Collects the scene time nodes
+      mScene->mCamera.Connect(std::make_shared<CameraNode>());
+      mScene->UpdateDependencies();
+      mScene->Update();
+    }
+  };
+}
+
+/// Frame ticks only evaluate the nodes depending on time. Their messages are
+/// flagged as time ticks.
+TEST(TimeTickUpdatesTimeDependentNodes) {
+  TimedScene scene(3, 3);
+  UINT frameCount = 0;
+  for (float time : { 1.0f, 2.5f }) {
+    TimeTickTargets.clear();
+    EditCount = 0;
+    TheMessageQueue.mOnMessageDelivered += RecordTimeTick;
+    scene.mScene->SetSceneTime(time);
+    TheMessageQueue.mOnMessageDelivered -= RecordTimeTick;
+    frameCount++;
+
+    CHECK(EditCount == 0);
+    CHECK(!TimeTickTargets.empty());
+    for (const auto& node : scene.mTimedNodes) {
+      CHECK(node->mOperateCount == 1 + frameCount);
+      CHECK(node->GetCurrentValue() == scene.mSpline->GetValue(time));
+      CHECK(std::find(TimeTickTargets.begin(), TimeTickTargets.end(), node.get()) !=
+        TimeTickTargets.end());
+    }
+    for (const auto& node : scene.mStaticNodes) {
+      CHECK(node->mOperateCount == 1);
+      CHECK(std::find(TimeTickTargets.begin(), TimeTickTargets.end(), node.get()) ==
+        TimeTickTargets.end());
+    }
+  }
+
+  /// Edits aren't time ticks, and static nodes are evaluated again after them
+  EditCount = 0;
+  TheMessageQueue.mOnMessageDelivered += RecordTimeTick;
+  scene.mValue->Set(5.0f);
+  TheMessageQueue.mOnMessageDelivered -= RecordTimeTick;
+  CHECK(EditCount > 0);
+  scene.mScene->UpdateDependencies();
+  for (const auto& node : scene.mStaticNodes) {
+    CHECK(node->mOperateCount == 2);
+    CHECK(node->GetCurrentValue() == 5.0f);
+  }
+}
+
+/// CPU time of a frame tick in a scene where most nodes are static. The
+/// reference walks the whole schedule every frame, like scenes did before.
+BENCHMARK(TimeTickFrame) {
+  const UINT nodeCount = 5000;
+  const int frameCount = 1000;
+  for (UINT timedCount : { nodeCount / 100, nodeCount / 10, nodeCount }) {
+    TimedScene scene(timedCount, nodeCount - timedCount);
+    double start = Test::GetTime();
+    for (int i = 0; i < frameCount; i++) scene.mScene->SetSceneTime(i * 0.01f);
+    const double tick = (Test::GetTime() - start) / frameCount;
+
+    start = Test::GetTime();
+    for (int i = 0; i < frameCount; i++) {
+      scene.mScene->SetSceneTime(i * 0.01f + 5.0f);
+      scene.mScene->UpdateDependencies();
+    }
+    const double reference = (Test::GetTime() - start) / frameCount;
+
+    printf("  %u of %u nodes timed: %.3f ms/frame, full walk %.3f ms/frame\n",
+      timedCount, nodeCount, tick * 1000.0, reference * 1000.0);
+
+    /// Messages of a time tick committed as one batch, and of the same time
+    /// change sent without a batch. Both evaluate between the ticks, so the
+    /// nodes are up to date and forward the next change again.
+    TheMessageQueue.ResetStatistics();
+    for (int i = 0; i < frameCount; i++) scene.mScene->SetSceneTime(i * 0.01f);
+    const MessageQueue::Statistics batched = TheMessageQueue.GetStatistics();
+    TheMessageQueue.ResetStatistics();
+    for (int i = 0; i < frameCount; i++) {
+      scene.mSpline->mSceneTimeNode->Set(i * 0.01f + 5.0f);
+      scene.mScene->UpdateDependencies();
+    }
+    const MessageQueue::Statistics unbatched = TheMessageQueue.GetStatistics();
+    printf("    messages per tick: batched %.1f delivered, %.1f merged; "
+      "unbatched %.1f delivered, %.1f merged\n",
+      double(batched.mDeliveredCount) / frameCount,
+      double(batched.mMergedCount) / frameCount,
+      double(unbatched.mDeliveredCount) / frameCount,
+      double(unbatched.mMergedCount) / frameCount);
+  }
+}
@@ -0,0 +1,179 @@
+#include "test.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <thread>
+
+namespace {
+  const UINT SampleCount = 10000;
+  const float EndTime = 100.0f;
+
+  /// A spline with irregularly spaced points and some linear segments
+  std::shared_ptr<FloatSplineNode> MakeSpline() {
+    auto spline = std::make_shared<FloatSplineNode>();
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> step(0.01f, 3.0f);
+    std::uniform_real_distribution<float> value(-10.0f, 10.0f);
+    for (float time = 0.0f; time < EndTime; time += step(random)) {
+      const int index = spline->AddPoint(SplineLayer::BASE, time, value(random));
+      if (index % 5 == 0) spline->SetLinear(SplineLayer::BASE, index, true);
+    }
+    return spline;
+  }
+
+  /// Sample times in random order, including some outside the spline
+  std::vector<float> MakeRandomTimes(unsigned int seed) {
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> time(-10.0f, EndTime + 10.0f);
+    std::vector<float> times(SampleCount);
+    for (float& t : times) t = time(random);
+    return times;
+  }
+}
+
+TEST(SplineCursorMatchesSearch) {
+  const auto spline = MakeSpline();
+  const SplineFloatComponent* component = spline->GetComponent(SplineLayer::BASE);
+
+  /// A cursor left behind by an earlier lookup must not change the result
+  SplineCursor cursor;
+  for (float time : MakeRandomTimes(2)) {
+    CHECK(component->Get(time, cursor) == component->Get(time));
+  }
+
+  /// Sampling in increasing order, mostly on the cursor's segment
+  SplineCursor sequentialCursor;
+  for (UINT i = 0; i < SampleCount; i++) {
+    const float time = EndTime * float(i) / float(SampleCount);
+    CHECK(component->Get(time, sequentialCursor) == component->Get(time));
+  }
+
+  /// Point times themselves are the edge cases of the search
+  for (const SplinePoint& point : component->GetPoints()) {
+    CHECK(component->Get(point.mTime, cursor) == component->Get(point.mTime));
+  }
+}
+
+TEST(SplineBatchMatchesSingle) {
+  const auto spline = MakeSpline();
+  const std::vector<float> times = MakeRandomTimes(3);
+  std::vector<float> values(times.size());
+  spline->GetValues(&times[0], &values[0], UINT(times.size()));
+  for (UINT i = 0; i < UINT(times.size()); i++) {
+    CHECK(values[i] == spline->GetValue(times[i]));
+  }
+}
+
+/// Several threads sample the same spline out of order, each with its own 
+/// cursor, and must get the same results as sampling on a single thread
+TEST(SplineConcurrentEvaluation) {
+  const auto spline = MakeSpline();
+  const SplineFloatComponent* component = spline->GetComponent(SplineLayer::BASE);
+  const std::vector<float> times = MakeRandomTimes(4);
+
+  std::vector<float> expected(times.size());
+  for (UINT i = 0; i < UINT(times.size()); i++) {
+    expected[i] = spline->GetValue(times[i]);
+  }
+
+  const UINT threadCount = std::max(std::thread::hardware_concurrency(), 4u);
+  const UINT roundCount = 20;
+  std::vector<UINT> mismatchCounts(threadCount, 0);
+  std::vector<std::thread> threads;
+  for (UINT t = 0; t < threadCount; t++) {
+    threads.emplace_back([&, t]() {
+      std::vector<float> values(times.size());
+      for (UINT round = 0; round < roundCount; round++) {
+        /// Each thread starts at a different offset to interleave the lookups
+        SplineCursor cursor;
+        for (UINT i = 0; i < UINT(times.size()); i++) {
+          const UINT index = (i + t * 997 + round * 31) % UINT(times.size());
+          if (component->Get(times[index], cursor) != component->Get(times[index]) ||
+            spline->GetValue(times[index]) != expected[index]) {
+            mismatchCounts[t]++;
+          }
+        }
+        spline->GetValues(&times[0], &values[0], UINT(times.size()));
+        if (values != expected) mismatchCounts[t]++;
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+  for (UINT mismatchCount : mismatchCounts) CHECK(mismatchCount == 0);
+}
+
+/// Baking doubles the sample rate until the table is within the error limit.
+/// Times outside the table, and parameters driven by other nodes, fall back to
+/// the analytic curve.
+TEST(SplineBakeWithinError) {
+  auto spline = std::make_shared<FloatSplineNode>();
+  for (int i = 0; i <= int(EndTime) / 2; i++) {
+    spline->AddPoint(SplineLayer::BASE, float(i * 2), (i % 2) ? 1.0f : -1.0f);
+  }
+  const std::vector<float> times = MakeRandomTimes(5);
+  std::vector<float> expected(times.size());
+  for (UINT i = 0; i < UINT(times.size()); i++) {
+    expected[i] = spline->GetValue(times[i]);
+  }
+
+  const float maxError = 0.01f;
+  const float error = spline->Bake(EndTime, 1.0f, maxError);
+  CHECK(spline->IsBaked());
+  CHECK(error >= 0.0f && error <= maxError);
+  CHECK(spline->GetBakedSampleCount() > UINT(EndTime) + 1);
+  for (UINT i = 0; i < UINT(times.size()); i++) {
+    const float value = spline->GetValue(times[i]);
+    if (times[i] < 0.0f || times[i] >= EndTime) CHECK(value == expected[i]);
+    else CHECK(fabsf(value - expected[i]) <= maxError);
+  }
+
+  /// Connecting a parameter drops the table, and the spline can't be baked
+  auto noiseEnabled = std::make_shared<FloatNode>();
+  noiseEnabled->Set(0.0f);
+  spline->mNoiseEnabled.Connect(noiseEnabled);
+  CHECK(!spline->IsBaked());
+  for (UINT i = 0; i < UINT(times.size()); i++) {
+    CHECK(spline->GetValue(times[i]) == expected[i]);
+  }
+  CHECK(spline->Bake(EndTime, 1.0f, maxError) < 0.0f);
+  CHECK(!spline->IsBaked());
+
+  spline->mNoiseEnabled.Disconnect(noiseEnabled);
+  spline->Bake(EndTime, 1.0f, maxError);
+  CHECK(spline->IsBaked());
+}
+
+/// Samples per second of the batch API, compared with sampling one by one
+BENCHMARK(SplineBatchThroughput) {
+  const auto spline = MakeSpline();
+  const std::vector<float> randomTimes = MakeRandomTimes(6);
+  std::vector<float> sortedTimes(SampleCount);
+  for (UINT i = 0; i < SampleCount; i++) {
+    sortedTimes[i] = EndTime * float(i) / float(SampleCount);
+  }
+  const int repeatCount = 200;
+  std::vector<float> values(SampleCount);
+  std::vector<float> singleValues(SampleCount);
+
+  for (bool isSorted : { true, false }) {
+    const std::vector<float>& times = isSorted ? sortedTimes : randomTimes;
+    double start = Test::GetTime();
+    for (int r = 0; r < repeatCount; r++) {
+      spline->GetValues(&times[0], &values[0], SampleCount);
+    }
+    const double batch = Test::GetTime() - start;
+
+    start = Test::GetTime();
+    for (int r = 0; r < repeatCount; r++) {
+      for (UINT i = 0; i < SampleCount; i++) singleValues[i] = spline->GetValue(times[i]);
+    }
+    const double single = Test::GetTime() - start;
+    CHECK(values == singleValues);
+
+    const double sampleCount = double(SampleCount) * repeatCount;
+    printf("  %s times: %.1fM samples/s, one by one %.1fM samples/s\n",
+      isSorted ? "sorted" : "random",
+      sampleCount / batch * 1e-6, sampleCount / single * 1e-6);
+  }
+}
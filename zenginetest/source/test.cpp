@@ -0,0 +1,74 @@
+#include <Windows.h>
+#include <psapi.h>
+
+#include "test.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace {
+  /// Failed checks of the running case
+  int FailedCheckCount = 0;
+
+  std::atomic<size_t> AllocationCount(0);
+}
+
+/// Replaces the global allocator to count allocations, the engine library is
+/// linked statically so its allocations are counted too
+void* operator new(size_t size) {
+  AllocationCount++;
+  void* memory = malloc(size == 0 ? 1 : size);
+  if (memory == nullptr) throw std::bad_alloc();
+  return memory;
+}
+
+void operator delete(void* memory) noexcept {
+  free(memory);
+}
+
+std::vector<Test::Case>& Test::GetCases() {
+  static std::vector<Case> cases;
+  return cases;
+}
+
+Test::Registrar::Registrar(const char* name, Function function, bool isBenchmark) {
+  GetCases().push_back({ name, function, isBenchmark });
+}
+
+void Test::ReportFailure(const char* condition, const char* file, int line) {
+  printf("  %s(%d): check failed: %s\n", file, line, condition);
+  FailedCheckCount++;
+}
+
+int Test::RunAll(bool runBenchmarks) {
+  int failedCount = 0;
+  int runCount = 0;
+  for (const Case& testCase : GetCases()) {
+    if (testCase.mIsBenchmark && !runBenchmarks) continue;
+    printf("%s\n", testCase.mName);
+    FailedCheckCount = 0;
+    testCase.mFunction();
+    runCount++;
+    if (FailedCheckCount > 0) failedCount++;
+  }
+  printf("%d of %d passed\n", runCount - failedCount, runCount);
+  return failedCount;
+}
+
+size_t Test::GetAllocationCount() {
+  return AllocationCount;
+}
+
+size_t Test::GetPrivateBytes() {
+  PROCESS_MEMORY_COUNTERS_EX counters;
+  GetProcessMemoryInfo(GetCurrentProcess(),
+    reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&counters), sizeof(counters));
+  return counters.PrivateUsage;
+}
+
+double Test::GetTime() {
+  return std::chrono::duration<double>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
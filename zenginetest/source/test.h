@@ -0,0 +1,53 @@
+#pragma once
+
+#include <include/zengine.h>
+#include <vector>
+
+/// Minimal test framework. TEST() and BENCHMARK() register functions that
+/// main() runs in the order of registration. CHECK() reports failed conditions
+/// without stopping the test. Benchmarks only run with --benchmark, they print
+/// their measurements.
+namespace Test {
+  typedef void(*Function)();
+
+  struct Case {
+    const char* mName;
+    Function mFunction;
+    bool mIsBenchmark;
+  };
+
+  /// Registered cases
+  std::vector<Case>& GetCases();
+
+  struct Registrar {
+    Registrar(const char* name, Function function, bool isBenchmark);
+  };
+
+  void ReportFailure(const char* condition, const char* file, int line);
+
+  /// Runs the tests, and the benchmarks if asked. Returns the number of
+  /// failed tests.
+  int RunAll(bool runBenchmarks);
+
+  /// Seconds elapsed since an arbitrary point, for benchmarks
+  double GetTime();
+
+  /// Number of operator new calls since the start, for benchmarks
+  size_t GetAllocationCount();
+
+  /// Committed memory of the process that isn't shared, eg. not mapped files
+  size_t GetPrivateBytes();
+}
+
+#define TEST(name) \
+  static void name(); \
+  static const Test::Registrar name##Registrar(#name, name, false); \
+  static void name()
+
+#define BENCHMARK(name) \
+  static void name(); \
+  static const Test::Registrar name##Registrar(#name, name, true); \
+  static void name()
+
+#define CHECK(condition) \
+  ((condition) ? (void)0 : Test::ReportFailure(#condition, __FILE__, __LINE__))
@@ -0,0 +1,37 @@
+#include "test.h"
+#include <thread>
+
+TEST(ParallelForFromTasks) {
+  ThreadPool threadPool(4);
+  std::atomic<UINT> sum{ 0 };
+  threadPool.ParallelFor(16, [&](UINT i) {
+    threadPool.ParallelFor(100, [&](UINT k) { sum += i * 100 + k; });
+  });
+  CHECK(sum == 1600 * 1599 / 2);
+}
+
+/// A caller doesn't wait for the jobs of another caller
+TEST(ParallelForCallersAreIndependent) {
+  ThreadPool threadPool(4);
+  std::atomic<UINT> startedCount{ 0 };
+  std::atomic<bool> isOtherCallerDone{ false };
+  std::atomic<UINT> blockedCount{ 0 };
+
+  /// These jobs block until the other caller is done, or give up after a while
+  std::thread blockingCaller([&]() {
+    threadPool.ParallelFor(2, [&](UINT) {
+      startedCount++;
+      const double deadline = Test::GetTime() + 5.0;
+      while (!isOtherCallerDone && Test::GetTime() < deadline) std::this_thread::yield();
+      if (!isOtherCallerDone) blockedCount++;
+    });
+  });
+  while (startedCount < 2) std::this_thread::yield();
+
+  std::atomic<UINT> count{ 0 };
+  threadPool.ParallelFor(100, [&](UINT) { count++; });
+  isOtherCallerDone = true;
+  blockingCaller.join();
+  CHECK(count == 100);
+  CHECK(blockedCount == 0);
+}